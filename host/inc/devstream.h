@@ -0,0 +1,117 @@
+/*
+ * devstream.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Host side decoder of the text stream printed by the device in SYSTEM_ACC_DATA_PROCESSING state.
+ *      Bytes are fed as they arrive from the serial link and every complete sample line is reported
+ *      through a callback together with the host receive time of its terminating byte. Setup
+ *      changed while streaming is marked by line "@cfg #<sensor> <rate>Hz <range>g avg <n>" ahead of
+ *      the first sample taken with it and reported through a second callback.
+ */
+#ifndef HOST_INC_DEVSTREAM_H_
+#define HOST_INC_DEVSTREAM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* === exported defines === */
+#define DEVSTREAM_MAX_LINE_LEN          128
+
+/** sample flags */
+#define DEVSTREAM_FLAG_CLICK            0x01                                    /// click detection reported with this sample
+#define DEVSTREAM_FLAG_SENSOR_Pos       6                                       /// sensor index from "#n" line tag
+#define DEVSTREAM_FLAG_SENSOR_Msk       (0x3 << DEVSTREAM_FLAG_SENSOR_Pos)
+#define DEVSTREAM_SENSOR(flags)         (((flags) & DEVSTREAM_FLAG_SENSOR_Msk) >> DEVSTREAM_FLAG_SENSOR_Pos)
+
+/* === exported types === */
+/** decoded sample */
+struct devstream_Sample
+{
+    int64_t timeUs;                                                             /// host receive time in microseconds
+    int16_t x, y, z;                                                            /// acceleration in mili g
+    uint8_t flags;                                                              /// DEVSTREAM_FLAG_x bits
+};
+
+/** setup marker */
+struct devstream_Config
+{
+    int64_t timeUs;                                                             /// host receive time in microseconds
+    uint8_t sensor;
+    uint32_t rateMilliHz;
+    uint8_t fullScaleG;
+    uint16_t avgNumber;                                                         /// moving average length, 1 for none
+};
+
+/** called for every decoded sample */
+typedef void
+(*devstream_SampleCb) (const struct devstream_Sample *sample, void *ctx);
+
+/** called for every setup marker */
+typedef void
+(*devstream_ConfigCb) (const struct devstream_Config *config, void *ctx);
+
+/** stream decoder state */
+struct devstream_Parser
+{
+    char line[DEVSTREAM_MAX_LINE_LEN];                                          /// current line content
+    size_t len;                                                                 /// number of bytes in line
+    int64_t lineTimeUs;                                                         /// receive time of the last byte of line
+    uint64_t samples,                                                           /// number of decoded samples
+            configs,                                                            /// number of setup markers
+            malformed;                                                          /// number of dropped, not decodable lines
+    devstream_SampleCb cb;
+    devstream_ConfigCb configCb;                                                /// optional
+    void *ctx;
+};
+
+/* === exported functions === */
+/**
+ * @brief Initialise stream decoder.
+ * @param parser decoder state
+ * @param cb callback called for each decoded sample
+ * @param ctx user pointer passed to callback
+ */
+void
+devstream_init (struct devstream_Parser *parser, devstream_SampleCb cb,
+                void *ctx);
+
+/**
+ * @brief Set callback for setup markers, none by default.
+ * @param parser decoder state
+ * @param cb callback called for each setup marker, with ctx of @ref devstream_init()
+ */
+void
+devstream_setConfigCb (struct devstream_Parser *parser, devstream_ConfigCb cb);
+
+/**
+ * @brief Feed received bytes into decoder.
+ * @param parser decoder state
+ * @param data received bytes
+ * @param len number of received bytes
+ * @param rxTimeUs host time at which the bytes were received
+ */
+void
+devstream_feed (struct devstream_Parser *parser, const uint8_t *data,
+                size_t len, int64_t rxTimeUs);
+
+/**
+ * @brief Decode single line printed by the device.
+ * @param line null terminated line without leading '\r'
+ * @param sample decoded sample, timeUs is left untouched
+ * @return 1 if line contains sample, 0 otherwise
+ */
+int
+devstream_decodeLine (const char *line, struct devstream_Sample *sample);
+
+/**
+ * @brief Decode setup marker line.
+ * @param line null terminated line without leading '\r'
+ * @param config decoded setup, timeUs is left untouched
+ * @return 1 if line is setup marker, 0 otherwise
+ */
+int
+devstream_decodeConfig (const char *line, struct devstream_Config *config);
+
+#endif /* HOST_INC_DEVSTREAM_H_ */
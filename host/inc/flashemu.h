@@ -0,0 +1,82 @@
+/*
+ * flashemu.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      File backed emulator of internal NOR flash for the firmware profile store. Follows
+ *      STM32F3 rules: erase sets page to 0xFF, half word can be programmed only when erased
+ *      or to zero. Power loss can be injected after given number of written bytes.
+ */
+#ifndef HOST_INC_FLASHEMU_H_
+#define HOST_INC_FLASHEMU_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "profile.h"
+
+/* === exported defines === */
+#define FLASHEMU_MAX_PAGES              16
+
+/* === exported types === */
+struct flashemu_Stats
+{
+    uint32_t erases[FLASHEMU_MAX_PAGES];                                        /// erase count per page
+    uint64_t programmedBytes;
+    uint32_t powerCuts;
+    uint32_t programErrors;                                                     /// writes to not erased half word
+};
+
+/* === exported functions === */
+/**
+ * @brief Open flash image file, created erased if it does not exist.
+ * @param path image file path
+ * @param pageSize page size in bytes
+ * @param numOfPages number of pages
+ * @return 0 on success, -1 on failure with errno set
+ */
+int
+flashemu_open (const char *path, uint32_t pageSize, uint8_t numOfPages);
+
+/**
+ * @brief Unmap and close flash image.
+ */
+void
+flashemu_close (void);
+
+/**
+ * @brief Get flash area for @ref profile_init().
+ * @return flash area
+ */
+const struct profile_Flash*
+flashemu_getArea (void);
+
+/**
+ * @brief Cut power after given number of bytes is erased or programmed. All operations fail afterwards
+ *        until @ref flashemu_powerOn().
+ * @param bytes bytes until power loss, negative to disable
+ */
+void
+flashemu_cutPowerAfter (int64_t bytes);
+
+/**
+ * @brief Check if injected power loss happened.
+ * @return true after power loss
+ */
+bool
+flashemu_isPowerLost (void);
+
+/**
+ * @brief Restore power, disables power loss injection.
+ */
+void
+flashemu_powerOn (void);
+
+/**
+ * @brief Get emulator statistics.
+ * @return statistics since open
+ */
+const struct flashemu_Stats*
+flashemu_getStats (void);
+
+#endif /* HOST_INC_FLASHEMU_H_ */
@@ -0,0 +1,197 @@
+/*
+ * record.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Chunked columnar recording file for long accelerometer captures.
+ *
+ *      File layout (little endian):
+ *          struct record_FileHeader
+ *          chunk 0: struct record_ChunkHeader, columns t[], x[], y[], z[], flags[], padding to 8 bytes
+ *          ...
+ *          chunk N-1
+ *          index:   struct record_ChunkInfo[N]
+ *          struct record_Trailer
+ *
+ *      Every chunk header repeats its index entry, so a file which was not closed properly
+ *      (missing index) can still be read by walking chunk headers.
+ *      Readers memory-map the file and use chunk time ranges and per-axis min/max/sum to touch
+ *      only chunks which are relevant for a query.
+ */
+#ifndef HOST_INC_RECORD_H_
+#define HOST_INC_RECORD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "devstream.h"
+
+/* === exported defines === */
+#define RECORD_FILE_MAGIC               "ACCREC01"
+#define RECORD_INDEX_MAGIC              "ACCIDX01"
+#define RECORD_CHUNK_MAGIC              0x4B4E4843UL                            /// "CHNK"
+#define RECORD_VERSION                  1
+#define RECORD_DEFAULT_CHUNK_LEN        4096                                    /// samples per chunk
+#define RECORD_AXES                     3
+
+/* === exported types === */
+/** file header */
+struct record_FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t chunkCapacity;                                                     /// max number of samples in chunk
+};
+
+/** chunk summary, stored in chunk header and in index footer */
+struct record_ChunkInfo
+{
+    uint64_t offset;                                                            /// file offset of struct record_ChunkHeader
+    uint32_t count;                                                             /// number of samples
+    uint32_t flagsMask;                                                         /// OR of all sample flags in chunk
+    int64_t t0Us, t1Us;                                                         /// time of first and last sample
+    int16_t min[RECORD_AXES], max[RECORD_AXES];                                 /// per axis extremes in mili g
+    uint32_t reserved;
+    int64_t sum[RECORD_AXES];                                                   /// per axis sum in mili g
+};
+
+/** chunk header */
+struct record_ChunkHeader
+{
+    uint32_t magic;
+    uint32_t size;                                                              /// chunk size in bytes including header
+    struct record_ChunkInfo info;
+};
+
+/** last bytes of properly closed file */
+struct record_Trailer
+{
+    uint64_t indexOffset;                                                       /// file offset of index
+    uint64_t numOfChunks;
+    char magic[8];
+};
+
+/** column pointers of single chunk */
+struct record_Columns
+{
+    const int64_t *t;
+    const int16_t *x, *y, *z;
+    const uint8_t *flags;
+    uint32_t count;
+};
+
+/** file writer */
+struct record_Writer
+{
+    FILE *file;
+    uint64_t offset;                                                            /// current file offset
+    uint32_t chunkCapacity;
+    struct record_ChunkInfo current;                                            /// summary of chunk being filled
+    int64_t *t;                                                                 /// column buffers of chunk being filled
+    int16_t *x, *y, *z;
+    uint8_t *flags;
+    struct record_ChunkInfo *index;                                             /// summaries of written chunks
+    size_t numOfChunks, indexCapacity;
+};
+
+/** memory mapped file reader */
+struct record_Reader
+{
+    const uint8_t *base;
+    size_t size;
+    const struct record_ChunkInfo *index;
+    size_t numOfChunks;
+    struct record_ChunkInfo *recovered;                                         /// index rebuilt from chunk headers if trailer missing
+    uint64_t chunksTouched;                                                     /// number of chunks whose columns were accessed
+};
+
+/** called for every sample returned by a query */
+typedef void
+(*record_QueryCb) (const struct devstream_Sample *sample, void *ctx);
+
+/* === exported functions === */
+/**
+ * @brief Create new recording file.
+ * @param writer writer state
+ * @param path file path
+ * @param chunkCapacity number of samples per chunk, 0 for default
+ * @return 0 on success, -1 on failure
+ */
+int
+record_create (struct record_Writer *writer, const char *path,
+               uint32_t chunkCapacity);
+
+/**
+ * @brief Append sample. Samples must be appended in time order.
+ * @return 0 on success, -1 on write failure
+ */
+int
+record_append (struct record_Writer *writer,
+               const struct devstream_Sample *sample);
+
+/**
+ * @brief Write partially filled chunk to file so that it survives a crash.
+ * @return 0 on success, -1 on write failure
+ */
+int
+record_flush (struct record_Writer *writer);
+
+/**
+ * @brief Write last chunk and index footer, close file.
+ * @return 0 on success, -1 on write failure
+ */
+int
+record_close (struct record_Writer *writer);
+
+/**
+ * @brief Map recording file. If index footer is missing, index is rebuilt from chunk headers.
+ * @return 0 on success, -1 on failure
+ */
+int
+record_open (struct record_Reader *reader, const char *path);
+
+/**
+ * @brief Unmap recording file.
+ */
+void
+record_release (struct record_Reader *reader);
+
+/**
+ * @brief Get column pointers of given chunk.
+ * @return 0 on success, -1 if chunk is corrupted
+ */
+int
+record_getColumns (struct record_Reader *reader, size_t chunk,
+                   struct record_Columns *columns);
+
+/**
+ * @brief Call cb for every sample with t0Us <= timeUs <= t1Us. Only overlapping chunks are touched.
+ * @return number of returned samples
+ */
+uint64_t
+record_query (struct record_Reader *reader, int64_t t0Us, int64_t t1Us,
+              record_QueryCb cb, void *ctx);
+
+/**
+ * @brief Find sample with the highest acceleration magnitude in given time range.
+ *        Chunks which can not contain a higher magnitude than already found are skipped
+ *        based on their per axis min/max.
+ * @param result sample with the highest magnitude
+ * @return 1 if any sample found, 0 otherwise
+ */
+int
+record_findMaxMagnitude (struct record_Reader *reader, int64_t t0Us,
+                         int64_t t1Us, struct devstream_Sample *result);
+
+/**
+ * @brief Get per axis min, max and mean in given time range. Chunks fully inside the range
+ *        are summarised from their headers only.
+ * @return number of samples in range
+ */
+uint64_t
+record_getAxisStats (struct record_Reader *reader, int64_t t0Us,
+                     int64_t t1Us, int16_t min[RECORD_AXES],
+                     int16_t max[RECORD_AXES], double mean[RECORD_AXES]);
+
+#endif /* HOST_INC_RECORD_H_ */
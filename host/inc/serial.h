@@ -0,0 +1,42 @@
+/*
+ * serial.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Opening of serial port connected to the device CLI and host time helpers.
+ */
+#ifndef HOST_INC_SERIAL_H_
+#define HOST_INC_SERIAL_H_
+
+#include <stdint.h>
+
+/* === exported defines === */
+#define SERIAL_DEFAULT_BAUD             460800                                  /// baud rate set in UART_Init()
+
+/* === exported functions === */
+/**
+ * @brief Open serial port in raw 8N1 mode.
+ * @param path device path, e.g. /dev/ttyACM0
+ * @param baud baud rate
+ * @param nonBlocking non zero to open port in non blocking mode
+ * @return file descriptor or -1 on failure
+ */
+int
+serial_open (const char *path, uint32_t baud, int nonBlocking);
+
+/**
+ * @brief Get host wall clock time.
+ * @return microseconds since epoch
+ */
+int64_t
+serial_getTimeUs (void);
+
+/**
+ * @brief Get host monotonic time.
+ * @return microseconds since arbitrary point
+ */
+int64_t
+serial_getMonotonicUs (void);
+
+#endif /* HOST_INC_SERIAL_H_ */
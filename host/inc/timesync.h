@@ -0,0 +1,123 @@
+/*
+ * timesync.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Host side of time synchronisation with the device, NTP like. Host sends its time t1 in
+ *      request "<0x02>sync <t1>\r", device answers "sync <t1> <t2> <t3 - t2>" with its receive time t2
+ *      in seconds and microseconds and the time until the reply started. Host receive time is t4.
+ *      Each exchange gives round trip delay (t4 - t1) - (t3 - t2) and clock offset at device time
+ *      (t2 + t3) / 2. Offset and drift are fitted by least squares over the exchanges of a sliding
+ *      window with round trip in the lowest quarter, so USB scheduling outliers do not count and drift
+ *      is tracked over long runs. Transmission time of request and reply bytes is taken out of the
+ *      exchange, so only the link latency, the same in both directions, remains.
+ */
+#ifndef HOST_INC_TIMESYNC_H_
+#define HOST_INC_TIMESYNC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* === exported defines === */
+#define TIMESYNC_WINDOW_LEN             128
+#define TIMESYNC_REQUEST_MAX_LEN        32
+#define TIMESYNC_MARK                   0x02                                    /// CLI_SYNC_MARK of firmware
+
+/* === exported types === */
+/** one request and reply, all in microseconds */
+struct timesync_Exchange
+{
+    int64_t t1;                                                                 /// host time when request was sent
+    int64_t t2;                                                                 /// device time when request was received
+    int64_t t3;                                                                 /// device time when reply was sent
+    int64_t t4;                                                                 /// host time when reply was received
+};
+
+/** fitted relation host = device + offset + drift * (device - reference) */
+struct timesync_Estimate
+{
+    int64_t refDeviceUs;                                                        /// device time offset refers to
+    double offsetUs;                                                            /// host minus device time at refDeviceUs
+    double driftPpm;                                                            /// host clock rate over device clock rate minus 1
+    double residualUs;                                                          /// rms distance of used exchanges from fit
+    double minDelayUs;                                                          /// smallest round trip in window
+    uint32_t used;                                                              /// exchanges in fit
+};
+
+/** exchange window */
+struct timesync_State
+{
+    struct timesync_Exchange window[TIMESYNC_WINDOW_LEN];
+    uint32_t head;                                                              /// next entry to write
+    uint32_t count;                                                             /// valid entries
+    double charUs;                                                              /// wire time of one character, 0 for none
+    uint64_t exchanges;                                                         /// replies accepted
+};
+
+/* === exported functions === */
+/**
+ * @brief Initialise exchange window.
+ * @param state exchange window
+ * @param baud baud rate of link, 0 to skip compensation of byte transmission time
+ */
+void
+timesync_init (struct timesync_State *state, uint32_t baud);
+
+/**
+ * @brief Build request.
+ * @param buf output, at least TIMESYNC_REQUEST_MAX_LEN long
+ * @param t1 host time of sending, non negative
+ * @return request length without terminating zero
+ */
+size_t
+timesync_formatRequest (char *buf, int64_t t1);
+
+/**
+ * @brief Decode reply line.
+ * @param line zero terminated line without line end characters
+ * @param exchange t1, t2 and t3 of reply, t4 is left untouched
+ * @return 1 if line is sync reply, 0 otherwise
+ */
+int
+timesync_parseReply (const char *line, struct timesync_Exchange *exchange);
+
+/**
+ * @brief Decode reply line and add its exchange to window.
+ * @param state exchange window
+ * @param line zero terminated line without line end characters
+ * @param t4 host time at which line end was received
+ * @return 1 if line is sync reply, 0 otherwise
+ */
+int
+timesync_onReply (struct timesync_State *state, const char *line, int64_t t4);
+
+/**
+ * @brief Add exchange to window, oldest one is dropped when window is full.
+ * @param state exchange window
+ * @param exchange exchange with byte transmission time already taken out
+ */
+void
+timesync_add (struct timesync_State *state,
+              const struct timesync_Exchange *exchange);
+
+/**
+ * @brief Fit offset and drift over window.
+ * @param state exchange window
+ * @param estimate fit result
+ * @return 0 on success, -1 without any exchange
+ */
+int
+timesync_getEstimate (const struct timesync_State *state,
+                      struct timesync_Estimate *estimate);
+
+/**
+ * @brief Map device time to host time.
+ * @param estimate fit result
+ * @param deviceUs device time in microseconds
+ * @return host time in microseconds
+ */
+int64_t
+timesync_toHostUs (const struct timesync_Estimate *estimate, int64_t deviceUs);
+
+#endif /* HOST_INC_TIMESYNC_H_ */
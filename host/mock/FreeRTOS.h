@@ -0,0 +1,16 @@
+/*
+ * FreeRTOS.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Host replacement of FreeRTOS.h, see task.h.
+ */
+#ifndef MOCK_FREERTOS_H_
+#define MOCK_FREERTOS_H_
+
+#include <stdint.h>
+
+typedef long BaseType_t;
+
+#endif /* MOCK_FREERTOS_H_ */
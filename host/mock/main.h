@@ -0,0 +1,19 @@
+/*
+ * main.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Host replacement of firmware main.h for building driver modules against register mocks.
+ *      Only what the drivers use from the HAL is provided.
+ */
+#ifndef MOCK_MAIN_H_
+#define MOCK_MAIN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* firmware is built without USE_FULL_ASSERT */
+#define assert_param(expr)              ((void)0U)
+
+#endif /* MOCK_MAIN_H_ */
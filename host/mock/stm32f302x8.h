@@ -0,0 +1,110 @@
+/*
+ * stm32f302x8.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Host replacement of the CMSIS device header for the I2C driver. Register blocks are plain
+ *      structures; I2C2 and GPIOA expand to calls into the check program, which advances its bus
+ *      model before every register access, so flags appear and clear as the driver polls them.
+ *      Bit values are the ones of RM0365.
+ */
+#ifndef MOCK_STM32F302X8_H_
+#define MOCK_STM32F302X8_H_
+
+#include <stdint.h>
+
+/* === register blocks === */
+typedef struct
+{
+    volatile uint32_t CR1, CR2, OAR1, OAR2, TIMINGR, TIMEOUTR, ISR, ICR, PECR,
+            RXDR, TXDR;
+} I2C_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t MODER, OTYPER, OSPEEDR, PUPDR, IDR, ODR, BSRR, LCKR,
+            AFR[2], BRR;
+} GPIO_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CR, CFGR, CIR, APB2RSTR, APB1RSTR, AHBENR, APB2ENR,
+            APB1ENR, BDCR, CSR, AHBRSTR, CFGR2, CFGR3;
+} RCC_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CFGR1, RCR, EXTICR[4], CFGR2;
+} SYSCFG_TypeDef;
+
+I2C_TypeDef*
+mock_i2c (void);
+
+GPIO_TypeDef*
+mock_gpioA (void);
+
+extern RCC_TypeDef mock_rcc;
+extern SYSCFG_TypeDef mock_syscfg;
+extern uint32_t SystemCoreClock;
+
+#define I2C2                            (mock_i2c ())
+#define GPIOA                           (mock_gpioA ())
+#define RCC                             (&mock_rcc)
+#define SYSCFG                          (&mock_syscfg)
+
+/* === I2C === */
+#define I2C_CR1_PE                      (1UL << 0)
+#define I2C_CR1_NOSTRETCH               (1UL << 17)
+
+#define I2C_CR2_SADD                    (0x3FFUL)
+#define I2C_CR2_RD_WRN                  (1UL << 10)
+#define I2C_CR2_START                   (1UL << 13)
+#define I2C_CR2_STOP                    (1UL << 14)
+#define I2C_CR2_NBYTES_Pos              (16U)
+#define I2C_CR2_NBYTES                  (0xFFUL << I2C_CR2_NBYTES_Pos)
+#define I2C_CR2_AUTOEND                 (1UL << 25)
+
+#define I2C_ISR_TXE                     (1UL << 0)
+#define I2C_ISR_TXIS                    (1UL << 1)
+#define I2C_ISR_RXNE                    (1UL << 2)
+#define I2C_ISR_NACKF                   (1UL << 4)
+#define I2C_ISR_STOPF                   (1UL << 5)
+#define I2C_ISR_TC                      (1UL << 6)
+#define I2C_ISR_BERR                    (1UL << 8)
+#define I2C_ISR_ARLO                    (1UL << 9)
+#define I2C_ISR_BUSY                    (1UL << 15)
+
+#define I2C_ICR_NACKCF                  (1UL << 4)
+#define I2C_ICR_STOPCF                  (1UL << 5)
+#define I2C_ICR_BERRCF                  (1UL << 8)
+#define I2C_ICR_ARLOCF                  (1UL << 9)
+
+/* === GPIO === */
+#define GPIO_MODER_MODER9_Pos           (18U)
+#define GPIO_MODER_MODER9               (0x3UL << GPIO_MODER_MODER9_Pos)
+#define GPIO_MODER_MODER10_Pos          (20U)
+#define GPIO_MODER_MODER10              (0x3UL << GPIO_MODER_MODER10_Pos)
+#define GPIO_OTYPER_OT_9                (1UL << 9)
+#define GPIO_OTYPER_OT_10               (1UL << 10)
+#define GPIO_PUPDR_PUPDR9_Pos           (18U)
+#define GPIO_PUPDR_PUPDR10_Pos          (20U)
+#define GPIO_AFRH_AFRH1_Pos             (4U)
+#define GPIO_AFRH_AFRH2_Pos             (8U)
+#define GPIO_IDR_9                      (1UL << 9)
+#define GPIO_IDR_10                     (1UL << 10)
+#define GPIO_BSRR_BS_9                  (1UL << 9)
+#define GPIO_BSRR_BS_10                 (1UL << 10)
+#define GPIO_BSRR_BR_9                  (1UL << 25)
+#define GPIO_BSRR_BR_10                 (1UL << 26)
+#define GPIO_AF4_I2C2                   (0x04UL)
+
+/* === RCC and SYSCFG === */
+#define RCC_AHBENR_GPIOAEN              (1UL << 17)
+#define RCC_APB1RSTR_I2C2RST            (1UL << 22)
+#define RCC_APB1ENR_I2C2EN              (1UL << 22)
+#define RCC_APB2ENR_SYSCFGEN            (1UL << 0)
+#define RCC_CFGR3_I2C2SW_SYSCLK         (1UL << 5)
+#define SYSCFG_CFGR1_I2C2_FMP           (1UL << 21)
+
+#endif /* MOCK_STM32F302X8_H_ */
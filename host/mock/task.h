@@ -0,0 +1,21 @@
+/*
+ * task.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Host replacement of FreeRTOS task.h. Scheduler suspension is implemented by the check
+ *      program, so it can verify that register sequences run with the scheduler suspended.
+ */
+#ifndef MOCK_TASK_H_
+#define MOCK_TASK_H_
+
+#include "FreeRTOS.h"
+
+void
+vTaskSuspendAll (void);
+
+BaseType_t
+xTaskResumeAll (void);
+
+#endif /* MOCK_TASK_H_ */
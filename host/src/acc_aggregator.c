@@ -0,0 +1,623 @@
+/*
+ * acc_aggregator.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Host daemon attaching to many devices at once and producing one time ordered stream.
+ *
+ *          acc_aggregator [-w workers] [-r nominal rate Hz] [-d merge delay ms] [-i report period s] port...
+ *
+ *      One thread waits on all serial ports with a single epoll loop and hands received byte
+ *      chunks to parsing workers (device i is owned by worker i % workers). Workers decode the
+ *      stream and map every sample to a common time base with a per link clock model:
+ *
+ *          alignedTime = offset + sampleIndex * period
+ *
+ *      The offset follows the lower envelope of (receive time - sampleIndex * period), so USB and
+ *      scheduling delays which only ever add latency do not bias it, and the period is refined from
+ *      the observed sample rate so that clock drift of every board is tracked. A setup marker of a
+ *      rate change while streaming starts the model again from the new nominal period, continuing
+ *      at the aligned time of the last sample.
+ *      A merger thread performs a k-way merge (binary heap keyed by the head sample of every
+ *      device) and writes "time us,device,x,y,z,flags" lines to stdout once all active devices
+ *      have passed the merge watermark. Per device lag and drop counters are reported on stderr.
+ */
+#define _GNU_SOURCE
+#include "devstream.h"
+#include "serial.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/* === private defines === */
+#define MAX_DEVICES                     64
+#define MAX_WORKERS                     16
+#define RX_CHUNK_LEN                    512
+#define RX_RING_LEN                     256                                     /// byte chunks waiting for worker
+#define SAMPLE_RING_LEN                 8192                                    /// samples waiting for merge
+#define DEFAULT_RATE_HZ                 400.0
+#define DEFAULT_MERGE_DELAY_MS          50
+#define DEFAULT_REPORT_PERIOD_S         5
+#define MERGE_PERIOD_US                 5000
+#define IDLE_TIMEOUT_US                 500000                                  /// silent device does not hold watermark
+#define PERIOD_WINDOW                   1024                                    /// samples used for single period estimate
+#define LOCK_WINDOW                     64                                      /// samples used for first period estimate
+#define PERIOD_SMOOTHING                0.2
+#define OFFSET_LEAK                     0.001                                   /// upward drift of lower envelope per sample
+
+/* === private types === */
+struct RxChunk
+{
+    int64_t timeUs;
+    uint16_t len;
+    uint8_t data[RX_CHUNK_LEN];
+};
+
+struct MergedSample
+{
+    int64_t timeUs;                                                             /// aligned time
+    int16_t x, y, z;
+    uint8_t flags;
+};
+
+/** link clock model */
+struct ClockModel
+{
+    uint64_t index;                                                             /// number of samples received
+    double nominalRateHz;                                                       /// -r option or rate of last setup marker
+    double periodUs;
+    double offsetUs;
+    bool synced,                                                                /// model initialised
+            locked;                                                             /// period measured at least once
+    int64_t windowStartUs;
+    uint64_t windowStartIndex;
+};
+
+struct Device
+{
+    int id, fd;
+    const char *path;
+    struct devstream_Parser parser;
+    struct ClockModel clock;
+    /* i/o thread -> worker */
+    pthread_mutex_t rxLock;
+    struct RxChunk rxRing[RX_RING_LEN];
+    size_t rxHead, rxCount;
+    /* worker -> merger */
+    pthread_mutex_t sampleLock;
+    struct MergedSample sampleRing[SAMPLE_RING_LEN];
+    size_t sampleHead, sampleCount;
+    int64_t lastAlignedUs, lastRxUs;
+    /* statistics */
+    uint64_t merged, rxOverflows, sampleOverflows, lateSamples;
+    int64_t lastLagUs, maxLagUs;
+    bool closed;
+};
+
+struct Worker
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool pending;
+    int index;
+};
+
+/* === private variables === */
+static struct Base
+{
+    struct Device *devices;
+    int numOfDevices;
+    struct Worker workers[MAX_WORKERS];
+    int numOfWorkers;
+    double nominalRateHz;
+    int64_t mergeDelayUs;
+    int64_t watermarkUs;                                                        /// time of last merged sample
+    volatile sig_atomic_t stopRequested;
+} base;
+
+/* === private functions === */
+static void
+onSignal (int sig)
+{
+    (void) sig;
+    base.stopRequested = 1;
+}
+
+static void
+clockModelUpdate (struct ClockModel *clock, int64_t rxUs)
+{
+    if (!clock->synced)
+        {
+            clock->periodUs = 1e6 / clock->nominalRateHz;
+            clock->offsetUs = rxUs - clock->index * clock->periodUs;
+            clock->windowStartUs = rxUs;
+            clock->windowStartIndex = clock->index;
+            clock->synced = true;
+        }
+
+    /* lower envelope of receive time, slowly leaking upwards */
+    double residual = rxUs - (clock->offsetUs
+            + clock->index * clock->periodUs);
+    if (residual < 0)
+        {
+            clock->offsetUs += residual;
+        }
+    else
+        {
+            clock->offsetUs += residual * OFFSET_LEAK;
+        }
+
+    /* refine period from observed rate, keep aligned time continuous */
+    uint64_t window = clock->locked ? PERIOD_WINDOW : LOCK_WINDOW;
+    if (clock->index - clock->windowStartIndex >= window)
+        {
+            double observed = (double) (rxUs - clock->windowStartUs)
+                    / (clock->index - clock->windowStartIndex);
+            if (clock->locked)
+                {
+                    double period = clock->periodUs
+                            + PERIOD_SMOOTHING * (observed - clock->periodUs);
+                    double aligned = clock->offsetUs
+                            + clock->index * clock->periodUs;
+                    clock->periodUs = period;
+                    clock->offsetUs = aligned - clock->index * period;
+                }
+            else
+                {
+                    /* nominal rate may be far off, restart envelope with measured period */
+                    clock->periodUs = observed;
+                    clock->offsetUs = rxUs - clock->index * observed;
+                    clock->locked = true;
+                }
+            clock->windowStartUs = rxUs;
+            clock->windowStartIndex = clock->index;
+        }
+}
+
+/* called by devstream from worker thread, samples after marker come at the new rate */
+static void
+onConfig (const struct devstream_Config *config, void *ctx)
+{
+    struct Device *dev = ctx;
+
+    if (config->rateMilliHz > 0
+            && config->rateMilliHz / 1000.0 != dev->clock.nominalRateHz)
+        {
+            dev->clock.nominalRateHz = config->rateMilliHz / 1000.0;
+            dev->clock.synced = false;
+            dev->clock.locked = false;
+        }
+}
+
+/* called by devstream from worker thread */
+static void
+onSample (const struct devstream_Sample *sample, void *ctx)
+{
+    struct Device *dev = ctx;
+    struct ClockModel *clock = &dev->clock;
+
+    clockModelUpdate (clock, sample->timeUs);
+    struct MergedSample out =
+        { (int64_t) (clock->offsetUs + clock->index * clock->periodUs),
+                sample->x, sample->y, sample->z, sample->flags };
+    clock->index++;
+
+    pthread_mutex_lock (&dev->sampleLock);
+    if (dev->sampleCount == SAMPLE_RING_LEN)
+        {
+            dev->sampleOverflows++;
+        }
+    else
+        {
+            dev->sampleRing[(dev->sampleHead + dev->sampleCount++)
+                    % SAMPLE_RING_LEN] = out;
+            dev->lastAlignedUs = out.timeUs;
+            dev->lastRxUs = sample->timeUs;
+        }
+    pthread_mutex_unlock (&dev->sampleLock);
+}
+
+static void*
+workerTask (void *params)
+{
+    struct Worker *worker = params;
+    struct RxChunk chunk;
+
+    while (!base.stopRequested)
+        {
+            pthread_mutex_lock (&worker->lock);
+            while (!worker->pending && !base.stopRequested)
+                {
+                    pthread_cond_wait (&worker->cond, &worker->lock);
+                }
+            worker->pending = false;
+            pthread_mutex_unlock (&worker->lock);
+
+            /* drain byte chunks of all owned devices */
+            bool any = true;
+            while (any)
+                {
+                    any = false;
+                    for (int i = worker->index; i < base.numOfDevices; i +=
+                            base.numOfWorkers)
+                        {
+                            struct Device *dev = &base.devices[i];
+                            bool got = false;
+                            pthread_mutex_lock (&dev->rxLock);
+                            if (dev->rxCount > 0)
+                                {
+                                    chunk = dev->rxRing[dev->rxHead];
+                                    dev->rxHead = (dev->rxHead + 1)
+                                            % RX_RING_LEN;
+                                    dev->rxCount--;
+                                    got = true;
+                                }
+                            pthread_mutex_unlock (&dev->rxLock);
+                            if (got)
+                                {
+                                    devstream_feed (&dev->parser, chunk.data,
+                                                    chunk.len, chunk.timeUs);
+                                    any = true;
+                                }
+                        }
+                }
+        }
+    return NULL;
+}
+
+/* min heap of device indexes ordered by time of their head sample */
+static void
+heapSiftDown (int *heap, const int64_t *key, int n, int i)
+{
+    while (1)
+        {
+            int smallest = i, l = 2 * i + 1, r = 2 * i + 2;
+            if (l < n && key[heap[l]] < key[heap[smallest]])
+                {
+                    smallest = l;
+                }
+            if (r < n && key[heap[r]] < key[heap[smallest]])
+                {
+                    smallest = r;
+                }
+            if (smallest == i)
+                {
+                    return;
+                }
+            int tmp = heap[i];
+            heap[i] = heap[smallest];
+            heap[smallest] = tmp;
+            i = smallest;
+        }
+}
+
+static bool
+peekSample (struct Device *dev, struct MergedSample *sample)
+{
+    bool available;
+    pthread_mutex_lock (&dev->sampleLock);
+    available = dev->sampleCount > 0;
+    if (available)
+        {
+            *sample = dev->sampleRing[dev->sampleHead];
+        }
+    pthread_mutex_unlock (&dev->sampleLock);
+    return available;
+}
+
+static void
+popSample (struct Device *dev)
+{
+    pthread_mutex_lock (&dev->sampleLock);
+    dev->sampleHead = (dev->sampleHead + 1) % SAMPLE_RING_LEN;
+    dev->sampleCount--;
+    pthread_mutex_unlock (&dev->sampleLock);
+}
+
+/* emit all samples older than watermark in time order */
+static void
+mergeStep (int64_t nowUs)
+{
+    static int heap[MAX_DEVICES];
+    static int64_t key[MAX_DEVICES];
+    struct MergedSample head[MAX_DEVICES];
+    int64_t watermark = INT64_MAX;
+    int n = 0;
+
+    /* watermark: no active device can still deliver older samples */
+    for (int i = 0; i < base.numOfDevices; i++)
+        {
+            struct Device *dev = &base.devices[i];
+            pthread_mutex_lock (&dev->sampleLock);
+            bool active = dev->lastRxUs != 0
+                    && nowUs - dev->lastRxUs < IDLE_TIMEOUT_US;
+            int64_t last = dev->lastAlignedUs;
+            pthread_mutex_unlock (&dev->sampleLock);
+            if (active && last < watermark)
+                {
+                    watermark = last;
+                }
+        }
+    if (watermark == INT64_MAX)
+        {
+            watermark = nowUs - base.mergeDelayUs;
+        }
+    else if (watermark > nowUs - base.mergeDelayUs)
+        {
+            watermark = nowUs - base.mergeDelayUs;
+        }
+
+    for (int i = 0; i < base.numOfDevices; i++)
+        {
+            if (peekSample (&base.devices[i], &head[i]))
+                {
+                    key[i] = head[i].timeUs;
+                    heap[n++] = i;
+                }
+        }
+    for (int i = n / 2 - 1; i >= 0; i--)
+        {
+            heapSiftDown (heap, key, n, i);
+        }
+
+    while (n > 0 && key[heap[0]] <= watermark)
+        {
+            int d = heap[0];
+            struct Device *dev = &base.devices[d];
+            struct MergedSample *s = &head[d];
+
+            if (s->timeUs < base.watermarkUs)
+                {
+                    /* arrived after its time slot was already emitted */
+                    dev->lateSamples++;
+                }
+            else
+                {
+                    printf ("%lld,%d,%d,%d,%d,%u\n", (long long) s->timeUs, d,
+                            s->x, s->y, s->z, s->flags);
+                    base.watermarkUs = s->timeUs;
+                    dev->merged++;
+                    dev->lastLagUs = nowUs - s->timeUs;
+                    if (dev->lastLagUs > dev->maxLagUs)
+                        {
+                            dev->maxLagUs = dev->lastLagUs;
+                        }
+                }
+            popSample (dev);
+
+            if (peekSample (dev, s))
+                {
+                    key[d] = s->timeUs;
+                }
+            else
+                {
+                    heap[0] = heap[--n];
+                }
+            heapSiftDown (heap, key, n, 0);
+        }
+    fflush (stdout);
+}
+
+static void*
+mergerTask (void *params)
+{
+    (void) params;
+    while (!base.stopRequested)
+        {
+            usleep (MERGE_PERIOD_US);
+            mergeStep (serial_getTimeUs ());
+        }
+    return NULL;
+}
+
+static void
+printReport (void)
+{
+    fprintf (stderr,
+             "dev       merged  rate[Hz]  lag[ms]  max lag[ms]  malformed"
+             "  rx ovf  smp ovf   late  port\n");
+    for (int i = 0; i < base.numOfDevices; i++)
+        {
+            struct Device *dev = &base.devices[i];
+            fprintf (stderr,
+                     "%3d %12llu %9.2f %8.1f %12.1f %10llu %7llu %8llu %6llu  %s%s\n",
+                     i, (unsigned long long) dev->merged,
+                     dev->clock.synced ? 1e6 / dev->clock.periodUs : 0.0,
+                     dev->lastLagUs / 1000.0, dev->maxLagUs / 1000.0,
+                     (unsigned long long) dev->parser.malformed,
+                     (unsigned long long) dev->rxOverflows,
+                     (unsigned long long) dev->sampleOverflows,
+                     (unsigned long long) dev->lateSamples, dev->path,
+                     dev->closed ? " (closed)" : "");
+        }
+}
+
+static void
+wakeWorker (int device)
+{
+    struct Worker *worker = &base.workers[device % base.numOfWorkers];
+    pthread_mutex_lock (&worker->lock);
+    worker->pending = true;
+    pthread_cond_signal (&worker->cond);
+    pthread_mutex_unlock (&worker->lock);
+}
+
+static int
+usage (void)
+{
+    fprintf (stderr,
+             "usage: acc_aggregator [-w workers] [-r nominal rate Hz] "
+             "[-d merge delay ms] [-i report period s] port...\n");
+    return 1;
+}
+
+int
+main (int argc, char **argv)
+{
+    int reportPeriodS = DEFAULT_REPORT_PERIOD_S;
+    int opt;
+
+    base.numOfWorkers = sysconf (_SC_NPROCESSORS_ONLN);
+    base.nominalRateHz = DEFAULT_RATE_HZ;
+    base.mergeDelayUs = DEFAULT_MERGE_DELAY_MS * 1000;
+    while ((opt = getopt (argc, argv, "w:r:d:i:")) != -1)
+        {
+            switch (opt)
+                {
+                case 'w':
+                    base.numOfWorkers = atoi (optarg);
+                    break;
+                case 'r':
+                    base.nominalRateHz = atof (optarg);
+                    break;
+                case 'd':
+                    base.mergeDelayUs = atoll (optarg) * 1000;
+                    break;
+                case 'i':
+                    reportPeriodS = atoi (optarg);
+                    break;
+                default:
+                    return usage ();
+                }
+        }
+    base.numOfDevices = argc - optind;
+    if (base.numOfDevices < 1 || base.numOfDevices > MAX_DEVICES
+            || base.nominalRateHz <= 0)
+        {
+            return usage ();
+        }
+    if (base.numOfWorkers < 1)
+        {
+            base.numOfWorkers = 1;
+        }
+    if (base.numOfWorkers > MAX_WORKERS)
+        {
+            base.numOfWorkers = MAX_WORKERS;
+        }
+    if (base.numOfWorkers > base.numOfDevices)
+        {
+            base.numOfWorkers = base.numOfDevices;
+        }
+
+    int epfd = epoll_create1 (0);
+    base.devices = calloc (base.numOfDevices, sizeof(struct Device));
+    if (epfd < 0 || base.devices == NULL)
+        {
+            return 1;
+        }
+    for (int i = 0; i < base.numOfDevices; i++)
+        {
+            struct Device *dev = &base.devices[i];
+            dev->id = i;
+            dev->path = argv[optind + i];
+            dev->fd = serial_open (dev->path, SERIAL_DEFAULT_BAUD, 1);
+            if (dev->fd < 0)
+                {
+                    fprintf (stderr, "can not open %s: %s\n", dev->path,
+                             strerror (errno));
+                    return 1;
+                }
+            pthread_mutex_init (&dev->rxLock, NULL);
+            pthread_mutex_init (&dev->sampleLock, NULL);
+            devstream_init (&dev->parser, onSample, dev);
+            devstream_setConfigCb (&dev->parser, onConfig);
+            dev->clock.nominalRateHz = base.nominalRateHz;
+
+            struct epoll_event ev =
+                { .events = EPOLLIN, .data.u32 = i };
+            if (epoll_ctl (epfd, EPOLL_CTL_ADD, dev->fd, &ev))
+                {
+                    return 1;
+                }
+        }
+
+    signal (SIGINT, onSignal);
+    signal (SIGTERM, onSignal);
+    for (int w = 0; w < base.numOfWorkers; w++)
+        {
+            struct Worker *worker = &base.workers[w];
+            worker->index = w;
+            pthread_mutex_init (&worker->lock, NULL);
+            pthread_cond_init (&worker->cond, NULL);
+            pthread_create (&worker->thread, NULL, workerTask, worker);
+        }
+    pthread_t merger;
+    pthread_create (&merger, NULL, mergerTask, NULL);
+
+    /* i/o loop */
+    struct epoll_event events[MAX_DEVICES];
+    int64_t nextReport = serial_getMonotonicUs () + reportPeriodS * 1000000LL;
+    while (!base.stopRequested)
+        {
+            int n = epoll_wait (epfd, events, MAX_DEVICES, 100);
+            int64_t now = serial_getTimeUs ();
+            for (int e = 0; e < n; e++)
+                {
+                    int i = events[e].data.u32;
+                    struct Device *dev = &base.devices[i];
+                    struct RxChunk *chunk;
+
+                    pthread_mutex_lock (&dev->rxLock);
+                    if (dev->rxCount == RX_RING_LEN)
+                        {
+                            /* worker can not keep up, chunk is consumed and dropped */
+                            struct RxChunk discard;
+                            dev->rxOverflows++;
+                            pthread_mutex_unlock (&dev->rxLock);
+                            if (read (dev->fd, discard.data, RX_CHUNK_LEN)
+                                    <= 0)
+                                {
+                                    dev->closed = true;
+                                    epoll_ctl (epfd, EPOLL_CTL_DEL, dev->fd,
+                                               NULL);
+                                }
+                            continue;
+                        }
+                    chunk = &dev->rxRing[(dev->rxHead + dev->rxCount)
+                            % RX_RING_LEN];
+                    pthread_mutex_unlock (&dev->rxLock);
+
+                    /* slot is owned by i/o thread until rxCount is incremented */
+                    ssize_t len = read (dev->fd, chunk->data, RX_CHUNK_LEN);
+                    if (len <= 0)
+                        {
+                            if (len == 0 || (errno != EAGAIN && errno != EINTR))
+                                {
+                                    dev->closed = true;
+                                    epoll_ctl (epfd, EPOLL_CTL_DEL, dev->fd,
+                                               NULL);
+                                }
+                            continue;
+                        }
+                    chunk->len = len;
+                    chunk->timeUs = now;
+                    pthread_mutex_lock (&dev->rxLock);
+                    dev->rxCount++;
+                    pthread_mutex_unlock (&dev->rxLock);
+                    wakeWorker (i);
+                }
+
+            if (reportPeriodS > 0 && serial_getMonotonicUs () >= nextReport)
+                {
+                    printReport ();
+                    nextReport += reportPeriodS * 1000000LL;
+                }
+        }
+
+    for (int w = 0; w < base.numOfWorkers; w++)
+        {
+            wakeWorker (w);
+            pthread_join (base.workers[w].thread, NULL);
+        }
+    pthread_join (merger, NULL);
+    printReport ();
+    return 0;
+}
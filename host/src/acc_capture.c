@@ -0,0 +1,337 @@
+/*
+ * acc_capture.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Receiver of triggered capture frames sent by the device in capture mode, see capture.h.
+ *      Frames are picked out of the serial stream (text echo and prompts are skipped), checked
+ *      and printed as csv: sequence, sensor, trigger, time relative to trigger in ms, x, y, z.
+ *      "check" runs the firmware capture module with synthetic samples and verifies that decoded
+ *      frames contain exactly the expected pre and post trigger samples.
+ *
+ *          acc_capture listen <port|->
+ *          acc_capture check
+ */
+#include "capture.h"
+#include "serial.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* === private defines === */
+#define READ_BUFF_LEN                   4096
+#define CHECK_CHUNK_LEN                 48                                      /// CLI_BIN_MAX_LEN of firmware
+#define CHECK_RATE_MHZ                  400000
+#define CHECK_THRESHOLD_MG              16000
+#define CHECK_PEAK_MG                   16384                                   /// above any synthetic sample value
+
+/* === private types === */
+/** frame receiver state */
+struct Receiver
+{
+    uint8_t frame[CAPTURE_MAX_FRAME_SIZE];
+    size_t len;                                                                 /// bytes collected
+    size_t frameSize;                                                           /// 0 until header is decoded
+    struct capture_FrameHeader header;
+    uint64_t frames, badFrames;
+    void
+    (*cb) (const struct capture_FrameHeader *header, const uint8_t *samples,
+           void *ctx);
+    void *ctx;
+};
+
+/* === private functions === */
+static int16_t
+sampleAxis (const uint8_t *samples, uint32_t idx, uint8_t axis)
+{
+    const uint8_t *p = samples + idx * CAPTURE_SAMPLE_SIZE + axis * 2;
+    return (int16_t) (p[0] | (p[1] << 8));
+}
+
+/* Drop first byte and look for next sync */
+static void
+resync (struct Receiver *rx)
+{
+    size_t skip = 1;
+    while (skip < rx->len
+            && !(rx->frame[skip] == (CAPTURE_SYNC & 0xFF)
+                    && (skip + 1 == rx->len
+                            || rx->frame[skip + 1] == (CAPTURE_SYNC >> 8))))
+        {
+            skip++;
+        }
+    memmove (rx->frame, rx->frame + skip, rx->len - skip);
+    rx->len -= skip;
+    rx->frameSize = 0;
+}
+
+static void
+feedByte (struct Receiver *rx, uint8_t byte)
+{
+    if (rx->len == 0 && byte != (CAPTURE_SYNC & 0xFF))
+        {
+            return;
+        }
+    rx->frame[rx->len++] = byte;
+
+    while (rx->len > 0)
+        {
+            if (rx->frameSize == 0)
+                {
+                    if (rx->len < CAPTURE_HEADER_SIZE)
+                        {
+                            if (rx->len >= 2
+                                    && rx->frame[1] != (CAPTURE_SYNC >> 8))
+                                {
+                                    resync (rx);
+                                    continue;
+                                }
+                            return;
+                        }
+                    if (!capture_decodeHeader (rx->frame, &rx->header)
+                            || rx->header.preSamples > CAPTURE_PRE_SAMPLES
+                            || rx->header.postSamples != CAPTURE_POST_SAMPLES)
+                        {
+                            resync (rx);
+                            continue;
+                        }
+                    rx->frameSize = CAPTURE_HEADER_SIZE
+                            + (rx->header.preSamples + rx->header.postSamples)
+                                    * CAPTURE_SAMPLE_SIZE
+                            + CAPTURE_CHECKSUM_SIZE;
+                }
+            if (rx->len < rx->frameSize)
+                {
+                    return;
+                }
+
+            size_t dataLen = rx->frameSize - CAPTURE_CHECKSUM_SIZE;
+            uint16_t sum = rx->frame[dataLen] | (rx->frame[dataLen + 1] << 8);
+            if (sum != capture_checksum (0, rx->frame, dataLen))
+                {
+                    rx->badFrames++;
+                    resync (rx);
+                    continue;
+                }
+            rx->frames++;
+            rx->cb (&rx->header, rx->frame + CAPTURE_HEADER_SIZE, rx->ctx);
+            rx->len = 0;
+            rx->frameSize = 0;
+        }
+}
+
+static void
+printFrame (const struct capture_FrameHeader *header, const uint8_t *samples,
+            void *ctx)
+{
+    static const char *triggerNames[CAPTURE_TRIGGER_COUNT] =
+        { "click", "threshold" };
+    (void) ctx;
+
+    uint32_t num = header->preSamples + header->postSamples;
+    for (uint32_t i = 0; i < num; i++)
+        {
+            double tMs = ((double) i - header->preSamples) * 1e6
+                    / header->rateMilliHz;
+            printf ("%u,%u,%s,%.3f,%d,%d,%d\n", header->sequence,
+                    header->sensorIdx,
+                    header->trigger < CAPTURE_TRIGGER_COUNT ?
+                            triggerNames[header->trigger] : "?",
+                    tMs, sampleAxis (samples, i, 0), sampleAxis (samples, i, 1),
+                    sampleAxis (samples, i, 2));
+        }
+    fflush (stdout);
+}
+
+static int
+listen (const char *port)
+{
+    struct Receiver rx =
+        { .cb = printFrame };
+    uint8_t buff[READ_BUFF_LEN];
+    int fd = 0;
+
+    if (strcmp (port, "-") != 0)
+        {
+            fd = serial_open (port, SERIAL_DEFAULT_BAUD, 0);
+            if (fd < 0)
+                {
+                    fprintf (stderr, "can not open %s: %s\n", port,
+                             strerror (errno));
+                    return 1;
+                }
+        }
+    printf ("sequence,sensor,trigger,t_ms,x,y,z\n");
+    while (1)
+        {
+            ssize_t n = read (fd, buff, sizeof(buff));
+            if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+            if (n <= 0)
+                {
+                    break;
+                }
+            for (ssize_t i = 0; i < n; i++)
+                {
+                    feedByte (&rx, buff[i]);
+                }
+        }
+    fprintf (stderr, "%llu frames, %llu with bad checksum\n",
+             (unsigned long long) rx.frames,
+             (unsigned long long) rx.badFrames);
+    return 0;
+}
+
+/* === self check === */
+struct Expected
+{
+    uint32_t triggerSample;                                                     /// sample number of first post trigger sample
+    uint32_t firstSample;                                                       /// sample number of first frame sample
+    bool peak;                                                                  /// trigger sample carries threshold peak
+    int failures;
+};
+
+/* Synthetic sample number n encoded into axes, so frames can be checked for order and gaps */
+static void
+makeSample (uint32_t n, bool peak, int16_t xyz[3])
+{
+    xyz[0] = (int16_t) (n & 0xFFF);
+    xyz[1] = peak ? CHECK_PEAK_MG : (int16_t) ((n * 7) & 0xFFF);
+    xyz[2] = -(int16_t) ((n >> 12) & 0xFFF);
+}
+
+static void
+checkFrame (const struct capture_FrameHeader *header, const uint8_t *samples,
+            void *ctx)
+{
+    struct Expected *exp = ctx;
+    uint32_t expectedPre = exp->triggerSample - exp->firstSample;
+    int16_t xyz[3];
+
+    if (header->preSamples != expectedPre)
+        {
+            printf ("  frame %u: %u pre samples, expected %u\n",
+                    header->sequence, header->preSamples, expectedPre);
+            exp->failures++;
+            return;
+        }
+    for (uint32_t i = 0; i < header->preSamples + header->postSamples; i++)
+        {
+            uint32_t n = exp->firstSample + i;
+            makeSample (n, exp->peak && n == exp->triggerSample, xyz);
+            for (uint8_t a = 0; a < 3; a++)
+                {
+                    if (sampleAxis (samples, i, a) != xyz[a])
+                        {
+                            printf ("  frame %u: sample %u axis %u wrong\n",
+                                    header->sequence, i, a);
+                            exp->failures++;
+                            return;
+                        }
+                }
+        }
+}
+
+/* Feed samples, trigger at given sample and read frame out in CLI sized chunks */
+static int
+runCase (const char *name, enum capture_Trigger trigger, uint32_t triggerAt,
+         uint32_t total)
+{
+    struct Expected exp =
+        { 0 };
+    struct Receiver rx =
+        { .cb = checkFrame, .ctx = &exp };
+    uint8_t chunk[CHECK_CHUNK_LEN];
+    int16_t xyz[3];
+    uint16_t len;
+    uint64_t frames = 0;
+    uint32_t armedAt = 0;
+
+    exp.peak = CAPTURE_TRIGGER_THRESHOLD == trigger;
+    capture_enable (0, trigger, CHECK_THRESHOLD_MG);
+    capture_arm (CHECK_RATE_MHZ);
+    for (uint32_t n = 1; n <= total; n++)
+        {
+            bool trig = (n - armedAt) == triggerAt;
+            makeSample (n, trig && exp.peak, xyz);
+            if (trig && CAPTURE_TRIGGER_CLICK == trigger)
+                {
+                    /* click arrives after the last sample before trigger */
+                    capture_onClick (0);
+                }
+            if (trig)
+                {
+                    exp.triggerSample = n;
+                    exp.firstSample =
+                            n - armedAt - 1 < CAPTURE_PRE_SAMPLES ?
+                                    armedAt + 1 : n - CAPTURE_PRE_SAMPLES;
+                }
+            /* other sensor must not disturb capture */
+            capture_addSample (1, 0, 0, 0);
+            if (capture_addSample (0, xyz[0], xyz[1], xyz[2]))
+                {
+                    frames++;
+                    while (0 < (len = capture_readFrame (chunk, sizeof(chunk))))
+                        {
+                            for (uint16_t i = 0; i < len; i++)
+                                {
+                                    feedByte (&rx, chunk[i]);
+                                }
+                        }
+                    armedAt = n;
+                }
+        }
+    capture_disable ();
+
+    int failed = exp.failures != 0 || rx.frames != frames || frames == 0
+            || rx.badFrames != 0;
+    printf ("%-28s %llu frames%s\n", name, (unsigned long long) frames,
+            failed ? "  FAILED" : "");
+    return failed;
+}
+
+static int
+check (void)
+{
+    int failures = 0;
+
+    /* trigger repeats given number of samples after previous frame */
+    failures += runCase ("click, full pre trigger", CAPTURE_TRIGGER_CLICK,
+                         500, 2000);
+    failures += runCase ("click, short pre trigger", CAPTURE_TRIGGER_CLICK,
+                         10, 2000);
+    failures += runCase ("threshold, full pre trigger",
+                         CAPTURE_TRIGGER_THRESHOLD, 300, 2000);
+    failures += runCase ("threshold, at first sample",
+                         CAPTURE_TRIGGER_THRESHOLD, 1, 2000);
+    printf ("%d cases failed, %lu missed triggers\n", failures,
+            (unsigned long) capture_getStats ()->missedTriggers);
+    return failures != 0;
+}
+
+static int
+usage (void)
+{
+    fprintf (stderr, "usage: acc_capture listen <port|->\n"
+             "       acc_capture check\n");
+    return 1;
+}
+
+int
+main (int argc, char **argv)
+{
+    if (argc == 2 && 0 == strcmp (argv[1], "check"))
+        {
+            return check ();
+        }
+    if (argc == 3 && 0 == strcmp (argv[1], "listen"))
+        {
+            return listen (argv[2]);
+        }
+    return usage ();
+}
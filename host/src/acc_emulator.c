@@ -0,0 +1,854 @@
+/*
+ * acc_emulator.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Emulator of the device UART behaviour over pseudo terminals, for load testing host tools
+ *      without hardware. Every instance implements the CLI of main_task (same commands, same
+ *      responses, same echo) and, after "start", prints averaged samples at the configured ODR.
+ *      The UART link is modelled as well: CLI transmit queue of CLI_TX_QUEUE_LEN lines drained at
+ *      baud / 10 bytes per second, each sample line is one queue item and is skipped when the
+ *      queue is full, exactly as main_task does. Lines are formatted with the firmware fmt module.
+ *      While streaming, range, rate and averaging commands apply live and print the @cfg setup
+ *      marker; stop or an empty line goes back to idle.
+ *
+ *          acc_emulator [-n instances] [-r replay file] [-b baud] [-l link prefix] [-c click period s] [-s seed]
+ *
+ *      Slave pty paths are printed on stdout, one per line. With -l, symlinks <prefix>0..N-1 are
+ *      created too. SIGINT prints per instance statistics and exits.
+ */
+#define _GNU_SOURCE
+#include "fmt.h"
+#include "record.h"
+#include "serial.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* === private defines === */
+/* values mirrored from firmware */
+#define CLI_MAX_LINE_LEN                50
+#define CLI_ENTER                       13
+#define BACKSPACE                       127
+#define CLI_TX_QUEUE_LEN                10
+#define ACC_MIN_AVG_NUMBER              1
+#define ACC_MAX_AVG_NUMBER              500
+#define I2C_BUS_HZ                      62500                                   /// SCL frequency of TIMINGR_CONTENT at 8 MHz
+#define BUS_BITS_PER_SAMPLE             93
+#define BUS_LOAD_LIMIT_PERCENT          90
+#define DEFAULT_RATE_MHZ                400000
+#define DEFAULT_FULL_SCALE              2
+
+#define MAX_INSTANCES                   64
+#define TX_FIFO_LEN                     4096
+#define WIRE_TICK_US                    1000                                    /// wire drain period while data pending
+#define RX_BUFF_LEN                     256
+#define DEFAULT_CLICK_PERIOD_S          7.0
+
+/* === private types === */
+enum SystemState
+{
+    SYSTEM_IDLE, SYSTEM_ACC_DATA_PROCESSING
+};
+
+/** model of CLI transmit queue and UART wire */
+struct Link
+{
+    uint8_t fifo[TX_FIFO_LEN];                                                  /// bytes waiting for transmission
+    size_t head, len;
+    size_t itemLen[CLI_TX_QUEUE_LEN * 4];                                       /// remaining bytes of queued items
+    size_t itemHead, items;
+    double credit;                                                              /// bytes which may be sent now
+    int64_t lastDrainUs;
+};
+
+struct Instance
+{
+    int master, slave;
+    char path[64];
+    enum SystemState state;
+    char rxLine[CLI_MAX_LINE_LEN + 1];
+    uint8_t rxIndex;
+    /* configuration */
+    uint8_t fullScale;
+    uint32_t rateMhz;
+    bool clickDetectionEnabled;
+    /* averaging, same arithmetic as main_task */
+    int16_t xBuff[ACC_MAX_AVG_NUMBER], yBuff[ACC_MAX_AVG_NUMBER],
+            zBuff[ACC_MAX_AVG_NUMBER], numOfAveragedSamples, head;
+    int32_t xNum, yNum, zNum;
+    /* data generation */
+    int64_t bootUs, startUs, nextSampleUs;
+    uint64_t sampleIndex;
+    uint32_t rng;
+    size_t replayChunk, replayPos;
+    struct Link link;
+    /* statistics */
+    uint64_t samples, linesPrinted, linesSkipped, bytesSent, bytesDropped;
+};
+
+/* === private variables === */
+static struct Base
+{
+    struct Instance *instances;
+    int numOfInstances;
+    uint32_t baud;
+    double clickPeriodS;
+    struct record_Reader replay;
+    bool replayEnabled;
+    volatile sig_atomic_t stopRequested;
+} base;
+
+/* === private functions === */
+static void
+onSignal (int sig)
+{
+    (void) sig;
+    base.stopRequested = 1;
+}
+
+static uint32_t
+nextRandom (struct Instance *inst)
+{
+    inst->rng = inst->rng * 1664525u + 1013904223u;
+    return inst->rng >> 8;
+}
+
+static void
+linkPush (struct Instance *inst, const char *data, size_t len, bool isItem)
+{
+    struct Link *l = &inst->link;
+
+    if (len > TX_FIFO_LEN - l->len)
+        {
+            inst->bytesDropped += len;
+            return;
+        }
+    for (size_t i = 0; i < len; i++)
+        {
+            l->fifo[(l->head + l->len++) % TX_FIFO_LEN] = data[i];
+        }
+    if (isItem)
+        {
+            size_t slots = sizeof(l->itemLen) / sizeof(l->itemLen[0]);
+            l->itemLen[(l->itemHead + l->items) % slots] = len;
+            l->items++;
+        }
+}
+
+/* equivalent of PRINT_TO_CLI: one queue item truncated to CLI_MAX_LINE_LEN - 1 characters */
+static void
+cliPrint (struct Instance *inst, const char *format, ...)
+{
+    char item[CLI_MAX_LINE_LEN];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf (item, sizeof(item), format, args);
+    va_end(args);
+    linkPush (inst, item, strlen (item), true);
+}
+
+static unsigned
+linkSpacesAvailable (const struct Instance *inst)
+{
+    return inst->link.items >= CLI_TX_QUEUE_LEN ?
+            0 : CLI_TX_QUEUE_LEN - inst->link.items;
+}
+
+/* move bytes allowed by baud rate from fifo to pty */
+static void
+linkDrain (struct Instance *inst, int64_t nowUs)
+{
+    struct Link *l = &inst->link;
+    size_t slots = sizeof(l->itemLen) / sizeof(l->itemLen[0]);
+
+    if (base.baud == 0)
+        {
+            l->credit = l->len;
+        }
+    else if (nowUs > l->lastDrainUs)
+        {
+            l->credit += (nowUs - l->lastDrainUs) * (base.baud / 10.0) / 1e6;
+            if (l->credit > l->len)
+                {
+                    /* idle line does not accumulate credit */
+                    l->credit = l->len;
+                }
+        }
+    if (nowUs > l->lastDrainUs)
+        {
+            l->lastDrainUs = nowUs;
+        }
+
+    size_t n = (size_t) l->credit;
+    while (n > 0)
+        {
+            size_t chunk = n;
+            if (chunk > TX_FIFO_LEN - l->head)
+                {
+                    chunk = TX_FIFO_LEN - l->head;
+                }
+            ssize_t written = write (inst->master, &l->fifo[l->head], chunk);
+            if (written < 0)
+                {
+                    /* host does not read, bytes are lost on the wire */
+                    written = chunk;
+                    inst->bytesDropped += chunk;
+                }
+            else
+                {
+                    inst->bytesSent += written;
+                    if ((size_t) written < chunk)
+                        {
+                            inst->bytesDropped += chunk - written;
+                            written = chunk;
+                        }
+                }
+
+            l->head = (l->head + written) % TX_FIFO_LEN;
+            l->len -= written;
+            l->credit -= written;
+            n -= written;
+
+            /* release queue items which left the wire */
+            size_t consumed = written;
+            while (consumed > 0 && l->items > 0)
+                {
+                    size_t *item = &l->itemLen[l->itemHead];
+                    size_t take = consumed < *item ? consumed : *item;
+                    *item -= take;
+                    consumed -= take;
+                    if (*item == 0)
+                        {
+                            l->itemHead = (l->itemHead + 1) % slots;
+                            l->items--;
+                        }
+                }
+        }
+}
+
+static void
+printAccSetup (struct Instance *inst)
+{
+    cliPrint (inst, "\n\rfull scale range +/- %u g\n\r", inst->fullScale);
+    cliPrint (inst, "data read rate: %lu.%lu Hz\n\r",
+              (unsigned long) (inst->rateMhz / 1000),
+              (unsigned long) (inst->rateMhz % 1000));
+    cliPrint (inst, "number of averaged samples: %d\n\r",
+              inst->numOfAveragedSamples);
+    cliPrint (inst, "click detection %s\n\r",
+              inst->clickDetectionEnabled ? "ON" : "OFF");
+}
+
+static void
+printHelp (struct Instance *inst)
+{
+    cliPrint (inst, "\n\rList of available commands:\n\racc get setup");
+    cliPrint (inst, "\n\racc set range [2g|4g|6g|8g|16g]\n\racc set ra");
+    cliPrint (inst, "te [25Hz|50Hz|100Hz|200Hz|400Hz|800Hz|1600Hz]\n\r");
+    cliPrint (inst, "acc set avg number [1-500]\n\racc set click det ");
+    cliPrint (inst, "[on|off]\n\racc sel [0-1]\n\rstart\n\n\r>>");
+}
+
+static void
+startStreaming (struct Instance *inst, int64_t nowUs)
+{
+    cliPrint (inst, "   acc x:    acc y:    acc z:    ");
+    cliPrint (inst, "last click time: \n\r");
+    inst->state = SYSTEM_ACC_DATA_PROCESSING;
+    inst->startUs = nowUs;
+    inst->nextSampleUs = nowUs;
+    inst->sampleIndex = 0;
+}
+
+static bool
+setFullScale (struct Instance *inst, uint8_t fullScale)
+{
+    if (fullScale == 2 || fullScale == 4 || fullScale == 6 || fullScale == 8
+            || fullScale == 16)
+        {
+            inst->fullScale = fullScale;
+            return true;
+        }
+    cliPrint (inst, "Wrong full scale value\n\r");
+    return false;
+}
+
+static bool
+setRate (struct Instance *inst, uint16_t rate)
+{
+    if (rate != 25 && rate != 50 && rate != 100 && rate != 200 && rate != 400
+            && rate != 800 && rate != 1600)
+        {
+            cliPrint (inst, "Wrong rate value\n\r");
+            return false;
+        }
+    if ((uint32_t) rate * BUS_BITS_PER_SAMPLE
+            > I2C_BUS_HZ / 100 * BUS_LOAD_LIMIT_PERCENT)
+        {
+            cliPrint (inst, "Rate exceeds I2C bus bandwidth\n\r");
+            return false;
+        }
+    inst->rateMhz = rate * 1000u;
+    if (inst->state == SYSTEM_ACC_DATA_PROCESSING)
+        {
+            /* keep the next scheduled sample, the following ones come at the new period */
+            inst->startUs = inst->nextSampleUs
+                    - (int64_t) (inst->sampleIndex * 1000000000.0 / inst->rateMhz);
+        }
+    return true;
+}
+
+static bool
+setAvgNumber (struct Instance *inst, uint16_t avgNumber)
+{
+    if (avgNumber > ACC_MIN_AVG_NUMBER && avgNumber < ACC_MAX_AVG_NUMBER)
+        {
+            /* running sums cover the new window, ring keeps the older samples */
+            inst->numOfAveragedSamples = avgNumber;
+            inst->xNum = inst->yNum = inst->zNum = 0;
+            for (int16_t i = 1; i <= avgNumber; i++)
+                {
+                    int16_t idx = (inst->head - i + ACC_MAX_AVG_NUMBER)
+                            % ACC_MAX_AVG_NUMBER;
+                    inst->xNum += inst->xBuff[idx];
+                    inst->yNum += inst->yBuff[idx];
+                    inst->zNum += inst->zBuff[idx];
+                }
+            return true;
+        }
+    cliPrint (inst, "wrong number of averaged samples");
+    return false;
+}
+
+/* command decoding of main_task in SYSTEM_ACC_DATA_PROCESSING state */
+static void
+executeStreamingCommand (struct Instance *inst, const char *cmd)
+{
+    uint16_t tempInt = 0;
+    uint8_t tempByte = 0;
+    bool changed = false;
+
+    if (cmd[0] == 0 || 0 == strcmp (cmd, "stop"))
+        {
+            inst->state = SYSTEM_IDLE;
+            cliPrint (inst, "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\r>>");
+            return;
+        }
+    else if (1 == sscanf (cmd, "acc set range %hhug", &tempByte))
+        {
+            changed = setFullScale (inst, tempByte);
+        }
+    else if (1 == sscanf (cmd, "acc set rate %huHz", &tempInt))
+        {
+            changed = setRate (inst, tempInt);
+        }
+    else if (1 == sscanf (cmd, "acc set avg number %hu", &tempInt))
+        {
+            changed = setAvgNumber (inst, tempInt);
+        }
+    else
+        {
+            cliPrint (inst, "\n\rNot while streaming, type stop first\n\r");
+        }
+
+    if (changed)
+        {
+            cliPrint (inst, "\n\r@cfg #0 %lu.%03luHz %ug avg %u\n\r",
+                      (unsigned long) (inst->rateMhz / 1000),
+                      (unsigned long) (inst->rateMhz % 1000), inst->fullScale,
+                      inst->numOfAveragedSamples);
+        }
+}
+
+/* command decoding of main_task in SYSTEM_IDLE state */
+static void
+executeCommand (struct Instance *inst, const char *cmd, int64_t nowUs)
+{
+    uint16_t tempInt = 0;
+    uint8_t tempByte = 0;
+
+    if (inst->state == SYSTEM_ACC_DATA_PROCESSING)
+        {
+            executeStreamingCommand (inst, cmd);
+            return;
+        }
+
+    if (cmd[0] == 0)
+        {
+            cliPrint (inst, "\n\r>>");
+        }
+    else if (0 == strcmp (cmd, "help"))
+        {
+            printHelp (inst);
+        }
+    else if (0 == strcmp (cmd, "acc get setup"))
+        {
+            printAccSetup (inst);
+        }
+    else if (1 == sscanf (cmd, "acc set range %hhug", &tempByte))
+        {
+            setFullScale (inst, tempByte);
+        }
+    else if (1 == sscanf (cmd, "acc set rate %huHz", &tempInt))
+        {
+            setRate (inst, tempInt);
+        }
+    else if (1 == sscanf (cmd, "acc set avg number %hu", &tempInt))
+        {
+            setAvgNumber (inst, tempInt);
+        }
+    else if (1 == sscanf (cmd, "acc sel %hu", &tempInt))
+        {
+            /* emulated device has single sensor */
+            if (tempInt != 0)
+                {
+                    cliPrint (inst, "No such sensor\n\r");
+                }
+        }
+    else if (0 == strcmp (cmd, "acc set click det on"))
+        {
+            inst->clickDetectionEnabled = true;
+        }
+    else if (0 == strcmp (cmd, "acc set click det off"))
+        {
+            inst->clickDetectionEnabled = false;
+        }
+    else if (0 == strcmp (cmd, "start"))
+        {
+            startStreaming (inst, nowUs);
+        }
+    else
+        {
+            cliPrint (inst, "Wrong command.Type in \"help\" for command list.");
+            cliPrint (inst, "\n\r>>");
+        }
+}
+
+/* line assembly and echo of HAL_UART_RxCpltCallback */
+static void
+receiveBytes (struct Instance *inst, const uint8_t *data, size_t len,
+              int64_t nowUs)
+{
+    /* echo of one pass goes out as queue items, like CLI_rxTask does */
+    char echo[CLI_MAX_LINE_LEN];
+    size_t echoLen = 0;
+
+    for (size_t i = 0; i < len; i++)
+        {
+            char c = data[i];
+            const char *out = NULL;
+            char str[2] =
+                { c, '\0' };
+
+            if (c == BACKSPACE)
+                {
+                    if (inst->rxIndex > 0)
+                        {
+                            out = "\b \b";
+                            inst->rxIndex--;
+                        }
+                }
+            else if (c == CLI_ENTER)
+                {
+                    out = "\n\r";
+                }
+            else if (c == '\n')
+                {
+                    /* CR LF line endings are ignored */
+                }
+            else if (inst->rxIndex < CLI_MAX_LINE_LEN - 1)
+                {
+                    out = str;
+                    inst->rxLine[inst->rxIndex++] = c;
+                }
+            else
+                {
+                    linkPush (inst, echo, echoLen, echoLen > 0);
+                    echoLen = 0;
+                    inst->rxIndex = 0;
+                    linkPush (inst, "\n\rCommand too long.\n\r>>", 23,
+                              true);
+                }
+
+            if (out != NULL)
+                {
+                    size_t n = strlen (out);
+                    if (echoLen + n >= CLI_MAX_LINE_LEN)
+                        {
+                            linkPush (inst, echo, echoLen, true);
+                            echoLen = 0;
+                        }
+                    memcpy (&echo[echoLen], out, n);
+                    echoLen += n;
+                }
+
+            if (c == CLI_ENTER)
+                {
+                    linkPush (inst, echo, echoLen, true);
+                    echoLen = 0;
+                    inst->rxLine[inst->rxIndex] = '\0';
+                    inst->rxIndex = 0;
+                    executeCommand (inst, inst->rxLine, nowUs);
+                }
+        }
+    if (echoLen > 0)
+        {
+            linkPush (inst, echo, echoLen, true);
+        }
+}
+
+/* next raw sample in mili g, returns true if click detected */
+static bool
+generateSample (struct Instance *inst, int16_t xyz[3])
+{
+    bool click = false;
+
+    if (base.replayEnabled)
+        {
+            struct record_Columns columns;
+            if (record_getColumns (&base.replay, inst->replayChunk, &columns)
+                    == 0)
+                {
+                    xyz[0] = columns.x[inst->replayPos];
+                    xyz[1] = columns.y[inst->replayPos];
+                    xyz[2] = columns.z[inst->replayPos];
+                    click = columns.flags[inst->replayPos]
+                            & DEVSTREAM_FLAG_CLICK;
+                    if (++inst->replayPos >= columns.count)
+                        {
+                            inst->replayPos = 0;
+                            inst->replayChunk = (inst->replayChunk + 1)
+                                    % base.replay.numOfChunks;
+                        }
+                }
+        }
+    else
+        {
+            double t = inst->sampleIndex * 1000.0 / inst->rateMhz;
+            double noise[3];
+            for (int a = 0; a < 3; a++)
+                {
+                    noise[a] = (int32_t) (nextRandom (inst) % 41) - 20;
+                }
+            xyz[0] = 30.0 * sin (2 * M_PI * 3.1 * t) + noise[0];
+            xyz[1] = 20.0 * sin (2 * M_PI * 5.3 * t + 1.0) + noise[1];
+            xyz[2] = 1000.0 + 10.0 * sin (2 * M_PI * 0.7 * t) + noise[2];
+
+            /* periodic impact */
+            uint64_t clickPeriod = base.clickPeriodS * inst->rateMhz / 1000.0;
+            if (clickPeriod > 0 && inst->sampleIndex % clickPeriod == 0
+                    && inst->sampleIndex > 0)
+                {
+                    xyz[2] += 1500;
+                    click = true;
+                }
+        }
+
+    /* sensor saturates at full scale */
+    int32_t limit = inst->fullScale * 1000;
+    for (int a = 0; a < 3; a++)
+        {
+            if (xyz[a] > limit)
+                {
+                    xyz[a] = limit;
+                }
+            else if (xyz[a] < -limit)
+                {
+                    xyz[a] = -limit;
+                }
+        }
+    return click;
+}
+
+/* sample processing of main_task in SYSTEM_ACC_DATA_PROCESSING state */
+static void
+processSample (struct Instance *inst, const int16_t xyz[3], bool click,
+               int64_t sampleUs)
+{
+    int16_t averaged[3];
+
+    inst->xBuff[inst->head] = xyz[0];
+    inst->yBuff[inst->head] = xyz[1];
+    inst->zBuff[inst->head] = xyz[2];
+    int16_t sub = inst->head - inst->numOfAveragedSamples;
+    if (sub < 0)
+        {
+            sub += ACC_MAX_AVG_NUMBER;
+        }
+    inst->xNum += inst->xBuff[inst->head] - inst->xBuff[sub];
+    inst->yNum += inst->yBuff[inst->head] - inst->yBuff[sub];
+    inst->zNum += inst->zBuff[inst->head] - inst->zBuff[sub];
+    if (++inst->head >= ACC_MAX_AVG_NUMBER)
+        {
+            inst->head = 0;
+        }
+    inst->samples++;
+
+    if (0 < linkSpacesAvailable (inst))
+        {
+            char line[CLI_MAX_LINE_LEN];
+            char *end = line;
+            averaged[0] = inst->xNum / inst->numOfAveragedSamples;
+            averaged[1] = inst->yNum / inst->numOfAveragedSamples;
+            averaged[2] = inst->zNum / inst->numOfAveragedSamples;
+            *end++ = '\r';
+            for (int a = 0; a < 3; a++)
+                {
+                    end = fmt_milliG (end, averaged[a]);
+                }
+            linkPush (inst, line, end - line, true);
+            inst->linesPrinted++;
+        }
+    else
+        {
+            inst->linesSkipped++;
+        }
+
+    if (click && inst->clickDetectionEnabled)
+        {
+            /* RTC is set to 00:00:00 at boot */
+            int64_t s = (sampleUs - inst->bootUs) / 1000000;
+            char line[CLI_MAX_LINE_LEN];
+            char *end = fmt_str (line, "   ");
+            end = fmt_hhmmss (end, s / 3600 % 24, s / 60 % 60, s % 60);
+            end = fmt_str (end, "\b\b\b\b\b\b\b\b");
+            linkPush (inst, line, end - line, true);
+        }
+}
+
+static int
+createInstance (struct Instance *inst, int index, const char *linkPrefix,
+                uint32_t seed, int64_t nowUs)
+{
+    struct termios tio;
+
+    memset (inst, 0, sizeof(*inst));
+    inst->master = posix_openpt (O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (inst->master < 0 || grantpt (inst->master)
+            || unlockpt (inst->master))
+        {
+            return -1;
+        }
+    snprintf (inst->path, sizeof(inst->path), "%s", ptsname (inst->master));
+
+    /* keep slave open so the master does not hang up when host closes the port */
+    inst->slave = open (inst->path, O_RDWR | O_NOCTTY);
+    if (inst->slave < 0)
+        {
+            return -1;
+        }
+    if (0 == tcgetattr (inst->slave, &tio))
+        {
+            cfmakeraw (&tio);
+            tcsetattr (inst->slave, TCSANOW, &tio);
+        }
+
+    if (linkPrefix)
+        {
+            char linkPath[128];
+            snprintf (linkPath, sizeof(linkPath), "%s%d", linkPrefix, index);
+            unlink (linkPath);
+            if (symlink (inst->path, linkPath))
+                {
+                    return -1;
+                }
+        }
+
+    inst->state = SYSTEM_IDLE;
+    inst->fullScale = DEFAULT_FULL_SCALE;
+    inst->rateMhz = DEFAULT_RATE_MHZ;
+    inst->numOfAveragedSamples = 1;
+    inst->rng = seed + index * 7919u;
+    inst->bootUs = nowUs;
+    inst->link.lastDrainUs = nowUs;
+    if (base.replayEnabled)
+        {
+            inst->replayChunk = index % base.replay.numOfChunks;
+        }
+    cliPrint (inst, "Type in \"help\" for command list\n\r>>");
+    return 0;
+}
+
+static void
+printStatistics (void)
+{
+    fprintf (stderr, "inst     samples     printed     skipped   bytes sent"
+             "  bytes lost\n");
+    for (int i = 0; i < base.numOfInstances; i++)
+        {
+            const struct Instance *inst = &base.instances[i];
+            fprintf (stderr, "%4d %11llu %11llu %11llu %12llu %11llu\n", i,
+                     (unsigned long long) inst->samples,
+                     (unsigned long long) inst->linesPrinted,
+                     (unsigned long long) inst->linesSkipped,
+                     (unsigned long long) inst->bytesSent,
+                     (unsigned long long) inst->bytesDropped);
+        }
+}
+
+static int
+usage (void)
+{
+    fprintf (stderr,
+             "usage: acc_emulator [-n instances] [-r replay file] [-b baud|0]"
+             " [-l link prefix] [-c click period s] [-s seed]\n");
+    return 1;
+}
+
+int
+main (int argc, char **argv)
+{
+    const char *linkPrefix = NULL, *replayPath = NULL;
+    uint32_t seed = 1;
+    int opt;
+
+    base.numOfInstances = 1;
+    base.baud = SERIAL_DEFAULT_BAUD;
+    base.clickPeriodS = DEFAULT_CLICK_PERIOD_S;
+    while ((opt = getopt (argc, argv, "n:r:b:l:c:s:")) != -1)
+        {
+            switch (opt)
+                {
+                case 'n':
+                    base.numOfInstances = atoi (optarg);
+                    break;
+                case 'r':
+                    replayPath = optarg;
+                    break;
+                case 'b':
+                    base.baud = strtoul (optarg, NULL, 0);
+                    break;
+                case 'l':
+                    linkPrefix = optarg;
+                    break;
+                case 'c':
+                    base.clickPeriodS = atof (optarg);
+                    break;
+                case 's':
+                    seed = strtoul (optarg, NULL, 0);
+                    break;
+                default:
+                    return usage ();
+                }
+        }
+    if (base.numOfInstances < 1 || base.numOfInstances > MAX_INSTANCES)
+        {
+            fprintf (stderr, "number of instances must be 1..%d\n",
+                     MAX_INSTANCES);
+            return 1;
+        }
+    if (replayPath)
+        {
+            if (record_open (&base.replay, replayPath)
+                    || base.replay.numOfChunks == 0)
+                {
+                    fprintf (stderr, "can not replay %s\n", replayPath);
+                    return 1;
+                }
+            base.replayEnabled = true;
+        }
+
+    base.instances = calloc (base.numOfInstances, sizeof(struct Instance));
+    struct pollfd *fds = calloc (base.numOfInstances, sizeof(struct pollfd));
+    if (!base.instances || !fds)
+        {
+            return 1;
+        }
+    int64_t now = serial_getMonotonicUs ();
+    for (int i = 0; i < base.numOfInstances; i++)
+        {
+            if (createInstance (&base.instances[i], i, linkPrefix, seed, now))
+                {
+                    fprintf (stderr, "can not create instance %d: %s\n", i,
+                             strerror (errno));
+                    return 1;
+                }
+            fds[i].fd = base.instances[i].master;
+            fds[i].events = POLLIN;
+            printf ("%s\n", base.instances[i].path);
+        }
+    fflush (stdout);
+
+    signal (SIGINT, onSignal);
+    signal (SIGTERM, onSignal);
+    while (!base.stopRequested)
+        {
+            /* sleep until the nearest sample or wire deadline */
+            now = serial_getMonotonicUs ();
+            int64_t wake = now + 100000;
+            for (int i = 0; i < base.numOfInstances; i++)
+                {
+                    struct Instance *inst = &base.instances[i];
+                    if (inst->state == SYSTEM_ACC_DATA_PROCESSING
+                            && inst->nextSampleUs < wake)
+                        {
+                            wake = inst->nextSampleUs;
+                        }
+                    if (inst->link.len > 0 && now + WIRE_TICK_US < wake)
+                        {
+                            wake = now + WIRE_TICK_US;
+                        }
+                }
+            int64_t waitUs = wake > now ? wake - now : 0;
+            struct timespec timeout =
+                { waitUs / 1000000, (waitUs % 1000000) * 1000 };
+            int ready = ppoll (fds, base.numOfInstances, &timeout, NULL);
+            if (ready < 0 && errno != EINTR)
+                {
+                    break;
+                }
+
+            now = serial_getMonotonicUs ();
+            for (int i = 0; i < base.numOfInstances; i++)
+                {
+                    struct Instance *inst = &base.instances[i];
+                    if (ready > 0 && (fds[i].revents & POLLIN))
+                        {
+                            uint8_t rx[RX_BUFF_LEN];
+                            ssize_t n = read (inst->master, rx, sizeof(rx));
+                            if (n > 0)
+                                {
+                                    receiveBytes (inst, rx, n, now);
+                                }
+                        }
+
+                    /* generate all samples which are due */
+                    while (inst->state == SYSTEM_ACC_DATA_PROCESSING
+                            && inst->nextSampleUs <= now)
+                        {
+                            int16_t xyz[3];
+                            bool click = generateSample (inst, xyz);
+                            processSample (inst, xyz, click,
+                                           inst->nextSampleUs);
+                            inst->sampleIndex++;
+                            inst->nextSampleUs = inst->startUs
+                                    + (int64_t) (inst->sampleIndex
+                                            * 1000000000.0 / inst->rateMhz);
+                            /* bytes leave the wire while samples are produced */
+                            linkDrain (inst, inst->nextSampleUs < now ?
+                                    inst->nextSampleUs : now);
+                        }
+                    linkDrain (inst, now);
+                }
+        }
+
+    printStatistics ();
+    if (base.replayEnabled)
+        {
+            record_release (&base.replay);
+        }
+    return 0;
+}
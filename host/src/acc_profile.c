@@ -0,0 +1,336 @@
+/*
+ * acc_profile.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Runs the firmware profile store on emulated flash image.
+ *
+ *          acc_profile <image> list                                     list profiles, * marks boot profile
+ *          acc_profile <image> save <name> <g> <Hz> <avg> [click 0|1]   save setup, same for both sensors
+ *          acc_profile <image> show <name>                              print profile content
+ *          acc_profile <image> default <name>                           select boot profile
+ *          acc_profile <image> stress <saves> [seed]                    random saves with power cuts,
+ *                                                                       checks every profile after each
+ *
+ *      Image has the layout of the firmware store: FLASH_PROFILE_PAGES pages of 2 KB.
+ */
+#include "flashemu.h"
+#include "profile.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* === private defines === */
+#define PAGE_SIZE                       2048                                    /// STM32F302R8 flash page
+#define NUM_OF_PAGES                    2                                       /// FLASH_PROFILE_PAGES
+#define STRESS_NAMES                    4
+#define POWER_CUT_ONE_IN                8                                       /// share of saves interrupted by power loss
+
+/* values of enum sensor_AccRate and enum sensor_AccFullScale */
+#define RATE_CODE(n)                    ((n) << 4)
+#define FULL_SCALE_CODE(n)              ((n) << 3)
+
+/* === private variables === */
+static const uint16_t rates[] =
+    { 3, 6, 12, 25, 50, 100, 200, 400, 800, 1600 };
+static const uint8_t fullScales[] =
+    { 2, 4, 6, 8, 16 };
+
+/* === private functions === */
+static int
+rateToCode (unsigned hz)
+{
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+        {
+            if (rates[i] == hz)
+                {
+                    return RATE_CODE(i + 1);
+                }
+        }
+    return -1;
+}
+
+static int
+fullScaleToCode (unsigned g)
+{
+    for (size_t i = 0; i < sizeof(fullScales); i++)
+        {
+            if (fullScales[i] == g)
+                {
+                    return FULL_SCALE_CODE(i);
+                }
+        }
+    return -1;
+}
+
+static const char*
+statusString (enum profile_Status status)
+{
+    switch (status)
+        {
+        case PROFILE_OK:
+            return "ok";
+        case PROFILE_NOT_FOUND:
+            return "no such profile";
+        case PROFILE_FULL:
+            return "profile store full";
+        case PROFILE_INVALID_NAME:
+            return "wrong profile name";
+        case PROFILE_FLASH_ERROR:
+        default:
+            return "flash error";
+        }
+}
+
+static void
+printInfo (void)
+{
+    struct profile_Info info;
+    const struct flashemu_Stats *stats = flashemu_getStats ();
+
+    profile_getInfo (&info);
+    printf ("page %u, sequence %u, %u bytes used, %u free\n",
+            info.activePage, info.sequence, info.usedBytes, info.freeBytes);
+    printf ("erases per page:");
+    for (uint8_t p = 0; p < NUM_OF_PAGES; p++)
+        {
+            printf (" %u", stats->erases[p]);
+        }
+    printf ("\n");
+}
+
+static int
+cmdList (void)
+{
+    char defaultName[PROFILE_NAME_LEN] = "";
+    const char *name = profile_getDefault ();
+
+    if (name != NULL)
+        {
+            strncpy (defaultName, name, PROFILE_NAME_LEN - 1);
+        }
+    for (uint8_t n = 0; (name = profile_getName (n)) != NULL; n++)
+        {
+            printf ("%c %s\n", strcmp (name, defaultName) == 0 ? '*' : ' ',
+                    name);
+        }
+    printInfo ();
+    return 0;
+}
+
+static int
+cmdSave (int argc, char **argv)
+{
+    struct profile_Config config;
+
+    if (argc < 4)
+        {
+            fprintf (stderr, "save <name> <g> <Hz> <avg> [click 0|1]\n");
+            return 1;
+        }
+    int fs = fullScaleToCode (atoi (argv[1]));
+    int rate = rateToCode (atoi (argv[2]));
+    int avg = atoi (argv[3]);
+    if (fs < 0 || rate < 0 || avg < 1 || avg > 500)
+        {
+            fprintf (stderr, "wrong setup\n");
+            return 1;
+        }
+
+    memset (&config, 0, sizeof(config));
+    for (int i = 0; i < PROFILE_MAX_SENSORS; i++)
+        {
+            config.sensors[i].fullScale = fs;
+            config.sensors[i].rate = rate;
+            config.sensors[i].avgNumber = avg;
+        }
+    config.clickDetection = (argc > 4) ? atoi (argv[4]) != 0 : 0;
+
+    enum profile_Status status = profile_save (argv[0], &config);
+    printf ("%s\n", statusString (status));
+    return status != PROFILE_OK;
+}
+
+static int
+cmdShow (const char *name)
+{
+    struct profile_Config config;
+    enum profile_Status status = profile_load (name, &config);
+
+    if (status != PROFILE_OK)
+        {
+            printf ("%s\n", statusString (status));
+            return 1;
+        }
+    for (int i = 0; i < PROFILE_MAX_SENSORS; i++)
+        {
+            const struct profile_SensorConfig *s = &config.sensors[i];
+            printf ("sensor %d: +/- %u g, %u Hz, avg %u, aa 0x%02x\n", i,
+                    fullScales[(s->fullScale >> 3) % sizeof(fullScales)],
+                    s->rate ? rates[((s->rate >> 4) - 1) % 10] : 0,
+                    s->avgNumber, s->AAFilterBW);
+        }
+    printf ("click detection %s\n", config.clickDetection ? "ON" : "OFF");
+    return 0;
+}
+
+static void
+randomConfig (struct profile_Config *config)
+{
+    memset (config, 0, sizeof(*config));
+    for (int i = 0; i < PROFILE_MAX_SENSORS; i++)
+        {
+            config->sensors[i].fullScale = FULL_SCALE_CODE(rand () % 5);
+            config->sensors[i].rate = RATE_CODE(1 + rand () % 10);
+            config->sensors[i].AAFilterBW = (rand () % 4) << 6;
+            config->sensors[i].avgNumber = 1 + rand () % 500;
+        }
+    config->clickDetection = rand () % 2;
+}
+
+/* Random saves, some interrupted by power loss followed by remount. After every step each
+ * profile must hold the last content saved successfully, or the interrupted one. */
+static int
+cmdStress (int argc, char **argv)
+{
+    static const char *names[STRESS_NAMES] =
+        { "lab", "line1", "line2", "drop" };
+    struct profile_Config expected[STRESS_NAMES], config, loaded;
+    bool known[STRESS_NAMES] =
+        { false };
+    unsigned long saves, mismatches = 0, interrupted = 0;
+
+    if (argc < 1)
+        {
+            fprintf (stderr, "stress <saves> [seed]\n");
+            return 1;
+        }
+    saves = strtoul (argv[0], NULL, 10);
+    srand (argc > 1 ? atoi (argv[1]) : 1);
+
+    /* names from earlier runs are part of the expected state */
+    for (int n = 0; n < STRESS_NAMES; n++)
+        {
+            known[n] = PROFILE_OK == profile_load (names[n], &expected[n]);
+        }
+
+    for (unsigned long i = 0; i < saves; i++)
+        {
+            int n = rand () % STRESS_NAMES;
+            randomConfig (&config);
+            if (rand () % POWER_CUT_ONE_IN == 0)
+                {
+                    flashemu_cutPowerAfter (rand () % (PAGE_SIZE + 64));
+                }
+
+            enum profile_Status status = profile_save (names[n], &config);
+            if (flashemu_isPowerLost ())
+                {
+                    /* reboot, interrupted save may or may not be visible */
+                    interrupted++;
+                    flashemu_powerOn ();
+                    if (PROFILE_OK != profile_init (flashemu_getArea ()))
+                        {
+                            fprintf (stderr, "remount failed\n");
+                            return 1;
+                        }
+                    if (PROFILE_OK == profile_load (names[n], &loaded)
+                            && 0 == memcmp (&loaded, &config, sizeof(config)))
+                        {
+                            expected[n] = config;
+                            known[n] = true;
+                        }
+                }
+            else
+                {
+                    flashemu_powerOn ();
+                    if (status != PROFILE_OK)
+                        {
+                            fprintf (stderr, "save %lu: %s\n", i,
+                                     statusString (status));
+                            return 1;
+                        }
+                    expected[n] = config;
+                    known[n] = true;
+                }
+
+            for (int k = 0; k < STRESS_NAMES; k++)
+                {
+                    status = profile_load (names[k], &loaded);
+                    if (known[k]
+                            && (status != PROFILE_OK
+                                    || memcmp (&loaded, &expected[k],
+                                               sizeof(loaded)) != 0))
+                        {
+                            mismatches++;
+                            fprintf (stderr, "save %lu: %s lost\n", i,
+                                     names[k]);
+                            expected[k] = loaded;
+                            known[k] = status == PROFILE_OK;
+                        }
+                }
+        }
+
+    printf ("%lu saves, %lu interrupted by power loss, %lu mismatches\n",
+            saves, interrupted, mismatches);
+    printInfo ();
+    return mismatches != 0;
+}
+
+/* === exported functions === */
+int
+main (int argc, char **argv)
+{
+    int ret;
+
+    if (argc < 3)
+        {
+            fprintf (stderr,
+                     "usage: %s <image> list|save|show|default|stress ...\n",
+                     argv[0]);
+            return 1;
+        }
+    if (flashemu_open (argv[1], PAGE_SIZE, NUM_OF_PAGES) != 0)
+        {
+            fprintf (stderr, "%s: %s\n", argv[1], strerror (errno));
+            return 1;
+        }
+    if (PROFILE_OK != profile_init (flashemu_getArea ()))
+        {
+            fprintf (stderr, "mount failed\n");
+            flashemu_close ();
+            return 1;
+        }
+
+    if (strcmp (argv[2], "list") == 0)
+        {
+            ret = cmdList ();
+        }
+    else if (strcmp (argv[2], "save") == 0)
+        {
+            ret = cmdSave (argc - 3, argv + 3);
+        }
+    else if (strcmp (argv[2], "show") == 0 && argc > 3)
+        {
+            ret = cmdShow (argv[3]);
+        }
+    else if (strcmp (argv[2], "default") == 0 && argc > 3)
+        {
+            enum profile_Status status = profile_setDefault (argv[3]);
+            printf ("%s\n", statusString (status));
+            ret = status != PROFILE_OK;
+        }
+    else if (strcmp (argv[2], "stress") == 0)
+        {
+            ret = cmdStress (argc - 3, argv + 3);
+        }
+    else
+        {
+            fprintf (stderr, "unknown command %s\n", argv[2]);
+            ret = 1;
+        }
+    flashemu_close ();
+    return ret;
+}
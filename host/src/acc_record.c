@@ -0,0 +1,264 @@
+/*
+ * acc_record.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Recorder and query tool for chunked columnar capture files.
+ *
+ *          acc_record record <file> <port|-> [chunk len]   record device stream until SIGINT
+ *          acc_record info <file>                          print chunk summary
+ *          acc_record window <file> <center s> <half s>    print samples around given time as csv
+ *          acc_record clicks <file>                        list samples with click detection
+ *          acc_record max <file> [t0 s] [t1 s]             sample with the highest magnitude
+ *          acc_record stats <file> [t0 s] [t1 s]           per axis min/max/mean
+ *
+ *      Times given to queries are in seconds relative to the first sample in file.
+ */
+#include "devstream.h"
+#include "record.h"
+#include "serial.h"
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* === private defines === */
+#define READ_BUFF_LEN                   4096
+#define US_PER_S                        1000000.0
+
+/* === private variables === */
+static volatile sig_atomic_t stopRequested;
+
+/* === private functions === */
+static void
+onSignal (int sig)
+{
+    (void) sig;
+    stopRequested = 1;
+}
+
+static void
+appendSample (const struct devstream_Sample *sample, void *ctx)
+{
+    struct record_Writer *writer = ctx;
+    if (record_append (writer, sample))
+        {
+            fprintf (stderr, "write failed: %s\n", strerror (errno));
+            stopRequested = 1;
+        }
+}
+
+static void
+printSample (const struct devstream_Sample *sample, void *ctx)
+{
+    int64_t origin = *(const int64_t*) ctx;
+    printf ("%.6f,%d,%d,%d,%u\n", (sample->timeUs - origin) / US_PER_S,
+            sample->x, sample->y, sample->z, sample->flags);
+}
+
+static int
+recordStream (const char *path, const char *port, uint32_t chunkLen)
+{
+    struct record_Writer writer;
+    struct devstream_Parser parser;
+    uint8_t buff[READ_BUFF_LEN];
+    int fd = 0;
+
+    if (strcmp (port, "-") != 0)
+        {
+            fd = serial_open (port, SERIAL_DEFAULT_BAUD, 0);
+            if (fd < 0)
+                {
+                    fprintf (stderr, "can not open %s: %s\n", port,
+                             strerror (errno));
+                    return 1;
+                }
+        }
+    if (record_create (&writer, path, chunkLen))
+        {
+            fprintf (stderr, "can not create %s: %s\n", path,
+                     strerror (errno));
+            return 1;
+        }
+
+    signal (SIGINT, onSignal);
+    signal (SIGTERM, onSignal);
+    devstream_init (&parser, appendSample, &writer);
+
+    while (!stopRequested)
+        {
+            ssize_t n = read (fd, buff, sizeof(buff));
+            if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+            if (n <= 0)
+                {
+                    break;
+                }
+            devstream_feed (&parser, buff, n, serial_getTimeUs ());
+        }
+
+    if (record_close (&writer))
+        {
+            fprintf (stderr, "can not finalise %s\n", path);
+            return 1;
+        }
+    fprintf (stderr, "%llu samples, %llu setup changes, %llu malformed lines\n",
+             (unsigned long long) parser.samples,
+             (unsigned long long) parser.configs,
+             (unsigned long long) parser.malformed);
+    return 0;
+}
+
+static void
+printInfo (struct record_Reader *reader)
+{
+    printf ("%zu chunks%s\n", reader->numOfChunks,
+            reader->recovered ? " (index recovered)" : "");
+    for (size_t c = 0; c < reader->numOfChunks; c++)
+        {
+            const struct record_ChunkInfo *info = &reader->index[c];
+            printf ("%6zu %8u samples %.3f..%.3f s  x[%d %d] y[%d %d] "
+                    "z[%d %d]%s\n",
+                    c, info->count,
+                    (info->t0Us - reader->index[0].t0Us) / US_PER_S,
+                    (info->t1Us - reader->index[0].t0Us) / US_PER_S,
+                    info->min[0], info->max[0], info->min[1], info->max[1],
+                    info->min[2], info->max[2],
+                    (info->flagsMask & DEVSTREAM_FLAG_CLICK) ? " click" : "");
+        }
+}
+
+static void
+printClicks (struct record_Reader *reader, int64_t origin)
+{
+    struct record_Columns columns;
+    for (size_t c = 0; c < reader->numOfChunks; c++)
+        {
+            if (!(reader->index[c].flagsMask & DEVSTREAM_FLAG_CLICK)
+                    || record_getColumns (reader, c, &columns))
+                {
+                    continue;
+                }
+            for (uint32_t i = 0; i < columns.count; i++)
+                {
+                    if (columns.flags[i] & DEVSTREAM_FLAG_CLICK)
+                        {
+                            printf ("%.6f\n",
+                                    (columns.t[i] - origin) / US_PER_S);
+                        }
+                }
+        }
+}
+
+static int
+usage (void)
+{
+    fprintf (stderr,
+             "usage: acc_record record <file> <port|-> [chunk len]\n"
+             "       acc_record info|clicks <file>\n"
+             "       acc_record window <file> <center s> <half s>\n"
+             "       acc_record max|stats <file> [t0 s] [t1 s]\n");
+    return 1;
+}
+
+int
+main (int argc, char **argv)
+{
+    struct record_Reader reader;
+
+    if (argc < 3)
+        {
+            return usage ();
+        }
+    if (0 == strcmp (argv[1], "record"))
+        {
+            if (argc < 4)
+                {
+                    return usage ();
+                }
+            return recordStream (argv[2], argv[3],
+                                 argc > 4 ? strtoul (argv[4], NULL, 0) : 0);
+        }
+
+    if (record_open (&reader, argv[2]))
+        {
+            fprintf (stderr, "can not open %s\n", argv[2]);
+            return 1;
+        }
+    if (reader.numOfChunks == 0)
+        {
+            fprintf (stderr, "no samples in %s\n", argv[2]);
+            record_release (&reader);
+            return 1;
+        }
+
+    int64_t origin = reader.index[0].t0Us;
+    int64_t t0 = INT64_MIN, t1 = INT64_MAX;
+    if (argc > 3)
+        {
+            t0 = origin + (int64_t) (atof (argv[3]) * US_PER_S);
+        }
+    if (argc > 4)
+        {
+            t1 = origin + (int64_t) (atof (argv[4]) * US_PER_S);
+        }
+
+    int status = 0;
+    if (0 == strcmp (argv[1], "info"))
+        {
+            printInfo (&reader);
+        }
+    else if (0 == strcmp (argv[1], "clicks"))
+        {
+            printClicks (&reader, origin);
+        }
+    else if (0 == strcmp (argv[1], "window") && argc > 4)
+        {
+            int64_t center = origin + (int64_t) (atof (argv[3]) * US_PER_S);
+            int64_t half = (int64_t) (atof (argv[4]) * US_PER_S);
+            printf ("t,x,y,z,flags\n");
+            record_query (&reader, center - half, center + half, printSample,
+                          &origin);
+        }
+    else if (0 == strcmp (argv[1], "max"))
+        {
+            struct devstream_Sample sample;
+            if (record_findMaxMagnitude (&reader, t0, t1, &sample))
+                {
+                    printf ("%.6f s: %.3f g (%d, %d, %d mg)\n",
+                            (sample.timeUs - origin) / US_PER_S,
+                            sqrt ((double) sample.x * sample.x
+                                    + (double) sample.y * sample.y
+                                    + (double) sample.z * sample.z) / 1000.0,
+                            sample.x, sample.y, sample.z);
+                }
+        }
+    else if (0 == strcmp (argv[1], "stats"))
+        {
+            int16_t min[RECORD_AXES], max[RECORD_AXES];
+            double mean[RECORD_AXES];
+            uint64_t n = record_getAxisStats (&reader, t0, t1, min, max,
+                                              mean);
+            printf ("%llu samples\n", (unsigned long long) n);
+            for (int a = 0; n && a < RECORD_AXES; a++)
+                {
+                    printf ("%c: min %d max %d mean %.1f mg\n", 'x' + a,
+                            min[a], max[a], mean[a]);
+                }
+        }
+    else
+        {
+            status = usage ();
+        }
+
+    fprintf (stderr, "%llu of %zu chunks touched\n",
+             (unsigned long long) reader.chunksTouched, reader.numOfChunks);
+    record_release (&reader);
+    return status;
+}
@@ -0,0 +1,342 @@
+/*
+ * acc_timesync.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Time synchronisation with the device, see timesync.h. "sync" sends a request every interval
+ *      and prints each exchange and the current offset and drift estimate, device time can then be
+ *      mapped to host wall clock as host = device + offset + drift * (device - ref). Works while
+ *      the device streams, sample lines are skipped. "check" runs the estimator against a simulated
+ *      device with drifting clock and asymmetric, spiky link latency.
+ *
+ *          acc_timesync sync <port> [interval ms] [count]
+ *          acc_timesync check [seed]
+ */
+#include "serial.h"
+#include "timesync.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* === private defines === */
+#define READ_BUFF_LEN                   4096
+#define LINE_MAX_LEN                    128
+#define DEFAULT_INTERVAL_MS             1000
+#define CHECK_EXCHANGES                 400
+#define CHECK_INTERVAL_US               1000000
+#define CHECK_MAX_ERROR_US              200.0
+#define CHECK_MAX_DRIFT_ERROR_PPM       3.0
+#define US_PER_S                        1000000
+
+/* === private types === */
+/** reply line assembly */
+struct LineReader
+{
+    char line[LINE_MAX_LEN];
+    size_t len;
+};
+
+/** simulated link and device clock */
+struct Case
+{
+    const char *name;
+    double driftPpm;                                                            /// host rate over device rate minus 1
+    double driftStepPpm;                                                        /// drift change half way, 0 for none
+    double latencyUs;                                                           /// fixed part of USB latency, each direction
+    double jitterUs;                                                            /// mean of exponential latency jitter
+    uint32_t spikeOneIn;                                                        /// share of exchanges delayed by scheduler, 0 for none
+};
+
+/* === private variables === */
+static volatile sig_atomic_t stopRequested;
+
+static const struct Case cases[] =
+    {
+        { "+40 ppm, quiet link", 40, 0, 500, 50, 0 },
+        { "-25 ppm, jittery link", -25, 0, 1000, 400, 0 },
+        { "+10 ppm, latency spikes", 10, 0, 1000, 200, 4 },
+        { "drift step +50 to -10 ppm", 50, -60, 800, 150, 10 } };
+
+/* === private functions === */
+static void
+onSignal (int sig)
+{
+    (void) sig;
+    stopRequested = 1;
+}
+
+/* Collect line, returns 1 on line end */
+static int
+feedChar (struct LineReader *reader, char c)
+{
+    if (c == '\n' || c == '\r')
+        {
+            reader->line[reader->len] = '\0';
+            int complete = reader->len > 0;
+            reader->len = 0;
+            return complete;
+        }
+    if (reader->len < LINE_MAX_LEN - 1)
+        {
+            reader->line[reader->len++] = c;
+        }
+    return 0;
+}
+
+static void
+printEstimate (const struct timesync_State *state)
+{
+    struct timesync_Estimate estimate;
+
+    if (0 == timesync_getEstimate (state, &estimate))
+        {
+            printf ("  offset %.1f us at device %.6f s, drift %+.3f ppm, "
+                    "residual %.1f us, %u of %u used\n",
+                    estimate.offsetUs, estimate.refDeviceUs / (double) US_PER_S,
+                    estimate.driftPpm, estimate.residualUs, estimate.used,
+                    state->count);
+        }
+}
+
+static int
+runSync (const char *port, uint32_t intervalMs, uint32_t count)
+{
+    struct timesync_State state;
+    struct LineReader reader =
+        { .len = 0 };
+    char request[TIMESYNC_REQUEST_MAX_LEN];
+    char buff[READ_BUFF_LEN];
+    uint32_t sent = 0;
+
+    int fd = serial_open (port, SERIAL_DEFAULT_BAUD, 0);
+    if (fd < 0)
+        {
+            fprintf (stderr, "can not open %s: %s\n", port, strerror (errno));
+            return 1;
+        }
+    signal (SIGINT, onSignal);
+    timesync_init (&state, SERIAL_DEFAULT_BAUD);
+
+    int64_t next = serial_getTimeUs ();
+    while (!stopRequested && (count == 0 || state.exchanges < count))
+        {
+            int64_t now = serial_getTimeUs ();
+            if (now >= next && (count == 0 || sent < count))
+                {
+                    size_t len = timesync_formatRequest (request, now);
+                    if (write (fd, request, len) != (ssize_t) len)
+                        {
+                            fprintf (stderr, "write failed: %s\n",
+                                     strerror (errno));
+                            break;
+                        }
+                    sent++;
+                    next = now + (int64_t) intervalMs * 1000;
+                }
+            struct pollfd pfd =
+                { .fd = fd, .events = POLLIN };
+            int timeoutMs = (int) ((next - now) / 1000);
+            if (poll (&pfd, 1, timeoutMs > 0 ? timeoutMs : 0) <= 0)
+                {
+                    continue;
+                }
+            ssize_t n = read (fd, buff, sizeof(buff));
+            int64_t rxUs = serial_getTimeUs ();
+            if (n <= 0)
+                {
+                    if (n < 0 && errno == EINTR)
+                        {
+                            continue;
+                        }
+                    break;
+                }
+            for (ssize_t i = 0; i < n; i++)
+                {
+                    if (feedChar (&reader, buff[i])
+                            && timesync_onReply (&state, reader.line, rxUs))
+                        {
+                            const struct timesync_Exchange *x =
+                                    &state.window[(state.head
+                                            + TIMESYNC_WINDOW_LEN - 1)
+                                            % TIMESYNC_WINDOW_LEN];
+                            printf ("delay %6" PRId64 " us, offset %.1f us\n",
+                                    (x->t4 - x->t1) - (x->t3 - x->t2),
+                                    ((x->t1 - x->t2) + (x->t4 - x->t3)) / 2.0);
+                            printEstimate (&state);
+                        }
+                }
+        }
+    close (fd);
+    return state.exchanges == 0;
+}
+
+/* === self check === */
+static double
+expJitter (double meanUs)
+{
+    return -meanUs * log ((rand () + 1.0) / (RAND_MAX + 2.0));
+}
+
+static double
+linkLatency (const struct Case *c)
+{
+    double us = c->latencyUs + expJitter (c->jitterUs);
+    if (c->spikeOneIn != 0 && rand () % c->spikeOneIn == 0)
+        {
+            us += 2000 + rand () % 8000;
+        }
+    return us;
+}
+
+/* Device clock is piecewise linear in host time, drift changes at host time stepAt */
+struct Clock
+{
+    double hostStart, deviceStart;
+    double driftPpm, stepPpm, stepAt;
+};
+
+static double
+hostToDevice (const struct Clock *clock, double host)
+{
+    double stepHost = clock->stepAt > host ? host : clock->stepAt;
+    double device = clock->deviceStart
+            + (stepHost - clock->hostStart) / (1 + clock->driftPpm * 1e-6);
+    if (host > clock->stepAt)
+        {
+            device += (host - clock->stepAt)
+                    / (1 + (clock->driftPpm + clock->stepPpm) * 1e-6);
+        }
+    return device;
+}
+
+static double
+deviceToHost (const struct Clock *clock, double device)
+{
+    double stepDevice = hostToDevice (clock, clock->stepAt);
+    if (device <= stepDevice)
+        {
+            return clock->hostStart
+                    + (device - clock->deviceStart) * (1 + clock->driftPpm * 1e-6);
+        }
+    return clock->stepAt
+            + (device - stepDevice)
+                    * (1 + (clock->driftPpm + clock->stepPpm) * 1e-6);
+}
+
+static int
+runCase (const struct Case *c)
+{
+    struct timesync_State state;
+    struct timesync_Estimate estimate;
+    struct Clock clock =
+        { 1.7e15, 12.5e6, c->driftPpm, c->driftStepPpm, 1e300 };
+    double charUs = 10.0 * US_PER_S / SERIAL_DEFAULT_BAUD;
+    char request[TIMESYNC_REQUEST_MAX_LEN];
+    char line[LINE_MAX_LEN];
+    double host = clock.hostStart;
+
+    if (c->driftStepPpm != 0)
+        {
+            clock.stepAt = clock.hostStart
+                    + CHECK_EXCHANGES / 2 * (double) CHECK_INTERVAL_US;
+        }
+    timesync_init (&state, SERIAL_DEFAULT_BAUD);
+    for (uint32_t i = 0; i < CHECK_EXCHANGES; i++, host += CHECK_INTERVAL_US)
+        {
+            int64_t t1 = (int64_t) host;
+            size_t requestLen = timesync_formatRequest (request, t1);
+            double rxHost = t1 + linkLatency (c) + (requestLen + 1) * charUs;
+            int64_t t2 = (int64_t) floor (hostToDevice (&clock, rxHost));
+            uint32_t turnaround = 30 + rand () % 1500;                          // waits for line on the wire
+            snprintf (line, sizeof(line), "sync %" PRId64 " %" PRId64 ".%06" PRId64 " %06u",
+                      t1, t2 / US_PER_S, t2 % US_PER_S, turnaround);
+            double txHost = deviceToHost (&clock, (double) (t2 + turnaround));
+            int64_t t4 = (int64_t) (txHost + (strlen (line) + 1) * charUs
+                    + linkLatency (c));
+            if (!timesync_onReply (&state, line, t4))
+                {
+                    printf ("    reply not decoded: %s\n", line);
+                    return 1;
+                }
+        }
+
+    /* mapping of latest device time and drift of the clock at the end */
+    timesync_getEstimate (&state, &estimate);
+    double device = hostToDevice (&clock, host);
+    double errorUs = timesync_toHostUs (&estimate, (int64_t) device)
+            - deviceToHost (&clock, (double) (int64_t) device);
+    double driftError = estimate.driftPpm - (c->driftPpm + c->driftStepPpm);
+    int failed = fabs (errorUs) > CHECK_MAX_ERROR_US
+            || fabs (driftError) > CHECK_MAX_DRIFT_ERROR_PPM;
+    printf ("%-28s error %7.1f us, drift %+8.3f ppm (%+.3f), residual %6.1f us%s\n",
+            c->name, errorUs, estimate.driftPpm, driftError, estimate.residualUs,
+            failed ? "  FAILED" : "");
+    return failed;
+}
+
+/* Lines other than replies are not taken */
+static int
+checkParse (void)
+{
+    static const char *lines[] =
+        { "sync 12 3.000004", "sync 12 3.000004 000010 x",
+          "   0.016 g   -0.004 g    1.002 g", "sync", "sync x 1.0 1" };
+    struct timesync_Exchange x;
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+        {
+            failed |= timesync_parseReply (lines[i], &x);
+        }
+    failed |= !timesync_parseReply ("sync 12 3.000004 000010", &x) || x.t1 != 12
+            || x.t2 != 3000004 || x.t3 != 3000014;
+    printf ("%-28s%s\n", "reply parsing", failed ? "  FAILED" : "");
+    return failed;
+}
+
+static int
+check (unsigned seed)
+{
+    int failures = checkParse ();
+
+    srand (seed);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        {
+            failures += runCase (&cases[i]);
+        }
+    printf ("%d of %zu cases failed\n", failures,
+            sizeof(cases) / sizeof(cases[0]) + 1);
+    return failures != 0;
+}
+
+static int
+usage (void)
+{
+    fprintf (stderr, "usage: acc_timesync sync <port> [interval ms] [count]\n"
+             "       acc_timesync check [seed]\n");
+    return 1;
+}
+
+int
+main (int argc, char **argv)
+{
+    if (argc >= 2 && argc <= 3 && 0 == strcmp (argv[1], "check"))
+        {
+            return check (argc == 3 ? strtoul (argv[2], NULL, 0) : 1);
+        }
+    if (argc >= 3 && argc <= 5 && 0 == strcmp (argv[1], "sync"))
+        {
+            uint32_t intervalMs = argc > 3 ?
+                    strtoul (argv[3], NULL, 0) : DEFAULT_INTERVAL_MS;
+            uint32_t count = argc > 4 ? strtoul (argv[4], NULL, 0) : 0;
+            return runSync (argv[2], intervalMs ? intervalMs : 1, count);
+        }
+    return usage ();
+}
@@ -0,0 +1,582 @@
+/*
+ * acc_trace.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Converter of trace frames sent by "trace dump", see trace.h, into Chrome trace event JSON,
+ *      which chrome://tracing and Perfetto open. Tasks and interrupts become slices on their own
+ *      rows, queue fill levels become counters and blocking on a queue becomes an instant event on
+ *      the row of the blocked task. Times are microseconds from the oldest record.
+ *      "dump" sends the command itself, "convert" reads a saved stream. "check" records synthetic
+ *      events with the firmware trace module and verifies frame readout and conversion.
+ *
+ *          acc_trace dump <port> <out.json>
+ *          acc_trace convert <stream file|-> <out.json>
+ *          acc_trace check
+ */
+#include "capture.h"
+#include "serial.h"
+#include "trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* === private defines === */
+#define READ_BUFF_LEN                   4096
+#define DUMP_TIMEOUT_MS                 3000
+#define ISR_ROW_BASE                    1000                                    /// rows of interrupts follow task rows
+#define MAX_IDS                         256
+#define CHECK_CHUNK_LEN                 48                                      /// CLI_BIN_MAX_LEN of firmware
+#define CHECK_HZ                        72000000UL
+
+/* === private types === */
+/** frame receiver state */
+struct Receiver
+{
+    uint8_t frame[TRACE_MAX_FRAME_SIZE];
+    size_t len;                                                                 /// bytes collected
+    size_t frameSize;                                                           /// 0 until header is decoded
+    struct trace_FrameHeader header;
+    uint32_t frames, badFrames;
+};
+
+/** conversion state */
+struct Timeline
+{
+    FILE *out;
+    const struct trace_FrameHeader *header;
+    const uint8_t *names;                                                       /// task name table of frame
+    double nowUs;
+    uint32_t lastCycles;
+    uint32_t hz;
+    double taskStartUs[MAX_IDS];                                                /// < 0 when task is not running
+    double isrStartUs[MAX_IDS];
+    int currentTask;                                                            /// -1 before first switch
+    uint32_t events;
+};
+
+/* === private variables === */
+static const char *queueNames[TRACE_QUEUE_COUNT] =
+    { "other queue", "cli tx", "cli rx", "cli event", "sensor out",
+      "sensor event", "sensor notify", "dsp out" };
+
+/* === private functions === */
+static uint16_t
+frameSizeOf (const struct trace_FrameHeader *header)
+{
+    return TRACE_HEADER_SIZE + header->numTasks * TRACE_TASK_ENTRY_SIZE
+            + header->numRecords * TRACE_RECORD_SIZE + TRACE_CHECKSUM_SIZE;
+}
+
+/* Drop first byte and look for next sync */
+static void
+resync (struct Receiver *rx)
+{
+    size_t skip = 1;
+    while (skip < rx->len
+            && !(rx->frame[skip] == (TRACE_SYNC & 0xFF)
+                    && (skip + 1 == rx->len
+                            || rx->frame[skip + 1] == (TRACE_SYNC >> 8))))
+        {
+            skip++;
+        }
+    memmove (rx->frame, &rx->frame[skip], rx->len - skip);
+    rx->len -= skip;
+    rx->frameSize = 0;
+}
+
+/* Collect byte, returns 1 when a complete frame with valid checksum is in rx->frame */
+static int
+feedByte (struct Receiver *rx, uint8_t byte)
+{
+    if (rx->len == 0 && byte != (TRACE_SYNC & 0xFF))
+        {
+            return 0;
+        }
+    rx->frame[rx->len++] = byte;
+    if (rx->frameSize == 0 && rx->len == TRACE_HEADER_SIZE)
+        {
+            if (!trace_decodeHeader (rx->frame, &rx->header))
+                {
+                    resync (rx);
+                    return 0;
+                }
+            rx->frameSize = frameSizeOf (&rx->header);
+        }
+    else if (rx->len == 2 && rx->frame[1] != (TRACE_SYNC >> 8))
+        {
+            resync (rx);
+            return 0;
+        }
+    if (rx->frameSize == 0 || rx->len < rx->frameSize)
+        {
+            return 0;
+        }
+
+    size_t payload = rx->frameSize - TRACE_CHECKSUM_SIZE;
+    uint16_t sum = capture_checksum (0, rx->frame, payload);
+    if (sum != (rx->frame[payload] | (rx->frame[payload + 1] << 8)))
+        {
+            rx->badFrames++;
+            resync (rx);
+            return 0;
+        }
+    rx->frames++;
+    rx->len = 0;
+    rx->frameSize = 0;
+    return 1;
+}
+
+static const char*
+taskName (const struct Timeline *tl, uint8_t number, char *buf, size_t len)
+{
+    for (uint8_t t = 0; t < tl->header->numTasks; t++)
+        {
+            const uint8_t *entry = &tl->names[t * TRACE_TASK_ENTRY_SIZE];
+            if (entry[0] == number)
+                {
+                    snprintf (buf, len, "%.*s", TRACE_TASK_NAME_LEN,
+                              (const char*) &entry[1]);
+                    return buf;
+                }
+        }
+    snprintf (buf, len, "task %u", number);
+    return buf;
+}
+
+static const char*
+irqName (uint8_t irq)
+{
+    /* STM32F302x8 IRQ numbers of interrupts marked in firmware */
+    switch (irq)
+        {
+        case 3:
+            return "RTC wakeup";
+        case 6:
+            return "EXTI0";
+        case 7:
+            return "EXTI1";
+        case 8:
+            return "EXTI2";
+        case 9:
+            return "EXTI3";
+        case 16:
+            return "DMA1 ch6 uart rx";
+        case 17:
+            return "DMA1 ch7 uart tx";
+        case 38:
+            return "USART2";
+        default:
+            return "IRQ";
+        }
+}
+
+static void
+emit (struct Timeline *tl, const char *fmt, const char *name, int tid,
+      double ts, double value)
+{
+    fprintf (tl->out, "%s\n{\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,",
+             tl->events++ ? "," : "", name, tid, ts);
+    fprintf (tl->out, fmt, value);
+    fputc ('}', tl->out);
+}
+
+static void
+endSlice (struct Timeline *tl, double *startUs, const char *name, int tid)
+{
+    double start = *startUs < 0 ? 0 : *startUs;
+    emit (tl, "\"ph\":\"X\",\"dur\":%.3f", name, tid, start, tl->nowUs - start);
+    *startUs = -1;
+}
+
+static void
+convertRecord (struct Timeline *tl, const struct trace_Record *r)
+{
+    char name[32];
+    uint32_t delta = r->cycles - tl->lastCycles;                                // counter wraps
+    tl->nowUs += delta * 1e6 / tl->hz;
+    tl->lastCycles = r->cycles;
+
+    switch (r->type)
+        {
+        case TRACE_TASK_IN:
+            tl->taskStartUs[r->id] = tl->nowUs;
+            tl->currentTask = r->id;
+            break;
+        case TRACE_TASK_OUT:
+            endSlice (tl, &tl->taskStartUs[r->id],
+                      taskName (tl, r->id, name, sizeof(name)), r->id);
+            break;
+        case TRACE_ISR_ENTER:
+            tl->isrStartUs[r->id] = tl->nowUs;
+            break;
+        case TRACE_ISR_EXIT:
+            endSlice (tl, &tl->isrStartUs[r->id], irqName (r->id),
+                      ISR_ROW_BASE + r->id);
+            break;
+        case TRACE_QUEUE_SEND:
+        case TRACE_QUEUE_SEND_FROM_ISR:
+        case TRACE_QUEUE_RECEIVE:
+        case TRACE_QUEUE_RECEIVE_FROM_ISR:
+            {
+                /* arg is fill level before operation */
+                int send = TRACE_QUEUE_SEND == r->type
+                        || TRACE_QUEUE_SEND_FROM_ISR == r->type;
+                int items = send ? r->arg + 1 : (r->arg > 0 ? r->arg - 1 : 0);
+                emit (tl, "\"ph\":\"C\",\"args\":{\"items\":%.0f}",
+                      r->id < TRACE_QUEUE_COUNT ? queueNames[r->id] : "queue",
+                      0, tl->nowUs, items);
+            }
+            break;
+        case TRACE_QUEUE_BLOCK_SEND:
+        case TRACE_QUEUE_BLOCK_RECEIVE:
+            snprintf (name, sizeof(name), "%s %s",
+                      TRACE_QUEUE_BLOCK_SEND == r->type ?
+                              "blocked full" : "blocked empty",
+                      r->id < TRACE_QUEUE_COUNT ? queueNames[r->id] : "queue");
+            emit (tl, "\"ph\":\"i\",\"s\":\"t\",\"args\":{\"items\":%.0f}", name,
+                  tl->currentTask < 0 ? 0 : tl->currentTask, tl->nowUs,
+                  r->arg);
+            break;
+        case TRACE_CLOCK:
+            tl->hz = r->arg * 1000000UL;
+            emit (tl, "\"ph\":\"i\",\"s\":\"g\",\"args\":{\"MHz\":%.0f}",
+                  "core clock", 0, tl->nowUs, r->arg);
+            break;
+        default:
+            break;
+        }
+}
+
+/* Write frame in rx->frame as JSON, returns number of records */
+static uint32_t
+convertFrame (const struct Receiver *rx, FILE *out)
+{
+    static struct Timeline tl;
+    const struct trace_FrameHeader *header = &rx->header;
+    const uint8_t *records = rx->frame + TRACE_HEADER_SIZE
+            + header->numTasks * TRACE_TASK_ENTRY_SIZE;
+    struct trace_Record r;
+    char name[32];
+
+    memset (&tl, 0, sizeof(tl));
+    tl.out = out;
+    tl.header = header;
+    tl.names = rx->frame + TRACE_HEADER_SIZE;
+    tl.hz = header->coreHz;
+    tl.currentTask = -1;
+    for (int i = 0; i < MAX_IDS; i++)
+        {
+            tl.taskStartUs[i] = -1;
+            tl.isrStartUs[i] = -1;
+        }
+
+    fprintf (out, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"lost records\":%u},"
+             "\"traceEvents\":[",
+             header->overwritten);
+    for (uint8_t t = 0; t < header->numTasks; t++)
+        {
+            uint8_t number = tl.names[t * TRACE_TASK_ENTRY_SIZE];
+            fprintf (out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                     "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                     tl.events++ ? "," : "", number,
+                     taskName (&tl, number, name, sizeof(name)));
+        }
+    for (uint16_t i = 0; i < header->numRecords; i++)
+        {
+            trace_decodeRecord (records + i * TRACE_RECORD_SIZE, &r);
+            if (i == 0)
+                {
+                    tl.lastCycles = r.cycles;
+                }
+            convertRecord (&tl, &r);
+        }
+
+    /* slices still open end when recording stopped */
+    if (header->numRecords > 0)
+        {
+            r.cycles = header->stopCycles;
+            r.type = TRACE_TYPE_COUNT;
+            convertRecord (&tl, &r);
+        }
+    for (int i = 0; i < MAX_IDS; i++)
+        {
+            if (tl.taskStartUs[i] >= 0)
+                {
+                    endSlice (&tl, &tl.taskStartUs[i],
+                              taskName (&tl, i, name, sizeof(name)), i);
+                }
+            if (tl.isrStartUs[i] >= 0)
+                {
+                    endSlice (&tl, &tl.isrStartUs[i], irqName (i),
+                              ISR_ROW_BASE + i);
+                }
+        }
+    fprintf (out, "\n]}\n");
+    return header->numRecords;
+}
+
+/* Read stream until first valid frame and convert it */
+static int
+receiveAndConvert (int fd, int timeoutMs, const char *outPath)
+{
+    static struct Receiver rx;
+    uint8_t buff[READ_BUFF_LEN];
+
+    memset (&rx, 0, sizeof(rx));
+    while (1)
+        {
+            struct pollfd pfd =
+                { .fd = fd, .events = POLLIN };
+            if (timeoutMs >= 0 && poll (&pfd, 1, timeoutMs) <= 0)
+                {
+                    fprintf (stderr, "no trace frame received\n");
+                    return 1;
+                }
+            ssize_t n = read (fd, buff, sizeof(buff));
+            if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+            if (n <= 0)
+                {
+                    fprintf (stderr, "no trace frame in stream, %u bad frames\n",
+                             rx.badFrames);
+                    return 1;
+                }
+            for (ssize_t i = 0; i < n; i++)
+                {
+                    if (feedByte (&rx, buff[i]))
+                        {
+                            FILE *out = fopen (outPath, "w");
+                            if (out == NULL)
+                                {
+                                    fprintf (stderr, "can not open %s: %s\n",
+                                             outPath, strerror (errno));
+                                    return 1;
+                                }
+                            uint32_t records = convertFrame (&rx, out);
+                            fclose (out);
+                            printf ("%u records, %u lost, %u tasks\n", records,
+                                    rx.header.overwritten, rx.header.numTasks);
+                            return 0;
+                        }
+                }
+        }
+}
+
+static int
+dump (const char *port, const char *outPath)
+{
+    static const char command[] = "trace dump\r";
+
+    int fd = serial_open (port, SERIAL_DEFAULT_BAUD, 0);
+    if (fd < 0)
+        {
+            fprintf (stderr, "can not open %s: %s\n", port, strerror (errno));
+            return 1;
+        }
+    if (write (fd, command, sizeof(command) - 1) != sizeof(command) - 1)
+        {
+            fprintf (stderr, "write failed: %s\n", strerror (errno));
+            close (fd);
+            return 1;
+        }
+    int result = receiveAndConvert (fd, DUMP_TIMEOUT_MS, outPath);
+    close (fd);
+    return result;
+}
+
+static int
+convert (const char *path, const char *outPath)
+{
+    int fd = 0;
+
+    if (strcmp (path, "-") != 0 && (fd = open (path, O_RDONLY)) < 0)
+        {
+            fprintf (stderr, "can not open %s: %s\n", path, strerror (errno));
+            return 1;
+        }
+    int result = receiveAndConvert (fd, -1, outPath);
+    if (fd != 0)
+        {
+            close (fd);
+        }
+    return result;
+}
+
+/* === self check === */
+/* Read frame out in CLI sized chunks with text around it, as on the serial link */
+static int
+readBack (struct Receiver *rx)
+{
+    static const char noise[] = "trace dump\n\r\xA5 >>";
+    uint8_t chunk[CHECK_CHUNK_LEN];
+    uint16_t len;
+    int complete = 0;
+
+    for (size_t i = 0; i < sizeof(noise) - 1; i++)
+        {
+            feedByte (rx, noise[i]);
+        }
+    while (0 < (len = trace_readFrame (chunk, sizeof(chunk))))
+        {
+            for (uint16_t i = 0; i < len; i++)
+                {
+                    complete |= feedByte (rx, chunk[i]);
+                }
+        }
+    return complete;
+}
+
+static int
+checkFrame (void)
+{
+    static struct Receiver rx;
+    struct trace_Record r;
+    int failed = 0;
+
+    /* overflow ring across counter wrap, clock change among the dropped records */
+    uint32_t cycles = 0xFFFF0000u;
+    trace_start (CHECK_HZ);
+    for (uint32_t i = 0; i < TRACE_RING_LEN + 10; i++, cycles += 720)
+        {
+            if (i == 5)
+                {
+                    trace_record (cycles, TRACE_CLOCK, 0, 24);
+                    continue;
+                }
+            trace_record (cycles, i % 2 ? TRACE_TASK_OUT : TRACE_TASK_IN, 2, 0);
+        }
+    trace_stop (cycles);
+    trace_record (cycles, TRACE_TASK_IN, 3, 0);                                 // not recorded when stopped
+    trace_addTaskName (2, "sensor task");
+    trace_addTaskName (1, "main task");
+    trace_addTaskName (2, "sensor");
+
+    memset (&rx, 0, sizeof(rx));
+    if (!readBack (&rx))
+        {
+            printf ("  frame not received, %u bad frames\n", rx.badFrames);
+            return 1;
+        }
+    const uint8_t *records = rx.frame + TRACE_HEADER_SIZE
+            + rx.header.numTasks * TRACE_TASK_ENTRY_SIZE;
+    trace_decodeRecord (records, &r);
+    failed |= rx.header.numRecords != TRACE_RING_LEN
+            || rx.header.overwritten != 10 || rx.header.numTasks != 2
+            || rx.header.coreHz != 24000000 || r.cycles != 0xFFFF0000u + 10 * 720
+            || 0 != strncmp ((const char*) rx.frame + TRACE_HEADER_SIZE + 1,
+                             "sensor", TRACE_TASK_NAME_LEN);
+
+    /* second readout gives the same frame, corrupted one is rejected */
+    uint8_t first[TRACE_MAX_FRAME_SIZE];
+    memcpy (first, rx.frame, frameSizeOf (&rx.header));
+    failed |= !readBack (&rx)
+            || 0 != memcmp (first, rx.frame, frameSizeOf (&rx.header));
+    uint8_t chunk[CHECK_CHUNK_LEN];
+    uint16_t len, total = 0;
+    int complete = 0;
+    while (0 < (len = trace_readFrame (chunk, sizeof(chunk))))
+        {
+            for (uint16_t i = 0; i < len; i++, total++)
+                {
+                    complete |= feedByte (&rx,
+                                          total == 100 ? chunk[i] ^ 0x10 : chunk[i]);
+                }
+        }
+    failed |= complete || rx.badFrames != 1;
+
+    printf ("%-28s%s\n", "frame readout", failed ? "  FAILED" : "");
+    return failed;
+}
+
+static int
+checkConversion (void)
+{
+    static struct Receiver rx;
+    char json[16384];
+    int failed = 0;
+
+    /* 10 us task slice and 2 us interrupt at 72 MHz, then 1 us slice after clock drops to 8 MHz */
+    trace_start (CHECK_HZ);
+    trace_record (1000, TRACE_TASK_IN, 4, 0);
+    trace_record (1000 + 72 * 2, TRACE_ISR_ENTER, 6, 0);
+    trace_record (1000 + 72 * 4, TRACE_ISR_EXIT, 6, 0);
+    trace_record (1000 + 72 * 5, TRACE_QUEUE_SEND_FROM_ISR, TRACE_QUEUE_SENSOR_NOTIFY, 0);
+    trace_record (1000 + 72 * 10, TRACE_TASK_OUT, 4, 0);
+    trace_record (1000 + 72 * 10, TRACE_QUEUE_BLOCK_RECEIVE, TRACE_QUEUE_CLI_RX, 0);
+    trace_record (1000 + 72 * 11, TRACE_CLOCK, 0, 8);
+    trace_record (1000 + 72 * 11 + 8 * 3, TRACE_TASK_IN, 1, 0);
+    trace_record (1000 + 72 * 11 + 8 * 4, TRACE_TASK_OUT, 1, 0);
+    trace_stop (1000 + 72 * 11 + 8 * 5);
+    trace_addTaskName (4, "sensor");
+    trace_addTaskName (1, "main");
+
+    memset (&rx, 0, sizeof(rx));
+    FILE *out = fmemopen (json, sizeof(json), "w");
+    failed |= !readBack (&rx) || out == NULL;
+    if (!failed)
+        {
+            convertFrame (&rx, out);
+            fclose (out);
+            failed |= NULL == strstr (json, "\"name\":\"sensor\",\"pid\":1,\"tid\":4,"
+                                      "\"ts\":0.000,\"ph\":\"X\",\"dur\":10.000");
+            failed |= NULL == strstr (json, "\"name\":\"EXTI0\",\"pid\":1,\"tid\":1006,"
+                                      "\"ts\":2.000,\"ph\":\"X\",\"dur\":2.000");
+            failed |= NULL == strstr (json, "\"name\":\"sensor notify\",\"pid\":1,"
+                                      "\"tid\":0,\"ts\":5.000,\"ph\":\"C\","
+                                      "\"args\":{\"items\":1}");
+            failed |= NULL == strstr (json, "\"name\":\"blocked empty cli rx\","
+                                      "\"pid\":1,\"tid\":4");
+            failed |= NULL == strstr (json, "\"name\":\"main\",\"pid\":1,\"tid\":1,"
+                                      "\"ts\":14.000,\"ph\":\"X\",\"dur\":1.000");
+            failed |= NULL == strstr (json, "\"args\":{\"name\":\"main\"}");
+        }
+    printf ("%-28s%s\n", "chrome json conversion", failed ? "  FAILED" : "");
+    if (failed && out != NULL)
+        {
+            printf ("%s", json);
+        }
+    return failed;
+}
+
+static int
+check (void)
+{
+    int failures = checkFrame () + checkConversion ();
+    printf ("%d of 2 cases failed\n", failures);
+    return failures != 0;
+}
+
+static int
+usage (void)
+{
+    fprintf (stderr, "usage: acc_trace dump <port> <out.json>\n"
+             "       acc_trace convert <stream file|-> <out.json>\n"
+             "       acc_trace check\n");
+    return 1;
+}
+
+int
+main (int argc, char **argv)
+{
+    if (argc == 2 && 0 == strcmp (argv[1], "check"))
+        {
+            return check ();
+        }
+    if (argc == 4 && 0 == strcmp (argv[1], "dump"))
+        {
+            return dump (argv[2], argv[3]);
+        }
+    if (argc == 4 && 0 == strcmp (argv[1], "convert"))
+        {
+            return convert (argv[2], argv[3]);
+        }
+    return usage ();
+}
@@ -0,0 +1,209 @@
+/*
+ * devstream.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "devstream.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+/* === private defines === */
+#define ACC_AXES                        3
+#define BACKSPACE                       '\b'
+
+/* === private functions === */
+/* parse "[-]d.ddd g" field, return pointer after it or NULL */
+static const char*
+parseAccField (const char *s, int16_t *val)
+{
+    int negative = 0;
+    long integer = 0, fraction = 0;
+
+    while (*s == ' ')
+        {
+            s++;
+        }
+    if (*s == '-')
+        {
+            negative = 1;
+            s++;
+        }
+    if (!isdigit ((unsigned char) *s))
+        {
+            return NULL;
+        }
+    while (isdigit ((unsigned char) *s))
+        {
+            integer = integer * 10 + (*s++ - '0');
+        }
+    if (*s++ != '.')
+        {
+            return NULL;
+        }
+    for (int i = 0; i < 3; i++)
+        {
+            if (!isdigit ((unsigned char) *s))
+                {
+                    return NULL;
+                }
+            fraction = fraction * 10 + (*s++ - '0');
+        }
+    if (s[0] != ' ' || s[1] != 'g')
+        {
+            return NULL;
+        }
+
+    long mili = integer * 1000 + fraction;
+    *val = (int16_t) (negative ? -mili : mili);
+    return s + 2;
+}
+
+/* check for "hh:mm:ss" click time stamp */
+static int
+containsClickTime (const char *s)
+{
+    while (*s == ' ')
+        {
+            s++;
+        }
+    return strlen (s) >= 8 && isdigit ((unsigned char) s[0])
+            && isdigit ((unsigned char) s[1]) && s[2] == ':'
+            && isdigit ((unsigned char) s[3])
+            && isdigit ((unsigned char) s[4]) && s[5] == ':'
+            && isdigit ((unsigned char) s[6])
+            && isdigit ((unsigned char) s[7]);
+}
+
+static void
+lineComplete (struct devstream_Parser *parser)
+{
+    struct devstream_Sample sample;
+    struct devstream_Config config;
+
+    if (parser->len == 0)
+        {
+            return;
+        }
+    parser->line[parser->len] = '\0';
+    if (devstream_decodeLine (parser->line, &sample))
+        {
+            sample.timeUs = parser->lineTimeUs;
+            parser->samples++;
+            if (parser->cb)
+                {
+                    parser->cb (&sample, parser->ctx);
+                }
+        }
+    else if (devstream_decodeConfig (parser->line, &config))
+        {
+            config.timeUs = parser->lineTimeUs;
+            parser->configs++;
+            if (parser->configCb)
+                {
+                    parser->configCb (&config, parser->ctx);
+                }
+        }
+    else if (strstr (parser->line, " g") != NULL)
+        {
+            /* looks like truncated or corrupted data line */
+            parser->malformed++;
+        }
+    parser->len = 0;
+}
+
+/* === exported functions === */
+void
+devstream_init (struct devstream_Parser *parser, devstream_SampleCb cb,
+                void *ctx)
+{
+    memset (parser, 0, sizeof(*parser));
+    parser->cb = cb;
+    parser->ctx = ctx;
+}
+
+void
+devstream_setConfigCb (struct devstream_Parser *parser, devstream_ConfigCb cb)
+{
+    parser->configCb = cb;
+}
+
+void
+devstream_feed (struct devstream_Parser *parser, const uint8_t *data,
+                size_t len, int64_t rxTimeUs)
+{
+    for (size_t i = 0; i < len; i++)
+        {
+            uint8_t c = data[i];
+
+            if (c == '\r' || c == '\n')
+                {
+                    lineComplete (parser);
+                }
+            else if (c == BACKSPACE)
+                {
+                    /* device moves cursor back over click time, ignore it */
+                }
+            else if (parser->len < DEVSTREAM_MAX_LINE_LEN - 1)
+                {
+                    parser->line[parser->len++] = (char) c;
+                    parser->lineTimeUs = rxTimeUs;
+                }
+            else
+                {
+                    /* line too long, drop it */
+                    parser->malformed++;
+                    parser->len = 0;
+                }
+        }
+}
+
+int
+devstream_decodeLine (const char *line, struct devstream_Sample *sample)
+{
+    int16_t axes[ACC_AXES];
+    const char *s = line;
+    uint8_t sensor = 0;
+
+    /* devices with more than one sensor tag lines with sensor index */
+    if (s[0] == '#' && isdigit ((unsigned char) s[1]))
+        {
+            sensor = s[1] - '0';
+            s += 2;
+        }
+    for (int i = 0; i < ACC_AXES; i++)
+        {
+            s = parseAccField (s, &axes[i]);
+            if (s == NULL)
+                {
+                    return 0;
+                }
+        }
+    sample->x = axes[0];
+    sample->y = axes[1];
+    sample->z = axes[2];
+    sample->flags = containsClickTime (s) ? DEVSTREAM_FLAG_CLICK : 0;
+    sample->flags |= (sensor << DEVSTREAM_FLAG_SENSOR_Pos)
+            & DEVSTREAM_FLAG_SENSOR_Msk;
+    return 1;
+}
+
+int
+devstream_decodeConfig (const char *line, struct devstream_Config *config)
+{
+    unsigned sensor, hz, milliHz, fullScale, avg;
+    int end = 0;
+
+    if (5 != sscanf (line, "@cfg #%u %u.%3uHz %ug avg %u%n", &sensor, &hz,
+                     &milliHz, &fullScale, &avg, &end)
+            || line[end] != '\0')
+        {
+            return 0;
+        }
+    config->sensor = sensor;
+    config->rateMilliHz = hz * 1000 + milliHz;
+    config->fullScaleG = fullScale;
+    config->avgNumber = avg;
+    return 1;
+}
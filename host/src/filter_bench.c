@@ -0,0 +1,409 @@
+/*
+ * filter_bench.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Checks firmware filter module and measures its cost.
+ *      Accuracy: every stage type is compared with a double precision reference on noisy input with
+ *      static offset; output must stay within FILTER_TOLERANCE_MG.
+ *      Reconfiguration: moving average length change must give exactly the new window average from
+ *      the next sample on, newly enabled stages must not step on constant input, biquad cutoff change
+ *      must not jump by more than the input noise.
+ *      Cost: host time per sample of typical chains, and Cortex-M4 cycles from an instruction model
+ *      of each stage path (see cyclesModel()). On target, "filter get" prints measured cycles.
+ *
+ *          filter_bench [samples]
+ */
+#include "filter.h"
+#include "serial.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* === private defines === */
+#define NUM_OF_ELEMENTS(a)              (sizeof(a) / sizeof(a[0]))
+#define RATE_MHZ                        400000
+#define SETTLE_SAMPLES                  4000
+#define CHECK_SAMPLES                   20000
+#define FILTER_TOLERANCE_MG             1.0
+#define DEFAULT_BENCH_SAMPLES           2000000L
+#define PI                              3.14159265358979323846
+
+/* Cortex-M4 cycles per axis (TRM instruction timings, zero wait state flash):
+ * loop and stage dispatch, load/store of stage input */
+#define M4_AXIS_OVERHEAD                10
+#define M4_STAGE_OVERHEAD               7
+#define M4_MOVING_AVG                   34                                      /// ring update, 2 SDIV of 2..12 cycles
+#define M4_EMA                          12                                      /// SMULL, 64 bit add and shift
+#define M4_BIQUAD                       32                                      /// 5 SMLAL, coefficient LDM, saturation
+
+/* === private types === */
+struct Chain
+{
+    const char *name;
+    struct filter_StageConfig stages[FILTER_MAX_STAGES];
+};
+
+/** double precision reference of single stage */
+struct Reference
+{
+    struct filter_StageConfig config;
+    double b0, b1, b2, a1, a2, gain;
+    double x1, x2, y1, y2;
+    double history[FILTER_MA_MAX_LEN];
+    long n;
+};
+
+/* === private variables === */
+static const struct Chain chains[] =
+    {
+        { "off", { { FILTER_NONE, 0 } } },
+        { "avg 16", { { FILTER_MOVING_AVG, 16 } } },
+        { "avg 500", { { FILTER_MOVING_AVG, 500 } } },
+        { "ema 16", { { FILTER_EMA, 16 } } },
+        { "lp 20", { { FILTER_LOW_PASS, 20 } } },
+        { "hp 1", { { FILTER_HIGH_PASS, 1 } } },
+        { "hp 1, avg 8, lp 50", { { FILTER_HIGH_PASS, 1 }, { FILTER_MOVING_AVG,
+                8 }, { FILTER_LOW_PASS, 50 } } } };
+
+static volatile int32_t sink;
+
+/* === private functions === */
+static int16_t
+noisy (int offset, int noise)
+{
+    return offset + rand () % (2 * noise + 1) - noise;
+}
+
+static void
+setChain (struct filter_Chain *chain, const struct Chain *setup)
+{
+    filter_init (chain, RATE_MHZ);
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+        {
+            if (!filter_setStage (chain, s, &setup->stages[s]))
+                {
+                    printf ("  stage %u of %s rejected\n", s, setup->name);
+                }
+        }
+}
+
+static void
+referenceInit (struct Reference *ref, const struct filter_StageConfig *config,
+               double level)
+{
+    double fs = RATE_MHZ / 1000.0;
+    double w0 = 2.0 * PI * config->param / fs;
+    double alpha = sin (w0) / sqrt (2.0);
+    double a0 = 1.0 + alpha;
+    double c = cos (w0);
+
+    ref->config = *config;
+    ref->n = 0;
+    ref->a1 = -2.0 * c / a0;
+    ref->a2 = (1.0 - alpha) / a0;
+    ref->b0 = (FILTER_LOW_PASS == config->type ? 1.0 - c : 1.0 + c) / 2.0 / a0;
+    ref->b1 = (FILTER_LOW_PASS == config->type ? 2.0 : -2.0) * ref->b0;
+    ref->b2 = ref->b0;
+    ref->gain = 2.0 / (config->param + 1.0);
+    ref->x1 = ref->x2 = level;
+    ref->y1 = ref->y2 = FILTER_HIGH_PASS == config->type ? 0.0 : level;
+}
+
+static double
+referenceStep (struct Reference *ref, double x)
+{
+    double y = x;
+    switch (ref->config.type)
+        {
+        case FILTER_MOVING_AVG:
+            {
+                ref->history[ref->n % ref->config.param] = x;
+                ref->n++;
+                long len = ref->n < ref->config.param ? ref->n : ref->config.param;
+                y = 0;
+                for (long i = 0; i < len; i++)
+                    {
+                        y += ref->history[i];
+                    }
+                y /= len;
+            }
+            break;
+        case FILTER_EMA:
+            ref->y1 += ref->gain * (x - ref->y1);
+            y = ref->y1;
+            break;
+        case FILTER_LOW_PASS:
+        case FILTER_HIGH_PASS:
+            y = ref->b0 * x + ref->b1 * ref->x1 + ref->b2 * ref->x2
+                    - ref->a1 * ref->y1 - ref->a2 * ref->y2;
+            ref->x2 = ref->x1;
+            ref->x1 = x;
+            ref->y2 = ref->y1;
+            ref->y1 = y;
+            break;
+        default:
+            break;
+        }
+    return y;
+}
+
+/* Single stage against double reference, worst error after settling */
+static int
+checkAccuracy (const struct filter_StageConfig *config, int offset, int noise)
+{
+    struct filter_Chain chain;
+    struct Reference ref;
+    double worst = 0;
+
+    filter_init (&chain, RATE_MHZ);
+    filter_setStage (&chain, 0, config);
+    referenceInit (&ref, config, 0);
+    for (long i = 0; i < SETTLE_SAMPLES + CHECK_SAMPLES; i++)
+        {
+            int16_t xyz[FILTER_AXES] =
+                { noisy (offset, noise), noisy (-offset, noise), noisy (0,
+                                                                        noise) };
+            double expected = referenceStep (&ref, xyz[0]);
+            filter_process (&chain, xyz);
+            if (i >= SETTLE_SAMPLES && fabs (xyz[0] - expected) > worst)
+                {
+                    worst = fabs (xyz[0] - expected);
+                }
+        }
+    static const char *typeNames[FILTER_TYPE_COUNT] =
+        { "off", "avg", "ema", "lp", "hp" };
+    int failed = worst > FILTER_TOLERANCE_MG;
+    printf ("  %-4s %4u, offset %6d mg: max error %.3f mg%s\n",
+            typeNames[config->type], config->param, offset, worst,
+            failed ? "  FAILED" : "");
+    return failed;
+}
+
+/* Moving average length change gives exact average of new window on the very next sample */
+static int
+checkMovingAvgResize (void)
+{
+    struct filter_Chain chain;
+    struct filter_StageConfig config =
+        { FILTER_MOVING_AVG, 16 };
+    static int16_t input[3000];
+    static const uint16_t lengths[] =
+        { 64, 3, 500, 499, 1, 200 };
+    int failures = 0;
+    long n = 0;
+
+    filter_init (&chain, RATE_MHZ);
+    filter_setStage (&chain, 0, &config);
+    for (size_t step = 0; step < NUM_OF_ELEMENTS(lengths); step++)
+        {
+            for (int i = 0; i < 400; i++, n++)
+                {
+                    input[n] = noisy (1000, 300);
+                    int16_t xyz[FILTER_AXES] =
+                        { input[n], 0, 0 };
+                    filter_process (&chain, xyz);
+                    if (i == 0)
+                        {
+                            long len = n + 1 < config.param ? n + 1 : config.param;
+                            double sum = 0;
+                            for (long k = n + 1 - len; k <= n; k++)
+                                {
+                                    sum += input[k];
+                                }
+                            if (fabs (xyz[0] - sum / len) > 0.5 + 1.0 / 256)
+                                {
+                                    printf ("  length %u: %d, expected %.2f\n",
+                                            config.param, xyz[0], sum / len);
+                                    failures++;
+                                }
+                        }
+                }
+            config.param = lengths[step];
+            filter_setStage (&chain, 0, &config);
+        }
+    printf ("  moving average resize%s\n", failures ? "  FAILED" : "");
+    return failures != 0;
+}
+
+/* Enabling stage on constant input does not change output, high pass starts at 0 */
+static int
+checkEnableStep (void)
+{
+    static const struct filter_StageConfig configs[] =
+        {
+            { FILTER_MOVING_AVG, 100 },
+            { FILTER_EMA, 50 },
+            { FILTER_LOW_PASS, 10 },
+            { FILTER_HIGH_PASS, 10 } };
+    int failures = 0;
+
+    for (size_t c = 0; c < NUM_OF_ELEMENTS(configs); c++)
+        {
+            struct filter_Chain chain;
+            filter_init (&chain, RATE_MHZ);
+            for (int i = 0; i < 1000; i++)
+                {
+                    if (i == 500)
+                        {
+                            filter_setStage (&chain, 1, &configs[c]);
+                        }
+                    int16_t xyz[FILTER_AXES] =
+                        { 1234, -987, 16000 };
+                    filter_process (&chain, xyz);
+                    bool hp = FILTER_HIGH_PASS == configs[c].type && i >= 500;
+                    if (xyz[0] != (hp ? 0 : 1234) || xyz[1] != (hp ? 0 : -987)
+                            || xyz[2] != (hp ? 0 : 16000))
+                        {
+                            printf ("  enable type %u: step at sample %d\n",
+                                    configs[c].type, i);
+                            failures++;
+                            break;
+                        }
+                }
+        }
+    printf ("  stage enable on constant input%s\n", failures ? "  FAILED" : "");
+    return failures != 0;
+}
+
+/* Cutoff change of running biquad, output moves no more than between ordinary samples */
+static int
+checkCutoffChange (void)
+{
+    struct filter_Chain chain;
+    struct filter_StageConfig config =
+        { FILTER_LOW_PASS, 100 };
+    static const uint16_t cutoffs[] =
+        { 2, 150, 1, 179 };
+    int16_t last = 0;
+    int worstNormal = 0, worstSwitch = 0;
+
+    filter_init (&chain, RATE_MHZ);
+    filter_setStage (&chain, 0, &config);
+    for (int i = 0; i < 5 * 4000; i++)
+        {
+            if (i % 4000 == 3999)
+                {
+                    config.param = cutoffs[i / 4000];
+                    filter_setStage (&chain, 0, &config);
+                }
+            int16_t xyz[FILTER_AXES] =
+                { noisy (1000, 20), 0, 0 };
+            filter_process (&chain, xyz);
+            int jump = abs (xyz[0] - last);
+            last = xyz[0];
+            if (i % 4000 == 3999)
+                {
+                    worstSwitch = jump > worstSwitch ? jump : worstSwitch;
+                }
+            else if (i > 1000)
+                {
+                    worstNormal = jump > worstNormal ? jump : worstNormal;
+                }
+        }
+    int failed = worstSwitch > worstNormal;
+    printf ("  cutoff change: jump %d mg, largest ordinary step %d mg%s\n",
+            worstSwitch, worstNormal, failed ? "  FAILED" : "");
+    return failed;
+}
+
+/* Cortex-M4 cycles per sample of all axes */
+static uint32_t
+cyclesModel (const struct Chain *setup)
+{
+    uint32_t perAxis = M4_AXIS_OVERHEAD;
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+        {
+            perAxis += M4_STAGE_OVERHEAD;
+            switch (setup->stages[s].type)
+                {
+                case FILTER_MOVING_AVG:
+                    perAxis += M4_MOVING_AVG;
+                    break;
+                case FILTER_EMA:
+                    perAxis += M4_EMA;
+                    break;
+                case FILTER_LOW_PASS:
+                case FILTER_HIGH_PASS:
+                    perAxis += M4_BIQUAD;
+                    break;
+                default:
+                    break;
+                }
+        }
+    return perAxis * FILTER_AXES;
+}
+
+static void
+bench (long samples)
+{
+    static struct filter_Chain chain;
+    enum
+    {
+        NUM_OF_INPUTS = 4096
+    };
+    static int16_t inputs[NUM_OF_INPUTS][FILTER_AXES];
+
+    for (int i = 0; i < NUM_OF_INPUTS; i++)
+        {
+            for (uint8_t a = 0; a < FILTER_AXES; a++)
+                {
+                    inputs[i][a] = noisy (a == 2 ? 1000 : 0, 2000);
+                }
+        }
+    printf ("%-20s %12s %14s\n", "chain", "host ns", "M4 model cyc");
+    for (size_t c = 0; c < NUM_OF_ELEMENTS(chains); c++)
+        {
+            setChain (&chain, &chains[c]);
+            int64_t start = serial_getMonotonicUs ();
+            for (long i = 0; i < samples; i++)
+                {
+                    int16_t xyz[FILTER_AXES] =
+                        { inputs[i % NUM_OF_INPUTS][0],
+                                inputs[i % NUM_OF_INPUTS][1],
+                                inputs[i % NUM_OF_INPUTS][2] };
+                    filter_process (&chain, xyz);
+                    sink += xyz[0];
+                }
+            double ns = (serial_getMonotonicUs () - start) * 1000.0 / samples;
+            printf ("%-20s %12.1f %14u\n", chains[c].name, ns,
+                    cyclesModel (&chains[c]));
+        }
+}
+
+int
+main (int argc, char **argv)
+{
+    static const struct filter_StageConfig accuracy[] =
+        {
+            { FILTER_MOVING_AVG, 1 },
+            { FILTER_MOVING_AVG, 37 },
+            { FILTER_MOVING_AVG, 500 },
+            { FILTER_EMA, 1 },
+            { FILTER_EMA, 8 },
+            { FILTER_EMA, 1000 },
+            { FILTER_LOW_PASS, 1 },
+            { FILTER_LOW_PASS, 20 },
+            { FILTER_LOW_PASS, 179 },
+            { FILTER_HIGH_PASS, 1 },
+            { FILTER_HIGH_PASS, 50 } };
+    long samples = argc > 1 ? atol (argv[1]) : DEFAULT_BENCH_SAMPLES;
+    int failures = 0;
+
+    srand (1);
+    printf ("accuracy against double precision:\n");
+    for (size_t i = 0; i < NUM_OF_ELEMENTS(accuracy); i++)
+        {
+            failures += checkAccuracy (&accuracy[i], 1000, 200);
+            failures += checkAccuracy (&accuracy[i], -15000, 800);
+        }
+    printf ("reconfiguration:\n");
+    failures += checkMovingAvgResize ();
+    failures += checkEnableStep ();
+    failures += checkCutoffChange ();
+    printf ("%d checks failed\n\n", failures);
+
+    bench (samples);
+    return failures != 0;
+}
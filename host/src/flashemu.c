@@ -0,0 +1,197 @@
+/*
+ * flashemu.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "flashemu.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* === private variables === */
+static struct Base
+{
+    int fd;
+    uint8_t *mem;
+    size_t size;
+    struct profile_Flash area;
+    int64_t powerBudget;                                                        // bytes until power loss, negative if disabled
+    bool powerLost;
+    struct flashemu_Stats stats;
+} base = { .fd = -1, .powerBudget = -1 };
+
+/* === private functions === */
+/* Consume power budget, false when power is lost before operation completes */
+static bool
+consumePower (uint32_t bytes)
+{
+    if (base.powerLost)
+        {
+            return false;
+        }
+    if (base.powerBudget >= 0)
+        {
+            if (base.powerBudget < bytes)
+                {
+                    base.powerBudget = 0;
+                    base.powerLost = true;
+                    base.stats.powerCuts++;
+                    return false;
+                }
+            base.powerBudget -= bytes;
+        }
+    return true;
+}
+
+static bool
+erasePage (uint8_t page)
+{
+    uint8_t *p = base.mem + (size_t) page * base.area.pageSize;
+
+    if (page >= base.area.numOfPages)
+        {
+            return false;
+        }
+    if (!base.powerLost && base.powerBudget >= 0
+            && base.powerBudget < base.area.pageSize)
+        {
+            /* interrupted erase leaves page partially erased */
+            memset (p, 0xFF, base.powerBudget);
+        }
+    if (!consumePower (base.area.pageSize))
+        {
+            return false;
+        }
+    memset (p, 0xFF, base.area.pageSize);
+    base.stats.erases[page]++;
+    return true;
+}
+
+static bool
+program (uint32_t offset, const void *data, uint32_t len)
+{
+    const uint8_t *src = data;
+
+    if (offset % 4 != 0 || len % 4 != 0 || offset + len > base.size)
+        {
+            base.stats.programErrors++;
+            return false;
+        }
+    for (uint32_t i = 0; i < len; i += 2)
+        {
+            uint16_t target, value;
+            memcpy (&target, base.mem + offset + i, 2);
+            memcpy (&value, src + i, 2);                                        // source may be flash itself
+            if (target != 0xFFFF && value != 0x0000)
+                {
+                    base.stats.programErrors++;
+                    return false;
+                }
+            if (!consumePower (2))
+                {
+                    return false;
+                }
+            target &= value;
+            memcpy (base.mem + offset + i, &target, 2);
+            base.stats.programmedBytes += 2;
+        }
+    return true;
+}
+
+/* === exported functions === */
+int
+flashemu_open (const char *path, uint32_t pageSize, uint8_t numOfPages)
+{
+    struct stat st;
+
+    if (numOfPages < 2 || numOfPages > FLASHEMU_MAX_PAGES)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+    base.size = (size_t) pageSize * numOfPages;
+    base.fd = open (path, O_RDWR | O_CREAT, 0644);
+    if (base.fd < 0 || fstat (base.fd, &st) != 0)
+        {
+            return -1;
+        }
+    bool isNew = (st.st_size == 0);
+    if (!isNew && (size_t) st.st_size != base.size)
+        {
+            close (base.fd);
+            errno = EINVAL;
+            return -1;
+        }
+    if (isNew && ftruncate (base.fd, base.size) != 0)
+        {
+            return -1;
+        }
+    base.mem = mmap (NULL, base.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     base.fd, 0);
+    if (base.mem == MAP_FAILED)
+        {
+            close (base.fd);
+            return -1;
+        }
+    if (isNew)
+        {
+            memset (base.mem, 0xFF, base.size);                                 // new chip comes erased
+        }
+
+    base.area.base = base.mem;
+    base.area.pageSize = pageSize;
+    base.area.numOfPages = numOfPages;
+    base.area.erasePage = erasePage;
+    base.area.program = program;
+    return 0;
+}
+
+void
+flashemu_close (void)
+{
+    if (base.mem != NULL && base.mem != MAP_FAILED)
+        {
+            munmap (base.mem, base.size);
+        }
+    if (base.fd >= 0)
+        {
+            close (base.fd);
+        }
+    base.mem = NULL;
+    base.fd = -1;
+}
+
+const struct profile_Flash*
+flashemu_getArea (void)
+{
+    return &base.area;
+}
+
+void
+flashemu_cutPowerAfter (int64_t bytes)
+{
+    base.powerBudget = bytes;
+}
+
+bool
+flashemu_isPowerLost (void)
+{
+    return base.powerLost;
+}
+
+void
+flashemu_powerOn (void)
+{
+    base.powerLost = false;
+    base.powerBudget = -1;
+}
+
+const struct flashemu_Stats*
+flashemu_getStats (void)
+{
+    return &base.stats;
+}
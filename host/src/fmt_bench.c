@@ -0,0 +1,133 @@
+/*
+ * fmt_bench.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Compares firmware fmt module with the snprintf based formatting it replaced. First every
+ *      milli g value of int16_t range and every time of day is formatted both ways and compared
+ *      byte by byte, then sample lines are timed.
+ *
+ *          fmt_bench [lines]
+ */
+#include "fmt.h"
+#include "serial.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* === private defines === */
+#define LINE_LEN                        50                                      /// CLI_MAX_LINE_LEN
+#define DEFAULT_LINES                   2000000
+#define FORMAT_ACC_DATA(data)           (data >= 0 ? "   %d.%.3d g" : "  -%d.%.3d g")
+
+/* === private variables === */
+static volatile size_t sink;                                                    // keeps results alive
+
+/* === private functions === */
+/* sample line as main_task built it: four snprintf calls, one per queue item */
+static size_t
+lineSnprintf (char *out, const int16_t xyz[3])
+{
+    char item[LINE_LEN];
+    size_t len = 0;
+
+    snprintf (item, LINE_LEN, "\r");
+    len += strlen (strcpy (out + len, item));
+    for (int a = 0; a < 3; a++)
+        {
+            snprintf (item, LINE_LEN, FORMAT_ACC_DATA(xyz[a]), abs (xyz[a]) / 1000,
+                      abs (xyz[a]) % 1000);
+            len += strlen (strcpy (out + len, item));
+        }
+    return len;
+}
+
+static size_t
+lineFmt (char *out, const int16_t xyz[3])
+{
+    char *end = out;
+
+    *end++ = '\r';
+    for (int a = 0; a < 3; a++)
+        {
+            end = fmt_milliG (end, xyz[a]);
+        }
+    *end = '\0';
+    return end - out;
+}
+
+static int
+checkIdentical (void)
+{
+    char a[LINE_LEN * 4], b[LINE_LEN * 4];
+    int errors = 0;
+
+    for (int32_t v = INT16_MIN; v <= INT16_MAX; v++)
+        {
+            int16_t xyz[3] =
+                { v, -v, v / 7 };
+            size_t la = lineSnprintf (a, xyz), lb = lineFmt (b, xyz);
+            if (la != lb || memcmp (a, b, la) != 0)
+                {
+                    if (errors++ < 5)
+                        {
+                            fprintf (stderr, "mismatch at %d: \"%s\" \"%s\"\n", v,
+                                     a, b);
+                        }
+                }
+        }
+    for (int t = 0; t < 24 * 3600; t++)
+        {
+            char *end = fmt_hhmmss (b, t / 3600, t / 60 % 60, t % 60);
+            *end = '\0';
+            snprintf (a, sizeof(a), "%02d:%02d:%02d", t / 3600, t / 60 % 60,
+                      t % 60);
+            if (strcmp (a, b) != 0 && errors++ < 5)
+                {
+                    fprintf (stderr, "mismatch at %d s: \"%s\" \"%s\"\n", t, a, b);
+                }
+        }
+    return errors;
+}
+
+static double
+timeLines (size_t
+(*format) (char*, const int16_t*),
+           const int16_t *values, size_t numOfValues, long lines)
+{
+    char out[LINE_LEN * 4];
+    int64_t start = serial_getMonotonicUs ();
+
+    for (long i = 0; i < lines; i++)
+        {
+            sink += format (out, &values[(i * 3) % numOfValues]);
+        }
+    return (serial_getMonotonicUs () - start) * 1000.0 / lines;
+}
+
+/* === exported functions === */
+int
+main (int argc, char **argv)
+{
+    long lines = argc > 1 ? atol (argv[1]) : DEFAULT_LINES;
+    enum
+    {
+        NUM_OF_VALUES = 3 * 4096
+    };
+    static int16_t values[NUM_OF_VALUES + 3];
+
+    int errors = checkIdentical ();
+    printf ("byte identical: %s\n", errors ? "NO" : "yes");
+
+    srand (1);
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        {
+            values[i] = (rand () % 4001) - 2000;                                // +/- 2 g range
+        }
+    double nsSnprintf = timeLines (lineSnprintf, values, NUM_OF_VALUES, lines);
+    double nsFmt = timeLines (lineFmt, values, NUM_OF_VALUES, lines);
+    printf ("snprintf: %.1f ns/line\nfmt:      %.1f ns/line (%.1fx)\n",
+            nsSnprintf, nsFmt, nsSnprintf / nsFmt);
+    return errors != 0;
+}
@@ -0,0 +1,530 @@
+/*
+ * i2c_check.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Checks transfer, retry and bus recovery paths of the firmware I2C driver (src/app/src/i2c.c)
+ *      built against the register mocks of host/mock. Every access to I2C2 or GPIOA steps a model
+ *      of the peripheral and of one slave, which injects NACK, bus error, arbitration loss, clock
+ *      stretching without end or SDA held low. For each case the returned status, error counters,
+ *      retries, recoveries with SCL pulses and STOP on the pins, and the time at which the deadline
+ *      expired are compared with the expected ones. Register accesses outside scheduler suspension
+ *      are counted as failure as well.
+ *
+ *          i2c_check
+ */
+#include "i2c.h"
+#include "systime.h"
+#include "task.h"
+#include <stdio.h>
+#include <string.h>
+
+/* === private defines === */
+#define NUM_OF_ELEMENTS(a)              (sizeof(a) / sizeof(a[0]))
+#define TXDR_EMPTY                      0x100                                   // driver writes bytes only
+#define SLAVE_ADDR                      0x3C
+#define REG_ADDR                        0x28
+#define DATA_LEN                        6
+#define MAX_ATTEMPTS                    3                                       // first one and MAX_RETRIES of driver
+#define HOLD_FOREVER                    1000                                    // SCL clocks, more than any recovery gives
+
+/* documented deadline: 1 ms and two byte times per byte, address and STOP included */
+#define DEADLINE_BASE_US                1000
+#define DEADLINE_BYTE_BITS              (2 * 9)
+
+/* === private types === */
+enum Fault
+{
+    FAULT_NONE, FAULT_NACK, FAULT_BERR, FAULT_ARLO, FAULT_STRETCH
+};
+
+struct Case
+{
+    const char *name;
+    bool isRead;
+    enum Fault fault;
+    uint8_t faultCount;                                                         /// transfers affected
+    uint32_t sdaHoldClocks;                                                     /// SDA low at start until this many SCL clocks, 0 for none
+    enum I2C_Status status;
+    uint32_t errors;                                                            /// counter of injected fault
+    uint32_t retries;
+    uint32_t recoveries;
+    uint32_t sclPulses;                                                         /// SCL rising edges driven by recovery
+    bool timesOut;                                                              /// first recovery must start at deadline
+};
+
+/* === private variables === */
+static const struct Case cases[] =
+    {
+        { "write", false, FAULT_NONE, 0, 0, I2C_SUCCES, 0, 0, 0, 0, false },
+        { "read", true, FAULT_NONE, 0, 0, I2C_SUCCES, 0, 0, 0, 0, false },
+        { "write, NACK", false, FAULT_NACK, 1, 0, I2C_FAILURE, 1, 0, 0, 0, false },
+        { "read, NACK", true, FAULT_NACK, 1, 0, I2C_FAILURE, 1, 0, 0, 0, false },
+        { "write, ARLO once", false, FAULT_ARLO, 1, 0, I2C_SUCCES, 1, 1, 0, 0, false },
+        { "read, ARLO always", true, FAULT_ARLO, MAX_ATTEMPTS, 0, I2C_BUSY,
+        MAX_ATTEMPTS, MAX_ATTEMPTS - 1, 0, 0, false },
+        { "write, BERR once", false, FAULT_BERR, 1, 0, I2C_SUCCES, 1, 1, 1, 1, false },
+        { "read, BERR always", true, FAULT_BERR, MAX_ATTEMPTS, 0, I2C_BUS_ERROR,
+        MAX_ATTEMPTS, MAX_ATTEMPTS - 1, MAX_ATTEMPTS, MAX_ATTEMPTS, false },
+        { "write, SCL stretched once", false, FAULT_STRETCH, 1, 0, I2C_SUCCES, 1, 1,
+        1, 1, true },
+        { "read, SDA low 3 clocks", true, FAULT_NONE, 0, 3, I2C_SUCCES, 1, 1, 1, 3 + 1,
+        true },
+        { "write, SDA low for good", false, FAULT_NONE, 0, HOLD_FOREVER, I2C_TIMEOUT,
+        MAX_ATTEMPTS, MAX_ATTEMPTS - 1, MAX_ATTEMPTS, MAX_ATTEMPTS * (9 + 1), true } };
+
+/** peripheral and slave model */
+static struct Model
+{
+    I2C_TypeDef i2c;
+    GPIO_TypeDef gpio;
+    /* transfer in progress */
+    bool active, isRead, autoEnd, rxOffered, stalled;
+    uint8_t numOfBytes, done;
+    /* slave */
+    uint8_t mem[128], pointer;
+    enum Fault fault;
+    uint8_t faultsLeft;
+    uint32_t sdaHoldClocks;
+    /* pins */
+    bool scl, sda, pinsDriven;
+    uint32_t sclPulses, stops, recoveryRuns, firstRecoveryUs;
+    /* time and scheduler */
+    uint32_t nowUs;
+    int suspended;
+    uint32_t unlockedAccesses;
+} model;
+
+RCC_TypeDef mock_rcc;
+SYSCFG_TypeDef mock_syscfg;
+uint32_t SystemCoreClock = 8000000;
+
+/* === private functions === */
+static void
+endTransfer (bool stop)
+{
+    model.active = false;
+    model.stalled = false;
+    if (stop)
+        {
+            model.i2c.ISR |= I2C_ISR_STOPF;
+        }
+}
+
+static void
+completeTransfer (void)
+{
+    if (model.autoEnd)
+        {
+            endTransfer (true);
+        }
+    else
+        {
+            model.i2c.ISR |= I2C_ISR_TC;
+        }
+}
+
+static bool
+takeFault (enum Fault fault)
+{
+    if (model.fault == fault && model.faultsLeft > 0)
+        {
+            model.faultsLeft--;
+            return true;
+        }
+    return false;
+}
+
+static void
+offerByte (void)
+{
+    model.i2c.RXDR = model.mem[model.pointer++ % sizeof(model.mem)];
+    model.i2c.ISR |= I2C_ISR_RXNE;
+    model.rxOffered = true;
+}
+
+static void
+startTransfer (void)
+{
+    I2C_TypeDef *r = &model.i2c;
+
+    model.active = true;
+    model.isRead = r->CR2 & I2C_CR2_RD_WRN;
+    model.autoEnd = r->CR2 & I2C_CR2_AUTOEND;
+    model.numOfBytes = (r->CR2 & I2C_CR2_NBYTES) >> I2C_CR2_NBYTES_Pos;
+    model.done = 0;
+    model.rxOffered = false;
+    r->ISR &= ~I2C_ISR_TC;
+
+    if (takeFault (FAULT_ARLO))
+        {
+            r->ISR |= I2C_ISR_ARLO;
+            model.active = false;
+        }
+    else if (takeFault (FAULT_NACK))
+        {
+            /* without AUTOEND master keeps the bus until STOP is requested */
+            r->ISR |= I2C_ISR_NACKF;
+            model.stalled = true;
+            if (model.autoEnd)
+                {
+                    endTransfer (true);
+                }
+        }
+    else if (takeFault (FAULT_STRETCH))
+        {
+            model.stalled = true;
+        }
+    else if (model.isRead)
+        {
+            offerByte ();
+        }
+    else
+        {
+            r->TXDR = TXDR_EMPTY;
+            r->ISR |= I2C_ISR_TXIS;
+        }
+}
+
+/* Advance transfer by one byte when driver took the previous one. A received byte is taken with
+ * the RXDR access which follows the ISR access that showed RXNE. */
+static void
+progressTransfer (void)
+{
+    I2C_TypeDef *r = &model.i2c;
+
+    if (model.stalled)
+        {
+            return;
+        }
+    if (model.isRead)
+        {
+            if (model.rxOffered)
+                {
+                    r->ISR &= ~I2C_ISR_RXNE;
+                    model.rxOffered = false;
+                    if (++model.done == model.numOfBytes)
+                        {
+                            completeTransfer ();
+                        }
+                }
+            else if (model.done < model.numOfBytes)
+                {
+                    offerByte ();
+                }
+        }
+    else if ((r->ISR & I2C_ISR_TXIS) && r->TXDR != TXDR_EMPTY)
+        {
+            uint8_t byte = r->TXDR;
+            r->TXDR = TXDR_EMPTY;
+            r->ISR &= ~I2C_ISR_TXIS;
+            if (takeFault (FAULT_BERR))
+                {
+                    r->ISR |= I2C_ISR_BERR;
+                    endTransfer (false);
+                    return;
+                }
+            if (model.done == 0)
+                {
+                    model.pointer = byte & 0x7F;                                // auto increment bit
+                }
+            else
+                {
+                    model.mem[model.pointer++ % sizeof(model.mem)] = byte;
+                }
+            if (++model.done < model.numOfBytes)
+                {
+                    r->ISR |= I2C_ISR_TXIS;
+                }
+            else
+                {
+                    completeTransfer ();
+                }
+        }
+}
+
+static void
+stepI2c (void)
+{
+    I2C_TypeDef *r = &model.i2c;
+
+    r->ISR &= ~r->ICR;
+    r->ICR = 0;
+    if (!(r->CR1 & I2C_CR1_PE))
+        {
+            /* disabled peripheral is in reset state, START and STOP requests are lost */
+            r->ISR = 0;
+            r->CR2 &= ~(I2C_CR2_START | I2C_CR2_STOP);
+            model.active = false;
+            model.stalled = false;
+            return;
+        }
+    if (r->CR2 & I2C_CR2_STOP)
+        {
+            r->CR2 &= ~I2C_CR2_STOP;
+            endTransfer (true);
+        }
+    if (r->CR2 & I2C_CR2_START)
+        {
+            r->CR2 &= ~I2C_CR2_START;
+            startTransfer ();
+        }
+    else if (model.active)
+        {
+            progressTransfer ();
+        }
+    if (model.active || model.sdaHoldClocks > 0)
+        {
+            r->ISR |= I2C_ISR_BUSY;
+        }
+    else
+        {
+            r->ISR &= ~I2C_ISR_BUSY;
+        }
+}
+
+/* Apply BSRR, drive pins in output mode and let slave release SDA after its clocks */
+static void
+stepGpio (void)
+{
+    GPIO_TypeDef *g = &model.gpio;
+
+    g->ODR = (g->ODR | (g->BSRR & 0xFFFF)) & ~(g->BSRR >> 16);
+    g->BSRR = 0;
+
+    bool sclOutput = ((g->MODER & GPIO_MODER_MODER9) >> GPIO_MODER_MODER9_Pos)
+            == 1;
+    bool sdaOutput = ((g->MODER & GPIO_MODER_MODER10)
+            >> GPIO_MODER_MODER10_Pos) == 1;
+    if (sclOutput && !model.pinsDriven)
+        {
+            if (model.recoveryRuns++ == 0)
+                {
+                    model.firstRecoveryUs = model.nowUs;
+                }
+        }
+    model.pinsDriven = sclOutput;
+
+    bool scl = !sclOutput || (g->ODR & GPIO_IDR_9);
+    if (scl && !model.scl && sclOutput)
+        {
+            model.sclPulses++;
+            if (model.sdaHoldClocks > 0 && model.sdaHoldClocks < HOLD_FOREVER)
+                {
+                    model.sdaHoldClocks--;
+                }
+        }
+    bool sda = (!sdaOutput || (g->ODR & GPIO_IDR_10))
+            && model.sdaHoldClocks == 0;
+    if (scl && model.scl && sda && !model.sda)
+        {
+            model.stops++;
+        }
+    model.scl = scl;
+    model.sda = sda;
+    g->IDR = (scl ? GPIO_IDR_9 : 0) | (sda ? GPIO_IDR_10 : 0);
+}
+
+/* === mock interface === */
+I2C_TypeDef*
+mock_i2c (void)
+{
+    model.unlockedAccesses += model.suspended == 0;
+    stepI2c ();
+    return &model.i2c;
+}
+
+GPIO_TypeDef*
+mock_gpioA (void)
+{
+    model.unlockedAccesses += model.suspended == 0;
+    stepGpio ();
+    return &model.gpio;
+}
+
+void
+vTaskSuspendAll (void)
+{
+    model.suspended++;
+}
+
+BaseType_t
+xTaskResumeAll (void)
+{
+    model.suspended--;
+    return 0;
+}
+
+/* polling the deadline takes one microsecond */
+uint32_t
+systime_deadline (uint32_t us)
+{
+    return model.nowUs + us;
+}
+
+bool
+systime_isReached (uint32_t deadline)
+{
+    model.nowUs++;
+    return (int32_t) (model.nowUs - deadline) >= 0;
+}
+
+void
+systime_delayUs (uint32_t us)
+{
+    model.nowUs += us;
+    stepGpio ();
+}
+
+/* === checks === */
+static int
+expectU32 (const char *label, uint32_t value, uint32_t expected)
+{
+    if (value != expected)
+        {
+            printf ("    %s %u, expected %u\n", label, value, expected);
+            return 1;
+        }
+    return 0;
+}
+
+static uint32_t
+faultCounter (const struct I2C_Stats *s, const struct Case *c)
+{
+    switch (c->fault)
+        {
+        case FAULT_NACK:
+            return s->nacks;
+        case FAULT_BERR:
+            return s->busErrors;
+        case FAULT_ARLO:
+            return s->arbitrationLosses;
+        default:
+            return s->timeouts;
+        }
+}
+
+static int
+runCase (const struct Case *c)
+{
+    uint8_t data[DATA_LEN];
+    uint8_t expected[DATA_LEN];
+    int failures = 0;
+
+    /* fresh bus, counters are compared as differences */
+    uint32_t nowUs = model.nowUs;
+    memset (&model, 0, sizeof(model));
+    model.nowUs = nowUs;
+    model.scl = model.sda = true;
+    I2C_init ();
+    for (uint8_t i = 0; i < sizeof(model.mem); i++)
+        {
+            model.mem[i] = 0xA0 + i;
+        }
+    for (uint8_t i = 0; i < DATA_LEN; i++)
+        {
+            data[i] = 0x10 + i;
+            expected[i] = c->isRead ? model.mem[REG_ADDR + i] : data[i];
+        }
+    if (c->isRead)
+        {
+            memset (data, 0, sizeof(data));
+        }
+    model.fault = c->fault;
+    model.faultsLeft = c->faultCount;
+    model.sdaHoldClocks = c->sdaHoldClocks;
+    model.unlockedAccesses = 0;
+    struct I2C_Stats before = *I2C_getStats ();
+
+    uint32_t startUs = model.nowUs;
+    enum I2C_Status status =
+            c->isRead ?
+                    I2C_readByteStream (SLAVE_ADDR, REG_ADDR | 0x80, data,
+                                        DATA_LEN) :
+                    I2C_writeByteStream (SLAVE_ADDR, REG_ADDR | 0x80, data,
+                                         DATA_LEN);
+    const struct I2C_Stats *after = I2C_getStats ();
+
+    failures += expectU32 ("status", status, c->status);
+    failures += expectU32 ("transfers", after->transfers - before.transfers, 1);
+    failures += expectU32 ("fault counter",
+                           faultCounter (after, c) - faultCounter (&before, c),
+                           c->errors);
+    failures += expectU32 ("retries", after->retries - before.retries,
+                           c->retries);
+    failures += expectU32 ("recoveries", after->recoveries - before.recoveries,
+                           c->recoveries);
+    failures += expectU32 ("failures", after->failures - before.failures,
+                           status != I2C_SUCCES);
+    failures += expectU32 ("recoverBus runs", model.recoveryRuns, c->recoveries);
+    failures += expectU32 ("SCL pulses", model.sclPulses, c->sclPulses);
+    /* STOP can not show on the bus while slave keeps SDA low */
+    failures += expectU32 ("STOPs on pins", model.stops,
+                           c->sdaHoldClocks == HOLD_FOREVER ? 0 : c->recoveries);
+    failures += expectU32 ("unlocked accesses", model.unlockedAccesses, 0);
+    if (c->timesOut)
+        {
+            uint32_t byteUs = DEADLINE_BYTE_BITS * 1000000UL
+                    / I2C_getBusFrequency ();
+            uint32_t deadlineUs = DEADLINE_BASE_US
+                    + byteUs * (DATA_LEN + (c->isRead ? 3 : 2));
+            failures += expectU32 ("deadline us", model.firstRecoveryUs - startUs,
+                                   deadlineUs);
+        }
+    if (status == I2C_SUCCES)
+        {
+            const uint8_t *written = &model.mem[REG_ADDR];
+            if (memcmp (c->isRead ? data : written, expected, DATA_LEN))
+                {
+                    printf ("    data differs\n");
+                    failures++;
+                }
+        }
+    stepI2c ();                                                                 // last flag clearing
+    if ((model.i2c.ISR & (I2C_ISR_STOPF | I2C_ISR_NACKF))
+            || ((model.i2c.ISR & I2C_ISR_BUSY) && model.sdaHoldClocks == 0))
+        {
+            printf ("    bus left busy or flags set, ISR 0x%04x\n",
+                    (unsigned) model.i2c.ISR);
+            failures++;
+        }
+
+    printf ("%-28s %u us%s\n", c->name, model.nowUs - startUs,
+            failures ? "  FAILED" : "");
+    return failures != 0;
+}
+
+/* Speed change disables the peripheral, a transfer must not start in between */
+static int
+checkSetSpeed (void)
+{
+    int failures = 0;
+
+    model.unlockedAccesses = 0;
+    if (!I2C_setSpeed (I2CTIMING_SPEED_FAST))
+        {
+            printf ("    400 kHz refused\n");
+            failures++;
+        }
+    failures += expectU32 ("unlocked accesses", model.unlockedAccesses, 0);
+    failures += expectU32 ("peripheral enabled", model.i2c.CR1 & I2C_CR1_PE,
+                           I2C_CR1_PE);
+    I2C_setSpeed (I2CTIMING_SPEED_STANDARD);
+    printf ("%-28s%s\n", "speed change", failures ? "  FAILED" : "");
+    return failures != 0;
+}
+
+int
+main (void)
+{
+    int failures = 0;
+
+    for (size_t i = 0; i < NUM_OF_ELEMENTS(cases); i++)
+        {
+            failures += runCase (&cases[i]);
+        }
+    failures += checkSetSpeed ();
+    printf ("%d of %zu cases failed\n", failures, NUM_OF_ELEMENTS(cases) + 1);
+    return failures != 0;
+}
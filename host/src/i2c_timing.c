@@ -0,0 +1,204 @@
+/*
+ * i2c_timing.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Checks firmware i2ctiming calculator against the timing setting examples of RM0365
+ *      (I2CCLK 8, 16 and 48 MHz at 100 kHz, 400 kHz and 1 MHz) and at the clock governor levels
+ *      24 and 72 MHz, which have no example in the manual. Computed TIMINGR is decoded and
+ *      evaluated with the SCL period formula of RM0365 plus SCL rise and fall times of the board,
+ *      independently of the calculator model:
+ *      - SCL frequency must not exceed nominal speed and must not be lower than the frequency of
+ *        the RM0365 example setting evaluated the same way, or than nominal speed where the manual
+ *        gives no example, by more than SCL_TOLERANCE; it may exceed the example up to nominal speed
+ *        (8 MHz example of 1 MHz gives 480 kHz),
+ *      - SCL low and high periods and SCLDEL must meet UM10204 minimums of tLOW, tHIGH, tSU;DAT,
+ *      - frequency reported by the calculator must not exceed nominal speed and must match the
+ *        estimate within REPORTED_TOLERANCE.
+ *      Exits with non zero status on mismatch.
+ *
+ *          i2c_timing
+ */
+#include "i2ctiming.h"
+#include <stdio.h>
+#include <math.h>
+
+/* === private defines === */
+#define NUM_OF_ELEMENTS(a)              (sizeof(a) / sizeof(a[0]))
+
+/* RM0365 I2C timings: tSCL = tSYNC1 + tSYNC2 + ((SCLL + 1) + (SCLH + 1)) * (PRESC + 1) * tI2CCLK,
+ * tSYNC is the analog filter delay (50 ns at least) and 2 to 3 I2CCLK periods. SCL rise and fall
+ * times of the board make the period longer. */
+#define AF_DELAY_MIN_NS                 50.0
+#define SYNC_MIN_CLOCKS                 2
+#define SCL_RISE_NS                     100.0
+#define SCL_FALL_NS                     10.0
+
+#define SCL_TOLERANCE                   0.2                                     // SCL frequency below reference
+#define REPORTED_TOLERANCE              0.01                                    // reported SCL frequency against estimate
+
+/* === private types === */
+struct Fields
+{
+    unsigned presc, scldel, sdadel, sclh, scll;
+};
+
+/** UM10204 limits, in nanoseconds */
+struct BusSpec
+{
+    unsigned hz;
+    unsigned lowMin, highMin, setupMin;
+};
+
+struct Case
+{
+    unsigned kernelHz;
+    enum i2ctiming_Speed speed;
+    struct Fields reference;                                                    /// RM0365 example, all zero if none
+};
+
+/* === private variables === */
+static const char *speedNames[I2CTIMING_SPEED_COUNT] =
+    { "100k", "400k", "1M" };
+
+static const struct BusSpec busSpecs[I2CTIMING_SPEED_COUNT] =
+    {
+        { 100000, 4700, 4000, 250 },
+        { 400000, 1300, 600, 100 },
+        { 1000000, 500, 260, 50 } };
+
+static const struct Case cases[] =
+    {
+        /* RM0365 examples of timing settings */
+        { 8000000, I2CTIMING_SPEED_STANDARD, { 0x1, 0x4, 0x2, 0xF, 0x13 } },
+        { 8000000, I2CTIMING_SPEED_FAST, { 0x0, 0x3, 0x1, 0x3, 0x9 } },
+        { 8000000, I2CTIMING_SPEED_FAST_PLUS, { 0x0, 0x1, 0x0, 0x3, 0x6 } },
+        { 16000000, I2CTIMING_SPEED_STANDARD, { 0x3, 0x4, 0x2, 0xF, 0x13 } },
+        { 16000000, I2CTIMING_SPEED_FAST, { 0x1, 0x3, 0x2, 0x3, 0x9 } },
+        { 16000000, I2CTIMING_SPEED_FAST_PLUS, { 0x0, 0x2, 0x0, 0x2, 0x4 } },
+        { 48000000, I2CTIMING_SPEED_STANDARD, { 0xB, 0x4, 0x2, 0xF, 0x13 } },
+        { 48000000, I2CTIMING_SPEED_FAST, { 0x5, 0x3, 0x3, 0x3, 0x9 } },
+        { 48000000, I2CTIMING_SPEED_FAST_PLUS, { 0x5, 0x1, 0x0, 0x1, 0x3 } },
+        /* clock governor levels */
+        { 24000000, I2CTIMING_SPEED_STANDARD, { 0 } },
+        { 24000000, I2CTIMING_SPEED_FAST, { 0 } },
+        { 24000000, I2CTIMING_SPEED_FAST_PLUS, { 0 } },
+        { 72000000, I2CTIMING_SPEED_STANDARD, { 0 } },
+        { 72000000, I2CTIMING_SPEED_FAST, { 0 } },
+        { 72000000, I2CTIMING_SPEED_FAST_PLUS, { 0 } } };
+
+/* === private functions === */
+static struct Fields
+decode (unsigned timingr)
+{
+    struct Fields f =
+        { timingr >> 28, (timingr >> 20) & 0xF, (timingr >> 16) & 0xF, (timingr
+                >> 8) & 0xFF, timingr & 0xFF };
+    return f;
+}
+
+static double
+syncNs (unsigned kernelHz)
+{
+    return AF_DELAY_MIN_NS + SYNC_MIN_CLOCKS * 1e9 / kernelHz;
+}
+
+/* SCL frequency of setting by RM0365 formula, signal edges included */
+static double
+sclHzOf (unsigned kernelHz, const struct Fields *f)
+{
+    double prescNs = (f->presc + 1) * 1e9 / kernelHz;
+    return 1e9 / ((f->scll + 1 + f->sclh + 1) * prescNs + 2 * syncNs (kernelHz)
+            + SCL_RISE_NS + SCL_FALL_NS);
+}
+
+/* Compare computed setting with bus limits and reference, returns number of mismatches */
+static int
+check (const struct Case *c, const struct Fields *f, unsigned reportedHz)
+{
+    const struct BusSpec *spec = &busSpecs[c->speed];
+    double prescNs = (f->presc + 1) * 1e9 / c->kernelHz;
+    double low = (f->scll + 1) * prescNs + syncNs (c->kernelHz);
+    double high = (f->sclh + 1) * prescNs + syncNs (c->kernelHz);
+    double sclHz = sclHzOf (c->kernelHz, f);
+    double refHz = c->reference.scll != 0 ?
+            sclHzOf (c->kernelHz, &c->reference) : spec->hz;
+    double minHz = refHz * (1 - SCL_TOLERANCE);
+    double maxHz = spec->hz;
+    int mismatches = 0;
+
+    printf ("  SCL %.0f Hz, reference %.0f Hz\n", sclHz, refHz);
+    if (sclHz < minHz || sclHz > maxHz)
+        {
+            printf ("    SCL outside %.0f-%.0f Hz\n", minHz, maxHz);
+            mismatches++;
+        }
+    if (low < spec->lowMin)
+        {
+            printf ("    tLOW %.0f < %u ns\n", low, spec->lowMin);
+            mismatches++;
+        }
+    if (high < spec->highMin)
+        {
+            printf ("    tHIGH %.0f < %u ns\n", high, spec->highMin);
+            mismatches++;
+        }
+    if ((f->scldel + 1) * prescNs < spec->setupMin)
+        {
+            printf ("    tSCLDEL %.0f < tSU;DAT %u ns\n", (f->scldel + 1) * prescNs,
+                    spec->setupMin);
+            mismatches++;
+        }
+    if (reportedHz > spec->hz
+            || fabs (reportedHz - sclHz) > sclHz * REPORTED_TOLERANCE)
+        {
+            printf ("    reported %u Hz does not match %.0f Hz\n", reportedHz,
+                    sclHz);
+            mismatches++;
+        }
+    return mismatches;
+}
+
+static void
+printFields (const char *label, const struct Fields *f)
+{
+    printf ("  %-9s PRESC %2u SCLDEL %2u SDADEL %2u SCLH %3u SCLL %3u", label,
+            f->presc, f->scldel, f->sdadel, f->sclh, f->scll);
+}
+
+int
+main ()
+{
+    int failures = 0;
+
+    for (size_t i = 0; i < NUM_OF_ELEMENTS(cases); i++)
+        {
+            const struct Case *c = &cases[i];
+            struct i2ctiming_Result result;
+
+            printf ("%2u MHz %-4s\n", c->kernelHz / 1000000,
+                    speedNames[c->speed]);
+            if (!i2ctiming_compute (c->kernelHz, c->speed, &result))
+                {
+                    printf ("  no timing found\n");
+                    failures++;
+                    continue;
+                }
+            struct Fields computed = decode (result.timingr);
+            printFields ("computed", &computed);
+            printf (" 0x%08X %u Hz\n", result.timingr, result.sclHz);
+            if (c->reference.scll != 0)
+                {
+                    printFields ("RM0365", &c->reference);
+                    printf ("\n");
+                }
+            if (check (c, &computed, result.sclHz) != 0)
+                {
+                    printf ("  FAILED\n");
+                    failures++;
+                }
+        }
+    printf ("%d of %zu cases failed\n", failures, NUM_OF_ELEMENTS(cases));
+    return failures != 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * odr_check.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Checks firmware ODR measurement module with synthetic data ready edges: sensor clock off
+ *      nominal, uniform edge jitter, dropped edges and cycle counter wrap. Rate must match the true
+ *      rate within 0.01 %, jitter and max deviation must match a double precision evaluation of the
+ *      same window within 1 % or one cycle, and every dropped edge must be counted.
+ *
+ *          odr_check [seed]
+ */
+#include "odr.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* === private defines === */
+#define NUM_OF_ELEMENTS(a)              (sizeof(a) / sizeof(a[0]))
+#define EDGES                           1000
+
+/* === private types === */
+struct Case
+{
+    const char *name;
+    uint32_t coreHz;
+    uint32_t nominalMilliHz;
+    double errorPpm;                                                            /// sensor clock error
+    uint32_t jitterCycles;                                                      /// uniform edge jitter amplitude
+    uint32_t dropEvery;                                                         /// every n-th edge is not seen, 0 for none
+};
+
+/* === private variables === */
+static const struct Case cases[] =
+    {
+        { "400 Hz, exact, no jitter", 72000000, 400000, 0, 0, 0 },
+        { "400 Hz, +7000 ppm", 72000000, 400000, 7000, 0, 0 },
+        { "1600 Hz, -3000 ppm, jitter", 72000000, 1600000, -3000, 300, 0 },
+        { "25 Hz, 8 MHz core, drops", 8000000, 25000, 1500, 40, 17 },
+        { "3.125 Hz, 72 MHz core", 72000000, 3125, -500, 5000, 0 },
+        { "800 Hz, drops and jitter", 48000000, 800000, 2500, 1000, 5 } };
+
+/* === private functions === */
+/* Within relative tolerance, or within one cycle of counter resolution */
+static int
+checkRelative (const char *label, double value, double reference,
+               double tolerance, double resolution)
+{
+    double error = reference == 0 ? fabs (value) : fabs (value / reference - 1);
+    if (error > tolerance && fabs (value - reference) > resolution)
+        {
+            printf ("    %s %.3f, reference %.3f\n", label, value, reference);
+            return 1;
+        }
+    return 0;
+}
+
+static int
+runCase (const struct Case *c)
+{
+    static struct odr_Window window;
+    double period = c->coreHz * 1000.0 / c->nominalMilliHz
+            / (1.0 + c->errorPpm * 1e-6);
+    double ideal = 0xFFF00000u;                                                 // counter wraps during the run
+    double seen[EDGES];
+    uint32_t numSeen = 0;
+    int failures = 0;
+
+    odr_start (&window, c->nominalMilliHz);
+    for (uint32_t i = 0; i < EDGES; i++, ideal += period)
+        {
+            if (c->dropEvery != 0 && i % c->dropEvery == c->dropEvery - 1)
+                {
+                    continue;
+                }
+            double edge = ideal + (c->jitterCycles == 0 ?
+                    0 : rand () % (2 * c->jitterCycles + 1) - (double) c->jitterCycles);
+            uint32_t cycles = (uint32_t) fmod (floor (edge), 4294967296.0);
+            odr_addEdge (&window, cycles, c->coreHz);
+            seen[numSeen++] = floor (edge);
+        }
+
+    /* reference over the same spans */
+    struct odr_Summary s;
+    odr_getSummary (&window, &s);
+    double sum = 0, sumSq = 0, maxDev = 0;
+    uint32_t singles = 0, periods = 0, refMissed = 0;
+    for (uint32_t i = numSeen - s.edges; i < numSeen; i++)
+        {
+            double span = seen[i] - seen[i - 1];
+            uint32_t n = (uint32_t) floor (span / period + 0.5);
+            periods += n;
+            refMissed += n - 1;
+            if (n == 1)
+                {
+                    sum += span;
+                    singles++;
+                }
+        }
+    double mean = sum / singles;
+    for (uint32_t i = numSeen - s.edges; i < numSeen; i++)
+        {
+            double span = seen[i] - seen[i - 1];
+            if (floor (span / period + 0.5) == 1)
+                {
+                    sumSq += (span - mean) * (span - mean);
+                    maxDev = fabs (span - mean) > maxDev ? fabs (span - mean) : maxDev;
+                }
+        }
+    double trueMilliHz = c->nominalMilliHz * (1.0 + c->errorPpm * 1e-6);
+    double jitterNs = sqrt (sumSq / singles) * 1e9 / c->coreHz;
+    double maxDevNs = maxDev * 1e9 / c->coreHz;
+
+    double cycleNs = 1e9 / c->coreHz;
+    failures += checkRelative ("rate", s.rateMilliHz, trueMilliHz, 1e-4, 1);
+    failures += checkRelative ("jitter", s.jitterNs, jitterNs, 0.01, cycleNs);
+    failures += checkRelative ("max deviation", s.maxDeviationNs, maxDevNs,
+                               0.01, cycleNs);
+    if (s.missed != refMissed || s.periods != periods)
+        {
+            printf ("    missed %lu of %lu, reference %u of %u\n",
+                    (unsigned long) s.missed, (unsigned long) s.periods,
+                    refMissed, periods);
+            failures++;
+        }
+    printf ("%-28s %8lu.%03lu Hz, jitter %7lu ns, max %7lu ns, missed %2lu%s\n",
+            c->name, (unsigned long) s.rateMilliHz / 1000,
+            (unsigned long) s.rateMilliHz % 1000, (unsigned long) s.jitterNs,
+            (unsigned long) s.maxDeviationNs, (unsigned long) s.missed,
+            failures ? "  FAILED" : "");
+    return failures != 0;
+}
+
+/* Core clock change starts new window */
+static int
+checkClockChange (void)
+{
+    struct odr_Window window;
+    struct odr_Summary s;
+    uint32_t cycles = 0;
+
+    odr_start (&window, 400000);
+    for (int i = 0; i < 50; i++, cycles += 180000)
+        {
+            odr_addEdge (&window, cycles, 72000000);
+        }
+    for (int i = 0; i < 10; i++, cycles += 20000)
+        {
+            odr_addEdge (&window, cycles, 8000000);
+        }
+    odr_getSummary (&window, &s);
+    int failed = s.edges != 9 || s.rateMilliHz != 400000 || s.missed != 0;
+    printf ("%-28s %u edges after change%s\n", "core clock change", s.edges,
+            failed ? "  FAILED" : "");
+    return failed;
+}
+
+int
+main (int argc, char **argv)
+{
+    int failures = 0;
+
+    srand (argc > 1 ? strtoul (argv[1], NULL, 0) : 1);
+    for (size_t i = 0; i < NUM_OF_ELEMENTS(cases); i++)
+        {
+            failures += runCase (&cases[i]);
+        }
+    failures += checkClockChange ();
+    printf ("%d of %zu cases failed\n", failures, NUM_OF_ELEMENTS(cases) + 1);
+    return failures != 0;
+}
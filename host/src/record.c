@@ -0,0 +1,578 @@
+/*
+ * record.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "record.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* === private defines === */
+#define ALIGN8(n)                       (((n) + 7u) & ~(size_t) 7u)
+#define INITIAL_INDEX_CAPACITY          64
+
+/* === private functions === */
+static size_t
+chunkSize (uint32_t count)
+{
+    return ALIGN8(sizeof(struct record_ChunkHeader)
+            + (size_t) count * (sizeof(int64_t) + RECORD_AXES * sizeof(int16_t)
+                    + sizeof(uint8_t)));
+}
+
+static void
+resetChunkInfo (struct record_ChunkInfo *info, uint64_t offset)
+{
+    memset (info, 0, sizeof(*info));
+    info->offset = offset;
+    for (int i = 0; i < RECORD_AXES; i++)
+        {
+            info->min[i] = INT16_MAX;
+            info->max[i] = INT16_MIN;
+        }
+}
+
+static int
+writeBytes (struct record_Writer *writer, const void *data, size_t len)
+{
+    if (len != 0 && 1 != fwrite (data, len, 1, writer->file))
+        {
+            return -1;
+        }
+    writer->offset += len;
+    return 0;
+}
+
+static int
+writeChunk (struct record_Writer *writer)
+{
+    static const uint8_t padding[8] =
+        { 0 };
+    struct record_ChunkInfo *info = &writer->current;
+    struct record_ChunkHeader header;
+    size_t count = info->count;
+
+    if (count == 0)
+        {
+            return 0;
+        }
+
+    header.magic = RECORD_CHUNK_MAGIC;
+    header.size = chunkSize (info->count);
+    header.info = *info;
+
+    size_t start = writer->offset;
+    if (writeBytes (writer, &header, sizeof(header))
+            || writeBytes (writer, writer->t, count * sizeof(int64_t))
+            || writeBytes (writer, writer->x, count * sizeof(int16_t))
+            || writeBytes (writer, writer->y, count * sizeof(int16_t))
+            || writeBytes (writer, writer->z, count * sizeof(int16_t))
+            || writeBytes (writer, writer->flags, count * sizeof(uint8_t))
+            || writeBytes (writer, padding,
+                           header.size - (writer->offset - start)))
+        {
+            return -1;
+        }
+
+    /* add chunk to index */
+    if (writer->numOfChunks == writer->indexCapacity)
+        {
+            size_t capacity = writer->indexCapacity * 2;
+            struct record_ChunkInfo *index = realloc (
+                    writer->index, capacity * sizeof(*index));
+            if (index == NULL)
+                {
+                    return -1;
+                }
+            writer->index = index;
+            writer->indexCapacity = capacity;
+        }
+    writer->index[writer->numOfChunks++] = *info;
+    resetChunkInfo (info, writer->offset);
+    return 0;
+}
+
+static int
+validChunkInfo (const struct record_Reader *reader,
+                const struct record_ChunkInfo *info)
+{
+    return info->offset + sizeof(struct record_ChunkHeader) <= reader->size
+            && info->offset + chunkSize (info->count) <= reader->size;
+}
+
+/* rebuild index of file which has not been closed by walking chunk headers */
+static int
+recoverIndex (struct record_Reader *reader)
+{
+    size_t capacity = INITIAL_INDEX_CAPACITY, offset =
+            sizeof(struct record_FileHeader);
+
+    reader->recovered = malloc (capacity * sizeof(struct record_ChunkInfo));
+    if (reader->recovered == NULL)
+        {
+            return -1;
+        }
+    reader->numOfChunks = 0;
+    while (offset + sizeof(struct record_ChunkHeader) <= reader->size)
+        {
+            struct record_ChunkHeader header;
+            memcpy (&header, reader->base + offset, sizeof(header));
+            if (header.magic != RECORD_CHUNK_MAGIC
+                    || header.info.offset != offset
+                    || header.size != chunkSize (header.info.count)
+                    || offset + header.size > reader->size)
+                {
+                    break;
+                }
+            if (reader->numOfChunks == capacity)
+                {
+                    capacity *= 2;
+                    struct record_ChunkInfo *index = realloc (
+                            reader->recovered,
+                            capacity * sizeof(struct record_ChunkInfo));
+                    if (index == NULL)
+                        {
+                            return -1;
+                        }
+                    reader->recovered = index;
+                }
+            reader->recovered[reader->numOfChunks++] = header.info;
+            offset += header.size;
+        }
+    reader->index = reader->recovered;
+    return 0;
+}
+
+/* index of first chunk which may contain samples with time >= t */
+static size_t
+firstChunkEndingAfter (const struct record_Reader *reader, int64_t t)
+{
+    size_t lo = 0, hi = reader->numOfChunks;
+    while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (reader->index[mid].t1Us < t)
+                {
+                    lo = mid + 1;
+                }
+            else
+                {
+                    hi = mid;
+                }
+        }
+    return lo;
+}
+
+static int64_t
+magnitudeSquared (int16_t x, int16_t y, int16_t z)
+{
+    return (int64_t) x * x + (int64_t) y * y + (int64_t) z * z;
+}
+
+static int32_t
+maxAbs (int16_t min, int16_t max)
+{
+    int32_t a = abs ((int32_t) min), b = abs ((int32_t) max);
+    return a > b ? a : b;
+}
+
+/* === exported functions === */
+int
+record_create (struct record_Writer *writer, const char *path,
+               uint32_t chunkCapacity)
+{
+    struct record_FileHeader header;
+
+    memset (writer, 0, sizeof(*writer));
+    writer->chunkCapacity =
+            chunkCapacity ? chunkCapacity : RECORD_DEFAULT_CHUNK_LEN;
+    writer->t = malloc (writer->chunkCapacity * sizeof(int64_t));
+    writer->x = malloc (writer->chunkCapacity * sizeof(int16_t));
+    writer->y = malloc (writer->chunkCapacity * sizeof(int16_t));
+    writer->z = malloc (writer->chunkCapacity * sizeof(int16_t));
+    writer->flags = malloc (writer->chunkCapacity * sizeof(uint8_t));
+    writer->indexCapacity = INITIAL_INDEX_CAPACITY;
+    writer->index = malloc (
+            writer->indexCapacity * sizeof(struct record_ChunkInfo));
+    if (!writer->t || !writer->x || !writer->y || !writer->z
+            || !writer->flags || !writer->index)
+        {
+            goto error;
+        }
+
+    writer->file = fopen (path, "wb");
+    if (writer->file == NULL)
+        {
+            goto error;
+        }
+
+    memcpy (header.magic, RECORD_FILE_MAGIC, sizeof(header.magic));
+    header.version = RECORD_VERSION;
+    header.chunkCapacity = writer->chunkCapacity;
+    if (writeBytes (writer, &header, sizeof(header)))
+        {
+            fclose (writer->file);
+            goto error;
+        }
+    resetChunkInfo (&writer->current, writer->offset);
+    return 0;
+
+    error:
+    free (writer->t);
+    free (writer->x);
+    free (writer->y);
+    free (writer->z);
+    free (writer->flags);
+    free (writer->index);
+    memset (writer, 0, sizeof(*writer));
+    return -1;
+}
+
+int
+record_append (struct record_Writer *writer,
+               const struct devstream_Sample *sample)
+{
+    struct record_ChunkInfo *info = &writer->current;
+    const int16_t axes[RECORD_AXES] =
+        { sample->x, sample->y, sample->z };
+    uint32_t i = info->count;
+
+    writer->t[i] = sample->timeUs;
+    writer->x[i] = sample->x;
+    writer->y[i] = sample->y;
+    writer->z[i] = sample->z;
+    writer->flags[i] = sample->flags;
+
+    if (i == 0)
+        {
+            info->t0Us = sample->timeUs;
+        }
+    info->t1Us = sample->timeUs;
+    info->flagsMask |= sample->flags;
+    for (int a = 0; a < RECORD_AXES; a++)
+        {
+            if (axes[a] < info->min[a])
+                {
+                    info->min[a] = axes[a];
+                }
+            if (axes[a] > info->max[a])
+                {
+                    info->max[a] = axes[a];
+                }
+            info->sum[a] += axes[a];
+        }
+    info->count++;
+
+    if (info->count == writer->chunkCapacity)
+        {
+            return writeChunk (writer);
+        }
+    return 0;
+}
+
+int
+record_flush (struct record_Writer *writer)
+{
+    if (writeChunk (writer))
+        {
+            return -1;
+        }
+    return fflush (writer->file) ? -1 : 0;
+}
+
+int
+record_close (struct record_Writer *writer)
+{
+    struct record_Trailer trailer;
+    int status = writeChunk (writer);
+
+    trailer.indexOffset = writer->offset;
+    trailer.numOfChunks = writer->numOfChunks;
+    memcpy (trailer.magic, RECORD_INDEX_MAGIC, sizeof(trailer.magic));
+    if (status == 0)
+        {
+            status = writeBytes (
+                    writer, writer->index,
+                    writer->numOfChunks * sizeof(struct record_ChunkInfo));
+        }
+    if (status == 0)
+        {
+            status = writeBytes (writer, &trailer, sizeof(trailer));
+        }
+    if (fclose (writer->file))
+        {
+            status = -1;
+        }
+
+    free (writer->t);
+    free (writer->x);
+    free (writer->y);
+    free (writer->z);
+    free (writer->flags);
+    free (writer->index);
+    memset (writer, 0, sizeof(*writer));
+    return status;
+}
+
+int
+record_open (struct record_Reader *reader, const char *path)
+{
+    struct stat st;
+    struct record_FileHeader header;
+    struct record_Trailer trailer;
+
+    memset (reader, 0, sizeof(*reader));
+    int fd = open (path, O_RDONLY);
+    if (fd < 0)
+        {
+            return -1;
+        }
+    if (fstat (fd, &st) || (size_t) st.st_size < sizeof(header))
+        {
+            close (fd);
+            return -1;
+        }
+    reader->size = st.st_size;
+    reader->base = mmap (NULL, reader->size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (reader->base == MAP_FAILED)
+        {
+            reader->base = NULL;
+            return -1;
+        }
+
+    memcpy (&header, reader->base, sizeof(header));
+    if (memcmp (header.magic, RECORD_FILE_MAGIC, sizeof(header.magic))
+            || header.version != RECORD_VERSION)
+        {
+            record_release (reader);
+            return -1;
+        }
+
+    /* use index footer if file was closed properly */
+    if (reader->size >= sizeof(header) + sizeof(trailer))
+        {
+            memcpy (&trailer, reader->base + reader->size - sizeof(trailer),
+                    sizeof(trailer));
+            if (0 == memcmp (trailer.magic, RECORD_INDEX_MAGIC,
+                             sizeof(trailer.magic))
+                    && trailer.indexOffset
+                            + trailer.numOfChunks
+                                    * sizeof(struct record_ChunkInfo)
+                            + sizeof(trailer) == reader->size)
+                {
+                    reader->index = (const struct record_ChunkInfo*) (reader
+                            ->base + trailer.indexOffset);
+                    reader->numOfChunks = trailer.numOfChunks;
+                    return 0;
+                }
+        }
+
+    if (recoverIndex (reader))
+        {
+            record_release (reader);
+            return -1;
+        }
+    return 0;
+}
+
+void
+record_release (struct record_Reader *reader)
+{
+    if (reader->base)
+        {
+            munmap ((void*) reader->base, reader->size);
+        }
+    free (reader->recovered);
+    memset (reader, 0, sizeof(*reader));
+}
+
+int
+record_getColumns (struct record_Reader *reader, size_t chunk,
+                   struct record_Columns *columns)
+{
+    const struct record_ChunkInfo *info = &reader->index[chunk];
+    if (!validChunkInfo (reader, info))
+        {
+            return -1;
+        }
+
+    const uint8_t *p = reader->base + info->offset
+            + sizeof(struct record_ChunkHeader);
+    columns->count = info->count;
+    columns->t = (const int64_t*) p;
+    p += info->count * sizeof(int64_t);
+    columns->x = (const int16_t*) p;
+    p += info->count * sizeof(int16_t);
+    columns->y = (const int16_t*) p;
+    p += info->count * sizeof(int16_t);
+    columns->z = (const int16_t*) p;
+    p += info->count * sizeof(int16_t);
+    columns->flags = p;
+    reader->chunksTouched++;
+    return 0;
+}
+
+uint64_t
+record_query (struct record_Reader *reader, int64_t t0Us, int64_t t1Us,
+              record_QueryCb cb, void *ctx)
+{
+    struct record_Columns columns;
+    struct devstream_Sample sample;
+    uint64_t found = 0;
+
+    for (size_t c = firstChunkEndingAfter (reader, t0Us);
+            c < reader->numOfChunks && reader->index[c].t0Us <= t1Us; c++)
+        {
+            if (record_getColumns (reader, c, &columns))
+                {
+                    break;
+                }
+            for (uint32_t i = 0; i < columns.count; i++)
+                {
+                    if (columns.t[i] < t0Us || columns.t[i] > t1Us)
+                        {
+                            continue;
+                        }
+                    sample.timeUs = columns.t[i];
+                    sample.x = columns.x[i];
+                    sample.y = columns.y[i];
+                    sample.z = columns.z[i];
+                    sample.flags = columns.flags[i];
+                    found++;
+                    if (cb)
+                        {
+                            cb (&sample, ctx);
+                        }
+                }
+        }
+    return found;
+}
+
+int
+record_findMaxMagnitude (struct record_Reader *reader, int64_t t0Us,
+                         int64_t t1Us, struct devstream_Sample *result)
+{
+    struct record_Columns columns;
+    int64_t best = -1;
+
+    for (size_t c = firstChunkEndingAfter (reader, t0Us);
+            c < reader->numOfChunks && reader->index[c].t0Us <= t1Us; c++)
+        {
+            const struct record_ChunkInfo *info = &reader->index[c];
+            int64_t bound = 0;
+
+            /* upper bound of magnitude in chunk from per axis extremes */
+            for (int a = 0; a < RECORD_AXES; a++)
+                {
+                    int64_t m = maxAbs (info->min[a], info->max[a]);
+                    bound += m * m;
+                }
+            if (bound <= best)
+                {
+                    continue;
+                }
+
+            if (record_getColumns (reader, c, &columns))
+                {
+                    break;
+                }
+            for (uint32_t i = 0; i < columns.count; i++)
+                {
+                    int64_t m = magnitudeSquared (columns.x[i], columns.y[i],
+                                                  columns.z[i]);
+                    if (columns.t[i] >= t0Us && columns.t[i] <= t1Us
+                            && m > best)
+                        {
+                            best = m;
+                            result->timeUs = columns.t[i];
+                            result->x = columns.x[i];
+                            result->y = columns.y[i];
+                            result->z = columns.z[i];
+                            result->flags = columns.flags[i];
+                        }
+                }
+        }
+    return best >= 0;
+}
+
+uint64_t
+record_getAxisStats (struct record_Reader *reader, int64_t t0Us,
+                     int64_t t1Us, int16_t min[RECORD_AXES],
+                     int16_t max[RECORD_AXES], double mean[RECORD_AXES])
+{
+    struct record_Columns columns;
+    int64_t sum[RECORD_AXES] =
+        { 0 };
+    uint64_t count = 0;
+
+    for (int a = 0; a < RECORD_AXES; a++)
+        {
+            min[a] = INT16_MAX;
+            max[a] = INT16_MIN;
+        }
+
+    for (size_t c = firstChunkEndingAfter (reader, t0Us);
+            c < reader->numOfChunks && reader->index[c].t0Us <= t1Us; c++)
+        {
+            const struct record_ChunkInfo *info = &reader->index[c];
+
+            if (info->t0Us >= t0Us && info->t1Us <= t1Us)
+                {
+                    /* whole chunk inside range, header is enough */
+                    for (int a = 0; a < RECORD_AXES; a++)
+                        {
+                            if (info->min[a] < min[a])
+                                {
+                                    min[a] = info->min[a];
+                                }
+                            if (info->max[a] > max[a])
+                                {
+                                    max[a] = info->max[a];
+                                }
+                            sum[a] += info->sum[a];
+                        }
+                    count += info->count;
+                    continue;
+                }
+
+            if (record_getColumns (reader, c, &columns))
+                {
+                    break;
+                }
+            for (uint32_t i = 0; i < columns.count; i++)
+                {
+                    if (columns.t[i] < t0Us || columns.t[i] > t1Us)
+                        {
+                            continue;
+                        }
+                    const int16_t axes[RECORD_AXES] =
+                        { columns.x[i], columns.y[i], columns.z[i] };
+                    for (int a = 0; a < RECORD_AXES; a++)
+                        {
+                            if (axes[a] < min[a])
+                                {
+                                    min[a] = axes[a];
+                                }
+                            if (axes[a] > max[a])
+                                {
+                                    max[a] = axes[a];
+                                }
+                            sum[a] += axes[a];
+                        }
+                    count++;
+                }
+        }
+
+    for (int a = 0; a < RECORD_AXES; a++)
+        {
+            mean[a] = count ? (double) sum[a] / count : 0.0;
+        }
+    return count;
+}
@@ -0,0 +1,80 @@
+/*
+ * serial.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "serial.h"
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* === private functions === */
+static speed_t
+toSpeed (uint32_t baud)
+{
+    switch (baud)
+        {
+        case 9600:
+            return B9600;
+        case 19200:
+            return B19200;
+        case 38400:
+            return B38400;
+        case 57600:
+            return B57600;
+        case 115200:
+            return B115200;
+        case 230400:
+            return B230400;
+        case 460800:
+        default:
+            return B460800;
+        }
+}
+
+/* === exported functions === */
+int
+serial_open (const char *path, uint32_t baud, int nonBlocking)
+{
+    struct termios tio;
+    int fd = open (path, O_RDWR | O_NOCTTY | (nonBlocking ? O_NONBLOCK : 0));
+    if (fd < 0)
+        {
+            return -1;
+        }
+
+    /* pseudo terminals of device emulator accept the same settings */
+    if (0 == tcgetattr (fd, &tio))
+        {
+            cfmakeraw (&tio);
+            cfsetispeed (&tio, toSpeed (baud));
+            cfsetospeed (&tio, toSpeed (baud));
+            tio.c_cflag |= CLOCAL | CREAD;
+            tio.c_cc[VMIN] = 1;
+            tio.c_cc[VTIME] = 0;
+            if (tcsetattr (fd, TCSANOW, &tio))
+                {
+                    close (fd);
+                    return -1;
+                }
+        }
+    return fd;
+}
+
+int64_t
+serial_getTimeUs (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_REALTIME, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t
+serial_getMonotonicUs (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
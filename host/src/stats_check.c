@@ -0,0 +1,137 @@
+/*
+ * stats_check.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Checks firmware stats module against two pass long double reference for windows with large
+ *      static offset, full scale swings and random noise. Every summary value must match the
+ *      reference rounded to nearest. Variance from single precision sum of squares, as computed
+ *      on PC from the stream so far, is printed for comparison.
+ *
+ *          stats_check [seed]
+ */
+#include "stats.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* === private defines === */
+#define NUM_OF_ELEMENTS(a)              (sizeof(a) / sizeof(a[0]))
+#define MAX_WINDOW                      96000                                   /// 60 s at 1600 Hz
+
+/* === private types === */
+struct Case
+{
+    const char *name;
+    uint32_t len;                                                               /// samples in window
+    int offset;                                                                 /// static acceleration in mili g
+    int noise;                                                                  /// uniform noise amplitude
+    int square;                                                                 /// square wave amplitude, period 16 samples
+};
+
+/* === private variables === */
+static const struct Case cases[] =
+    {
+        { "1 g, low noise, 1 s", 1600, 1000, 3, 0 },
+        { "1 g, low noise, 60 s", MAX_WINDOW, 1000, 3, 0 },
+        { "15.9 g, no noise", 800, 15900, 0, 0 },
+        { "full scale square", 1600, 0, 0, 16000 },
+        { "negative offset, noise", 400, -8000, 200, 0 },
+        { "single sample", 1, -1234, 0, 0 },
+        { "random full scale", 25000, 0, 16000, 0 } };
+
+static int16_t samples[STATS_AXES][MAX_WINDOW];
+
+/* === private functions === */
+static int
+randomRange (int amplitude)
+{
+    return amplitude == 0 ? 0 : rand () % (2 * amplitude + 1) - amplitude;
+}
+
+static int
+checkValue (const char *label, long double value, long double reference)
+{
+    if (fabsl (value - reference) > 0.5L + 1e-9L)
+        {
+            printf ("    %s %.3Lf, reference %.3Lf\n", label, value, reference);
+            return 1;
+        }
+    return 0;
+}
+
+static int
+runCase (const struct Case *c)
+{
+    struct stats_Window window;
+    int failures = 0;
+
+    stats_reset (&window);
+    for (uint32_t i = 0; i < c->len; i++)
+        {
+            for (uint8_t a = 0; a < STATS_AXES; a++)
+                {
+                    int v = c->offset * (a == 2 ? 1 : -1) + randomRange (c->noise)
+                            + ((i / 8) % 2 ? c->square : -c->square);
+                    v = v > 16000 ? 16000 : (v < -16000 ? -16000 : v);
+                    samples[a][i] = v;
+                }
+            stats_add (&window, samples[0][i], samples[1][i], samples[2][i]);
+        }
+
+    float worstFloatError = 0;
+    for (uint8_t a = 0; a < STATS_AXES; a++)
+        {
+            struct stats_Summary s;
+            long double sum = 0, sq = 0;
+            float fSum = 0, fSq = 0;
+            int min = INT16_MAX, max = INT16_MIN;
+
+            stats_getSummary (&window, a, &s);
+            for (uint32_t i = 0; i < c->len; i++)
+                {
+                    sum += samples[a][i];
+                    fSum += samples[a][i];
+                    fSq += (float) samples[a][i] * samples[a][i];
+                    min = samples[a][i] < min ? samples[a][i] : min;
+                    max = samples[a][i] > max ? samples[a][i] : max;
+                }
+            long double mean = sum / c->len;
+            for (uint32_t i = 0; i < c->len; i++)
+                {
+                    sq += (samples[a][i] - mean) * (samples[a][i] - mean);
+                }
+            long double variance = sq / c->len;
+            long double rms = sqrtl (variance + mean * mean);
+            float fMean = fSum / c->len;
+            float fVariance = fSq / c->len - fMean * fMean;
+            float floatError = fabsf (fVariance - (float) variance);
+            worstFloatError =
+                    floatError > worstFloatError ? floatError : worstFloatError;
+
+            failures += checkValue ("mean", s.mean, mean);
+            failures += checkValue ("variance", s.variance, variance);
+            failures += checkValue ("rms", s.rms, rms);
+            failures += s.min != min || s.max != max;
+            failures += s.peak != (-min > max ? -min : max);
+            failures += s.peakToPeak != max - min;
+        }
+    printf ("%-24s %6u samples, float variance error %10.3f%s\n", c->name,
+            c->len, worstFloatError, failures ? "  FAILED" : "");
+    return failures != 0;
+}
+
+int
+main (int argc, char **argv)
+{
+    int failures = 0;
+
+    srand (argc > 1 ? strtoul (argv[1], NULL, 0) : 1);
+    for (size_t i = 0; i < NUM_OF_ELEMENTS(cases); i++)
+        {
+            failures += runCase (&cases[i]);
+        }
+    printf ("%d of %zu cases failed\n", failures, NUM_OF_ELEMENTS(cases));
+    return failures != 0;
+}
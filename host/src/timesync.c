@@ -0,0 +1,188 @@
+/*
+ * timesync.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "timesync.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* === private defines === */
+#define BITS_PER_CHAR                   10                                      /// 8N1
+#define US_PER_S                        1000000
+#define USED_SHARE_DIVISOR              4                                       /// exchanges with round trip in lowest quarter are fitted
+
+/* === private functions === */
+static int64_t
+delayOf (const struct timesync_Exchange *x)
+{
+    return (x->t4 - x->t1) - (x->t3 - x->t2);
+}
+
+/* Twice the offset, kept integer so host wall clock time loses no precision */
+static int64_t
+doubleOffsetOf (const struct timesync_Exchange *x)
+{
+    return (x->t1 - x->t2) + (x->t4 - x->t3);
+}
+
+static int
+compareInt64 (const void *a, const void *b)
+{
+    int64_t l = *(const int64_t*) a, r = *(const int64_t*) b;
+    return (l > r) - (l < r);
+}
+
+/* === exported functions === */
+void
+timesync_init (struct timesync_State *state, uint32_t baud)
+{
+    memset (state, 0, sizeof(*state));
+    state->charUs = baud == 0 ? 0 : (double) BITS_PER_CHAR * US_PER_S / baud;
+}
+
+size_t
+timesync_formatRequest (char *buf, int64_t t1)
+{
+    return (size_t) snprintf (buf, TIMESYNC_REQUEST_MAX_LEN, "%csync %" PRId64 "\r",
+                              TIMESYNC_MARK, t1);
+}
+
+int
+timesync_parseReply (const char *line, struct timesync_Exchange *exchange)
+{
+    int64_t t1;
+    unsigned long seconds, micros, turnaround;
+    int end = 0;
+
+    if (4 != sscanf (line, "sync %" SCNd64 " %lu.%6lu %lu%n", &t1, &seconds,
+                     &micros, &turnaround, &end) || line[end] != '\0')
+        {
+            return 0;
+        }
+    exchange->t1 = t1;
+    exchange->t2 = (int64_t) seconds * US_PER_S + (int64_t) micros;
+    exchange->t3 = exchange->t2 + (int64_t) turnaround;
+    return 1;
+}
+
+int
+timesync_onReply (struct timesync_State *state, const char *line, int64_t t4)
+{
+    struct timesync_Exchange x;
+    char request[TIMESYNC_REQUEST_MAX_LEN];
+
+    if (!timesync_parseReply (line, &x))
+        {
+            return 0;
+        }
+    /* device takes t2 one idle character after the request, t3 at the first reply byte and host
+     * sees line end after the line and '\n' */
+    size_t requestLen = timesync_formatRequest (request, x.t1);
+    x.t1 += llround (state->charUs * (requestLen + 1));
+    x.t4 = t4 - llround (state->charUs * (strlen (line) + 1));
+    timesync_add (state, &x);
+    return 1;
+}
+
+void
+timesync_add (struct timesync_State *state,
+              const struct timesync_Exchange *exchange)
+{
+    state->window[state->head] = *exchange;
+    state->head = (state->head + 1) % TIMESYNC_WINDOW_LEN;
+    if (state->count < TIMESYNC_WINDOW_LEN)
+        {
+            state->count++;
+        }
+    state->exchanges++;
+}
+
+int
+timesync_getEstimate (const struct timesync_State *state,
+                      struct timesync_Estimate *estimate)
+{
+    int64_t delays[TIMESYNC_WINDOW_LEN];
+    const struct timesync_Exchange *base = NULL;
+
+    if (state->count == 0)
+        {
+            return -1;
+        }
+    for (uint32_t i = 0; i < state->count; i++)
+        {
+            delays[i] = delayOf (&state->window[i]);
+            if (base == NULL || delays[i] < delayOf (base))
+                {
+                    base = &state->window[i];
+                }
+        }
+    qsort (delays, state->count, sizeof(delays[0]), compareInt64);
+    int64_t limit = delays[(state->count - 1) / USED_SHARE_DIVISOR];
+
+    /* reference point is the mean device time of used exchanges */
+    double sumX = 0;
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < state->count; i++)
+        {
+            const struct timesync_Exchange *x = &state->window[i];
+            if (delayOf (x) <= limit)
+                {
+                    sumX += (x->t2 + x->t3) / 2.0 - base->t2;
+                    used++;
+                }
+        }
+    int64_t ref = base->t2 + llround (sumX / used);
+
+    /* offsets relative to best exchange, fitted against device time */
+    double sumDx = 0, sumY = 0, sumXY = 0, sumXX = 0;
+    for (uint32_t i = 0; i < state->count; i++)
+        {
+            const struct timesync_Exchange *x = &state->window[i];
+            if (delayOf (x) <= limit)
+                {
+                    double dx = (x->t2 + x->t3) / 2.0 - ref;
+                    double y = (doubleOffsetOf (x) - doubleOffsetOf (base)) / 2.0;
+                    sumDx += dx;
+                    sumY += y;
+                    sumXY += dx * y;
+                    sumXX += dx * dx;
+                }
+        }
+    double meanX = sumDx / used, meanY = sumY / used;
+    double sxx = sumXX - used * meanX * meanX;
+    double slope = sxx > 0 ? (sumXY - used * meanX * meanY) / sxx : 0;
+    double intercept = meanY - slope * meanX;
+    double sumSq = 0;
+    for (uint32_t i = 0; i < state->count; i++)
+        {
+            const struct timesync_Exchange *x = &state->window[i];
+            if (delayOf (x) <= limit)
+                {
+                    double dx = (x->t2 + x->t3) / 2.0 - ref;
+                    double y = (doubleOffsetOf (x) - doubleOffsetOf (base)) / 2.0;
+                    double r = y - intercept - slope * dx;
+                    sumSq += r * r;
+                }
+        }
+
+    estimate->refDeviceUs = ref;
+    estimate->offsetUs = doubleOffsetOf (base) / 2.0 + intercept;
+    estimate->driftPpm = slope * US_PER_S;
+    estimate->residualUs = sqrt (sumSq / used);
+    estimate->minDelayUs = (double) delays[0];
+    estimate->used = used;
+    return 0;
+}
+
+int64_t
+timesync_toHostUs (const struct timesync_Estimate *estimate, int64_t deviceUs)
+{
+    double dx = (double) (deviceUs - estimate->refDeviceUs);
+    return deviceUs
+            + llround (estimate->offsetUs + estimate->driftPpm / US_PER_S * dx);
+}
@@ -42,7 +42,7 @@
  *----------------------------------------------------------*/
 
 /* Ensure stdint is only used by the compiler, and not the assembler. */
-#ifdef __ICCARM__
+#if defined(__ICCARM__) || defined(__GNUC__)
 	#include <stdint.h>
 	extern uint32_t SystemCoreClock;
 #endif
@@ -50,7 +50,7 @@
 #define configUSE_PREEMPTION			1
 #define configUSE_IDLE_HOOK				0
 #define configUSE_TICK_HOOK				0
-#define configCPU_CLOCK_HZ				( 8000000 )
+#define configCPU_CLOCK_HZ				( SystemCoreClock )	/* changed at runtime by clock governor */
 #define configTICK_RATE_HZ				( ( TickType_t ) 1000 )
 #define configMAX_PRIORITIES			( 4 )
 #define configMINIMAL_STACK_SIZE		( ( unsigned short ) 130 )
@@ -59,7 +59,7 @@
 #define configUSE_TRACE_FACILITY		1
 #define configUSE_16_BIT_TICKS			0
 #define configIDLE_SHOULD_YIELD			1
-#define configUSE_MUTEXES				0
+#define configUSE_MUTEXES				1
 #define configQUEUE_REGISTRY_SIZE		8
 #define configCHECK_FOR_STACK_OVERFLOW	0
 #define configUSE_RECURSIVE_MUTEXES		0
@@ -68,6 +68,9 @@
 #define configUSE_COUNTING_SEMAPHORES	1
 #define configGENERATE_RUN_TIME_STATS	0
 #define configUSE_TASK_NOTIFICATIONS	1
+#define configUSE_QUEUE_SETS			1
+#define configUSE_TICKLESS_IDLE			2
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP	2
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 		0
@@ -124,5 +127,14 @@ standard names. */
 #define xPortPendSVHandler PendSV_Handler
 #define xPortSysTickHandler SysTick_Handler
 
+/* Tickless idle is implemented by power module, tick is compensated from RTC. */
+extern void power_suppressTicksAndSleep( uint32_t expectedIdleTime );
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) power_suppressTicksAndSleep( xExpectedIdleTime )
+
+/* Scheduler and queue events are recorded by trace module, see tracehooks.h. */
+#if defined(__ICCARM__) || defined(__GNUC__)
+	#include "tracehooks.h"
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
 
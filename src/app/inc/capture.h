@@ -0,0 +1,160 @@
+/*
+ * capture.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Triggered capture of accelerometer waveform. Samples of one sensor are kept in a ring buffer at
+ *      full rate. On trigger, CAPTURE_POST_SAMPLES more samples are collected and up to
+ *      CAPTURE_PRE_SAMPLES samples from before the trigger are frozen together with them. Frozen
+ *      capture is read out as a binary frame, afterwards capture is armed again.
+ *
+ *      Frame layout (little endian):
+ *          struct capture_FrameHeader
+ *          samples[pre + post] of int16 x, y, z in mili g
+ *          uint16 Fletcher-16 checksum of header and samples
+ *
+ *      Does not depend on RTOS or HAL, so host tools use it to decode frames.
+ */
+#ifndef APP_INC_CAPTURE_H_
+#define APP_INC_CAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* === exported defines === */
+#define CAPTURE_PRE_SAMPLES             64
+#define CAPTURE_POST_SAMPLES            64
+#define CAPTURE_SYNC                    0x5AA5                                  /// sent as A5 5A, text output is 7 bit
+#define CAPTURE_VERSION                 1
+#define CAPTURE_SAMPLE_SIZE             6
+#define CAPTURE_CHECKSUM_SIZE           2
+#define CAPTURE_HEADER_SIZE             20
+#define CAPTURE_MAX_FRAME_SIZE          (CAPTURE_HEADER_SIZE \
+                                        + (CAPTURE_PRE_SAMPLES + CAPTURE_POST_SAMPLES) * CAPTURE_SAMPLE_SIZE \
+                                        + CAPTURE_CHECKSUM_SIZE)
+
+/* === exported types === */
+/** trigger source */
+enum capture_Trigger
+{
+    CAPTURE_TRIGGER_CLICK,                                                      /// click detected by sensor
+    CAPTURE_TRIGGER_THRESHOLD,                                                  /// any axis reached threshold
+    CAPTURE_TRIGGER_COUNT
+};
+
+/** frame header, CAPTURE_HEADER_SIZE bytes on the wire */
+struct capture_FrameHeader
+{
+    uint16_t sync;                                                              /// CAPTURE_SYNC
+    uint8_t version;                                                            /// CAPTURE_VERSION
+    uint8_t trigger;                                                            /// enum capture_Trigger
+    uint8_t sensorIdx;
+    uint8_t reserved;
+    uint16_t preSamples;                                                        /// samples before trigger
+    uint16_t postSamples;                                                       /// samples from trigger on
+    uint16_t thresholdMg;                                                       /// threshold trigger level
+    uint32_t rateMilliHz;                                                       /// sample rate
+    uint32_t sequence;                                                          /// frame number since boot
+};
+
+/** capture counters */
+struct capture_Stats
+{
+    uint32_t frames;                                                            /// frames frozen
+    uint32_t missedTriggers;                                                    /// triggers during post trigger collection or readout
+};
+
+/* === exported functions === */
+/**
+ * @brief Enable capture of one sensor. Triggers are accepted after @ref capture_arm().
+ * @param sensorIdx captured sensor instance
+ * @param trigger trigger source
+ * @param thresholdMg absolute value of any axis which triggers capture, used with CAPTURE_TRIGGER_THRESHOLD
+ */
+void
+capture_enable (uint8_t sensorIdx, enum capture_Trigger trigger,
+                uint16_t thresholdMg);
+
+/**
+ * @brief Disable capture, samples are no longer stored.
+ */
+void
+capture_disable (void);
+
+/**
+ * @brief Check if capture is enabled.
+ * @retval true if enabled
+ */
+bool
+capture_isEnabled (void);
+
+/**
+ * @brief Get capture setup.
+ * @param sensorIdx captured sensor instance
+ * @param trigger trigger source
+ * @param thresholdMg threshold trigger level
+ */
+void
+capture_getSetup (uint8_t *sensorIdx, enum capture_Trigger *trigger,
+                  uint16_t *thresholdMg);
+
+/**
+ * @brief Empty ring buffer and start accepting triggers.
+ * @param rateMilliHz sample rate of captured sensor, reported in frame header
+ */
+void
+capture_arm (uint32_t rateMilliHz);
+
+/**
+ * @brief Store sample. Samples of other sensors are ignored.
+ * @param sensorIdx sensor instance which produced sample
+ * @param x, y, z acceleration in mili g
+ * @retval true if capture is complete and frame can be read with @ref capture_readFrame()
+ */
+bool
+capture_addSample (uint8_t sensorIdx, int16_t x, int16_t y, int16_t z);
+
+/**
+ * @brief Trigger capture on click detection. Ignored if trigger source is not CAPTURE_TRIGGER_CLICK.
+ * @param sensorIdx sensor instance which detected click
+ */
+void
+capture_onClick (uint8_t sensorIdx);
+
+/**
+ * @brief Read next part of frozen capture frame. When the whole frame is read, capture is armed again.
+ * @param dst output buffer
+ * @param len size of output buffer
+ * @retval number of bytes written, 0 when there is nothing to read
+ */
+uint16_t
+capture_readFrame (uint8_t *dst, uint16_t len);
+
+/**
+ * @brief Get capture counters.
+ * @retval counters since boot
+ */
+const struct capture_Stats*
+capture_getStats (void);
+
+/**
+ * @brief Decode frame header.
+ * @param src CAPTURE_HEADER_SIZE bytes of frame
+ * @param header decoded header
+ * @retval false if sync or version does not match
+ */
+bool
+capture_decodeHeader (const uint8_t *src, struct capture_FrameHeader *header);
+
+/**
+ * @brief Fletcher-16 checksum update.
+ * @param sum running checksum, 0 at frame start
+ * @param data bytes
+ * @param len number of bytes
+ * @retval updated checksum
+ */
+uint16_t
+capture_checksum (uint16_t sum, const uint8_t *data, uint32_t len);
+
+#endif /* APP_INC_CAPTURE_H_ */
@@ -18,15 +18,39 @@
 #include "stm32f3xx_hal.h"
 #include "FreeRTOS.h"
 #include "queue.h"
+#include <stdbool.h>
 
 /* === exported defines === */
 #define CLI_MAX_LINE_LEN	50
 #define CLI_ENTER    		13
+#define CLI_BIN_ITEM_MARK   0x01                                                /// first byte of TX queue item carrying binary data
+#define CLI_BIN_MAX_LEN     (CLI_MAX_LINE_LEN - 2)                              /// binary item: mark, length, data
+#define CLI_EVENT_QUEUE_LEN 4                                                   /// event lines waiting for transmission
+#define CLI_SYNC_MARK       0x02                                                /// first byte of time sync request line, such line is not echoed
+#define CLI_SYNC_TOKEN_MAX_LEN 16                                               /// host time stamp of sync request, decimal digits
+
+/* === exported types === */
+/** event line, transmitted before any line waiting in TX queue */
+struct CLI_EventItem
+{
+    char line[CLI_MAX_LINE_LEN];                                                /// zero terminated text
+    uint32_t originCycles;                                                      /// cycle counter at event interrupt
+    bool measured;                                                              /// counts in latency statistics
+    uint8_t syncFieldPos;                                                       /// turnaround field of time sync reply, 0 for event lines
+    uint32_t syncRxUs;                                                          /// low word of device time at reception of sync request
+};
+
+/** time from event interrupt until its line is completely transmitted */
+struct CLI_LatencyStats
+{
+    uint32_t count;                                                             /// measured events
+    uint32_t lastUs, maxUs, avgUs;
+};
 
 /* === exported functions === */
 /**
  * @brief initialise CLI
- * @param txQueue queue in which data to be transmitted should be inserted
+ * @param txQueue empty queue in which data to be transmitted should be inserted
  * @param rxQueue queue where receiveed commands are stored
  * @param huart uart handle
  */
@@ -35,12 +59,47 @@ CLI_init (QueueHandle_t txQueue, QueueHandle_t rxQueue,
           UART_HandleTypeDef *huart);
 
 /**
- * @brief CLI task
+ * @brief Send event line. It goes out as soon as line currently transmitted ends, ahead of TX queue.
+ * @param line zero terminated text, up to CLI_MAX_LINE_LEN - 1 characters
+ * @param originCycles cycle counter at event interrupt
+ * @param measured true if event latency should be counted in statistics
+ */
+void
+CLI_sendEvent (const char *line, uint32_t originCycles, bool measured);
+
+/**
+ * @brief Get statistics of event latency, from interrupt until end of transmission of event line.
+ * @param stats statistics since last reset
+ */
+void
+CLI_getEventLatency (struct CLI_LatencyStats *stats);
+
+/**
+ * @brief Reset statistics of event latency.
+ */
+void
+CLI_resetEventLatency (void);
+
+/**
+ * @brief CLI task, transmits event lines and content of TX queue, event lines first. Items are zero terminated strings, except items starting
+ *        with CLI_BIN_ITEM_MARK, which carry number of data bytes in the second byte and up to
+ *        CLI_BIN_MAX_LEN bytes of binary data.
  * @param params unused
  */
 void
 CLI_task (void *params);
 
+/**
+ * @brief CLI receive task, assembles lines from received bytes, echoes them over TX queue
+ *        and puts complete lines into RX queue. Time sync request "<CLI_SYNC_MARK>sync <host time>"
+ *        is answered here in any system state with event line "sync <host time> <rx s>.<rx us> <turnaround us>",
+ *        where rx is device time (@ref timebase_getUs()) at idle line after the request and turnaround
+ *        runs until transmission of the reply starts.
+ * @param params unused
+ */
+void
+CLI_rxTask (void *params);
+
 #ifndef APP_INC_UART_CLI_C_
 #define APP_INC_UART_CLI_C_
 
@@ -0,0 +1,79 @@
+/*
+ * clock.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      System clock levels and governor. SYSCLK runs from 8 MHz HSE directly or through PLL.
+ *      On level change I2C timing, USART baud rate and FreeRTOS tick period are recalculated.
+ */
+#ifndef APP_INC_CLOCK_H_
+#define APP_INC_CLOCK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32f3xx_hal.h"
+
+/* === exported types === */
+enum clock_Level
+{
+    CLOCK_LEVEL_8MHZ,                                                           /// HSE, PLL off
+    CLOCK_LEVEL_24MHZ,                                                          /// HSE x3
+    CLOCK_LEVEL_48MHZ,                                                          /// HSE x6
+    CLOCK_LEVEL_72MHZ,                                                          /// HSE x9
+    CLOCK_LEVEL_COUNT
+};
+
+/* === exported functions === */
+/**
+ * @brief Init clock module, SYSCLK must already run from HSE (@ref CLK_init()).
+ * @param huart CLI UART, its baud rate is recalculated on level change
+ */
+void
+clock_init (UART_HandleTypeDef *huart);
+
+/**
+ * @brief Change SYSCLK. Waits until UART transmission ends, then switches with scheduler suspended,
+ *        so no I2C transfer is ongoing. Must be called from task.
+ * @param level new clock level
+ */
+void
+clock_setLevel (enum clock_Level level);
+
+/**
+ * @brief Get current clock level.
+ * @retval clock level
+ */
+enum clock_Level
+clock_getLevel (void);
+
+/**
+ * @brief Get SYSCLK frequency of clock level.
+ * @param level clock level
+ * @retval frequency in Hz
+ */
+uint32_t
+clock_getLevelHz (enum clock_Level level);
+
+/**
+ * @brief Find lowest clock level which keeps CPU load below governor limit.
+ * @param cyclesPerSecond expected CPU cycles needed per second
+ * @retval clock level
+ */
+enum clock_Level
+clock_levelForLoad (uint32_t cyclesPerSecond);
+
+/**
+ * @brief Get number of level changes since boot.
+ * @retval number of changes
+ */
+uint32_t
+clock_getNumOfSwitches (void);
+
+/**
+ * @brief Restart HSE and PLL of current level after wake up from STOP mode. Called with interrupts disabled.
+ */
+void
+clock_restoreAfterStop (void);
+
+#endif /* APP_INC_CLOCK_H_ */
@@ -0,0 +1,133 @@
+/*
+ * filter.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Fixed point filter chain applied to every axis of accelerometer samples. Up to FILTER_MAX_STAGES
+ *      stages, each a moving average, exponential moving average or second order Butterworth low or
+ *      high pass biquad. Signal between stages is in mili g with FILTER_FRAC_BITS fractional bits,
+ *      EMA gain is Q15 and biquad coefficients are Q30 (|a1| reaches 2, so Q31 can not hold them).
+ *
+ *      Stages can be changed while samples flow:
+ *      - moving average length change adds or removes only samples between old and new window start,
+ *        history of FILTER_MA_MAX_LEN samples is always kept,
+ *      - EMA gain change keeps filter output,
+ *      - biquads run in direct form I, whose state is past input and output and stays valid for any
+ *        coefficients, so cutoff change does not cause a jump,
+ *      - a newly enabled stage starts in steady state for its current input, so it does not step.
+ *      Does not depend on RTOS or HAL, so it is built on host as well.
+ */
+#ifndef APP_INC_FILTER_H_
+#define APP_INC_FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* === exported defines === */
+#define FILTER_MAX_STAGES               3
+#define FILTER_AXES                     3
+#define FILTER_MA_MAX_LEN               500                                     /// only one moving average stage per chain
+#define FILTER_FRAC_BITS                8
+#define FILTER_COEF_FRAC_BITS           30
+#define FILTER_EMA_FRAC_BITS            15
+
+/* === exported types === */
+enum filter_Type
+{
+    FILTER_NONE,                                                                /// stage passes input through
+    FILTER_MOVING_AVG,                                                          /// param: number of samples
+    FILTER_EMA,                                                                 /// param: equivalent moving average length, gain 2 / (param + 1)
+    FILTER_LOW_PASS,                                                            /// param: cutoff in Hz
+    FILTER_HIGH_PASS,                                                           /// param: cutoff in Hz
+    FILTER_TYPE_COUNT
+};
+
+/** stage setup */
+struct filter_StageConfig
+{
+    enum filter_Type type;
+    uint16_t param;
+};
+
+/** coefficients of stage, derived from setup */
+struct filter_Stage
+{
+    struct filter_StageConfig config;
+    int32_t b0, b1, b2, a1, a2;                                                 /// biquad, Q30, a0 is 1
+    int32_t gain;                                                               /// EMA, Q15
+};
+
+/** state of single axis */
+struct filter_Axis
+{
+    int16_t maRing[FILTER_MA_MAX_LEN];                                          /// moving average input history in mili g
+    uint16_t maHead;                                                            /// next ring index to write
+    uint16_t maFilled;                                                          /// samples in ring
+    int32_t maSum;                                                              /// sum of samples in moving average window
+    int32_t in[FILTER_MAX_STAGES];                                              /// last input of every stage
+    int32_t x2[FILTER_MAX_STAGES];                                              /// input before last, biquad
+    int32_t y1[FILTER_MAX_STAGES], y2[FILTER_MAX_STAGES];                       /// last two outputs, biquad and EMA
+    int32_t err[FILTER_MAX_STAGES];                                             /// biquad rounding error fed back into next output
+};
+
+/** filter chain of one sensor */
+struct filter_Chain
+{
+    struct filter_Stage stages[FILTER_MAX_STAGES];
+    uint32_t rateMilliHz;                                                       /// sample rate biquads are designed for
+    struct filter_Axis axes[FILTER_AXES];
+};
+
+/* === exported functions === */
+/**
+ * @brief Init chain with all stages off.
+ * @param chain filter chain
+ * @param rateMilliHz sample rate
+ */
+void
+filter_init (struct filter_Chain *chain, uint32_t rateMilliHz);
+
+/**
+ * @brief Set up stage. Takes effect with next sample, without transient for parameter change of the
+ *        same stage type.
+ * @param chain filter chain
+ * @param stage stage index
+ * @param config stage setup
+ * @retval false if setup is invalid (length out of range, second moving average, cutoff not below
+ *         45 % of sample rate), chain is not changed then
+ */
+bool
+filter_setStage (struct filter_Chain *chain, uint8_t stage,
+                 const struct filter_StageConfig *config);
+
+/**
+ * @brief Check stage setup against chain without changing it, e.g. before handing it over to the
+ *        task which owns the chain.
+ * @param chain filter chain
+ * @param stage stage index
+ * @param config stage setup
+ * @retval false if @ref filter_setStage() would refuse the setup
+ */
+bool
+filter_checkStage (const struct filter_Chain *chain, uint8_t stage,
+                   const struct filter_StageConfig *config);
+
+/**
+ * @brief Change sample rate, biquad coefficients are designed again.
+ * @param chain filter chain
+ * @param rateMilliHz sample rate
+ * @retval false if a cutoff is not below 45 % of the new rate, such stage is turned off
+ */
+bool
+filter_setRate (struct filter_Chain *chain, uint32_t rateMilliHz);
+
+/**
+ * @brief Filter one sample of all axes.
+ * @param chain filter chain
+ * @param xyz sample in mili g, replaced with filter output rounded to mili g
+ */
+void
+filter_process (struct filter_Chain *chain, int16_t xyz[FILTER_AXES]);
+
+#endif /* APP_INC_FILTER_H_ */
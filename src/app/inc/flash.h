@@ -0,0 +1,30 @@
+/*
+ * flash.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Internal flash access for profile store. Last FLASH_PROFILE_PAGES pages of flash are
+ *      reserved for it and must be excluded from FLASH region in linker script.
+ *      Erase and program stall code execution from flash, so they are used only on user request.
+ */
+#ifndef APP_INC_FLASH_H_
+#define APP_INC_FLASH_H_
+
+#include "stm32f3xx_hal.h"
+#include "profile.h"
+
+/* === exported defines === */
+#define FLASH_SIZE_BYTES                (64 * 1024)                             /// STM32F302R8
+#define FLASH_PROFILE_PAGES             2
+#define FLASH_PROFILE_ADDR              (FLASH_BASE + FLASH_SIZE_BYTES - FLASH_PROFILE_PAGES * FLASH_PAGE_SIZE)
+
+/* === exported functions === */
+/**
+ * @brief Get flash area of profile store.
+ * @retval flash area description for @ref profile_init()
+ */
+const struct profile_Flash*
+flash_getProfileArea (void);
+
+#endif /* APP_INC_FLASH_H_ */
@@ -0,0 +1,81 @@
+/*
+ * fmt.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Allocation free formatting of CLI output. Every function writes into caller buffer without
+ *      terminating zero and returns pointer past the last written character, so calls can be chained
+ *      to build a whole line in place. Output matches printf conversions named at each function.
+ */
+#ifndef APP_INC_FMT_H_
+#define APP_INC_FMT_H_
+
+#include <stdint.h>
+
+/* === exported defines === */
+#define FMT_UINT_MAX_LEN                10                                      /// digits of UINT32_MAX
+#define FMT_MILLI_G_MAX_LEN             (3 + 2 + 1 + 3 + 2)                     /// "  -32.768 g"
+#define FMT_HHMMSS_LEN                  8
+
+/* === exported functions === */
+/**
+ * @brief Copy string.
+ * @param dst output buffer
+ * @param str zero terminated string
+ * @retval end of output
+ */
+char*
+fmt_str (char *dst, const char *str);
+
+/**
+ * @brief Unsigned integer, as "%u".
+ * @param dst output buffer, at least FMT_UINT_MAX_LEN long
+ * @param value value
+ * @retval end of output
+ */
+char*
+fmt_uint (char *dst, uint32_t value);
+
+/**
+ * @brief Unsigned integer right aligned in field, as "%0*u" for '0' pad or "%*u" for ' ' pad.
+ *        Wider values are not truncated.
+ * @param dst output buffer
+ * @param value value
+ * @param width field width
+ * @param pad padding character
+ * @retval end of output
+ */
+char*
+fmt_uintWidth (char *dst, uint32_t value, uint8_t width, char pad);
+
+/**
+ * @brief Signed integer, as "%d".
+ * @param dst output buffer, at least FMT_UINT_MAX_LEN + 1 long
+ * @param value value
+ * @retval end of output
+ */
+char*
+fmt_int (char *dst, int32_t value);
+
+/**
+ * @brief Acceleration in g with sign column, as "   %d.%.3d g" or "  -%d.%.3d g" of absolute value.
+ * @param dst output buffer, at least FMT_MILLI_G_MAX_LEN long
+ * @param milliG acceleration in mili g
+ * @retval end of output
+ */
+char*
+fmt_milliG (char *dst, int32_t milliG);
+
+/**
+ * @brief Time of day, as "%02d:%02d:%02d".
+ * @param dst output buffer, at least FMT_HHMMSS_LEN long
+ * @param hours hours
+ * @param minutes minutes
+ * @param seconds seconds
+ * @retval end of output
+ */
+char*
+fmt_hhmmss (char *dst, uint8_t hours, uint8_t minutes, uint8_t seconds);
+
+#endif /* APP_INC_FMT_H_ */
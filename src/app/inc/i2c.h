@@ -5,18 +5,36 @@
  *      Author: Wiktor Lechowicz
  *      Description:
  *      This file contains functions for initialization and handling of I2C peripherial for stm32f3xx devices.
- *      Desired initialization values have been hardcoded in myI2C_Init function.
+ *      Bus timing is computed by i2ctiming module for selected speed and current SYSCLK.
  */
 #ifndef INC_MYI2C_H_
 #define INC_MYI2C_H_
 
 #include "main.h"
 #include "stm32f302x8.h"
+#include "i2ctiming.h"
 
 /** error codes for detecting transmission failure(NACK, arbitration lost or bus error) */
 enum I2C_Status
 {
-    I2C_FAILURE = 0x00, I2C_SUCCES = 0x01, I2C_BUSY = 0x02
+    I2C_FAILURE = 0x00,                                                         /// slave did not acknowledge
+    I2C_SUCCES = 0x01,
+    I2C_BUSY = 0x02,                                                            /// bus held by other master or arbitration lost
+    I2C_BUS_ERROR = 0x03,                                                       /// misplaced START or STOP detected
+    I2C_TIMEOUT = 0x04                                                          /// transfer not finished before deadline
+};
+
+/** transfer error counters */
+struct I2C_Stats
+{
+    uint32_t transfers,                                                         /// transfers requested
+            retries,                                                            /// transfers attempted again after error
+            recoveries,                                                         /// bus recoveries with SCL toggling
+            failures,                                                           /// transfers given up, including NACK
+            nacks,                                                              /// NACK received
+            busErrors,                                                          /// BERR detected
+            arbitrationLosses,                                                  /// ARLO detected
+            timeouts;                                                           /// deadline passed
 };
 
 #define myI2C_SUCCESS    0x01
@@ -28,7 +46,45 @@ void
 I2C_init ();
 
 /**
- * @brief write a byte stream to given memory location of a slave in blocking mode
+ * @brief Recalculate bus timing after SYSCLK change, SYSCLK is I2C kernel clock.
+ *        Must not be called during transfer.
+ */
+void
+I2C_updateTiming ();
+
+/**
+ * @brief Get transfer error counters.
+ * @retval counters since boot
+ */
+const struct I2C_Stats*
+I2C_getStats ();
+
+/**
+ * @brief Get SCL frequency resulting from current timing configuration.
+ * @retval bus frequency in Hz, synchronisation delays and signal edges included
+ */
+uint32_t
+I2C_getBusFrequency ();
+
+/**
+ * @brief Set bus speed, timing is computed for current SYSCLK. Must not be called during transfer.
+ * @param speed speed mode
+ * @retval false if speed can not be reached at current SYSCLK
+ */
+bool
+I2C_setSpeed (enum i2ctiming_Speed speed);
+
+/**
+ * @brief Get bus speed mode.
+ * @retval speed mode
+ */
+enum i2ctiming_Speed
+I2C_getSpeed ();
+
+/**
+ * @brief write a byte stream to given memory location of a slave in blocking mode.
+ *        Transfer is bounded by deadline. Arbitration loss, bus error and timeout are retried,
+ *        bus error and timeout after recovery of the bus. NACK is returned at once.
  * @param slaveAdrr -       slave address
  * @param memAddr   -       memory address
  * @param pData     -       pointer to data to send
@@ -41,6 +97,8 @@ I2C_writeByteStream (uint8_t slaveAddr, uint8_t memAddr, uint8_t *pData,
 
 /**
  * @brief read byte stream from given slave memory location in polling mode.
+ *        Memory address is written and data read with repeated start, errors are handled
+ *        like in @ref I2C_writeByteStream().
  * @param slaveAddr -       slave address
  * @param memAddr   -       memory address
  * @param pData     -       address at which the received byte stream will be stored
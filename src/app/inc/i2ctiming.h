@@ -0,0 +1,71 @@
+/*
+ * i2ctiming.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      I2C TIMINGR calculator following timing formulas of STM32F3 reference manual (RM0365, I2C timings).
+ *      Does not access hardware, so it is built on host as well.
+ */
+#ifndef APP_INC_I2CTIMING_H_
+#define APP_INC_I2CTIMING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* === exported defines === */
+#define I2CTIMING_RISE_NS               100                                     // SCL/SDA rise time with external pull ups
+#define I2CTIMING_FALL_NS               10                                      // SCL/SDA fall time
+#define I2CTIMING_AF_MIN_NS             50                                      // analog filter delay range
+#define I2CTIMING_AF_MAX_NS             260
+
+/* === exported types === */
+enum i2ctiming_Speed
+{
+    I2CTIMING_SPEED_STANDARD,                                                   /// 100 kHz
+    I2CTIMING_SPEED_FAST,                                                       /// 400 kHz
+    I2CTIMING_SPEED_FAST_PLUS,                                                  /// 1 MHz
+    I2CTIMING_SPEED_COUNT
+};
+
+/** I2C bus specification limits of speed mode, in nanoseconds */
+struct i2ctiming_Spec
+{
+    uint32_t hz;                                                                /// nominal SCL frequency
+    uint32_t minHz;                                                             /// lowest accepted SCL frequency
+    uint32_t lowMin;                                                            /// tLOW
+    uint32_t highMin;                                                           /// tHIGH
+    uint32_t setupMin;                                                          /// tSU;DAT
+    uint32_t validMax;                                                          /// tVD;DAT
+    uint32_t riseMax;                                                           /// tr
+    uint32_t fallMax;                                                           /// tf
+};
+
+struct i2ctiming_Result
+{
+    uint32_t timingr;                                                           /// TIMINGR register content
+    uint32_t sclHz;                                                             /// SCL frequency including synchronisation and edges
+};
+
+/* === exported functions === */
+/**
+ * @brief Get bus specification limits of speed mode.
+ * @param speed speed mode
+ * @retval limits
+ */
+const struct i2ctiming_Spec*
+i2ctiming_getSpec (enum i2ctiming_Speed speed);
+
+/**
+ * @brief Compute TIMINGR with analog filter on and digital filter off. SCL period is the shortest one
+ *        not faster than nominal speed which meets all specification limits.
+ * @param kernelHz I2C kernel clock
+ * @param speed speed mode
+ * @param result output
+ * @retval false if speed can not be reached with given kernel clock
+ */
+bool
+i2ctiming_compute (uint32_t kernelHz, enum i2ctiming_Speed speed,
+                   struct i2ctiming_Result *result);
+
+#endif /* APP_INC_I2CTIMING_H_ */
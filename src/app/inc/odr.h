@@ -0,0 +1,76 @@
+/*
+ * odr.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Measurement of real output data rate from time stamps of data ready edges, taken with CPU cycle
+ *      counter. The last ODR_WINDOW_LEN periods are kept, so rate, jitter and missed periods follow a
+ *      sliding window. A period longer than 1.5 nominal periods is counted as missed edges, its length
+ *      still counts for rate but not for jitter. Window restarts when core clock changes.
+ *      odr_addEdge() is O(1) and meant for interrupt context, odr_getSummary() scans the window and
+ *      should run on a copy taken with interrupts masked.
+ *      Does not depend on RTOS or HAL, so it is built on host as well.
+ */
+#ifndef APP_INC_ODR_H_
+#define APP_INC_ODR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* === exported defines === */
+#define ODR_WINDOW_LEN                  128
+
+/* === exported types === */
+/** edge history */
+struct odr_Window
+{
+    uint32_t span[ODR_WINDOW_LEN];                                              /// cycles between consecutive edges
+    uint8_t periods[ODR_WINDOW_LEN];                                            /// nominal periods in span, more than 1 when edges were missed
+    uint16_t head;                                                              /// next entry to write
+    uint16_t count;                                                             /// valid entries
+    uint32_t lastEdge;                                                          /// cycle counter at last edge
+    bool started;                                                               /// lastEdge is valid
+    uint32_t coreHz;                                                            /// cycle counter frequency of window
+    uint32_t nominalMilliHz;
+    uint32_t nominalCycles;                                                     /// nominal period at coreHz
+};
+
+/** window summary */
+struct odr_Summary
+{
+    uint16_t edges;                                                             /// spans in window
+    uint32_t periods;                                                           /// nominal periods covered by window
+    uint32_t rateMilliHz;                                                       /// measured rate, 0 until two edges are seen
+    uint32_t jitterNs;                                                          /// standard deviation of period
+    uint32_t maxDeviationNs;                                                    /// largest distance of a period from mean
+    uint32_t missed;                                                            /// edges missed
+};
+
+/* === exported functions === */
+/**
+ * @brief Start new window.
+ * @param window edge history
+ * @param nominalMilliHz configured rate
+ */
+void
+odr_start (struct odr_Window *window, uint32_t nominalMilliHz);
+
+/**
+ * @brief Add data ready edge.
+ * @param window edge history
+ * @param cycles cycle counter at edge
+ * @param coreHz cycle counter frequency, window restarts when it changes
+ */
+void
+odr_addEdge (struct odr_Window *window, uint32_t cycles, uint32_t coreHz);
+
+/**
+ * @brief Evaluate window.
+ * @param window edge history
+ * @param summary rate, jitter and missed edges
+ */
+void
+odr_getSummary (const struct odr_Window *window, struct odr_Summary *summary);
+
+#endif /* APP_INC_ODR_H_ */
@@ -0,0 +1,87 @@
+/*
+ * pipeline.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Instrumentation of the sample data path. Samples pass four stages, each a task reading a
+ *      bounded input queue: acquisition (sensor task, sensor to samples in mili g), DSP (capture,
+ *      statistics and filtering), format (CLI lines) and transmit (CLI task, UART). Every stage
+ *      reports the items it serves; a stage with load close to 100 % or with full output queue
+ *      downstream is the bottleneck.
+ */
+#ifndef APP_INC_PIPELINE_H_
+#define APP_INC_PIPELINE_H_
+
+#include <stdint.h>
+
+/* === exported types === */
+enum pipeline_Stage
+{
+    PIPELINE_ACQUIRE,
+    PIPELINE_DSP,
+    PIPELINE_FORMAT,
+    PIPELINE_TRANSMIT,
+    PIPELINE_STAGE_COUNT
+};
+
+/** stage metrics since last reset */
+struct pipeline_StageStats
+{
+    uint32_t items;                                                             /// items served
+    uint32_t itemsPerS;                                                         /// average item rate
+    uint16_t queueMax;                                                          /// highest input queue fill seen when an item was taken, including it
+    uint32_t serviceMaxUs;                                                      /// longest time from taking an item to finishing it
+    uint32_t serviceAvgUs;
+    uint16_t loadPercent;                                                       /// share of time spent serving items
+    uint32_t outputFull;                                                        /// items which found output queue full and were dropped or waited
+};
+
+/* === exported functions === */
+/**
+ * @brief Clear metrics of all stages.
+ */
+void
+pipeline_reset (void);
+
+/**
+ * @brief Mark start of item service. Called by stage task right after an item is taken.
+ * @param stage stage
+ * @param queueFill items in input queue including the one taken
+ * @retval start time for @ref pipeline_endItem()
+ */
+uint32_t
+pipeline_beginItem (enum pipeline_Stage stage, uint32_t queueFill);
+
+/**
+ * @brief Mark end of item service.
+ * @param stage stage
+ * @param startCycles value returned by @ref pipeline_beginItem()
+ */
+void
+pipeline_endItem (enum pipeline_Stage stage, uint32_t startCycles);
+
+/**
+ * @brief Count item which found output queue of stage full.
+ * @param stage stage
+ */
+void
+pipeline_outputFull (enum pipeline_Stage stage);
+
+/**
+ * @brief Get stage metrics.
+ * @param stage stage
+ * @param stats output
+ */
+void
+pipeline_getStats (enum pipeline_Stage stage, struct pipeline_StageStats *stats);
+
+/**
+ * @brief Get stage name for CLI output.
+ * @param stage stage
+ * @retval name, up to 8 characters
+ */
+const char*
+pipeline_getStageName (enum pipeline_Stage stage);
+
+#endif /* APP_INC_PIPELINE_H_ */
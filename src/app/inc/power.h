@@ -0,0 +1,72 @@
+/*
+ * power.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Low power idle. FreeRTOS tickless idle stops the 1 kHz tick while all tasks are blocked,
+ *      the MCU sleeps until next timeout (RTC wakeup timer) or interrupt and skipped ticks are
+ *      compensated from the LSE clocked RTC.
+ */
+#ifndef APP_INC_POWER_H_
+#define APP_INC_POWER_H_
+
+#include <stdint.h>
+#include "stm32f3xx_hal.h"
+
+/* === exported types === */
+enum power_Mode
+{
+    POWER_MODE_RUN,                                                             /// tick always running, idle task spins
+    POWER_MODE_SLEEP,                                                           /// tickless, core sleeps, peripherals run
+    POWER_MODE_STOP,                                                            /// tickless, STOP mode when UART is quiet
+    POWER_MODE_COUNT
+};
+
+struct power_Stats
+{
+    uint32_t sleeps;                                                            /// number of sleep mode entries
+    uint32_t stops;                                                             /// number of STOP mode entries
+    uint32_t uartWakeups;                                                       /// STOP mode left on UART RX line
+    uint64_t sleepUs;                                                           /// time spent in sleep mode
+    uint64_t stopUs;                                                            /// time spent in STOP mode
+    uint64_t totalUs;                                                           /// time since stats reset
+};
+
+/* === exported functions === */
+/**
+ * @brief Init low power module. Wake up timer runs from RTC, so @ref RTC_init() must be called first.
+ * @param huart CLI UART, it is checked for ongoing transfers before STOP mode entry
+ */
+void
+power_init (UART_HandleTypeDef *huart);
+
+/**
+ * @brief Select idle mode, resets statistics.
+ * @param mode idle mode
+ */
+void
+power_setMode (enum power_Mode mode);
+
+/**
+ * @brief Get idle mode.
+ * @retval idle mode
+ */
+enum power_Mode
+power_getMode (void);
+
+/**
+ * @brief Get sleep residency statistics since last mode change.
+ * @param stats output
+ */
+void
+power_getStats (struct power_Stats *stats);
+
+/**
+ * @brief Tickless idle implementation, called by FreeRTOS idle task with scheduler suspended.
+ * @param expectedIdleTime ticks until next task unblocks
+ */
+void
+power_suppressTicksAndSleep (uint32_t expectedIdleTime);
+
+#endif /* APP_INC_POWER_H_ */
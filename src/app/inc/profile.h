@@ -0,0 +1,141 @@
+/*
+ * profile.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Named configuration profiles kept in a log-structured store over a ring of flash pages.
+ *      Every save appends a record protected by CRC32, the newest record of a name wins.
+ *      When the active page is full, live records are copied to the next page of the ring, so
+ *      all pages are erased equally often. A page becomes active only after the copy is
+ *      committed, so power loss at any moment leaves the previous state readable.
+ *      The module does not depend on hardware, flash is accessed through struct profile_Flash.
+ */
+#ifndef APP_INC_PROFILE_H_
+#define APP_INC_PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* === exported defines === */
+#define PROFILE_NAME_LEN                12                                      /// including terminating zero
+#define PROFILE_MAX_SENSORS             2                                       /// sensor setups in one profile
+#define PROFILE_MAX_PROFILES            8                                       /// distinct names in store
+
+/* === exported types === */
+/** setup of single sensor, enum values are stored as used by sensor module */
+struct profile_SensorConfig
+{
+    uint8_t fullScale,                                                          /// enum sensor_AccFullScale
+            rate,                                                               /// enum sensor_AccRate
+            AAFilterBW,                                                         /// enum sensor_AccAAFilterBW
+            reserved;
+    uint16_t avgNumber;                                                         /// number of averaged samples
+    uint16_t reserved2;
+};
+
+/** content of a profile */
+struct profile_Config
+{
+    struct profile_SensorConfig sensors[PROFILE_MAX_SENSORS];
+    uint8_t clickDetection;                                                     /// click detection printing enabled
+    uint8_t reserved[3];
+};
+
+/** flash area used by the store, programmed in 32 bit words */
+struct profile_Flash
+{
+    const uint8_t *base;                                                        /// memory mapped start of area
+    uint32_t pageSize;                                                          /// erase unit in bytes
+    uint8_t numOfPages;                                                         /// at least 2
+    bool
+    (*erasePage) (uint8_t page);                                                /// set page to 0xFF
+    bool
+    (*program) (uint32_t offset, const void *data, uint32_t len);               /// offset and len multiple of 4
+};
+
+enum profile_Status
+{
+    PROFILE_OK,
+    PROFILE_NOT_FOUND,                                                          /// no profile with given name
+    PROFILE_FULL,                                                               /// too many profiles
+    PROFILE_INVALID_NAME,                                                       /// empty or too long name
+    PROFILE_FLASH_ERROR                                                         /// erase or program failed
+};
+
+/** store state */
+struct profile_Info
+{
+    uint32_t sequence;                                                          /// number of page switches since format
+    uint8_t activePage;
+    uint32_t usedBytes,                                                         /// in active page
+            freeBytes;
+};
+
+/* === exported functions === */
+/**
+ * @brief Mount store, flash area is formatted if it holds no committed page.
+ * @param flash flash area, must stay valid
+ * @retval PROFILE_OK or PROFILE_FLASH_ERROR
+ */
+enum profile_Status
+profile_init (const struct profile_Flash *flash);
+
+/**
+ * @brief Save profile, replaces previous content of profile with the same name.
+ * @param name zero terminated name, shorter than PROFILE_NAME_LEN
+ * @param config profile content
+ * @retval profile_Status
+ */
+enum profile_Status
+profile_save (const char *name, const struct profile_Config *config);
+
+/**
+ * @brief Load profile.
+ * @param name profile name
+ * @param config loaded profile content
+ * @retval PROFILE_OK or PROFILE_NOT_FOUND
+ */
+enum profile_Status
+profile_load (const char *name, struct profile_Config *config);
+
+/**
+ * @brief Select profile applied at boot.
+ * @param name name of existing profile
+ * @retval profile_Status
+ */
+enum profile_Status
+profile_setDefault (const char *name);
+
+/**
+ * @brief Get name of profile applied at boot.
+ * @retval name, NULL if not selected
+ */
+const char*
+profile_getDefault (void);
+
+/**
+ * @brief Get name of n-th stored profile.
+ * @param n profile number, from 0
+ * @retval name, NULL if there are not so many profiles
+ */
+const char*
+profile_getName (uint8_t n);
+
+/**
+ * @brief Get store state.
+ * @param info store state
+ */
+void
+profile_getInfo (struct profile_Info *info);
+
+/**
+ * @brief CRC-32 (IEEE 802.3) of data.
+ * @param data data
+ * @param len data length
+ * @retval CRC
+ */
+uint32_t
+profile_crc32 (const void *data, uint32_t len);
+
+#endif /* APP_INC_PROFILE_H_ */
@@ -0,0 +1,169 @@
+/*
+ * regmap.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Register map of I2C slave with 8 bit register addresses and auto increment burst access.
+ *      Writes go to a shadow copy first and are marked dirty only if they change the register value,
+ *      regmap_flush() then writes consecutive dirty registers in one burst each.
+ *      Reads of several registers are merged into as few burst transactions as possible.
+ *      Every transaction is counted against the operation passed to the call which issues it, so the
+ *      bus cost of driver operations can be reported also when tasks of different priority use
+ *      one map, e.g. configuration preempted by event reads.
+ */
+#ifndef APP_INC_REGMAP_H_
+#define APP_INC_REGMAP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+
+/* === exported defines === */
+#define REGMAP_SIZE                     64                                      /// number of registers, addresses 0x00..0x3F
+#define REGMAP_MAX_OPS                  6                                       /// number of operation statistics slots
+#define REGMAP_MAX_READ_GAP             3                                       /// max unrequested registers read to merge two reads
+
+/* === exported types === */
+/** bus cost of single driver operation type */
+struct regmap_OpStats
+{
+    uint32_t ops,                                                               /// number of operations
+            transactions,                                                       /// I2C transactions issued by operations
+            writesSkipped;                                                      /// register writes which did not change shadow
+};
+
+/** register map of single slave */
+struct regmap_Map
+{
+    uint8_t slaveAddr;                                                          /// 8 bit slave address
+    uint8_t autoIncrement;                                                      /// register address bit enabling auto increment
+    uint8_t shadow[REGMAP_SIZE];                                                /// last value written to or read from register
+    uint64_t valid,                                                             /// bit per register, shadow holds device content
+            dirty,                                                              /// bit per register, shadow not written to device yet
+            noIncidentalRead;                                                   /// bit per register which must not be read unless requested
+    uint32_t writesSkipped;                                                     /// skipped writes not counted to operation by flush yet
+    struct regmap_OpStats stats[REGMAP_MAX_OPS];
+};
+
+/* === exported functions === */
+/**
+ * @brief Initialise register map. All registers are invalid and clean.
+ * @param map register map
+ * @param slaveAddr 8 bit slave address
+ * @param autoIncrement register address bit enabling auto increment, 0 if not needed
+ */
+void
+regmap_init (struct regmap_Map *map, uint8_t slaveAddr, uint8_t autoIncrement);
+
+/**
+ * @brief Mark registers which have read side effects (e.g. clear latched interrupt), so they are
+ *        never read only to merge two neighbouring reads.
+ * @param map register map
+ * @param mask bit per register
+ */
+void
+regmap_setNoIncidentalRead (struct regmap_Map *map, uint64_t mask);
+
+/**
+ * @brief Forget shadow content, e.g. after device reboot. Pending writes are dropped.
+ * @param map register map
+ */
+void
+regmap_invalidate (struct regmap_Map *map);
+
+/**
+ * @brief Count one operation.
+ * @param map register map
+ * @param op operation index, below REGMAP_MAX_OPS
+ */
+void
+regmap_countOp (struct regmap_Map *map, uint8_t op);
+
+/**
+ * @brief Write register value to shadow. Register is marked dirty only if value changes, skipped
+ *        writes are counted to the operation of next flush.
+ * @param map register map
+ * @param reg register address
+ * @param value register value
+ */
+void
+regmap_write (struct regmap_Map *map, uint8_t reg, uint8_t value);
+
+/**
+ * @brief Modify bits of register in shadow.
+ * @param map register map
+ * @param reg register address
+ * @param mask bits to modify
+ * @param value new value of bits selected by mask
+ */
+void
+regmap_update (struct regmap_Map *map, uint8_t reg, uint8_t mask,
+               uint8_t value);
+
+/**
+ * @brief Get shadow value of register.
+ * @param map register map
+ * @param reg register address
+ * @retval shadow value
+ */
+uint8_t
+regmap_get (const struct regmap_Map *map, uint8_t reg);
+
+/**
+ * @brief Write all dirty registers to device, consecutive registers in one burst.
+ * @param map register map
+ * @param op operation the transactions and skipped writes are counted to
+ * @retval I2C_SUCCES if all writes succeeded, registers which failed stay dirty
+ */
+enum I2C_Status
+regmap_flush (struct regmap_Map *map, uint8_t op);
+
+/**
+ * @brief Write register immediately, bypassing write-back, e.g. for commands like reboot.
+ * @param map register map
+ * @param op operation the transaction is counted to
+ * @param reg register address
+ * @param value register value
+ * @retval I2C_Status
+ */
+enum I2C_Status
+regmap_writeThrough (struct regmap_Map *map, uint8_t op, uint8_t reg,
+                     uint8_t value);
+
+/**
+ * @brief Read consecutive registers from device in one burst.
+ * @param map register map
+ * @param op operation the transaction is counted to
+ * @param startingReg first register address
+ * @param pData read values
+ * @param numOfRegisters number of registers
+ * @retval I2C_Status
+ */
+enum I2C_Status
+regmap_read (struct regmap_Map *map, uint8_t op, uint8_t startingReg,
+             uint8_t *pData, uint8_t numOfRegisters);
+
+/**
+ * @brief Read list of registers, adjacent or nearby registers are merged into single bursts.
+ * @param map register map
+ * @param op operation the transactions are counted to
+ * @param regs register addresses in ascending order
+ * @param pData read values, one per register in regs
+ * @param numOfRegisters number of registers in regs
+ * @retval I2C_Status
+ */
+enum I2C_Status
+regmap_readList (struct regmap_Map *map, uint8_t op, const uint8_t *regs,
+                 uint8_t *pData, uint8_t numOfRegisters);
+
+/**
+ * @brief Get bus statistics of operation.
+ * @param map register map
+ * @param op operation index
+ * @retval statistics
+ */
+const struct regmap_OpStats*
+regmap_getStats (const struct regmap_Map *map, uint8_t op);
+
+#endif /* APP_INC_REGMAP_H_ */
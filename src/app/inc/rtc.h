@@ -8,6 +8,10 @@
 #ifndef APP_INC_RTC_H_
 #define APP_INC_RTC_H_
 #include "stm32f3xx_hal.h"
+/* === exported defines === */
+#define RTC_ASYNCH_PREDIV                   7                                   // 4096 Hz sub second counter clock
+#define RTC_SYNCH_PREDIV                    4095                                // 1 Hz calendar clock
+
 /* === exported variables === */
 extern RTC_HandleTypeDef hrtc;
 
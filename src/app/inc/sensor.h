@@ -9,15 +9,21 @@
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include <stdbool.h>
+#include "regmap.h"
+#include "odr.h"
 
 #ifndef APP_INC_SENSOR_H_
 #define APP_INC_SENSOR_H_
 
+/* === exported defines === */
+#define SENSOR_MAX_INSTANCES            2                                       /// LSM303D with SA0 pin high and low on one bus
+
 /* === exported types === */
 /** sensor output type indicator */
 enum sensor_OutputType
 {
-    SENSOR_OUT_ACC_DATA, SENSOR_OUT_CLICK_DETECTION,
+    SENSOR_OUT_ACC_DATA, SENSOR_OUT_CLICK_DETECTION, SENSOR_OUT_FREE_FALL,
+    SENSOR_OUT_CONFIG,                                                          /// setup changed while running, sample queue only
 };
 
 /** sensor data */
@@ -26,22 +32,59 @@ struct sensor_XyzData
     int16_t x, y, z;                                                            /// in mili g for accelerometer,
 };
 
+/** axis bits of click source */
+#define SENSOR_AXIS_X                   0x01
+#define SENSOR_AXIS_Y                   0x02
+#define SENSOR_AXIS_Z                   0x04
+
+/** detected event */
+struct sensor_Event
+{
+    uint32_t timeMs;                                                            /// RTOS tick time of interrupt, in ms
+    uint32_t cycles;                                                            /// cycle counter at interrupt, for latency measurement
+    uint8_t axes;                                                               /// click: SENSOR_AXIS_ bits of axes which detected it
+    bool negative;                                                              /// click: acceleration sign
+    bool doubleClick;                                                           /// click: double click, single otherwise
+};
+
+/** click detection setup, register values follow from full scale and rate */
+struct sensor_ClickConfig
+{
+    uint16_t thresholdMg;                                                       /// resolution is 1/128 of full scale
+    uint16_t limitMs;                                                           /// max time above threshold, up to 127 sample periods
+    uint16_t latencyMs;                                                         /// dead time after first click of double click
+    uint16_t windowMs;                                                          /// time for second click after latency, 0 disables double click
+};
+
 /** sensor output data struct. Variables of this type are stored in sensor output queue */
 struct sensor_Output
 {
     enum sensor_OutputType type;
+    uint8_t sensorIdx;                                                          /// index of sensor instance which produced output
     union
     {
-        struct sensor_XyzData xyzData;
+        struct sensor_XyzData xyzData;                                          /// SENSOR_OUT_ACC_DATA
+        struct sensor_Event event;                                              /// detections
     };
 };
 
+/** driver operations with separate I2C transaction statistics, see @ref sensor_getBusStats() */
+enum sensor_BusOp
+{
+    SENSOR_BUS_OP_INIT,                                                         /// probing and default configuration
+    SENSOR_BUS_OP_CONFIG,                                                       /// setters called by user
+    SENSOR_BUS_OP_DATA,                                                         /// data read on data ready
+    SENSOR_BUS_OP_DETECTION,                                                    /// event source read on detection
+    SENSOR_BUS_OP_COUNT
+};
+
 /**
  * Sensor accelerometer data read rate. Parameter for @ref sensor_setAccRate().
  * Assigned values are compliant with accelerometer CTRL1 register content.
  */
 enum sensor_AccRate
 {
+    SENSOR_ACC_RATE_POWER_DOWN = 0x0,
     SENSOR_ACC_RATE_3HZ125 = 0x1 << 4,
     SENSOR_ACC_RATE_6HZ25 = 0x2 << 4,
     SENSOR_ACC_RATE_12HZ5 = 0x3 << 4,
@@ -80,6 +123,14 @@ enum sensor_AccFullScale
     SENSOR_ACC_FULL_SCALE_16G = 0x4 << 3
 };
 
+/** accelerometer setup which can be applied at once, see @ref sensor_setAccConfig() */
+struct sensor_AccConfig
+{
+    enum sensor_AccFullScale fullScale;
+    enum sensor_AccRate rate;
+    enum sensor_AccAAFilterBW AAFilterBW;
+};
+
 /* === tasks === */
 /**
  * @brief This task is responsible for reading data from sensor and pushing it to queue.
@@ -91,11 +142,31 @@ sensor_task (void *params);
 /* === exported functions === */
 
 /**
- * @brief Initialise sensor to work in default mode and create tasks.d
- * @param sensorOutputQueue uninitialised freeRTOS queue which will contain accelerometer output data.
+ * @brief Initialise sensor module. No bus traffic happens here, sensors are probed, rebooted and
+ *        configured by sensor_task after scheduler start. Both bus addresses are probed, every
+ *        sensor which answers becomes an instance.
+ * @param sensorOutputQueue freeRTOS queue which will contain accelerometer data samples.
+ * @param sensorEventQueue freeRTOS queue which will contain detected events, kept apart from samples so
+ *        they are not delayed by sample backlog. Items of both queues are struct sensor_Output.
+ * @param bootConfig setup of each of SENSOR_MAX_INSTANCES applied at bring-up, NULL for defaults.
+ *        Rate is lowered if it does not fit on the bus.
+ */
+void
+sensor_init (QueueHandle_t sensorOutputQueue, QueueHandle_t sensorEventQueue,
+             const struct sensor_AccConfig *bootConfig);
+
+/**
+ * @brief Block until sensor bring-up is done. Other functions of this module can be used afterwards.
  */
 void
-sensor_init (QueueHandle_t sensorOutputQueue);
+sensor_waitReady ();
+
+/**
+ * @brief Get number of sensor instances found on the bus.
+ * @return number of instances, instances are indexed from 0
+ */
+uint8_t
+sensor_getNumOfInstances ();
 
 /**
  * @brief Start sensor operation.
@@ -112,55 +183,180 @@ sensor_stop ();
 /* accelerometer setters */
 /**
  * @brief Set accelerometer range.
+ * @param sensorIdx sensor instance
  * @param accelerometer range
  * @return void
  */
 void
-sensor_setAccFullScale (enum sensor_AccFullScale fullScale);
+sensor_setAccFullScale (uint8_t sensorIdx, enum sensor_AccFullScale fullScale);
 
 /**
- * @brief Set accelerometer data read rate
+ * @brief Set accelerometer data read rate. Rate is rejected if data of all instances could not be
+ *        read within I2C bus bandwidth.
+ * @param sensorIdx sensor instance
  * @param rate data read rate
- * @return void
+ * @return true if rate has been set, false if it would exceed I2C bus bandwidth
+ */
+bool
+sensor_setAccRate (uint8_t sensorIdx, enum sensor_AccRate rate);
+
+/**
+ * @brief Set full scale, rate and anti alias filter at once, in one bus transfer.
+ * @param sensorIdx sensor instance
+ * @param config accelerometer setup
+ * @return false if rate would exceed I2C bus bandwidth, nothing is changed then
+ */
+bool
+sensor_setAccConfig (uint8_t sensorIdx, const struct sensor_AccConfig *config);
+
+/**
+ * @brief Change setup of running sensor at a sample boundary. sensor_task writes it after the data
+ *        read in progress and puts a SENSOR_OUT_CONFIG item into the sample queue, so samples before
+ *        the item were taken with the old setup and samples after it with the new one. When not
+ *        started, works as @ref sensor_setAccConfig().
+ * @param sensorIdx sensor instance
+ * @param config accelerometer setup
+ * @return false if rate would exceed I2C bus bandwidth, nothing is changed then
+ */
+bool
+sensor_changeAccConfig (uint8_t sensorIdx,
+                        const struct sensor_AccConfig *config);
+
+/**
+ * @brief Get accelerometer setup, including a change requested with @ref sensor_changeAccConfig()
+ *        which is not applied yet.
+ * @param sensorIdx sensor instance
+ * @param config accelerometer setup
  */
 void
-sensor_setAccRate (enum sensor_AccRate rate);
+sensor_getAccConfig (uint8_t sensorIdx, struct sensor_AccConfig *config);
 
 /**
  * @brief Set accelerometer anti alias filter bandwidth.
+ * @param sensorIdx sensor instance
  * @param bandwidth
  */
 void
-sensor_setAccAAFiletrBW (enum sensor_AccAAFilterBW bandwidth);
+sensor_setAccAAFiletrBW (uint8_t sensorIdx,
+                         enum sensor_AccAAFilterBW bandwidth);
 
 /* accelerometer getters */
 /**
  * @brief Get accelerometer range.
+ * @param sensorIdx sensor instance
  * @return accelerometer range
  */
 enum sensor_AccFullScale
-sensor_getAccFullScale ();
+sensor_getAccFullScale (uint8_t sensorIdx);
 
 /**
  * @brief Get accelerometer range as integer.
+ * @param sensorIdx sensor instance
  * @return accelerometer range as integer.
  */
 uint8_t
-sensor_getAccFullScaleInt ();
+sensor_getAccFullScaleInt (uint8_t sensorIdx);
 
 /**
  * @brief Get accelerometer data read rate.
+ * @param sensorIdx sensor instance
  * @return accelerometer data read rate
  */
 enum sensor_AccRate
-sensor_getAccRate ();
+sensor_getAccRate (uint8_t sensorIdx);
 
 /**
  * @brief Get accelerometer data read rate as integer in miliHertz.
+ * @param sensorIdx sensor instance
  * @return accelerometer data read rate as integer
  */
 uint32_t
-sensor_getAccRateInt ();
+sensor_getAccRateInt (uint8_t sensorIdx);
+
+/**
+ * @brief Get I2C bus load caused by data reads of all instances at their current rates.
+ * @return bus load in percent
+ */
+uint8_t
+sensor_getBusLoad ();
+
+/**
+ * @brief Get I2C bus time of single sample read at current bus speed.
+ * @return time in microseconds
+ */
+uint32_t
+sensor_getBusTimePerSampleUs ();
+
+/**
+ * @brief Get I2C transaction statistics of driver operation.
+ * @param sensorIdx sensor instance
+ * @param op driver operation
+ * @return number of operations, transactions they issued and register writes skipped by shadow cache
+ */
+const struct regmap_OpStats*
+sensor_getBusStats (uint8_t sensorIdx, enum sensor_BusOp op);
+
+/**
+ * @brief Set free fall detection, done by interrupt generator 1 of sensor: all axes below threshold
+ *        for given time. Detection is reported with @ref SENSOR_OUT_FREE_FALL also when sensor is
+ *        not started, no CPU time is used until it happens.
+ * @param sensorIdx sensor instance
+ * @param thresholdMg threshold, resolution is 1/128 of full scale, 0 disables detection
+ * @param durationMs minimum time, resolution is one sample period
+ * @return false if threshold is not below full scale or duration exceeds 127 sample periods
+ */
+bool
+sensor_setFreeFall (uint8_t sensorIdx, uint16_t thresholdMg,
+                    uint16_t durationMs);
+
+/**
+ * @brief Get free fall detection setup as applied to sensor, after rounding to its resolution at
+ *        current full scale and rate.
+ * @param sensorIdx sensor instance
+ * @param thresholdMg threshold, 0 when disabled
+ * @param durationMs minimum time
+ */
+void
+sensor_getFreeFall (uint8_t sensorIdx, uint16_t *thresholdMg,
+                    uint16_t *durationMs);
+
+/**
+ * @brief Set click detection on all axes. Clicks are reported with @ref SENSOR_OUT_CLICK_DETECTION
+ *        in event queue, axis, sign and kind are decoded from single source register read.
+ * @param sensorIdx sensor instance
+ * @param config click setup, times have resolution of one sample period
+ * @return false if threshold is not below full scale or a time does not fit into its register
+ */
+bool
+sensor_setClick (uint8_t sensorIdx, const struct sensor_ClickConfig *config);
+
+/**
+ * @brief Get click setup as applied to sensor, after rounding to its resolution at current full scale
+ *        and rate.
+ * @param sensorIdx sensor instance
+ * @param config click setup
+ */
+void
+sensor_getClick (uint8_t sensorIdx, struct sensor_ClickConfig *config);
+
+/**
+ * @brief Start or stop measurement of real data rate of one sensor. Data ready edges are time stamped
+ *        with cycle counter in interrupt, window restarts on rate change and on sensor start.
+ * @param sensorIdx sensor instance, measurement of other instance is stopped
+ * @param enable false stops measurement
+ */
+void
+sensor_measureAccRate (uint8_t sensorIdx, bool enable);
+
+/**
+ * @brief Get real data rate, jitter and missed data ready edges over last ODR_WINDOW_LEN periods.
+ *        Interrupts are masked while the window is copied.
+ * @param sensorIdx sensor instance
+ * @param summary measurement result
+ * @return false if rate of this instance is not measured
+ */
+bool
+sensor_getMeasuredAccRate (uint8_t sensorIdx, struct odr_Summary *summary);
 
 /**
  * @brief Get numbers of samples averaged for accelerometer data readings.
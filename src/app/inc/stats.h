@@ -0,0 +1,74 @@
+/*
+ * stats.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Windowed per axis statistics of accelerometer samples: min, max, mean, RMS, variance, peak and
+ *      peak to peak. Samples are integers in mili g, so sums of samples and of their squares are kept
+ *      exactly in 64 bits and variance is evaluated once per window as (n*sum(x^2) - sum(x)^2) / n^2,
+ *      which has no cancellation error and costs no division per sample.
+ *      Does not depend on RTOS or HAL, so it is built on host as well.
+ */
+#ifndef APP_INC_STATS_H_
+#define APP_INC_STATS_H_
+
+#include <stdint.h>
+
+/* === exported defines === */
+#define STATS_AXES                      3
+#define STATS_MAX_SAMPLES               (1UL << 17)                             /// keeps n*sum(x^2) in 63 bits for |x| < 16384
+
+/* === exported types === */
+/** running sums of single axis */
+struct stats_Axis
+{
+    int16_t min, max;
+    int64_t sum;                                                                /// sum of samples
+    uint64_t sumSq;                                                             /// sum of squared samples
+};
+
+/** statistics of one window */
+struct stats_Window
+{
+    uint32_t count;                                                             /// number of samples
+    struct stats_Axis axes[STATS_AXES];
+};
+
+/** window summary of single axis, all values in mili g or mili g squared */
+struct stats_Summary
+{
+    int16_t min, max, mean;
+    uint16_t rms;
+    uint16_t peak;                                                              /// highest absolute value
+    uint16_t peakToPeak;
+    uint32_t variance;
+};
+
+/* === exported functions === */
+/**
+ * @brief Start new window.
+ * @param window window state
+ */
+void
+stats_reset (struct stats_Window *window);
+
+/**
+ * @brief Add sample to window. Samples beyond STATS_MAX_SAMPLES are ignored.
+ * @param window window state
+ * @param x, y, z sample in mili g, absolute value below 16384
+ */
+void
+stats_add (struct stats_Window *window, int16_t x, int16_t y, int16_t z);
+
+/**
+ * @brief Get summary of single axis. Results are rounded to nearest.
+ * @param window window with at least one sample
+ * @param axis 0 for x, 1 for y, 2 for z
+ * @param summary output
+ */
+void
+stats_getSummary (const struct stats_Window *window, uint8_t axis,
+                  struct stats_Summary *summary);
+
+#endif /* APP_INC_STATS_H_ */
@@ -0,0 +1,95 @@
+/*
+ * systime.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Cycle accurate time base on DWT cycle counter. Works with interrupts masked and before
+ *      scheduler start, so it is used for driver deadlines and short busy waits.
+ */
+#ifndef APP_INC_SYSTIME_H_
+#define APP_INC_SYSTIME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* === exported types === */
+/** boot stages, time of each is measured from start of main() */
+enum systime_BootMark
+{
+    SYSTIME_BOOT_CLOCKS,                                                        /// clock tree configured
+    SYSTIME_BOOT_SCHEDULER,                                                     /// first task running
+    SYSTIME_BOOT_SENSOR_READY,                                                  /// sensors configured
+    SYSTIME_BOOT_FIRST_SAMPLE,                                                  /// first data ready from sensor
+    SYSTIME_BOOT_MARK_COUNT
+};
+
+/* === exported functions === */
+/**
+ * @brief Enable DWT cycle counter. Called first in main(), so counter holds time since reset.
+ */
+void
+systime_init (void);
+
+/**
+ * @brief Get current value of free running cycle counter.
+ * @retval CPU cycles, wraps around
+ */
+uint32_t
+systime_getCycles (void);
+
+/**
+ * @brief Convert microseconds to CPU cycles at current core clock.
+ * @param us time in microseconds
+ * @retval CPU cycles
+ */
+uint32_t
+systime_usToCycles (uint32_t us);
+
+/**
+ * @brief Convert CPU cycles to microseconds at current core clock.
+ * @param cycles CPU cycles
+ * @retval time in microseconds
+ */
+uint32_t
+systime_cyclesToUs (uint32_t cycles);
+
+/**
+ * @brief Get deadline given number of microseconds from now.
+ * @param us time in microseconds, below half of counter wrap period
+ * @retval deadline for @ref systime_isReached()
+ */
+uint32_t
+systime_deadline (uint32_t us);
+
+/**
+ * @brief Check if deadline has passed.
+ * @param deadline value returned by @ref systime_deadline()
+ * @retval true if deadline has passed
+ */
+bool
+systime_isReached (uint32_t deadline);
+
+/**
+ * @brief Busy wait.
+ * @param us time in microseconds
+ */
+void
+systime_delayUs (uint32_t us);
+
+/**
+ * @brief Record time of boot stage. Only first call for given stage has effect. Can be called from ISR.
+ * @param mark boot stage
+ */
+void
+systime_markBoot (enum systime_BootMark mark);
+
+/**
+ * @brief Get time of boot stage.
+ * @param mark boot stage
+ * @retval microseconds since start of main(), 0 if stage not reached yet
+ */
+uint32_t
+systime_getBootMarkUs (enum systime_BootMark mark);
+
+#endif /* APP_INC_SYSTIME_H_ */
@@ -0,0 +1,34 @@
+/*
+ * timebase.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Device time in microseconds since scheduler start: RTOS tick count extended with elapsed part
+ *      of current SysTick period. Tick count is compensated after stop mode and SysTick follows core
+ *      clock changes, so unlike DWT cycles the time stays continuous through power and clock
+ *      governor changes. Time of event lines (tick milliseconds) is the same clock.
+ *      Tick count wraps after 49 days, the wrap is counted as long as time is read at least once
+ *      in that period.
+ */
+#ifndef APP_INC_TIMEBASE_H_
+#define APP_INC_TIMEBASE_H_
+
+#include <stdint.h>
+
+/* === exported functions === */
+/**
+ * @brief Get device time. Task context, scheduler running.
+ * @retval microseconds since scheduler start
+ */
+uint64_t
+timebase_getUs (void);
+
+/**
+ * @brief Get device time from interrupt, priority not above configMAX_SYSCALL_INTERRUPT_PRIORITY.
+ * @retval microseconds since scheduler start
+ */
+uint64_t
+timebase_getUsFromISR (void);
+
+#endif /* APP_INC_TIMEBASE_H_ */
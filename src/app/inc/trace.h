@@ -0,0 +1,171 @@
+/*
+ * trace.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      Recorder of scheduler, queue and interrupt events into a RAM ring. Each record is 8 bytes:
+ *      cycle counter, type, task, queue or IRQ number and queue fill level. The ring keeps the
+ *      newest TRACE_RING_LEN records, recording stops with @ref trace_stop() and the frozen ring is
+ *      read out as one binary frame together with the task name table. Records are written by
+ *      hooks in tracehooks.h with interrupts masked.
+ *
+ *      Frame layout (little endian):
+ *          struct trace_FrameHeader
+ *          numTasks entries of uint8 task number and TRACE_TASK_NAME_LEN bytes of zero padded name
+ *          numRecords records of uint32 cycles, uint8 type, uint8 id, uint16 arg, oldest first
+ *          uint16 Fletcher-16 checksum of header, names and records, see @ref capture_checksum()
+ *
+ *      Cycle counter frequency is coreHz of header until the first TRACE_CLOCK record, which gives
+ *      the new frequency in MHz. Does not depend on RTOS or HAL, so host tools use it to decode frames.
+ */
+#ifndef APP_INC_TRACE_H_
+#define APP_INC_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* === exported defines === */
+#define TRACE_RING_LEN                  128
+#define TRACE_MAX_TASKS                 8
+#define TRACE_TASK_NAME_LEN             10                                      /// configMAX_TASK_NAME_LEN
+#define TRACE_SYNC                      0x5BA5                                  /// sent as A5 5B, differs from CAPTURE_SYNC
+#define TRACE_VERSION                   1
+#define TRACE_HEADER_SIZE               16
+#define TRACE_TASK_ENTRY_SIZE           (1 + TRACE_TASK_NAME_LEN)
+#define TRACE_RECORD_SIZE               8
+#define TRACE_CHECKSUM_SIZE             2
+#define TRACE_MAX_FRAME_SIZE            (TRACE_HEADER_SIZE + TRACE_MAX_TASKS * TRACE_TASK_ENTRY_SIZE \
+                                        + TRACE_RING_LEN * TRACE_RECORD_SIZE + TRACE_CHECKSUM_SIZE)
+
+/* === exported types === */
+/** record type */
+enum trace_Type
+{
+    TRACE_TASK_IN,                                                              /// id task number
+    TRACE_TASK_OUT,                                                             /// id task number
+    TRACE_QUEUE_SEND,                                                           /// id queue number, arg items before send
+    TRACE_QUEUE_SEND_FROM_ISR,
+    TRACE_QUEUE_RECEIVE,                                                        /// id queue number, arg items before receive
+    TRACE_QUEUE_RECEIVE_FROM_ISR,
+    TRACE_QUEUE_BLOCK_SEND,                                                     /// task blocks on full queue
+    TRACE_QUEUE_BLOCK_RECEIVE,                                                  /// task blocks on empty queue
+    TRACE_ISR_ENTER,                                                            /// id IRQ number
+    TRACE_ISR_EXIT,
+    TRACE_CLOCK,                                                                /// arg new core clock in MHz
+    TRACE_TYPE_COUNT
+};
+
+/** queue numbers given with vQueueSetQueueNumber(), queues left at 0 are semaphores and kernel queues */
+enum trace_Queue
+{
+    TRACE_QUEUE_OTHER,
+    TRACE_QUEUE_CLI_TX,
+    TRACE_QUEUE_CLI_RX,
+    TRACE_QUEUE_CLI_EVENT,
+    TRACE_QUEUE_SENSOR_OUT,
+    TRACE_QUEUE_SENSOR_EVENT,
+    TRACE_QUEUE_SENSOR_NOTIFY,
+    TRACE_QUEUE_DSP_OUT,
+    TRACE_QUEUE_COUNT
+};
+
+/** record */
+struct trace_Record
+{
+    uint32_t cycles;                                                            /// cycle counter
+    uint8_t type;                                                               /// enum trace_Type
+    uint8_t id;                                                                 /// task, queue or IRQ number
+    uint16_t arg;
+};
+
+/** frame header, TRACE_HEADER_SIZE bytes on the wire */
+struct trace_FrameHeader
+{
+    uint16_t sync;                                                              /// TRACE_SYNC
+    uint8_t version;                                                            /// TRACE_VERSION
+    uint8_t numTasks;                                                           /// entries of task name table
+    uint16_t numRecords;
+    uint16_t overwritten;                                                       /// older records lost, saturates
+    uint32_t coreHz;                                                            /// cycle counter frequency at first record
+    uint32_t stopCycles;                                                        /// cycle counter when recording stopped
+};
+
+/* === exported functions === */
+/**
+ * @brief Empty ring and start recording.
+ * @param coreHz current cycle counter frequency
+ */
+void
+trace_start (uint32_t coreHz);
+
+/**
+ * @brief Stop recording, ring is kept for readout.
+ * @param cycles cycle counter now
+ */
+void
+trace_stop (uint32_t cycles);
+
+/**
+ * @brief Check if records are taken.
+ * @retval true between @ref trace_start() and @ref trace_stop()
+ */
+bool
+trace_isRecording (void);
+
+/**
+ * @brief Store record, ignored when not recording. Caller masks interrupts.
+ * @param cycles cycle counter
+ * @param type enum trace_Type
+ * @param id task, queue or IRQ number
+ * @param arg type specific argument
+ */
+void
+trace_record (uint32_t cycles, uint8_t type, uint8_t id, uint16_t arg);
+
+/**
+ * @brief Get ring fill.
+ * @param records records in ring
+ * @param overwritten records lost since start
+ */
+void
+trace_getFill (uint16_t *records, uint32_t *overwritten);
+
+/**
+ * @brief Add entry to task name table of frame, an entry of the same task number is replaced.
+ *        Table is emptied by @ref trace_start().
+ * @param number task number
+ * @param name task name, cut to TRACE_TASK_NAME_LEN characters
+ * @retval false if table is full
+ */
+bool
+trace_addTaskName (uint8_t number, const char *name);
+
+/**
+ * @brief Read next part of frame of stopped ring. Next call after the whole frame returns 0,
+ *        following call starts the frame again.
+ * @param dst output buffer
+ * @param len size of output buffer
+ * @retval number of bytes written, 0 at frame end or while recording
+ */
+uint16_t
+trace_readFrame (uint8_t *dst, uint16_t len);
+
+/**
+ * @brief Decode frame header.
+ * @param src TRACE_HEADER_SIZE bytes of frame
+ * @param header decoded header
+ * @retval false if sync or version does not match
+ */
+bool
+trace_decodeHeader (const uint8_t *src, struct trace_FrameHeader *header);
+
+/**
+ * @brief Decode record.
+ * @param src TRACE_RECORD_SIZE bytes of frame
+ * @param record decoded record
+ */
+void
+trace_decodeRecord (const uint8_t *src, struct trace_Record *record);
+
+#endif /* APP_INC_TRACE_H_ */
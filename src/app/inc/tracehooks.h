@@ -0,0 +1,45 @@
+/*
+ * tracehooks.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *      Description:
+ *      FreeRTOS trace macros feeding the trace module, included at the end of FreeRTOSConfig.h.
+ *      Kernel macros expand inside tasks.c and queue.c, where TCB and queue fields are visible.
+ *      Task and queue numbers come from configUSE_TRACE_FACILITY, queues are numbered with
+ *      vQueueSetQueueNumber() and enum trace_Queue. Interrupt handlers of the application mark
+ *      their entry and exit with TRACE_IRQ_ENTER() and TRACE_IRQ_EXIT(). When recording is off,
+ *      each hook costs one function call.
+ */
+#ifndef APP_INC_TRACEHOOKS_H_
+#define APP_INC_TRACEHOOKS_H_
+
+#include "trace.h"
+#include "stm32f3xx.h"
+
+/* === exported macros === */
+/** store record with interrupts up to configMAX_SYSCALL_INTERRUPT_PRIORITY masked */
+#define TRACE_RECORD(type, id, arg)     do { \
+                                            if (trace_isRecording ()) \
+                                                { \
+                                                    UBaseType_t traceMask = portSET_INTERRUPT_MASK_FROM_ISR(); \
+                                                    trace_record (DWT->CYCCNT, (type), (uint8_t) (id), (uint16_t) (arg)); \
+                                                    portCLEAR_INTERRUPT_MASK_FROM_ISR(traceMask); \
+                                                } \
+                                        } while (0)
+
+#define TRACE_IRQ_ENTER(irq)            TRACE_RECORD(TRACE_ISR_ENTER, (irq), 0)
+#define TRACE_IRQ_EXIT(irq)             TRACE_RECORD(TRACE_ISR_EXIT, (irq), 0)
+#define TRACE_CLOCK_CHANGED(hz)         TRACE_RECORD(TRACE_CLOCK, 0, (hz) / 1000000UL)
+
+/* === kernel hooks === */
+#define traceTASK_SWITCHED_IN()         TRACE_RECORD(TRACE_TASK_IN, pxCurrentTCB->uxTCBNumber, 0)
+#define traceTASK_SWITCHED_OUT()        TRACE_RECORD(TRACE_TASK_OUT, pxCurrentTCB->uxTCBNumber, 0)
+#define traceQUEUE_SEND(q)              TRACE_RECORD(TRACE_QUEUE_SEND, (q)->uxQueueNumber, (q)->uxMessagesWaiting)
+#define traceQUEUE_SEND_FROM_ISR(q)     TRACE_RECORD(TRACE_QUEUE_SEND_FROM_ISR, (q)->uxQueueNumber, (q)->uxMessagesWaiting)
+#define traceQUEUE_RECEIVE(q)           TRACE_RECORD(TRACE_QUEUE_RECEIVE, (q)->uxQueueNumber, (q)->uxMessagesWaiting)
+#define traceQUEUE_RECEIVE_FROM_ISR(q)  TRACE_RECORD(TRACE_QUEUE_RECEIVE_FROM_ISR, (q)->uxQueueNumber, (q)->uxMessagesWaiting)
+#define traceBLOCKING_ON_QUEUE_SEND(q)  TRACE_RECORD(TRACE_QUEUE_BLOCK_SEND, (q)->uxQueueNumber, (q)->uxMessagesWaiting)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(q) TRACE_RECORD(TRACE_QUEUE_BLOCK_RECEIVE, (q)->uxQueueNumber, (q)->uxMessagesWaiting)
+
+#endif /* APP_INC_TRACEHOOKS_H_ */
@@ -13,5 +13,11 @@
 /** UART initialisation function */
 void UART_Init(UART_HandleTypeDef* huart);
 
+/** Recalculate baud rate divider after PCLK1 change, call when transmission is finished */
+void UART_updateBaudRate(UART_HandleTypeDef* huart);
+
+/** Called from USART interrupt when RX line becomes idle after a frame, to be implemented by user */
+void UART_IdleCallback(UART_HandleTypeDef* huart);
+
 
 #endif /* APP_INC_UART_H_ */
@@ -0,0 +1,290 @@
+/*
+ * capture.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "capture.h"
+#include <stdlib.h>
+
+/* === private defines === */
+#define RING_LEN                        (CAPTURE_PRE_SAMPLES + CAPTURE_POST_SAMPLES)    // after post samples the ring still holds pre samples
+#define AXES                            3
+
+/* === private types === */
+enum State
+{
+    STATE_OFF,                                                                  /// capture disabled
+    STATE_IDLE,                                                                 /// enabled, waiting for arm
+    STATE_ARMED,                                                                /// storing samples, waiting for trigger
+    STATE_TRIGGERED,                                                            /// collecting post trigger samples
+    STATE_FROZEN                                                                /// frame ready for readout
+};
+
+/* === private variables === */
+static struct Base
+{
+    enum State state;
+    uint8_t sensorIdx;
+    enum capture_Trigger trigger;
+    uint16_t thresholdMg;
+    uint32_t rateMilliHz;
+    int16_t ring[RING_LEN][AXES];
+    uint16_t head;                                                              /// next ring index to write
+    uint16_t filled;                                                            /// samples stored since arm, up to RING_LEN
+    uint16_t preSamples;                                                        /// samples before trigger in current capture
+    uint16_t postLeft;                                                          /// post trigger samples still to collect
+    uint8_t header[CAPTURE_HEADER_SIZE];                                        /// header of frozen frame
+    uint16_t frameStart;                                                        /// ring index of first frame sample
+    uint16_t frameSize;
+    uint16_t readPos;                                                           /// next frame byte to read
+    uint16_t readSum;                                                           /// checksum of bytes read so far
+    struct capture_Stats stats;
+} base;
+
+/* === private functions === */
+static uint8_t*
+put16 (uint8_t *dst, uint16_t value)
+{
+    *dst++ = value & 0xFF;
+    *dst++ = value >> 8;
+    return dst;
+}
+
+static uint8_t*
+put32 (uint8_t *dst, uint32_t value)
+{
+    dst = put16 (dst, value & 0xFFFF);
+    return put16 (dst, value >> 16);
+}
+
+static uint16_t
+get16 (const uint8_t *src)
+{
+    return src[0] | (src[1] << 8);
+}
+
+static uint32_t
+get32 (const uint8_t *src)
+{
+    return get16 (src) | ((uint32_t) get16 (src + 2) << 16);
+}
+
+static void
+startTrigger (enum capture_Trigger trigger)
+{
+    if (STATE_ARMED != base.state)
+        {
+            base.stats.missedTriggers++;
+            return;
+        }
+    base.preSamples =
+            base.filled < CAPTURE_PRE_SAMPLES ?
+                    base.filled : CAPTURE_PRE_SAMPLES;
+    base.postLeft = CAPTURE_POST_SAMPLES;
+    base.trigger = trigger;
+    base.state = STATE_TRIGGERED;
+}
+
+/* Serialise header and mark frame ready for readout */
+static void
+freeze ()
+{
+    uint16_t numOfSamples = base.preSamples + CAPTURE_POST_SAMPLES;
+    uint8_t *h = put16 (base.header, CAPTURE_SYNC);
+
+    *h++ = CAPTURE_VERSION;
+    *h++ = base.trigger;
+    *h++ = base.sensorIdx;
+    *h++ = 0;
+    h = put16 (h, base.preSamples);
+    h = put16 (h, CAPTURE_POST_SAMPLES);
+    h = put16 (h, base.thresholdMg);
+    h = put32 (h, base.rateMilliHz);
+    put32 (h, base.stats.frames);
+
+    base.frameStart = (base.head + RING_LEN - numOfSamples) % RING_LEN;
+    base.frameSize = CAPTURE_HEADER_SIZE + numOfSamples * CAPTURE_SAMPLE_SIZE
+            + CAPTURE_CHECKSUM_SIZE;
+    base.readPos = 0;
+    base.readSum = 0;
+    base.stats.frames++;
+    base.state = STATE_FROZEN;
+}
+
+/* Byte of frozen frame at given position, checksum excluded */
+static uint8_t
+frameByte (uint16_t pos)
+{
+    if (pos < CAPTURE_HEADER_SIZE)
+        {
+            return base.header[pos];
+        }
+    pos -= CAPTURE_HEADER_SIZE;
+    uint16_t idx = (base.frameStart + pos / CAPTURE_SAMPLE_SIZE) % RING_LEN;
+    uint8_t field = pos % CAPTURE_SAMPLE_SIZE;
+    uint16_t value = (uint16_t) base.ring[idx][field / 2];
+    return (field & 1) ? value >> 8 : value & 0xFF;
+}
+
+/* === exported functions === */
+void
+capture_enable (uint8_t sensorIdx, enum capture_Trigger trigger,
+                uint16_t thresholdMg)
+{
+    base.sensorIdx = sensorIdx;
+    base.trigger = trigger;
+    base.thresholdMg = thresholdMg;
+    base.state = STATE_IDLE;
+}
+
+void
+capture_disable (void)
+{
+    base.state = STATE_OFF;
+}
+
+bool
+capture_isEnabled (void)
+{
+    return STATE_OFF != base.state;
+}
+
+void
+capture_getSetup (uint8_t *sensorIdx, enum capture_Trigger *trigger,
+                  uint16_t *thresholdMg)
+{
+    *sensorIdx = base.sensorIdx;
+    *trigger = base.trigger;
+    *thresholdMg = base.thresholdMg;
+}
+
+void
+capture_arm (uint32_t rateMilliHz)
+{
+    if (STATE_OFF == base.state)
+        {
+            return;
+        }
+    base.rateMilliHz = rateMilliHz;
+    base.head = 0;
+    base.filled = 0;
+    base.state = STATE_ARMED;
+}
+
+bool
+capture_addSample (uint8_t sensorIdx, int16_t x, int16_t y, int16_t z)
+{
+    if (sensorIdx != base.sensorIdx
+            || (STATE_ARMED != base.state && STATE_TRIGGERED != base.state))
+        {
+            return false;
+        }
+
+    /* sample which reaches threshold is the first post trigger sample */
+    if (CAPTURE_TRIGGER_THRESHOLD == base.trigger)
+        {
+            if (abs (x) >= base.thresholdMg || abs (y) >= base.thresholdMg
+                    || abs (z) >= base.thresholdMg)
+                {
+                    startTrigger (CAPTURE_TRIGGER_THRESHOLD);
+                }
+        }
+
+    base.ring[base.head][0] = x;
+    base.ring[base.head][1] = y;
+    base.ring[base.head][2] = z;
+    base.head = (base.head + 1) % RING_LEN;
+    if (base.filled < RING_LEN)
+        {
+            base.filled++;
+        }
+
+    if (STATE_TRIGGERED == base.state && 0 == --base.postLeft)
+        {
+            freeze ();
+            return true;
+        }
+    return false;
+}
+
+void
+capture_onClick (uint8_t sensorIdx)
+{
+    if (sensorIdx == base.sensorIdx && CAPTURE_TRIGGER_CLICK == base.trigger
+            && STATE_OFF != base.state && STATE_IDLE != base.state)
+        {
+            startTrigger (CAPTURE_TRIGGER_CLICK);
+        }
+}
+
+uint16_t
+capture_readFrame (uint8_t *dst, uint16_t len)
+{
+    uint16_t n = 0;
+
+    if (STATE_FROZEN != base.state)
+        {
+            return 0;
+        }
+    while (n < len && base.readPos < base.frameSize)
+        {
+            if (base.readPos < base.frameSize - CAPTURE_CHECKSUM_SIZE)
+                {
+                    dst[n] = frameByte (base.readPos);
+                    base.readSum = capture_checksum (base.readSum, &dst[n], 1);
+                }
+            else
+                {
+                    dst[n] = base.readPos
+                            == base.frameSize - CAPTURE_CHECKSUM_SIZE ?
+                            base.readSum & 0xFF : base.readSum >> 8;
+                }
+            n++;
+            base.readPos++;
+        }
+
+    /* samples which arrived during readout are lost, start with empty ring */
+    if (base.readPos == base.frameSize)
+        {
+            base.head = 0;
+            base.filled = 0;
+            base.state = STATE_ARMED;
+        }
+    return n;
+}
+
+const struct capture_Stats*
+capture_getStats (void)
+{
+    return &base.stats;
+}
+
+bool
+capture_decodeHeader (const uint8_t *src, struct capture_FrameHeader *header)
+{
+    header->sync = get16 (src);
+    header->version = src[2];
+    header->trigger = src[3];
+    header->sensorIdx = src[4];
+    header->reserved = src[5];
+    header->preSamples = get16 (src + 6);
+    header->postSamples = get16 (src + 8);
+    header->thresholdMg = get16 (src + 10);
+    header->rateMilliHz = get32 (src + 12);
+    header->sequence = get32 (src + 16);
+    return CAPTURE_SYNC == header->sync && CAPTURE_VERSION == header->version;
+}
+
+uint16_t
+capture_checksum (uint16_t sum, const uint8_t *data, uint32_t len)
+{
+    uint16_t sum1 = sum & 0xFF, sum2 = sum >> 8;
+
+    while (len--)
+        {
+            sum1 = (sum1 + *data++) % 255;
+            sum2 = (sum2 + sum1) % 255;
+        }
+    return (sum2 << 8) | sum1;
+}
@@ -12,12 +12,17 @@
 #include "cli.h"
 #include "uart.h"
 #include <stdint.h>
+#include <stdbool.h>
 #include "string.h"
 #include "stm32f3xx.h"
 #include <stdio.h>
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
+#include "systime.h"
+#include "timebase.h"
+#include "fmt.h"
+#include "pipeline.h"
 
 /* === private macros === */
 #define PRINT(S, ...) do { \
@@ -27,18 +32,240 @@
 
 /* === private defines === */
 #define RECEIVED_BUFF_LEN                   30
+#define RX_DMA_BUFF_LEN                     256                                 // holds input pasted while main_task executes commands
+#define LINE_FEED                           '\n'
+#define TOO_LONG_MSG                        "\n\rCommand too long.\n\r>>"
+#define SYNC_REQUEST                        "sync "
+#define SYNC_REPLY_PREFIX                   "sync "
+#define SYNC_TURNAROUND_DIGITS              6
+#define SYNC_TURNAROUND_MAX_US              999999UL
+#define US_PER_S                            1000000UL
+#define NO_IDLE_HEAD                        RX_DMA_BUFF_LEN
 
 /* === private variables === */
 static struct cli
 {
     UART_HandleTypeDef *huart;
     QueueHandle_t txQueue;
+    QueueHandle_t eventQueue;                                                   // event lines, served before txQueue
+    QueueSetHandle_t txSet;                                                     // txQueue and eventQueue
     QueueHandle_t rxQueue;
+    TaskHandle_t rxTask;                                                        // notified on new received data
+    TaskHandle_t txTask;                                                        // notified on transmission end
+    struct CLI_EventItem eventItem;                                             // event line in transmission
+    struct CLI_LatencyStats latency;
+    uint64_t latencySumUs;
     char transmitBuff[CLI_MAX_LINE_LEN];
     char receivedBuff[CLI_MAX_LINE_LEN];
     uint8_t receivedIndex;
+    uint8_t rxDmaBuff[RX_DMA_BUFF_LEN];                                         // written by DMA in circular mode
+    uint16_t rxTail;                                                            // next byte of rxDmaBuff to process
+    volatile bool rxRestarted;                                                  // reception restarted after UART error
+    volatile uint64_t idleUs;                                                   // device time of last idle line interrupt
+    volatile uint16_t idleHead;                                                 // rxDmaBuff position at idleUs
+    bool syncLine;                                                              // line started with CLI_SYNC_MARK
+    char echoBuff[CLI_MAX_LINE_LEN];                                            // echo sent as one TX queue item
+    uint8_t echoLen;
 } base;
 
+/* === private functions === */
+/* Start circular DMA reception with idle line interrupt */
+static void
+startReception ()
+{
+    HAL_UART_Receive_DMA (base.huart, base.rxDmaBuff, RX_DMA_BUFF_LEN);
+    __HAL_UART_CLEAR_IDLEFLAG(base.huart);
+    __HAL_UART_ENABLE_IT(base.huart, UART_IT_IDLE);
+}
+
+static void
+notifyRxTaskFromISR ()
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    if (base.rxTask != NULL)
+        {
+            vTaskNotifyGiveFromISR (base.rxTask, &higherPriorityTaskWoken);
+        }
+    portEND_SWITCHING_ISR(higherPriorityTaskWoken);
+}
+
+static void
+flushEcho ()
+{
+    if (base.echoLen > 0)
+        {
+            base.echoBuff[base.echoLen] = '\0';
+            xQueueSendToBack (base.txQueue, base.echoBuff, portMAX_DELAY);
+            base.echoLen = 0;
+        }
+}
+
+static void
+echo (const char *str)
+{
+    size_t len = strlen (str);
+    if (base.echoLen + len >= CLI_MAX_LINE_LEN)
+        {
+            flushEcho ();
+        }
+    memcpy (&base.echoBuff[base.echoLen], str, len);
+    base.echoLen += len;
+}
+
+/* Reply to time sync request, receive time is taken from idle line interrupt when the request
+ * ended right before it. Turnaround field is filled in by CLI_task right before transmission. */
+static void
+replySync ()
+{
+    struct CLI_EventItem item;
+    const char *token = &base.receivedBuff[sizeof(SYNC_REQUEST) - 1];
+    uint64_t rxUs = 0;
+    char *p;
+
+    base.receivedBuff[base.receivedIndex] = '\0';
+    if (0 != strncmp (base.receivedBuff, SYNC_REQUEST, sizeof(SYNC_REQUEST) - 1)
+            || strlen (token) == 0 || strlen (token) > CLI_SYNC_TOKEN_MAX_LEN)
+        {
+            return;
+        }
+    taskENTER_CRITICAL();
+    if ((base.rxTail + 1) % RX_DMA_BUFF_LEN == base.idleHead)
+        {
+            rxUs = base.idleUs;
+            base.idleHead = NO_IDLE_HEAD;
+        }
+    taskEXIT_CRITICAL();
+    rxUs = rxUs != 0 ? rxUs : timebase_getUs ();
+
+    p = fmt_str (item.line, SYNC_REPLY_PREFIX);
+    p = fmt_str (p, token);
+    *p++ = ' ';
+    p = fmt_uint (p, (uint32_t) (rxUs / US_PER_S));
+    *p++ = '.';
+    p = fmt_uintWidth (p, (uint32_t) (rxUs % US_PER_S), 6, '0');
+    *p++ = ' ';
+    item.syncFieldPos = p - item.line;
+    p = fmt_uintWidth (p, 0, SYNC_TURNAROUND_DIGITS, '0');
+    p = fmt_str (p, "\n\r");
+    *p = '\0';
+    item.syncRxUs = (uint32_t) rxUs;
+    item.originCycles = 0;
+    item.measured = false;
+    xQueueSendToBack (base.eventQueue, &item, portMAX_DELAY);
+}
+
+/* Line assembly of single received character */
+static void
+processChar (char c)
+{
+    char str[2] =
+        { c, '\0' };
+
+    if (c == BACKSPACE)
+        {
+            /* On BACKSPACE key, erase last character on terminal */
+            if (base.receivedIndex > 0)
+                {
+                    echo ("\b \b");
+                    base.receivedIndex--;
+                }
+        }
+    else if (c == CLI_SYNC_MARK)
+        {
+            /* sync request replaces partial line */
+            base.syncLine = true;
+            base.receivedIndex = 0;
+        }
+    else if (c == CLI_ENTER && base.syncLine)
+        {
+            replySync ();
+            base.syncLine = false;
+            base.receivedIndex = 0;
+        }
+    else if (c == CLI_ENTER)
+        {
+            /* If ENTER key press, send buffer to controller to decode */
+            echo ("\n\r");
+            flushEcho ();
+            base.receivedBuff[base.receivedIndex] = '\0';
+            xQueueSendToBack (base.rxQueue, base.receivedBuff, portMAX_DELAY);
+            base.receivedIndex = 0;
+        }
+    else if (c == LINE_FEED)
+        {
+            /* CR LF line endings of pasted scripts */
+        }
+    else if (base.receivedIndex < CLI_MAX_LINE_LEN - 1)
+        {
+            /* Print received character and store it in the buffer, last byte is left for '\0' */
+            if (!base.syncLine)
+                {
+                    echo (str);
+                }
+            base.receivedBuff[base.receivedIndex++] = c;
+        }
+    else
+        {
+            /* If message too long */
+            flushEcho ();
+            base.receivedIndex = 0;
+            if (!base.syncLine)
+                {
+                    xQueueSendToBack (base.txQueue, TOO_LONG_MSG,
+                                      portMAX_DELAY);
+                }
+            base.syncLine = false;
+        }
+}
+
+/* Process everything DMA has written since last call */
+static void
+processReceived ()
+{
+    if (base.rxRestarted)
+        {
+            base.rxRestarted = false;
+            base.rxTail = 0;
+            base.receivedIndex = 0;
+        }
+
+    uint16_t head = RX_DMA_BUFF_LEN
+            - __HAL_DMA_GET_COUNTER(base.huart->hdmarx);
+    if (head == RX_DMA_BUFF_LEN)
+        {
+            head = 0;
+        }
+    while (base.rxTail != head)
+        {
+            processChar (base.rxDmaBuff[base.rxTail]);
+            base.rxTail = (base.rxTail + 1) % RX_DMA_BUFF_LEN;
+        }
+    flushEcho ();
+}
+
+/* Transmit and block until last byte is out */
+static void
+transmit (uint8_t *data, uint16_t len)
+{
+    if (HAL_OK == HAL_UART_Transmit_DMA (base.huart, data, len))
+        {
+            ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+        }
+}
+
+static void
+recordLatency (uint32_t originCycles)
+{
+    uint32_t us = systime_cyclesToUs (systime_getCycles () - originCycles);
+
+    taskENTER_CRITICAL();
+    base.latency.count++;
+    base.latency.lastUs = us;
+    base.latency.maxUs = us > base.latency.maxUs ? us : base.latency.maxUs;
+    base.latencySumUs += us;
+    taskEXIT_CRITICAL();
+}
+
 /* === exported functions === */
 void
 CLI_init (QueueHandle_t txQueue, QueueHandle_t rxQueue,
@@ -53,84 +280,177 @@ CLI_init (QueueHandle_t txQueue, QueueHandle_t rxQueue,
 
     base.txQueue = txQueue;
     base.rxQueue = rxQueue;
+    base.eventQueue = xQueueCreate(CLI_EVENT_QUEUE_LEN,
+                                   sizeof(struct CLI_EventItem));
+    assert_param(base.eventQueue);
+    vQueueSetQueueNumber (base.eventQueue, TRACE_QUEUE_CLI_EVENT);
+
+    /* set holds one handle per queued item, TX queue is empty so its free space is its length */
+    base.txSet = xQueueCreateSet (
+            uxQueueSpacesAvailable (txQueue) + CLI_EVENT_QUEUE_LEN);
+    assert_param(base.txSet);
+    xQueueAddToSet (base.txQueue, base.txSet);
+    xQueueAddToSet (base.eventQueue, base.txSet);
+    CLI_resetEventLatency ();
     base.receivedIndex = 0;
+    base.rxTail = 0;
+    base.idleHead = NO_IDLE_HEAD;
 
-    /* Start character receiving using IT. */
-    HAL_UART_Receive_IT (base.huart, (uint8_t*) &base.receivedBuff[0], 1);
+    /* Start character receiving using DMA, bytes are processed by CLI_rxTask. */
+    startReception ();
 }
 
 void
-CLI_task (void *params)
+CLI_sendEvent (const char *line, uint32_t originCycles, bool measured)
 {
-    UNUSED(params);
+    struct CLI_EventItem item;
 
-    while (1)
-        {
-            /* wait for uart ready */
-            while (HAL_UART_STATE_READY != base.huart->gState)
-                {
-                    vTaskDelay (10 / portTICK_RATE_MS);
-                }
-            xQueueReceive (base.txQueue, base.transmitBuff, portMAX_DELAY);
-            HAL_UART_Transmit_DMA (
-                    base.huart, base.transmitBuff,
-                    strnlen ((char*) base.transmitBuff, CLI_MAX_LINE_LEN));
-        }
+    strncpy (item.line, line, CLI_MAX_LINE_LEN - 1);
+    item.line[CLI_MAX_LINE_LEN - 1] = '\0';
+    item.originCycles = originCycles;
+    item.measured = measured;
+    item.syncFieldPos = 0;
+    xQueueSendToBack (base.eventQueue, &item, portMAX_DELAY);
 }
 
-/* === callbacks === */
 void
-HAL_UART_RxCpltCallback (UART_HandleTypeDef *huart)
+CLI_getEventLatency (struct CLI_LatencyStats *stats)
 {
+    taskENTER_CRITICAL();
+    *stats = base.latency;
+    stats->avgUs = base.latency.count == 0 ?
+            0 : (uint32_t) (base.latencySumUs / base.latency.count);
+    taskEXIT_CRITICAL();
+}
 
-    BaseType_t higherPriorityTaskWoken = pdFALSE;
-    if (huart == base.huart)
+void
+CLI_resetEventLatency (void)
+{
+    taskENTER_CRITICAL();
+    memset (&base.latency, 0, sizeof(base.latency));
+    base.latencySumUs = 0;
+    taskEXIT_CRITICAL();
+}
+
+void
+CLI_task (void *params)
+{
+    UNUSED(params);
+
+    base.txTask = xTaskGetCurrentTaskHandle ();
+    while (1)
         {
-            /* On BACKSPACE key, put "\b \b" in transmit queue*/
-            if (base.receivedBuff[base.receivedIndex] == BACKSPACE)
+            /* one item is taken per selected handle, so set and queues stay in step while event
+             * lane is always served first */
+            xQueueSelectFromSet (base.txSet, portMAX_DELAY);
+            uint32_t start = pipeline_beginItem (
+                    PIPELINE_TRANSMIT,
+                    uxQueueMessagesWaiting (base.txQueue)
+                            + uxQueueMessagesWaiting (base.eventQueue));
+            if (pdTRUE == xQueueReceive (base.eventQueue, &base.eventItem, 0))
                 {
-                    if (base.receivedIndex > 0)
+                    if (base.eventItem.syncFieldPos != 0)
                         {
-
-                            xQueueSendToBackFromISR(base.txQueue, "\b \b",
-                                                    &higherPriorityTaskWoken);
-                            base.receivedIndex--;
+                            uint32_t turnaroundUs = (uint32_t) timebase_getUs ()
+                                    - base.eventItem.syncRxUs;
+                            fmt_uintWidth (
+                                    &base.eventItem.line[base.eventItem.syncFieldPos],
+                                    turnaroundUs < SYNC_TURNAROUND_MAX_US ?
+                                            turnaroundUs : SYNC_TURNAROUND_MAX_US,
+                                    SYNC_TURNAROUND_DIGITS, '0');
+                        }
+                    transmit ((uint8_t*) base.eventItem.line,
+                              strnlen (base.eventItem.line, CLI_MAX_LINE_LEN));
+                    if (base.eventItem.measured)
+                        {
+                            recordLatency (base.eventItem.originCycles);
                         }
-                    /* If ENTER key press, send buffer to controller to decode*/
-                }
-            else if (base.receivedBuff[base.receivedIndex] == CLI_ENTER)
-                {
-                    xQueueSendToBackFromISR(base.txQueue, "\n\r",
-                                            &higherPriorityTaskWoken);
-                    base.receivedBuff[base.receivedIndex] = '\0';
-                    xQueueSendToBackFromISR(base.rxQueue, base.receivedBuff,
-                                            &higherPriorityTaskWoken);
-
-                    base.receivedIndex = 0;
-                    /* Print received character and store it in the buffer. */
                 }
-            else
+            else if (pdTRUE
+                    == xQueueReceive (base.txQueue, base.transmitBuff, 0))
                 {
-                    HAL_UART_Transmit_IT (
-                            base.huart,
-                            (uint8_t*) &base.receivedBuff[base.receivedIndex],
-                            1);
-                    if (base.receivedIndex < CLI_MAX_LINE_LEN)
+                    if (CLI_BIN_ITEM_MARK == base.transmitBuff[0])
                         {
-                            base.receivedIndex++;
+                            transmit ((uint8_t*) &base.transmitBuff[2],
+                                      (uint8_t) base.transmitBuff[1]);
                         }
                     else
                         {
-                            /* If message too long */
-                            base.receivedIndex = 0;
-                            xQueueSendToBackFromISR(
-                                    base.txQueue, "\n\rCommand too long.\n\r>>",
-                                    &higherPriorityTaskWoken);
+                            transmit ((uint8_t*) base.transmitBuff,
+                                      strnlen ((char*) base.transmitBuff,
+                                               CLI_MAX_LINE_LEN));
                         }
                 }
-            HAL_UART_Receive_IT (
-                    base.huart,
-                    (uint8_t*) &base.receivedBuff[base.receivedIndex], 1);
-            portEND_SWITCHING_ISR(higherPriorityTaskWoken);
+            pipeline_endItem (PIPELINE_TRANSMIT, start);
+        }
+}
+
+void
+CLI_rxTask (void *params)
+{
+    UNUSED(params);
+
+    base.rxTask = xTaskGetCurrentTaskHandle ();
+    while (1)
+        {
+            processReceived ();
+            /* wait for idle line, half or full buffer */
+            ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+        }
+}
+
+/* === callbacks === */
+void
+HAL_UART_TxCpltCallback (UART_HandleTypeDef *huart)
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    if (huart == base.huart && base.txTask != NULL)
+        {
+            vTaskNotifyGiveFromISR (base.txTask, &higherPriorityTaskWoken);
+        }
+    portEND_SWITCHING_ISR(higherPriorityTaskWoken);
+}
+
+void
+UART_IdleCallback (UART_HandleTypeDef *huart)
+{
+    if (huart == base.huart)
+        {
+            /* time of line end for sync requests */
+            base.idleUs = timebase_getUsFromISR ();
+            base.idleHead = (RX_DMA_BUFF_LEN
+                    - __HAL_DMA_GET_COUNTER(base.huart->hdmarx)) % RX_DMA_BUFF_LEN;
+            notifyRxTaskFromISR ();
+        }
+}
+
+void
+HAL_UART_RxHalfCpltCallback (UART_HandleTypeDef *huart)
+{
+    if (huart == base.huart)
+        {
+            notifyRxTaskFromISR ();
+        }
+}
+
+void
+HAL_UART_RxCpltCallback (UART_HandleTypeDef *huart)
+{
+    /* circular mode, reception continues from the buffer start */
+    if (huart == base.huart)
+        {
+            notifyRxTaskFromISR ();
+        }
+}
+
+void
+HAL_UART_ErrorCallback (UART_HandleTypeDef *huart)
+{
+    /* overrun, noise or framing error stop DMA reception, start it again */
+    if (huart == base.huart && huart->RxState == HAL_UART_STATE_READY)
+        {
+            base.rxRestarted = true;
+            startReception ();
+            notifyRxTaskFromISR ();
         }
 }
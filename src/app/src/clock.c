@@ -0,0 +1,208 @@
+/*
+ * clock.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "clock.h"
+#include "main.h"
+#include "uart.h"
+#include "i2c.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* === private defines === */
+#define GOVERNOR_MAX_LOAD_PERCENT       60                                      // headroom for bursts and CLI
+
+/* === private types === */
+struct LevelConfig
+{
+    uint32_t hz;                                                                /// SYSCLK
+    uint32_t pllMul;                                                            /// PLL multiplier of 8 MHz HSE, 0 if PLL is off
+    uint32_t flashLatency;                                                      /// flash wait states
+    uint32_t apb1Divider;                                                       /// keeps PCLK1 at or below 36 MHz
+};
+
+/* === private variables === */
+static const struct LevelConfig levels[CLOCK_LEVEL_COUNT] =
+    {
+        { 8000000, 0, FLASH_LATENCY_0, RCC_HCLK_DIV1 },
+        { 24000000, RCC_PLL_MUL3, FLASH_LATENCY_0, RCC_HCLK_DIV1 },
+        { 48000000, RCC_PLL_MUL6, FLASH_LATENCY_1, RCC_HCLK_DIV2 },
+        { 72000000, RCC_PLL_MUL9, FLASH_LATENCY_2, RCC_HCLK_DIV2 } };
+
+static struct Base
+{
+    UART_HandleTypeDef *huart;
+    enum clock_Level level;
+    uint32_t switches;
+} base;
+
+/* === private functions === */
+/* Return with scheduler suspended once UART transmission has ended */
+static void
+waitForQuiescentWindow ()
+{
+    while (1)
+        {
+            vTaskSuspendAll ();
+            if (HAL_UART_STATE_READY == base.huart->gState)
+                {
+                    return;
+                }
+            xTaskResumeAll ();
+            vTaskDelay (1);
+        }
+}
+
+static void
+switchClock (const struct LevelConfig *config)
+{
+    RCC_ClkInitTypeDef clkInit =
+        { 0 };
+    clkInit.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_PCLK1
+            | RCC_CLOCKTYPE_PCLK2 | RCC_CLOCKTYPE_SYSCLK;
+    clkInit.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    clkInit.APB2CLKDivider = RCC_HCLK_DIV1;
+
+    /* PLL can be reconfigured only when it does not drive SYSCLK */
+    if (RCC_SYSCLKSOURCE_STATUS_PLLCLK == __HAL_RCC_GET_SYSCLK_SOURCE())
+        {
+            clkInit.SYSCLKSource = RCC_SYSCLKSOURCE_HSE;
+            clkInit.APB1CLKDivider = RCC_HCLK_DIV1;
+            if (HAL_OK
+                    != HAL_RCC_ClockConfig (&clkInit,
+                                            __HAL_FLASH_GET_LATENCY()))
+                {
+                    errorHandler ();
+                }
+        }
+
+    RCC_OscInitTypeDef oscInit =
+        { 0 };
+    oscInit.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+    if (config->pllMul != 0)
+        {
+            oscInit.HSEPredivValue = RCC_HSE_PREDIV_DIV1;
+            oscInit.PLL.PLLState = RCC_PLL_ON;
+            oscInit.PLL.PLLSource = RCC_PLLSOURCE_HSE;
+            oscInit.PLL.PLLMUL = config->pllMul;
+        }
+    else
+        {
+            oscInit.PLL.PLLState = RCC_PLL_OFF;
+        }
+    if (HAL_OK != HAL_RCC_OscConfig (&oscInit))
+        {
+            errorHandler ();
+        }
+
+    clkInit.SYSCLKSource =
+            config->pllMul != 0 ? RCC_SYSCLKSOURCE_PLLCLK : RCC_SYSCLKSOURCE_HSE;
+    clkInit.APB1CLKDivider = config->apb1Divider;
+    if (HAL_OK != HAL_RCC_ClockConfig (&clkInit, config->flashLatency))
+        {
+            errorHandler ();
+        }
+}
+
+/* === exported functions === */
+void
+clock_init (UART_HandleTypeDef *huart)
+{
+    assert_param(huart);
+
+    base.huart = huart;
+    base.level = CLOCK_LEVEL_8MHZ;
+    base.switches = 0;
+}
+
+void
+clock_setLevel (enum clock_Level level)
+{
+    assert_param(level < CLOCK_LEVEL_COUNT);
+
+    if (level == base.level)
+        {
+            return;
+        }
+
+    waitForQuiescentWindow ();
+    taskENTER_CRITICAL();
+    switchClock (&levels[level]);
+
+    /* HAL reprograms SysTick for its own tick, set FreeRTOS tick period explicitly */
+    SysTick->LOAD = SystemCoreClock / configTICK_RATE_HZ - 1;
+    SysTick->VAL = 0;
+    UART_updateBaudRate (base.huart);
+    I2C_updateTiming ();
+
+    base.level = level;
+    base.switches++;
+    TRACE_CLOCK_CHANGED(SystemCoreClock);
+    taskEXIT_CRITICAL();
+    xTaskResumeAll ();
+}
+
+enum clock_Level
+clock_getLevel (void)
+{
+    return base.level;
+}
+
+uint32_t
+clock_getLevelHz (enum clock_Level level)
+{
+    assert_param(level < CLOCK_LEVEL_COUNT);
+
+    return levels[level].hz;
+}
+
+enum clock_Level
+clock_levelForLoad (uint32_t cyclesPerSecond)
+{
+    for (uint8_t level = 0; level < CLOCK_LEVEL_COUNT - 1; level++)
+        {
+            if ((uint64_t) cyclesPerSecond * 100
+                    <= (uint64_t) levels[level].hz * GOVERNOR_MAX_LOAD_PERCENT)
+                {
+                    return level;
+                }
+        }
+    return CLOCK_LEVEL_COUNT - 1;
+}
+
+uint32_t
+clock_getNumOfSwitches (void)
+{
+    return base.switches;
+}
+
+void
+clock_restoreAfterStop (void)
+{
+    /* MCU wakes up on HSI, PLL multiplier and bus dividers are kept */
+    RCC->CR |= RCC_CR_HSEON;
+    while (0 == (RCC->CR & RCC_CR_HSERDY))
+        {
+        }
+    if (levels[base.level].pllMul != 0)
+        {
+            RCC->CR |= RCC_CR_PLLON;
+            while (0 == (RCC->CR & RCC_CR_PLLRDY))
+                {
+                }
+            MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_PLL);
+            while (RCC_CFGR_SWS_PLL != (RCC->CFGR & RCC_CFGR_SWS))
+                {
+                }
+        }
+    else
+        {
+            MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_HSE);
+            while (RCC_CFGR_SWS_HSE != (RCC->CFGR & RCC_CFGR_SWS))
+                {
+                }
+        }
+    RCC->CR &= ~RCC_CR_HSION;
+}
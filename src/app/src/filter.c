@@ -0,0 +1,315 @@
+/*
+ * filter.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "filter.h"
+#include <math.h>
+#include <stddef.h>
+
+/* === private defines === */
+#define ONE_Q30                         (1L << FILTER_COEF_FRAC_BITS)
+#define EMA_FRAC_MASK                   ((1L << FILTER_EMA_FRAC_BITS) - 1)
+#define BUTTERWORTH_Q                   0.70710678118654752
+#define PI                              3.14159265358979323846
+#define SIGNAL_MAX                      ((int32_t) INT16_MAX << FILTER_FRAC_BITS)
+#define SIGNAL_MIN                      (-SIGNAL_MAX - (1L << FILTER_FRAC_BITS))
+#define CUTOFF_MAX_PERCENT              45                                      /// of sample rate, poles too close to z = -1 above
+
+/* === private functions === */
+static int32_t
+saturate (int64_t value)
+{
+    return value > SIGNAL_MAX ? SIGNAL_MAX :
+           (value < SIGNAL_MIN ? SIGNAL_MIN : (int32_t) value);
+}
+
+static int16_t
+toMilliG (int32_t value)
+{
+    return (value + (1 << (FILTER_FRAC_BITS - 1))) >> FILTER_FRAC_BITS;
+}
+
+/* Ring index k samples before head */
+static uint16_t
+maIndex (const struct filter_Axis *axis, uint16_t k)
+{
+    return axis->maHead >= k ?
+            axis->maHead - k : axis->maHead + FILTER_MA_MAX_LEN - k;
+}
+
+/* Move moving average window start, only samples between old and new start are touched */
+static void
+resizeMovingAvg (struct filter_Axis *axis, uint16_t oldLen, uint16_t newLen)
+{
+    uint16_t oldEff = axis->maFilled < oldLen ? axis->maFilled : oldLen;
+    uint16_t newEff = axis->maFilled < newLen ? axis->maFilled : newLen;
+
+    for (uint16_t k = oldEff + 1; k <= newEff; k++)
+        {
+            axis->maSum += axis->maRing[maIndex (axis, k)];
+        }
+    for (uint16_t k = newEff + 1; k <= oldEff; k++)
+        {
+            axis->maSum -= axis->maRing[maIndex (axis, k)];
+        }
+}
+
+/* Start stage in steady state for its last input */
+static void
+prime (struct filter_Axis *axis, uint8_t s, enum filter_Type type)
+{
+    int32_t level = axis->in[s];
+
+    axis->x2[s] = level;
+    axis->y1[s] = (FILTER_HIGH_PASS == type) ? 0 : level;
+    axis->y2[s] = axis->y1[s];
+    axis->err[s] = 0;
+    if (FILTER_MOVING_AVG == type)
+        {
+            /* window grows from the first sample on, so output starts at input */
+            axis->maHead = 0;
+            axis->maFilled = 0;
+            axis->maSum = 0;
+        }
+}
+
+/* Second order Butterworth, coefficients of RBJ audio EQ cookbook, designed once per setup */
+static bool
+design (struct filter_Stage *stage, uint32_t rateMilliHz)
+{
+    const struct filter_StageConfig *config = &stage->config;
+
+    if ((uint64_t) config->param * 1000 * 100
+            >= (uint64_t) rateMilliHz * CUTOFF_MAX_PERCENT || config->param == 0)
+        {
+            return false;
+        }
+    double w0 = 2.0 * PI * config->param * 1000.0 / rateMilliHz;
+    double alpha = sin (w0) / (2.0 * BUTTERWORTH_Q);
+    double oneMinusCos = 2.0 * sin (w0 / 2) * sin (w0 / 2);                    // no cancellation at low cutoff
+    double a0 = 1.0 + alpha;
+
+    stage->a1 = llround ((-2.0 + 2.0 * oneMinusCos) / a0 * ONE_Q30);
+    stage->a2 = llround ((1.0 - alpha) / a0 * ONE_Q30);
+    if (FILTER_LOW_PASS == config->type)
+        {
+            /* b1 takes quantisation error, so DC gain is exactly 1 */
+            stage->b0 = llround (oneMinusCos / 2.0 / a0 * ONE_Q30);
+            stage->b1 = ONE_Q30 + stage->a1 + stage->a2 - 2 * stage->b0;
+        }
+    else
+        {
+            /* b1 = -2 b0, so DC gain is exactly 0 */
+            stage->b0 = llround ((2.0 - oneMinusCos) / 2.0 / a0 * ONE_Q30);
+            stage->b1 = -2 * stage->b0;
+        }
+    stage->b2 = stage->b0;
+    return true;
+}
+
+/* Validate setup and derive coefficients into stage */
+static bool
+configure (const struct filter_Chain *chain, uint8_t s,
+           const struct filter_StageConfig *config, struct filter_Stage *stage)
+{
+    stage->config = *config;
+    switch (config->type)
+        {
+        case FILTER_NONE:
+            return true;
+        case FILTER_MOVING_AVG:
+            for (uint8_t other = 0; other < FILTER_MAX_STAGES; other++)
+                {
+                    if (other != s
+                            && FILTER_MOVING_AVG
+                                    == chain->stages[other].config.type)
+                        {
+                            return false;
+                        }
+                }
+            return config->param >= 1 && config->param <= FILTER_MA_MAX_LEN;
+        case FILTER_EMA:
+            stage->gain = ((2L << FILTER_EMA_FRAC_BITS) + config->param / 2)
+                    / (config->param + 1);
+            return config->param >= 1;
+        case FILTER_LOW_PASS:
+        case FILTER_HIGH_PASS:
+            return design (stage, chain->rateMilliHz);
+        default:
+            return false;
+        }
+}
+
+static int32_t
+movingAvg (struct filter_Axis *axis, uint16_t len, int32_t in)
+{
+    int16_t sample = toMilliG (in);
+
+    if (axis->maFilled >= len)
+        {
+            axis->maSum -= axis->maRing[maIndex (axis, len)];
+        }
+    axis->maRing[axis->maHead] = sample;
+    axis->maHead =
+            axis->maHead + 1 < FILTER_MA_MAX_LEN ? axis->maHead + 1 : 0;
+    if (axis->maFilled < FILTER_MA_MAX_LEN)
+        {
+            axis->maFilled++;
+        }
+    axis->maSum += sample;
+
+    /* sum * 2^FRAC / n without 64 bit division */
+    int32_t n = axis->maFilled < len ? axis->maFilled : len;
+    int32_t quot = axis->maSum / n;
+    int32_t rem = axis->maSum % n;
+    return quot * (1 << FILTER_FRAC_BITS) + rem * (1 << FILTER_FRAC_BITS) / n;
+}
+
+static int32_t
+ema (struct filter_Axis *axis, uint8_t s, int32_t gain, int32_t in)
+{
+    /* fraction below output resolution is carried to next sample, so there is no dead band */
+    int64_t acc = (int64_t) (in - axis->y1[s]) * gain + axis->err[s];
+    axis->y1[s] += (int32_t) (acc >> FILTER_EMA_FRAC_BITS);
+    axis->err[s] = (int32_t) (acc & EMA_FRAC_MASK);
+    return axis->y1[s];
+}
+
+static int32_t
+biquad (struct filter_Axis *axis, uint8_t s, const struct filter_Stage *stage,
+        int32_t in)
+{
+    /* direct form I with first order error feedback */
+    int64_t acc = (int64_t) stage->b0 * in + (int64_t) stage->b1 * axis->in[s]
+            + (int64_t) stage->b2 * axis->x2[s]
+            - (int64_t) stage->a1 * axis->y1[s]
+            - (int64_t) stage->a2 * axis->y2[s] + axis->err[s];
+    int32_t out = saturate (acc >> FILTER_COEF_FRAC_BITS);
+
+    axis->err[s] = (int32_t) (acc & (ONE_Q30 - 1));
+    axis->x2[s] = axis->in[s];
+    axis->y2[s] = axis->y1[s];
+    axis->y1[s] = out;
+    return out;
+}
+
+/* === exported functions === */
+void
+filter_init (struct filter_Chain *chain, uint32_t rateMilliHz)
+{
+    const struct filter_StageConfig none =
+        { FILTER_NONE, 0 };
+
+    chain->rateMilliHz = rateMilliHz;
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+        {
+            configure (chain, s, &none, &chain->stages[s]);
+        }
+    for (uint8_t a = 0; a < FILTER_AXES; a++)
+        {
+            struct filter_Axis *axis = &chain->axes[a];
+            axis->maHead = 0;
+            axis->maFilled = 0;
+            axis->maSum = 0;
+            for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+                {
+                    axis->in[s] = 0;
+                    prime (axis, s, FILTER_NONE);
+                }
+        }
+}
+
+bool
+filter_setStage (struct filter_Chain *chain, uint8_t stage,
+                 const struct filter_StageConfig *config)
+{
+    struct filter_Stage next;
+
+    if (stage >= FILTER_MAX_STAGES || !configure (chain, stage, config, &next))
+        {
+            return false;
+        }
+
+    enum filter_Type type = chain->stages[stage].config.type;
+    for (uint8_t a = 0; a < FILTER_AXES; a++)
+        {
+            if (type != config->type)
+                {
+                    prime (&chain->axes[a], stage, config->type);
+                }
+            else if (FILTER_MOVING_AVG == type)
+                {
+                    resizeMovingAvg (&chain->axes[a],
+                                     chain->stages[stage].config.param,
+                                     config->param);
+                }
+        }
+    chain->stages[stage] = next;
+    return true;
+}
+
+bool
+filter_checkStage (const struct filter_Chain *chain, uint8_t stage,
+                   const struct filter_StageConfig *config)
+{
+    struct filter_Stage next;
+
+    return stage < FILTER_MAX_STAGES && configure (chain, stage, config, &next);
+}
+
+bool
+filter_setRate (struct filter_Chain *chain, uint32_t rateMilliHz)
+{
+    const struct filter_StageConfig none =
+        { FILTER_NONE, 0 };
+    bool valid = true;
+
+    chain->rateMilliHz = rateMilliHz;
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+        {
+            enum filter_Type type = chain->stages[s].config.type;
+            if ((FILTER_LOW_PASS == type || FILTER_HIGH_PASS == type)
+                    && !design (&chain->stages[s], rateMilliHz))
+                {
+                    filter_setStage (chain, s, &none);
+                    valid = false;
+                }
+        }
+    return valid;
+}
+
+void
+filter_process (struct filter_Chain *chain, int16_t xyz[FILTER_AXES])
+{
+    for (uint8_t a = 0; a < FILTER_AXES; a++)
+        {
+            struct filter_Axis *axis = &chain->axes[a];
+            int32_t value = xyz[a] * (1 << FILTER_FRAC_BITS);
+
+            for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+                {
+                    const struct filter_Stage *stage = &chain->stages[s];
+                    int32_t in = value;
+                    switch (stage->config.type)
+                        {
+                        case FILTER_MOVING_AVG:
+                            value = movingAvg (axis, stage->config.param, in);
+                            break;
+                        case FILTER_EMA:
+                            value = ema (axis, s, stage->gain, in);
+                            break;
+                        case FILTER_LOW_PASS:
+                        case FILTER_HIGH_PASS:
+                            value = biquad (axis, s, stage, in);
+                            break;
+                        case FILTER_NONE:
+                        default:
+                            break;
+                        }
+                    axis->in[s] = in;
+                }
+            xyz[a] = toMilliG (value);
+        }
+}
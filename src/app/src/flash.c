@@ -0,0 +1,58 @@
+/*
+ * flash.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "flash.h"
+#include "stm32f3xx_hal.h"
+
+/* === private functions === */
+static bool
+erasePage (uint8_t page)
+{
+    FLASH_EraseInitTypeDef erase =
+        { 0 };
+    uint32_t pageError = 0;
+    HAL_StatusTypeDef status;
+
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.PageAddress = FLASH_PROFILE_ADDR + page * FLASH_PAGE_SIZE;
+    erase.NbPages = 1;
+
+    HAL_FLASH_Unlock ();
+    status = HAL_FLASHEx_Erase (&erase, &pageError);
+    HAL_FLASH_Lock ();
+    return status == HAL_OK;
+}
+
+static bool
+program (uint32_t offset, const void *data, uint32_t len)
+{
+    const uint8_t *p = data;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    HAL_FLASH_Unlock ();
+    for (uint32_t i = 0; i < len && status == HAL_OK; i += 2)
+        {
+            /* flash is programmed in half words, data may be read from flash itself */
+            uint16_t halfWord = p[i] | (p[i + 1] << 8);
+            status = HAL_FLASH_Program (FLASH_TYPEPROGRAM_HALFWORD,
+                                        FLASH_PROFILE_ADDR + offset + i,
+                                        halfWord);
+        }
+    HAL_FLASH_Lock ();
+    return status == HAL_OK;
+}
+
+/* === private variables === */
+static const struct profile_Flash profileArea =
+    { (const uint8_t*) FLASH_PROFILE_ADDR, FLASH_PAGE_SIZE, FLASH_PROFILE_PAGES,
+            erasePage, program };
+
+/* === exported functions === */
+const struct profile_Flash*
+flash_getProfileArea (void)
+{
+    return &profileArea;
+}
@@ -0,0 +1,100 @@
+/*
+ * fmt.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "fmt.h"
+
+/* === private functions === */
+/* Write digits of value backwards from end of tmp, return number of digits */
+static uint8_t
+toDigits (char tmp[FMT_UINT_MAX_LEN], uint32_t value)
+{
+    uint8_t n = 0;
+    do
+        {
+            tmp[FMT_UINT_MAX_LEN - 1 - n] = '0' + value % 10;
+            value /= 10;
+            n++;
+        }
+    while (value != 0);
+    return n;
+}
+
+static char*
+copyDigits (char *dst, const char tmp[FMT_UINT_MAX_LEN], uint8_t n)
+{
+    for (uint8_t i = FMT_UINT_MAX_LEN - n; i < FMT_UINT_MAX_LEN; i++)
+        {
+            *dst++ = tmp[i];
+        }
+    return dst;
+}
+
+/* === exported functions === */
+char*
+fmt_str (char *dst, const char *str)
+{
+    while (*str != '\0')
+        {
+            *dst++ = *str++;
+        }
+    return dst;
+}
+
+char*
+fmt_uint (char *dst, uint32_t value)
+{
+    char tmp[FMT_UINT_MAX_LEN];
+    return copyDigits (dst, tmp, toDigits (tmp, value));
+}
+
+char*
+fmt_uintWidth (char *dst, uint32_t value, uint8_t width, char pad)
+{
+    char tmp[FMT_UINT_MAX_LEN];
+    uint8_t n = toDigits (tmp, value);
+
+    while (width > n)
+        {
+            *dst++ = pad;
+            width--;
+        }
+    return copyDigits (dst, tmp, n);
+}
+
+char*
+fmt_int (char *dst, int32_t value)
+{
+    if (value < 0)
+        {
+            *dst++ = '-';
+            return fmt_uint (dst, -(uint32_t) value);
+        }
+    return fmt_uint (dst, value);
+}
+
+char*
+fmt_milliG (char *dst, int32_t milliG)
+{
+    uint32_t absVal = milliG < 0 ? -(uint32_t) milliG : (uint32_t) milliG;
+
+    dst = fmt_str (dst, milliG >= 0 ? "   " : "  -");
+    dst = fmt_uint (dst, absVal / 1000);
+    *dst++ = '.';
+    dst = fmt_uintWidth (dst, absVal % 1000, 3, '0');
+    *dst++ = ' ';
+    *dst++ = 'g';
+    return dst;
+}
+
+char*
+fmt_hhmmss (char *dst, uint8_t hours, uint8_t minutes, uint8_t seconds)
+{
+    dst = fmt_uintWidth (dst, hours, 2, '0');
+    *dst++ = ':';
+    dst = fmt_uintWidth (dst, minutes, 2, '0');
+    *dst++ = ':';
+    return fmt_uintWidth (dst, seconds, 2, '0');
+}
@@ -6,18 +6,290 @@
  */
 
 #define I2Cx                I2C2                                                // used I2C
-#include "I2C.h"
+#include "i2c.h"
 #include "stm32f302x8.h"                                                        // device registers
+#include "systime.h"
+#include "i2ctiming.h"
+#include "FreeRTOS.h"
+#include "task.h"
 
-#define TIMINGR_CONTENT     0x10E8122C                                          // calculation based on reference manual
+#define MAX_RETRIES         2                                                   // attempts after first failed one
+#define TIMEOUT_BASE_US     1000                                                // START, STOP and clock stretching margin
+#define BYTE_TIMEOUT_MARGIN 2                                                   // byte deadline as multiple of byte time
+#define BITS_PER_BYTE       9                                                   // data bits and acknowledge
+#define RECOVERY_CLOCKS     9                                                   // enough to finish any byte slave sends
+#define RECOVERY_HALF_PERIOD_US 5                                               // 100 kHz SCL while recovering
 
+/* === private variables === */
+static struct Base
+{
+    struct I2C_Stats stats;
+    enum i2ctiming_Speed speed;                                                 // kept over bus recovery and clock changes
+    uint32_t sclHz;                                                             // SCL frequency of current timing
+} base;
+
+/* === private functions === */
+/* Set timing of current speed for current SYSCLK, peripheral must be disabled */
+static void
+applyTiming ()
+{
+    struct i2ctiming_Result timing;
+    if (!i2ctiming_compute (SystemCoreClock, base.speed, &timing))
+        {
+            /* SYSCLK too low for requested speed, fall back to standard mode */
+            base.speed = I2CTIMING_SPEED_STANDARD;
+            i2ctiming_compute (SystemCoreClock, base.speed, &timing);
+        }
+    I2Cx->TIMINGR = timing.timingr;
+    base.sclHz = timing.sclHz;
+
+    /* Fast mode plus needs stronger output drivers */
+    if (I2CTIMING_SPEED_FAST_PLUS == base.speed)
+        {
+            SYSCFG->CFGR1 |= SYSCFG_CFGR1_I2C2_FMP;
+        }
+    else
+        {
+            SYSCFG->CFGR1 &= ~SYSCFG_CFGR1_I2C2_FMP;
+        }
+}
+
+/* Get flag status after error or timeout check. Errors are counted. */
+static enum I2C_Status
+waitFlag (uint32_t flag, uint32_t deadline)
+{
+    uint32_t isr;
+
+    while (!((isr = I2Cx->ISR) & flag))
+        {
+            if (isr & I2C_ISR_NACKF)
+                {
+                    base.stats.nacks++;
+                    return I2C_FAILURE;
+                }
+            if (isr & I2C_ISR_ARLO)
+                {
+                    base.stats.arbitrationLosses++;
+                    return I2C_BUSY;
+                }
+            if (isr & I2C_ISR_BERR)
+                {
+                    base.stats.busErrors++;
+                    return I2C_BUS_ERROR;
+                }
+            if (systime_isReached (deadline))
+                {
+                    base.stats.timeouts++;
+                    return I2C_TIMEOUT;
+                }
+        }
+    return I2C_SUCCES;
+}
+
+/* Finish transfer: wait for STOP, generate it if transfer was aborted, clear flags */
+static void
+finishTransfer (enum I2C_Status status, uint32_t deadline)
+{
+    if (status == I2C_FAILURE && !(I2Cx->ISR & I2C_ISR_STOPF))
+        {
+            I2Cx->CR2 |= I2C_CR2_STOP;                                          // NACK without AUTOEND does not stop
+        }
+    if (status == I2C_SUCCES || status == I2C_FAILURE)
+        {
+            while (!(I2Cx->ISR & I2C_ISR_STOPF)
+                    && !systime_isReached (deadline))
+                {
+                }
+        }
+    I2Cx->ICR = I2C_ICR_STOPCF | I2C_ICR_NACKCF | I2C_ICR_BERRCF
+            | I2C_ICR_ARLOCF;
+}
+
+/* Deadline of transfer with given number of bytes on the bus */
+static uint32_t
+transferDeadline (uint8_t numOfBytes)
+{
+    uint32_t byteUs = BYTE_TIMEOUT_MARGIN * BITS_PER_BYTE * 1000000UL
+            / I2C_getBusFrequency ();
+    return systime_deadline (TIMEOUT_BASE_US + byteUs * numOfBytes);
+}
+
+static enum I2C_Status
+waitBusFree (uint32_t deadline)
+{
+    while (I2Cx->ISR & I2C_ISR_BUSY)
+        {                                                                       // wait for I2Cx bus not busy
+            if (systime_isReached (deadline))
+                {
+                    base.stats.timeouts++;
+                    return I2C_TIMEOUT;
+                }
+        }
+    return I2C_SUCCES;
+}
+
+static enum I2C_Status
+writeTransfer (uint8_t slaveAddr, uint8_t memAddr, uint8_t *pData, uint8_t dataLen)
+{
+    uint32_t deadline = transferDeadline (dataLen + 2);
+    enum I2C_Status status = waitBusFree (deadline);
+    if (status != I2C_SUCCES)
+        {
+            return status;
+        }
+
+    /* 7-bit address, write mode, STOP generated after NBYTES sent */
+    I2Cx->CR2 = (I2C_CR2_SADD & slaveAddr)
+            | ((dataLen + 1) << I2C_CR2_NBYTES_Pos) | I2C_CR2_AUTOEND
+            | I2C_CR2_START;
+
+    status = waitFlag (I2C_ISR_TXIS, deadline);
+    if (status == I2C_SUCCES)
+        {
+            I2Cx->TXDR = memAddr;
+        }
+    for (uint8_t i = 0; i < dataLen && status == I2C_SUCCES; i++)
+        {
+            status = waitFlag (I2C_ISR_TXIS, deadline);
+            if (status == I2C_SUCCES)
+                {
+                    I2Cx->TXDR = pData[i];
+                }
+        }
+    if (status == I2C_SUCCES)
+        {
+            status = waitFlag (I2C_ISR_STOPF, deadline);
+        }
+    finishTransfer (status, deadline);
+    return status;
+}
+
+static enum I2C_Status
+readTransfer (uint8_t slaveAddr, uint8_t memAddr, uint8_t *pData, uint8_t dataLen)
+{
+    uint32_t deadline = transferDeadline (dataLen + 3);
+    enum I2C_Status status = waitBusFree (deadline);
+    if (status != I2C_SUCCES)
+        {
+            return status;
+        }
+
+    /* set device memory address to read from, no STOP before repeated start */
+    I2Cx->CR2 = (I2C_CR2_SADD & slaveAddr) | (1 << I2C_CR2_NBYTES_Pos)
+            | I2C_CR2_START;
+    status = waitFlag (I2C_ISR_TXIS, deadline);
+    if (status == I2C_SUCCES)
+        {
+            I2Cx->TXDR = memAddr;
+            status = waitFlag (I2C_ISR_TC, deadline);
+        }
+
+    /* read */
+    if (status == I2C_SUCCES)
+        {
+            I2Cx->CR2 = (I2C_CR2_SADD & slaveAddr) | I2C_CR2_RD_WRN
+                    | (dataLen << I2C_CR2_NBYTES_Pos) | I2C_CR2_AUTOEND
+                    | I2C_CR2_START;
+        }
+    for (uint8_t i = 0; i < dataLen && status == I2C_SUCCES; i++)
+        {
+            /* wait for data in RXDR */
+            status = waitFlag (I2C_ISR_RXNE, deadline);
+            if (status == I2C_SUCCES)
+                {
+                    pData[i] = I2Cx->RXDR;
+                }
+        }
+    if (status == I2C_SUCCES)
+        {
+            status = waitFlag (I2C_ISR_STOPF, deadline);
+        }
+    finishTransfer (status, deadline);
+    return status;
+}
+
+/* Free the bus from slave holding SDA low: clock SCL by hand until SDA is released,
+ * generate STOP and reinitialise peripheral. */
+static void
+recoverBus ()
+{
+    base.stats.recoveries++;
+    I2Cx->CR1 &= ~I2C_CR1_PE;
+
+    /* SCL and SDA as open drain outputs, released */
+    GPIOA->BSRR = GPIO_BSRR_BS_9 | GPIO_BSRR_BS_10;
+    GPIOA->MODER = (GPIOA->MODER & ~(GPIO_MODER_MODER9 | GPIO_MODER_MODER10))
+            | (0x1UL << GPIO_MODER_MODER9_Pos)
+            | (0x1UL << GPIO_MODER_MODER10_Pos);
+
+    for (uint8_t i = 0; i < RECOVERY_CLOCKS && !(GPIOA->IDR & GPIO_IDR_10);
+            i++)
+        {
+            GPIOA->BSRR = GPIO_BSRR_BR_9;
+            systime_delayUs (RECOVERY_HALF_PERIOD_US);
+            GPIOA->BSRR = GPIO_BSRR_BS_9;
+            systime_delayUs (RECOVERY_HALF_PERIOD_US);
+        }
+
+    /* STOP condition: SDA rising while SCL high */
+    GPIOA->BSRR = GPIO_BSRR_BR_9;
+    systime_delayUs (RECOVERY_HALF_PERIOD_US);
+    GPIOA->BSRR = GPIO_BSRR_BR_10;
+    systime_delayUs (RECOVERY_HALF_PERIOD_US);
+    GPIOA->BSRR = GPIO_BSRR_BS_9;
+    systime_delayUs (RECOVERY_HALF_PERIOD_US);
+    GPIOA->BSRR = GPIO_BSRR_BS_10;
+    systime_delayUs (RECOVERY_HALF_PERIOD_US);
+
+    I2C_init ();
+}
+
+/* Run transfer with retries. Scheduler is suspended instead of masking interrupts,
+ * so a stuck bus delays other tasks by the transfer deadline at most. */
+static enum I2C_Status
+transfer (uint8_t slaveAddr, uint8_t memAddr, uint8_t *pData, uint8_t dataLen,
+          bool isRead)
+{
+    enum I2C_Status status;
+
+    vTaskSuspendAll ();
+    base.stats.transfers++;
+    for (uint8_t attempt = 0;; attempt++)
+        {
+            status = isRead ?
+                    readTransfer (slaveAddr, memAddr, pData, dataLen) :
+                    writeTransfer (slaveAddr, memAddr, pData, dataLen);
+            if (status == I2C_SUCCES || status == I2C_FAILURE)
+                {
+                    break;                                                      // retry does not help missing slave
+                }
+            if (status == I2C_TIMEOUT || status == I2C_BUS_ERROR)
+                {
+                    recoverBus ();
+                }
+            if (attempt == MAX_RETRIES)
+                {
+                    break;
+                }
+            base.stats.retries++;
+        }
+    if (status != I2C_SUCCES)
+        {
+            base.stats.failures++;
+        }
+    xTaskResumeAll ();
+    return status;
+}
+
+/* === exported functions === */
 void
 I2C_init ()
 {
     /* GPIOA CLK enable */
     RCC->AHBENR |= RCC_AHBENR_GPIOAEN;
 
-    GPIOA->MODER |= (0x2UL << GPIO_MODER_MODER9_Pos)
+    GPIOA->MODER = (GPIOA->MODER & ~(GPIO_MODER_MODER9 | GPIO_MODER_MODER10))
+            | (0x2UL << GPIO_MODER_MODER9_Pos)
             | (0x2UL << GPIO_MODER_MODER10_Pos);                                // alternate function mode
     GPIOA->OTYPER |= GPIO_OTYPER_OT_9 | GPIO_OTYPER_OT_10;                      // open drain
     GPIOA->PUPDR |= (0x1UL << GPIO_PUPDR_PUPDR9_Pos)
@@ -32,12 +304,57 @@ I2C_init ()
     RCC->CFGR3 |= RCC_CFGR3_I2C2SW_SYSCLK;                                      // select I2C kernel clk source
 
     /* configure and enable I2C2 */
-    I2C2->CR2 &= ~I2C_CR1_PE;                                                   // disable I2C2
-    I2C2->TIMINGR = TIMINGR_CONTENT;                                            // set timings
+    I2C2->CR1 &= ~I2C_CR1_PE;                                                   // disable I2C2
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;                                       // fast mode plus drive control
+    applyTiming ();                                                             // set timings
     I2C2->CR1 &= ~I2C_CR1_NOSTRETCH;                                            // enable clock stretching
     I2C2->CR1 |= I2C_CR1_PE;                                                    // enable I2C2
 }
 
+void
+I2C_updateTiming ()
+{
+    I2Cx->CR1 &= ~I2C_CR1_PE;                                                   // TIMINGR is writable only when disabled
+    applyTiming ();
+    I2Cx->CR1 |= I2C_CR1_PE;
+}
+
+const struct I2C_Stats*
+I2C_getStats ()
+{
+    return &base.stats;
+}
+
+uint32_t
+I2C_getBusFrequency ()
+{
+    return base.sclHz;
+}
+
+bool
+I2C_setSpeed (enum i2ctiming_Speed speed)
+{
+    struct i2ctiming_Result timing;
+    if (!i2ctiming_compute (SystemCoreClock, speed, &timing))
+        {
+            return false;
+        }
+    /* same lock as transfer(), sensor task must not start one on disabled peripheral */
+    vTaskSuspendAll ();
+    base.speed = speed;
+    I2Cx->CR1 &= ~I2C_CR1_PE;
+    applyTiming ();
+    I2Cx->CR1 |= I2C_CR1_PE;
+    xTaskResumeAll ();
+    return true;
+}
+
+enum i2ctiming_Speed
+I2C_getSpeed ()
+{
+    return base.speed;
+}
+
 enum I2C_Status
 I2C_writeByteStream (uint8_t slaveAddr, uint8_t memAddr, uint8_t *pData,
                      uint8_t dataLen)
@@ -47,32 +364,7 @@ I2C_writeByteStream (uint8_t slaveAddr, uint8_t memAddr, uint8_t *pData,
         {
             assert_param(pData);
         }
-
-    while (I2Cx->ISR & I2C_ISR_BUSY)
-        {                                                                       // wait for I2Cx bus not busy
-        }
-    taskENTER_CRITICAL();
-    I2Cx->CR2 &= ~I2C_CR2_ADD10;                                                // select 7-bit addressing mode
-    I2Cx->CR2 = I2C_CR2_SADD & slaveAddr;                                       // set slave address
-    I2Cx->CR2 &= ~I2C_CR2_RD_WRN;                                               // set write mode
-
-    I2Cx->CR2 &= ~I2C_CR2_NBYTES_Msk;
-    I2Cx->CR2 |= (dataLen + 1) << I2C_CR2_NBYTES_Pos;
-
-    I2Cx->CR2 |= I2C_CR2_AUTOEND;                                               // STOP will be generated after NBYTES send
-    I2Cx->TXDR = memAddr;
-    I2Cx->CR2 |= I2C_CR2_START;                                                 // generate start condition
-
-    for (uint8_t i = 0; i < dataLen; i++)
-        {
-            while (!(I2Cx->ISR & I2C_ISR_TXIS))
-                {
-                    __NOP();
-                }
-            I2Cx->TXDR = pData[i];
-        }
-    taskEXIT_CRITICAL();
-    return I2C_SUCCES;
+    return transfer (slaveAddr, memAddr, pData, dataLen, false);
 }
 
 enum I2C_Status
@@ -81,30 +373,5 @@ I2C_readByteStream (uint8_t slaveAddr, uint8_t memAddr, uint8_t *pData,
 {
     assert_param(I2Cx);
     assert_param(pData);
-    taskENTER_CRITICAL();
-    /* set device memory address to read from. */
-    I2C_writeByteStream (slaveAddr, memAddr, pData, 0);
-
-    while (I2Cx->ISR & I2C_ISR_BUSY)
-        {                                                                       // wait for I2Cx bus not busy
-        }
-    /* read */
-    I2Cx->CR2 |= I2C_CR2_RD_WRN;
-    I2Cx->CR2 &= ~I2C_CR2_NBYTES_Msk;
-    I2Cx->CR2 |= (dataLen) << I2C_CR2_NBYTES_Pos;                               // set number of bytes to read
-    I2Cx->CR2 |= I2C_CR2_AUTOEND;
-    I2Cx->CR2 |= I2C_CR2_START;
-
-    for (uint8_t i = 0; i < dataLen; i++)
-        {
-            /* wait for data in RXDR */
-            while (!(I2Cx->ISR & I2C_ISR_RXNE))
-                {
-                }
-            pData[i] = I2Cx->RXDR;
-        }
-    taskEXIT_CRITICAL();
-
-    return I2C_SUCCES;
+    return transfer (slaveAddr, memAddr, pData, dataLen, true);
 }
-
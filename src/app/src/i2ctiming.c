@@ -0,0 +1,136 @@
+/*
+ * i2ctiming.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "i2ctiming.h"
+
+/* === private defines === */
+#define PS_PER_S                        1000000000000ULL
+#define PS_PER_NS                       1000
+#define TIMINGR_PRESC_POS               28
+#define TIMINGR_SCLDEL_POS              20
+#define TIMINGR_SDADEL_POS              16
+#define TIMINGR_SCLH_POS                8
+#define TIMINGR_SCLL_POS                0
+#define PRESC_MAX                       15
+#define SCLDEL_MAX                      15
+#define SDADEL_MAX                      15
+#define SCLH_MAX                        255
+#define SCLL_MAX                        255
+
+/* === private variables === */
+static const struct i2ctiming_Spec specs[I2CTIMING_SPEED_COUNT] =
+    {
+        { 100000, 80000, 4700, 4000, 250, 3450, 1000, 300 },
+        { 400000, 320000, 1300, 600, 100, 900, 300, 300 },
+        { 1000000, 800000, 500, 260, 50, 450, 120, 120 } };
+
+/* === private functions === */
+static int32_t
+ceilDiv (int32_t num, int32_t den)
+{
+    return num > 0 ? (num + den - 1) / den : 0;
+}
+
+static int32_t
+minPs (uint32_t aNs, uint32_t bNs)
+{
+    return (int32_t) (aNs < bNs ? aNs : bNs) * PS_PER_NS;
+}
+
+/* === exported functions === */
+const struct i2ctiming_Spec*
+i2ctiming_getSpec (enum i2ctiming_Speed speed)
+{
+    return &specs[speed];
+}
+
+bool
+i2ctiming_compute (uint32_t kernelHz, enum i2ctiming_Speed speed,
+                   struct i2ctiming_Result *result)
+{
+    const struct i2ctiming_Spec *spec = &specs[speed];
+
+    /* all times in picoseconds, kernel clock period is not a whole number of nanoseconds */
+    int32_t clkPs = (int32_t) (PS_PER_S / kernelHz);
+    int32_t risePs = minPs (I2CTIMING_RISE_NS, spec->riseMax);
+    int32_t fallPs = minPs (I2CTIMING_FALL_NS, spec->fallMax);
+    int32_t syncPs = I2CTIMING_AF_MIN_NS * PS_PER_NS + 2 * clkPs;              // SCL edge detection after counter ends
+    int32_t sclMinPs = (int32_t) (PS_PER_S / spec->hz);
+    int32_t sclMaxPs = (int32_t) (PS_PER_S / spec->minHz);
+    int32_t scldelMinPs = risePs + (int32_t) spec->setupMin * PS_PER_NS;
+    int32_t sdadelMinPs = fallPs - I2CTIMING_AF_MIN_NS * PS_PER_NS - 3 * clkPs;
+    int32_t sdadelMaxPs = (int32_t) spec->validMax * PS_PER_NS - risePs
+            - I2CTIMING_AF_MAX_NS * PS_PER_NS - 4 * clkPs;
+    int32_t bestSclPs = 0;
+    int32_t bestPresc = 0;                                                      // finest resolution wins on equal period
+
+    for (int32_t presc = 0; presc <= PRESC_MAX; presc++)
+        {
+            int32_t prescPs = (presc + 1) * clkPs;
+
+            /* data setup and hold, no delay is the best possible for data valid time */
+            int32_t scldel = ceilDiv (scldelMinPs, prescPs) - 1;
+            int32_t sdadel = ceilDiv (sdadelMinPs, prescPs);
+            scldel = scldel < 0 ? 0 : scldel;
+            if (scldel > SCLDEL_MAX || sdadel > SDADEL_MAX
+                    || (sdadel > 0 && sdadel * prescPs > sdadelMaxPs))
+                {
+                    continue;
+                }
+
+            for (int32_t scll = 0; scll <= SCLL_MAX; scll++)
+                {
+                    int32_t lowPs = (scll + 1) * prescPs + syncPs;
+                    if (lowPs < (int32_t) spec->lowMin * PS_PER_NS
+                            || 4 * clkPs
+                                    >= lowPs - I2CTIMING_AF_MIN_NS * PS_PER_NS)
+                        {
+                            continue;
+                        }
+
+                    /* shortest high period which keeps SCL at or below nominal frequency,
+                     * on equal period longer low phase is preferred */
+                    int32_t highPs = sclMinPs - lowPs - risePs - fallPs;
+                    if (highPs < (int32_t) spec->highMin * PS_PER_NS)
+                        {
+                            highPs = spec->highMin * PS_PER_NS;
+                        }
+                    if (highPs <= clkPs)
+                        {
+                            highPs = clkPs + 1;
+                        }
+                    int32_t sclh = ceilDiv (highPs - syncPs, prescPs) - 1;
+                    sclh = sclh < 0 ? 0 : sclh;
+                    if (sclh > SCLH_MAX)
+                        {
+                            continue;
+                        }
+
+                    int32_t sclPs = lowPs + (sclh + 1) * prescPs + syncPs
+                            + risePs + fallPs;
+                    bool better = bestSclPs == 0 || sclPs < bestSclPs
+                            || (sclPs == bestSclPs && presc == bestPresc);
+                    if (sclPs > sclMaxPs || !better)
+                        {
+                            continue;
+                        }
+                    bestSclPs = sclPs;
+                    bestPresc = presc;
+                    result->timingr = ((uint32_t) presc << TIMINGR_PRESC_POS)
+                            | ((uint32_t) scldel << TIMINGR_SCLDEL_POS)
+                            | ((uint32_t) sdadel << TIMINGR_SDADEL_POS)
+                            | ((uint32_t) sclh << TIMINGR_SCLH_POS)
+                            | ((uint32_t) scll << TIMINGR_SCLL_POS);
+                }
+        }
+
+    if (bestSclPs == 0)
+        {
+            return false;
+        }
+    result->sclHz = (uint32_t) (PS_PER_S / (uint32_t) bestSclPs);
+    return true;
+}
@@ -0,0 +1,144 @@
+/*
+ * odr.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "odr.h"
+
+/* === private defines === */
+#define NS_PER_S                        1000000000ULL
+#define MAX_PERIODS_PER_SPAN            UINT8_MAX
+#define SQRT_SCALE_BITS                 4                                       // standard deviation in 1/16 cycle
+
+/* === private functions === */
+/* Integer square root, rounded down */
+static uint64_t
+isqrt (uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > value)
+        {
+            bit >>= 2;
+        }
+    while (bit != 0)
+        {
+            if (value >= root + bit)
+                {
+                    value -= root + bit;
+                    root = (root >> 1) + bit;
+                }
+            else
+                {
+                    root >>= 1;
+                }
+            bit >>= 2;
+        }
+    return root;
+}
+
+static uint32_t
+cyclesToNs (uint64_t cycles, uint32_t coreHz)
+{
+    return coreHz == 0 ? 0 : (uint32_t) (cycles * NS_PER_S / coreHz);
+}
+
+/* === exported functions === */
+void
+odr_start (struct odr_Window *window, uint32_t nominalMilliHz)
+{
+    window->head = 0;
+    window->count = 0;
+    window->started = false;
+    window->coreHz = 0;
+    window->nominalMilliHz = nominalMilliHz;
+    window->nominalCycles = 0;
+}
+
+void
+odr_addEdge (struct odr_Window *window, uint32_t cycles, uint32_t coreHz)
+{
+    if (coreHz != window->coreHz)
+        {
+            /* spans measured with different clocks do not mix */
+            odr_start (window, window->nominalMilliHz);
+            window->coreHz = coreHz;
+            window->nominalCycles = window->nominalMilliHz == 0 ?
+                    0 : (uint64_t) coreHz * 1000 / window->nominalMilliHz;
+        }
+    if (!window->started)
+        {
+            window->lastEdge = cycles;
+            window->started = true;
+            return;
+        }
+
+    uint32_t span = cycles - window->lastEdge;
+    uint32_t nominal = window->nominalCycles;
+    uint32_t periods = 1;
+    window->lastEdge = cycles;
+    if (nominal != 0 && span > nominal + nominal / 2)
+        {
+            periods = (span + nominal / 2) / nominal;
+            periods = periods > MAX_PERIODS_PER_SPAN ? MAX_PERIODS_PER_SPAN : periods;
+        }
+
+    window->span[window->head] = span;
+    window->periods[window->head] = periods;
+    window->head = window->head + 1 < ODR_WINDOW_LEN ? window->head + 1 : 0;
+    if (window->count < ODR_WINDOW_LEN)
+        {
+            window->count++;
+        }
+}
+
+void
+odr_getSummary (const struct odr_Window *window, struct odr_Summary *summary)
+{
+    uint64_t totalSpan = 0, singleSpan = 0;
+    uint32_t singles = 0;
+
+    summary->edges = window->count;
+    summary->periods = 0;
+    summary->missed = 0;
+    for (uint16_t i = 0; i < window->count; i++)
+        {
+            totalSpan += window->span[i];
+            summary->periods += window->periods[i];
+            if (window->periods[i] == 1)
+                {
+                    singleSpan += window->span[i];
+                    singles++;
+                }
+        }
+    summary->missed = summary->periods - window->count;
+    summary->rateMilliHz = totalSpan == 0 ?
+            0 : (uint32_t) ((uint64_t) window->coreHz * 1000 * summary->periods
+                    / totalSpan);
+
+    /* jitter of spans without missed edges, mean rounded to cycle adds at most 1/4 cycle^2 */
+    summary->jitterNs = 0;
+    summary->maxDeviationNs = 0;
+    if (singles == 0)
+        {
+            return;
+        }
+    uint32_t mean = (singleSpan + singles / 2) / singles;
+    uint64_t sumSq = 0;
+    uint32_t maxDeviation = 0;
+    for (uint16_t i = 0; i < window->count; i++)
+        {
+            if (window->periods[i] == 1)
+                {
+                    uint32_t deviation = window->span[i] > mean ?
+                            window->span[i] - mean : mean - window->span[i];
+                    sumSq += (uint64_t) deviation * deviation;
+                    maxDeviation = deviation > maxDeviation ? deviation : maxDeviation;
+                }
+        }
+    uint64_t scaledSd = isqrt ((sumSq << (2 * SQRT_SCALE_BITS)) / singles);
+    summary->jitterNs = cyclesToNs (scaledSd, window->coreHz) >> SQRT_SCALE_BITS;
+    summary->maxDeviationNs = cyclesToNs (maxDeviation, window->coreHz);
+}
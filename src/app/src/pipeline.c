@@ -0,0 +1,109 @@
+/*
+ * pipeline.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "pipeline.h"
+#include "systime.h"
+#include "timebase.h"
+#include "stm32f3xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* === private defines === */
+#define NS_PER_US                       1000UL
+#define US_PER_S                        1000000UL
+
+/* === private types === */
+struct Stage
+{
+    uint32_t items;
+    uint16_t queueMax;
+    uint32_t serviceMaxNs;
+    uint64_t busyNs;                                                            // sum of service times
+    uint32_t outputFull;
+};
+
+/* === private variables === */
+static const char *const stageNames[PIPELINE_STAGE_COUNT] =
+    { "acquire", "dsp", "format", "transmit" };
+
+static struct Base
+{
+    struct Stage stages[PIPELINE_STAGE_COUNT];
+    uint64_t resetUs;                                                           // device time of last reset
+} base;
+
+/* === exported functions === */
+void
+pipeline_reset (void)
+{
+    taskENTER_CRITICAL();
+    for (uint8_t s = 0; s < PIPELINE_STAGE_COUNT; s++)
+        {
+            base.stages[s] = (struct Stage)
+                { 0 };
+        }
+    base.resetUs = timebase_getUs ();
+    taskEXIT_CRITICAL();
+}
+
+uint32_t
+pipeline_beginItem (enum pipeline_Stage stage, uint32_t queueFill)
+{
+    struct Stage *s = &base.stages[stage];
+
+    if (queueFill > s->queueMax)
+        {
+            s->queueMax = queueFill > UINT16_MAX ? UINT16_MAX : queueFill;
+        }
+    return systime_getCycles ();
+}
+
+void
+pipeline_endItem (enum pipeline_Stage stage, uint32_t startCycles)
+{
+    /* nanoseconds keep short services of a few cycles from rounding to zero */
+    uint32_t ns = (uint32_t) ((uint64_t) (systime_getCycles () - startCycles)
+            * NS_PER_US / (SystemCoreClock / US_PER_S));
+    struct Stage *s = &base.stages[stage];
+
+    taskENTER_CRITICAL();
+    s->items++;
+    s->busyNs += ns;
+    s->serviceMaxNs = ns > s->serviceMaxNs ? ns : s->serviceMaxNs;
+    taskEXIT_CRITICAL();
+}
+
+void
+pipeline_outputFull (enum pipeline_Stage stage)
+{
+    base.stages[stage].outputFull++;
+}
+
+void
+pipeline_getStats (enum pipeline_Stage stage, struct pipeline_StageStats *stats)
+{
+    struct Stage s;
+
+    taskENTER_CRITICAL();
+    s = base.stages[stage];
+    uint64_t elapsedUs = timebase_getUs () - base.resetUs;
+    taskEXIT_CRITICAL();
+
+    elapsedUs = elapsedUs > 0 ? elapsedUs : 1;
+    stats->items = s.items;
+    stats->itemsPerS = (uint32_t) ((uint64_t) s.items * US_PER_S / elapsedUs);
+    stats->queueMax = s.queueMax;
+    stats->serviceMaxUs = s.serviceMaxNs / NS_PER_US;
+    stats->serviceAvgUs = s.items > 0 ? s.busyNs / s.items / NS_PER_US : 0;
+    stats->loadPercent = (uint16_t) (s.busyNs / NS_PER_US * 100 / elapsedUs);
+    stats->outputFull = s.outputFull;
+}
+
+const char*
+pipeline_getStageName (enum pipeline_Stage stage)
+{
+    return stageNames[stage];
+}
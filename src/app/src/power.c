@@ -0,0 +1,294 @@
+/*
+ * power.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "power.h"
+#include "rtc.h"
+#include "systime.h"
+#include "clock.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdbool.h>
+
+/* === private defines === */
+#define US_PER_S                        1000000UL
+#define US_PER_TICK                     (US_PER_S / configTICK_RATE_HZ)
+#define RTC_SUBSEC_HZ                   (RTC_SYNCH_PREDIV + 1)                  // sub second counter clock, 244 us resolution
+#define RTC_SUBSEC_PER_DAY              (86400UL * RTC_SUBSEC_HZ)
+#define WAKEUP_TIMER_HZ                 2048UL                                  // LSE / 16
+#define WAKEUP_TIMER_MIN_COUNT          2                                       // shorter idle time is spent awake
+#define MAX_SLEEP_TICKS                 pdMS_TO_TICKS(30000)                    // wake up timer counter range
+#define STOP_MIN_IDLE_TICKS             pdMS_TO_TICKS(5)                        // STOP entry and HSE restart cost
+#define UART_HOLD_TICKS                 pdMS_TO_TICKS(10000)                    // no STOP after UART activity
+#define UART_RX_EXTI_LINE               (1UL << 3)                              // PA3, USART2 RX
+
+/* === private variables === */
+static struct Base
+{
+    UART_HandleTypeDef *huart;
+    enum power_Mode mode;
+    uint32_t residualUs;                                                        // elapsed part of current tick period
+    uint32_t lastRxCounter;                                                     // RX DMA counter at last check
+    TickType_t lastUartActivity;
+    TickType_t statsStart;
+    uint32_t extiCr;                                                            // EXTI line 3 port selection before STOP
+    struct power_Stats stats;
+} base;
+
+/* === private functions === */
+static uint32_t
+bcdToBin (uint32_t bcd)
+{
+    return (bcd >> 4) * 10 + (bcd & 0x0F);
+}
+
+/* RTC time of day in sub second counter periods, shadow registers are bypassed */
+static uint32_t
+readRtcSubsec (void)
+{
+    uint32_t tr, ssr;
+    do
+        {
+            tr = RTC->TR;
+            ssr = RTC->SSR;
+        }
+    while (tr != RTC->TR);
+
+    uint32_t seconds = bcdToBin ((tr & (RTC_TR_HT | RTC_TR_HU)) >> RTC_TR_HU_Pos)
+            * 3600
+            + bcdToBin ((tr & (RTC_TR_MNT | RTC_TR_MNU)) >> RTC_TR_MNU_Pos) * 60
+            + bcdToBin ((tr & (RTC_TR_ST | RTC_TR_SU)) >> RTC_TR_SU_Pos);
+    return seconds * RTC_SUBSEC_HZ + (RTC_SYNCH_PREDIV - ssr);                  // sub second counter counts down
+}
+
+static uint32_t
+subsecToUs (uint32_t subsec)
+{
+    return (uint32_t) (((uint64_t) subsec * US_PER_S) / RTC_SUBSEC_HZ);
+}
+
+/* UART may be stopped only when nothing is sent and nothing was received for a while */
+static bool
+isUartQuiet (TickType_t now)
+{
+    uint32_t rxCounter = __HAL_DMA_GET_COUNTER(base.huart->hdmarx);
+    if (rxCounter != base.lastRxCounter)
+        {
+            base.lastRxCounter = rxCounter;
+            base.lastUartActivity = now;
+        }
+    return HAL_UART_STATE_READY == base.huart->gState
+            && (now - base.lastUartActivity) >= UART_HOLD_TICKS;
+}
+
+/* USART2 does not run in STOP mode, start bit on RX pin wakes MCU through EXTI line 3.
+ * The line can be used only when no sensor interrupt is connected to it. */
+static bool
+isUartWakeupAvailable (void)
+{
+    return 0 == (EXTI->IMR & UART_RX_EXTI_LINE);
+}
+
+static void
+armUartWakeup (void)
+{
+    base.extiCr = SYSCFG->EXTICR[0];
+    MODIFY_REG(SYSCFG->EXTICR[0], SYSCFG_EXTICR1_EXTI3, SYSCFG_EXTICR1_EXTI3_PA);
+    EXTI->FTSR |= UART_RX_EXTI_LINE;
+    EXTI->PR = UART_RX_EXTI_LINE;
+    EXTI->IMR |= UART_RX_EXTI_LINE;
+    HAL_NVIC_ClearPendingIRQ (EXTI3_IRQn);
+    HAL_NVIC_EnableIRQ (EXTI3_IRQn);
+}
+
+/* Disconnect RX pin from EXTI line 3, returns true if it woke MCU up */
+static bool
+disarmUartWakeup (void)
+{
+    bool woken = 0 != (EXTI->PR & UART_RX_EXTI_LINE);
+
+    EXTI->IMR &= ~UART_RX_EXTI_LINE;
+    EXTI->FTSR &= ~UART_RX_EXTI_LINE;
+    EXTI->PR = UART_RX_EXTI_LINE;
+    HAL_NVIC_DisableIRQ (EXTI3_IRQn);
+    HAL_NVIC_ClearPendingIRQ (EXTI3_IRQn);
+    SYSCFG->EXTICR[0] = base.extiCr;
+    return woken;
+}
+
+/* Start tick timer with first period shortened by time already elapsed in it */
+static void
+restartTick (uint32_t cyclesPerTick)
+{
+    uint32_t firstPeriod = cyclesPerTick
+            - systime_usToCycles (base.residualUs);
+    SysTick->LOAD = (firstPeriod > 1 ? firstPeriod : 2) - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = cyclesPerTick - 1;                                          // used from next reload
+}
+
+/* === exported functions === */
+void
+power_init (UART_HandleTypeDef *huart)
+{
+    assert_param(huart);
+
+    base.huart = huart;
+    base.mode = POWER_MODE_RUN;
+    base.residualUs = 0;
+
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    HAL_NVIC_SetPriority (RTC_WKUP_IRQn, 10, 10);
+    HAL_NVIC_EnableIRQ (RTC_WKUP_IRQn);
+}
+
+void
+power_setMode (enum power_Mode mode)
+{
+    assert_param(mode < POWER_MODE_COUNT);
+
+    taskENTER_CRITICAL();
+    base.mode = mode;
+    base.stats = (struct power_Stats)
+        { 0 };
+    base.statsStart = xTaskGetTickCount ();
+    base.lastUartActivity = base.statsStart;
+    taskEXIT_CRITICAL();
+}
+
+enum power_Mode
+power_getMode (void)
+{
+    return base.mode;
+}
+
+void
+power_getStats (struct power_Stats *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = base.stats;
+    stats->totalUs = (uint64_t) (xTaskGetTickCount () - base.statsStart)
+            * US_PER_TICK;
+    taskEXIT_CRITICAL();
+}
+
+void
+power_suppressTicksAndSleep (uint32_t expectedIdleTime)
+{
+    if (POWER_MODE_RUN == base.mode)
+        {
+            return;
+        }
+    if (expectedIdleTime > MAX_SLEEP_TICKS)
+        {
+            expectedIdleTime = MAX_SLEEP_TICKS;
+        }
+
+    /* interrupts masked by PRIMASK still wake core from WFI */
+    __disable_irq ();
+    __DSB();
+    __ISB();
+    if (eAbortSleep == eTaskConfirmSleepModeStatus ())
+        {
+            __enable_irq ();
+            return;
+        }
+
+    /* stop tick, part of current tick period is carried over */
+    uint32_t cyclesPerTick = SystemCoreClock / configTICK_RATE_HZ;
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+        {
+            /* tick period ended meanwhile, let it be counted normally */
+            SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+            __enable_irq ();
+            return;
+        }
+    base.residualUs = systime_cyclesToUs (cyclesPerTick - 1 - SysTick->VAL);
+
+    /* wake up before next task timeout, rest of it is counted by tick timer */
+    uint32_t wakeupCount = (uint32_t) (((uint64_t) (expectedIdleTime
+            * US_PER_TICK - base.residualUs) * WAKEUP_TIMER_HZ) / US_PER_S);
+    if (wakeupCount <= WAKEUP_TIMER_MIN_COUNT)
+        {
+            SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+            __enable_irq ();
+            return;
+        }
+    wakeupCount--;                                                              // margin for timer start phase
+    HAL_RTCEx_SetWakeUpTimer_IT (&hrtc, wakeupCount - 1,
+                                 RTC_WAKEUPCLOCK_RTCCLK_DIV16);
+
+    TickType_t now = xTaskGetTickCount ();
+    bool stop = POWER_MODE_STOP == base.mode
+            && expectedIdleTime >= STOP_MIN_IDLE_TICKS && isUartQuiet (now)
+            && isUartWakeupAvailable ();
+    bool uartWakeup = false;
+
+    uint32_t sleepStart = readRtcSubsec ();
+    if (stop)
+        {
+            armUartWakeup ();
+            HAL_PWR_EnterSTOPMode (PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+            clock_restoreAfterStop ();
+            uartWakeup = disarmUartWakeup ();
+        }
+    else
+        {
+            __DSB();
+            __WFI();
+            __ISB();
+        }
+    uint32_t sleptUs = subsecToUs (
+            (readRtcSubsec () + RTC_SUBSEC_PER_DAY - sleepStart)
+                    % RTC_SUBSEC_PER_DAY);
+
+    HAL_RTCEx_DeactivateWakeUpTimer (&hrtc);
+    __HAL_RTC_WAKEUPTIMER_CLEAR_FLAG(&hrtc, RTC_FLAG_WUTF);
+    __HAL_RTC_WAKEUPTIMER_EXTI_CLEAR_FLAG();
+    HAL_NVIC_ClearPendingIRQ (RTC_WKUP_IRQn);
+
+    /* compensate ticks from RTC time, fraction of tick is carried over */
+    uint32_t elapsedUs = base.residualUs + sleptUs;
+    uint32_t ticks = elapsedUs / US_PER_TICK;
+    base.residualUs = elapsedUs % US_PER_TICK;
+    if (ticks >= expectedIdleTime)
+        {
+            /* last tick of idle time is always counted by tick interrupt */
+            ticks = expectedIdleTime - 1;
+            base.residualUs = US_PER_TICK - 1;
+        }
+    restartTick (cyclesPerTick);
+    vTaskStepTick (ticks);
+
+    if (stop)
+        {
+            base.stats.stops++;
+            base.stats.stopUs += sleptUs;
+        }
+    else
+        {
+            base.stats.sleeps++;
+            base.stats.sleepUs += sleptUs;
+        }
+    if (uartWakeup)
+        {
+            /* first character is lost, keep UART running for the rest of input */
+            base.stats.uartWakeups++;
+            base.lastUartActivity = now + ticks;
+        }
+
+    __enable_irq ();
+}
+
+/* === interrupt handlers === */
+void
+RTC_WKUP_IRQHandler (void)
+{
+    TRACE_IRQ_ENTER(RTC_WKUP_IRQn);
+    HAL_RTCEx_WakeUpTimerIRQHandler (&hrtc);
+    TRACE_IRQ_EXIT(RTC_WKUP_IRQn);
+}
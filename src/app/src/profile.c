@@ -0,0 +1,449 @@
+/*
+ * profile.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ *
+ *      Page layout: struct PageHeader, then records until first word which is not a record header.
+ *      Record layout: struct RecordHeader, payload padded to 4 bytes, CRC32 of everything after magic.
+ *      Record is programmed from the lowest address, so interrupted write leaves either a record
+ *      with bad CRC, skipped on read, or a broken header which ends the log and forces compaction.
+ */
+#include "profile.h"
+#include <string.h>
+#include <stddef.h>
+
+#define PAGE_MAGIC          0x31465250UL                                        // "PRF1"
+#define PAGE_COMMITTED      0x00000000UL                                        // programmed after page content is complete
+#define RECORD_MAGIC        0xA55A
+
+#define RECORD_PROFILE      0x01                                                // struct ProfilePayload
+#define RECORD_DEFAULT      0x02                                                // name of profile applied at boot
+
+#define ALIGN4(n)           (((n) + 3UL) & ~3UL)
+#define CRC_SIZE            4
+#define RECORD_SIZE(len)    (sizeof(struct RecordHeader) + ALIGN4(len) + CRC_SIZE)
+#define MAX_RECORD_SIZE     RECORD_SIZE(sizeof(struct ProfilePayload))
+#define NO_RECORD           0                                                   // offset 0 holds page header
+
+/* === private types === */
+struct PageHeader
+{
+    uint32_t magic, sequence, commit, reserved;
+};
+
+struct RecordHeader
+{
+    uint16_t magic;
+    uint8_t type, len;
+};
+
+struct ProfilePayload
+{
+    char name[PROFILE_NAME_LEN];
+    struct profile_Config config;
+};
+
+/* === private variables === */
+static struct Base
+{
+    const struct profile_Flash *flash;
+    uint8_t activePage;
+    uint32_t sequence;
+    uint32_t writeOffset;                                                       // end of log in active page
+    char nameBuf[PROFILE_NAME_LEN];                                             // returned by name getters
+} base;
+
+/* === private functions === */
+static const uint8_t*
+pageData (uint8_t page)
+{
+    return base.flash->base + (uint32_t) page * base.flash->pageSize;
+}
+
+static uint32_t
+pageOffset (uint8_t page)
+{
+    return (uint32_t) page * base.flash->pageSize;
+}
+
+/* Read record header at offset of page. Returns false at end of log, *valid tells if CRC matches */
+static bool
+readRecord (uint8_t page, uint32_t offset, struct RecordHeader *hdr,
+            bool *valid)
+{
+    if (offset + RECORD_SIZE(0) > base.flash->pageSize)
+        {
+            return false;
+        }
+    memcpy (hdr, pageData (page) + offset, sizeof(*hdr));
+    if (hdr->magic != RECORD_MAGIC
+            || (hdr->type != RECORD_PROFILE && hdr->type != RECORD_DEFAULT)
+            || offset + RECORD_SIZE(hdr->len) > base.flash->pageSize)
+        {
+            return false;
+        }
+
+    const uint8_t *rec = pageData (page) + offset;
+    uint32_t crc;
+    memcpy (&crc, rec + RECORD_SIZE(hdr->len) - CRC_SIZE, CRC_SIZE);
+    *valid = crc
+            == profile_crc32 (rec + offsetof(struct RecordHeader, type),
+                              RECORD_SIZE(hdr->len) - CRC_SIZE
+                                      - offsetof(struct RecordHeader, type));
+    return true;
+}
+
+/* Name stored in record payload, both record types start with it */
+static const char*
+recordName (uint8_t page, uint32_t offset)
+{
+    return (const char*) pageData (page) + offset + sizeof(struct RecordHeader);
+}
+
+/* Check if no later valid record of the same type and name exists */
+static bool
+isNewest (uint8_t page, uint32_t offset)
+{
+    struct RecordHeader hdr, next;
+    bool valid;
+
+    readRecord (page, offset, &hdr, &valid);
+    for (uint32_t o = offset + RECORD_SIZE(hdr.len);
+            readRecord (page, o, &next, &valid); o += RECORD_SIZE(next.len))
+        {
+            if (valid && next.type == hdr.type
+                    && (hdr.type == RECORD_DEFAULT
+                            || 0
+                                    == strncmp (recordName (page, o),
+                                                recordName (page, offset),
+                                                PROFILE_NAME_LEN)))
+                {
+                    return false;
+                }
+        }
+    return true;
+}
+
+/* Offset of newest valid record of given type (and name for profiles), NO_RECORD if none */
+static uint32_t
+findRecord (uint8_t type, const char *name)
+{
+    struct RecordHeader hdr;
+    bool valid;
+    uint32_t found = NO_RECORD;
+
+    for (uint32_t o = sizeof(struct PageHeader);
+            readRecord (base.activePage, o, &hdr, &valid);
+            o += RECORD_SIZE(hdr.len))
+        {
+            if (valid && hdr.type == type
+                    && (name == NULL
+                            || 0
+                                    == strncmp (recordName (base.activePage, o),
+                                                name, PROFILE_NAME_LEN)))
+                {
+                    found = o;
+                }
+        }
+    return found;
+}
+
+static bool
+isBlank (uint8_t page, uint32_t offset, uint32_t len)
+{
+    const uint8_t *p = pageData (page) + offset;
+    for (uint32_t i = 0; i < len; i++)
+        {
+            if (p[i] != 0xFF)
+                {
+                    return false;
+                }
+        }
+    return true;
+}
+
+static uint32_t
+findLogEnd (uint8_t page)
+{
+    struct RecordHeader hdr;
+    bool valid;
+    uint32_t o = sizeof(struct PageHeader);
+
+    while (readRecord (page, o, &hdr, &valid))
+        {
+            o += RECORD_SIZE(hdr.len);
+        }
+    return o;
+}
+
+/* Start new page of the ring with given sequence number, content follows before commit */
+static bool
+startPage (uint8_t page, uint32_t sequence)
+{
+    struct PageHeader hdr =
+        { PAGE_MAGIC, sequence, 0xFFFFFFFFUL, 0xFFFFFFFFUL };
+
+    return base.flash->erasePage (page)
+            && base.flash->program (pageOffset (page), &hdr, sizeof(hdr));
+}
+
+static bool
+commitPage (uint8_t page)
+{
+    uint32_t commit = PAGE_COMMITTED;
+
+    return base.flash->program (
+            pageOffset (page) + offsetof(struct PageHeader, commit), &commit,
+            sizeof(commit));
+}
+
+/* Copy newest valid records to next page of the ring and make it active */
+static enum profile_Status
+compact ()
+{
+    uint8_t next = (base.activePage + 1) % base.flash->numOfPages;
+    uint32_t dst = sizeof(struct PageHeader);
+    struct RecordHeader hdr;
+    bool valid;
+
+    if (!startPage (next, base.sequence + 1))
+        {
+            return PROFILE_FLASH_ERROR;
+        }
+    for (uint32_t o = sizeof(struct PageHeader);
+            readRecord (base.activePage, o, &hdr, &valid);
+            o += RECORD_SIZE(hdr.len))
+        {
+            if (valid && isNewest (base.activePage, o))
+                {
+                    if (!base.flash->program (pageOffset (next) + dst,
+                                              pageData (base.activePage) + o,
+                                              RECORD_SIZE(hdr.len)))
+                        {
+                            return PROFILE_FLASH_ERROR;
+                        }
+                    dst += RECORD_SIZE(hdr.len);
+                }
+        }
+    if (!commitPage (next))
+        {
+            return PROFILE_FLASH_ERROR;
+        }
+    base.activePage = next;
+    base.sequence++;
+    base.writeOffset = dst;
+    return PROFILE_OK;
+}
+
+static enum profile_Status
+append (uint8_t type, const void *payload, uint8_t len)
+{
+    uint8_t rec[MAX_RECORD_SIZE];
+    uint32_t size = RECORD_SIZE(len);
+    struct RecordHeader hdr =
+        { RECORD_MAGIC, type, len };
+
+    /* full page or leftovers of interrupted write: continue in the next page */
+    if (base.writeOffset + size > base.flash->pageSize
+            || !isBlank (base.activePage, base.writeOffset, size))
+        {
+            enum profile_Status status = compact ();
+            if (status != PROFILE_OK)
+                {
+                    return status;
+                }
+            if (base.writeOffset + size > base.flash->pageSize)
+                {
+                    return PROFILE_FULL;
+                }
+        }
+
+    memset (rec, 0, sizeof(rec));
+    memcpy (rec, &hdr, sizeof(hdr));
+    memcpy (rec + sizeof(hdr), payload, len);
+    uint32_t crc = profile_crc32 (rec + offsetof(struct RecordHeader, type),
+                                  size - CRC_SIZE
+                                          - offsetof(struct RecordHeader, type));
+    memcpy (rec + size - CRC_SIZE, &crc, CRC_SIZE);
+
+    if (!base.flash->program (pageOffset (base.activePage) + base.writeOffset,
+                              rec, size))
+        {
+            return PROFILE_FLASH_ERROR;
+        }
+    base.writeOffset += size;
+    return PROFILE_OK;
+}
+
+static bool
+isNameValid (const char *name)
+{
+    size_t len = strnlen (name, PROFILE_NAME_LEN);
+    return len > 0 && len < PROFILE_NAME_LEN;
+}
+
+/* === exported functions === */
+enum profile_Status
+profile_init (const struct profile_Flash *flash)
+{
+    struct PageHeader hdr;
+    bool found = false;
+
+    base.flash = flash;
+    for (uint8_t page = 0; page < flash->numOfPages; page++)
+        {
+            memcpy (&hdr, pageData (page), sizeof(hdr));
+            if (hdr.magic == PAGE_MAGIC && hdr.commit == PAGE_COMMITTED
+                    && (!found || hdr.sequence > base.sequence))
+                {
+                    found = true;
+                    base.activePage = page;
+                    base.sequence = hdr.sequence;
+                }
+        }
+
+    if (!found)
+        {
+            /* format */
+            base.activePage = 0;
+            base.sequence = 0;
+            if (!startPage (0, 0) || !commitPage (0))
+                {
+                    return PROFILE_FLASH_ERROR;
+                }
+        }
+    base.writeOffset = findLogEnd (base.activePage);
+    return PROFILE_OK;
+}
+
+enum profile_Status
+profile_save (const char *name, const struct profile_Config *config)
+{
+    struct ProfilePayload payload;
+
+    if (!isNameValid (name))
+        {
+            return PROFILE_INVALID_NAME;
+        }
+
+    uint32_t o = findRecord (RECORD_PROFILE, name);
+    if (o != NO_RECORD)
+        {
+            /* saving the same content again only wears flash */
+            memcpy (&payload, recordName (base.activePage, o), sizeof(payload));
+            if (0 == memcmp (&payload.config, config, sizeof(*config)))
+                {
+                    return PROFILE_OK;
+                }
+        }
+    else if (profile_getName (PROFILE_MAX_PROFILES - 1) != NULL)
+        {
+            return PROFILE_FULL;
+        }
+
+    memset (&payload, 0, sizeof(payload));
+    strncpy (payload.name, name, PROFILE_NAME_LEN - 1);
+    payload.config = *config;
+    return append (RECORD_PROFILE, &payload, sizeof(payload));
+}
+
+enum profile_Status
+profile_load (const char *name, struct profile_Config *config)
+{
+    struct ProfilePayload payload;
+    uint32_t o = findRecord (RECORD_PROFILE, name);
+
+    if (o == NO_RECORD)
+        {
+            return PROFILE_NOT_FOUND;
+        }
+    memcpy (&payload, recordName (base.activePage, o), sizeof(payload));
+    *config = payload.config;
+    return PROFILE_OK;
+}
+
+enum profile_Status
+profile_setDefault (const char *name)
+{
+    char payload[PROFILE_NAME_LEN] =
+        { 0 };
+    const char *current = profile_getDefault ();
+
+    if (!isNameValid (name))
+        {
+            return PROFILE_INVALID_NAME;
+        }
+    if (NO_RECORD == findRecord (RECORD_PROFILE, name))
+        {
+            return PROFILE_NOT_FOUND;
+        }
+    if (current != NULL && 0 == strncmp (current, name, PROFILE_NAME_LEN))
+        {
+            return PROFILE_OK;
+        }
+    strncpy (payload, name, PROFILE_NAME_LEN - 1);
+    return append (RECORD_DEFAULT, payload, sizeof(payload));
+}
+
+const char*
+profile_getDefault (void)
+{
+    uint32_t o = findRecord (RECORD_DEFAULT, NULL);
+
+    if (o == NO_RECORD)
+        {
+            return NULL;
+        }
+    memcpy (base.nameBuf, recordName (base.activePage, o), PROFILE_NAME_LEN);
+    base.nameBuf[PROFILE_NAME_LEN - 1] = '\0';
+    return base.nameBuf;
+}
+
+const char*
+profile_getName (uint8_t n)
+{
+    struct RecordHeader hdr;
+    bool valid;
+
+    for (uint32_t o = sizeof(struct PageHeader);
+            readRecord (base.activePage, o, &hdr, &valid);
+            o += RECORD_SIZE(hdr.len))
+        {
+            if (valid && hdr.type == RECORD_PROFILE
+                    && isNewest (base.activePage, o) && n-- == 0)
+                {
+                    memcpy (base.nameBuf, recordName (base.activePage, o),
+                            PROFILE_NAME_LEN);
+                    base.nameBuf[PROFILE_NAME_LEN - 1] = '\0';
+                    return base.nameBuf;
+                }
+        }
+    return NULL;
+}
+
+void
+profile_getInfo (struct profile_Info *info)
+{
+    info->sequence = base.sequence;
+    info->activePage = base.activePage;
+    info->usedBytes = base.writeOffset;
+    info->freeBytes = base.flash->pageSize - base.writeOffset;
+}
+
+uint32_t
+profile_crc32 (const void *data, uint32_t len)
+{
+    const uint8_t *p = data;
+    uint32_t crc = 0xFFFFFFFFUL;
+
+    while (len--)
+        {
+            crc ^= *p++;
+            for (uint8_t bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc >> 1) ^ (0xEDB88320UL & -(crc & 1));
+                }
+        }
+    return ~crc;
+}
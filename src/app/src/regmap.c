@@ -0,0 +1,198 @@
+/*
+ * regmap.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "regmap.h"
+#include <string.h>
+
+#define REG_BIT(reg)        (1ULL << (reg))
+#define MAX_BURST_LEN       16                                                  // registers in single merged read
+
+/* === private functions === */
+static void
+countTransaction (struct regmap_Map *map, uint8_t op)
+{
+    assert_param(op < REGMAP_MAX_OPS);
+    map->stats[op].transactions++;
+}
+
+static uint8_t
+burstAddress (const struct regmap_Map *map, uint8_t reg, uint8_t len)
+{
+    return len > 1 ? (reg | map->autoIncrement) : reg;
+}
+
+/* === exported functions === */
+void
+regmap_init (struct regmap_Map *map, uint8_t slaveAddr, uint8_t autoIncrement)
+{
+    memset (map, 0, sizeof(*map));
+    map->slaveAddr = slaveAddr;
+    map->autoIncrement = autoIncrement;
+}
+
+void
+regmap_setNoIncidentalRead (struct regmap_Map *map, uint64_t mask)
+{
+    map->noIncidentalRead = mask;
+}
+
+void
+regmap_invalidate (struct regmap_Map *map)
+{
+    map->valid = 0;
+    map->dirty = 0;
+}
+
+void
+regmap_countOp (struct regmap_Map *map, uint8_t op)
+{
+    assert_param(op < REGMAP_MAX_OPS);
+    map->stats[op].ops++;
+}
+
+void
+regmap_write (struct regmap_Map *map, uint8_t reg, uint8_t value)
+{
+    assert_param(reg < REGMAP_SIZE);
+    if ((map->valid & REG_BIT(reg)) && map->shadow[reg] == value)
+        {
+            map->writesSkipped++;
+            return;
+        }
+    map->shadow[reg] = value;
+    map->valid |= REG_BIT(reg);
+    map->dirty |= REG_BIT(reg);
+}
+
+void
+regmap_update (struct regmap_Map *map, uint8_t reg, uint8_t mask,
+               uint8_t value)
+{
+    regmap_write (map, reg, (map->shadow[reg] & ~mask) | (value & mask));
+}
+
+uint8_t
+regmap_get (const struct regmap_Map *map, uint8_t reg)
+{
+    return map->shadow[reg];
+}
+
+enum I2C_Status
+regmap_flush (struct regmap_Map *map, uint8_t op)
+{
+    enum I2C_Status status = I2C_SUCCES;
+    uint8_t reg = 0;
+
+    map->stats[op].writesSkipped += map->writesSkipped;
+    map->writesSkipped = 0;
+
+    while (map->dirty != 0 && reg < REGMAP_SIZE)
+        {
+            if (!(map->dirty & REG_BIT(reg)))
+                {
+                    reg++;
+                    continue;
+                }
+
+            /* find run of consecutive dirty registers */
+            uint8_t len = 1;
+            while (reg + len < REGMAP_SIZE && (map->dirty & REG_BIT(reg + len)))
+                {
+                    len++;
+                }
+
+            countTransaction (map, op);
+            if (I2C_SUCCES
+                    == I2C_writeByteStream (map->slaveAddr,
+                                            burstAddress (map, reg, len),
+                                            &map->shadow[reg], len))
+                {
+                    for (uint8_t i = 0; i < len; i++)
+                        {
+                            map->dirty &= ~REG_BIT(reg + i);
+                        }
+                }
+            else
+                {
+                    status = I2C_FAILURE;
+                }
+            reg += len;
+        }
+    return status;
+}
+
+enum I2C_Status
+regmap_writeThrough (struct regmap_Map *map, uint8_t op, uint8_t reg,
+                     uint8_t value)
+{
+    map->shadow[reg] = value;
+    map->valid |= REG_BIT(reg);
+    map->dirty &= ~REG_BIT(reg);
+    countTransaction (map, op);
+    return I2C_writeByteStream (map->slaveAddr, reg, &value, 1);
+}
+
+enum I2C_Status
+regmap_read (struct regmap_Map *map, uint8_t op, uint8_t startingReg,
+             uint8_t *pData, uint8_t numOfRegisters)
+{
+    countTransaction (map, op);
+    return I2C_readByteStream (map->slaveAddr,
+                               burstAddress (map, startingReg, numOfRegisters),
+                               pData, numOfRegisters);
+}
+
+enum I2C_Status
+regmap_readList (struct regmap_Map *map, uint8_t op, const uint8_t *regs,
+                 uint8_t *pData, uint8_t numOfRegisters)
+{
+    uint8_t burst[MAX_BURST_LEN];
+    uint8_t first = 0;
+
+    while (first < numOfRegisters)
+        {
+            /* extend burst while next register is close and gap is safe to read */
+            uint8_t last = first;
+            while (last + 1 < numOfRegisters)
+                {
+                    uint8_t from = regs[last] + 1, to = regs[last + 1];
+                    bool mergeable = (to - regs[first] < MAX_BURST_LEN)
+                            && (to - from <= REGMAP_MAX_READ_GAP);
+                    for (uint8_t r = from; mergeable && r < to; r++)
+                        {
+                            if (map->noIncidentalRead & REG_BIT(r))
+                                {
+                                    mergeable = false;
+                                }
+                        }
+                    if (!mergeable)
+                        {
+                            break;
+                        }
+                    last++;
+                }
+
+            uint8_t len = regs[last] - regs[first] + 1;
+            enum I2C_Status status = regmap_read (map, op, regs[first], burst,
+                                                 len);
+            if (status != I2C_SUCCES)
+                {
+                    return status;
+                }
+            for (uint8_t i = first; i <= last; i++)
+                {
+                    pData[i] = burst[regs[i] - regs[first]];
+                }
+            first = last + 1;
+        }
+    return I2C_SUCCES;
+}
+
+const struct regmap_OpStats*
+regmap_getStats (const struct regmap_Map *map, uint8_t op)
+{
+    return &map->stats[op];
+}
@@ -19,13 +19,14 @@ void RTC_init(void) {
 
 	/* RTC parameters init.*/
 	hrtc.Instance = RTC;
-	hrtc.Init.AsynchPrediv = 127;
-	hrtc.Init.SynchPrediv = 255;
+	hrtc.Init.AsynchPrediv = RTC_ASYNCH_PREDIV;                                 // fine sub seconds for tickless idle
+	hrtc.Init.SynchPrediv = RTC_SYNCH_PREDIV;
 	hrtc.Init.HourFormat = RTC_HOURFORMAT_24;
 	hrtc.Init.OutPut = RTC_OUTPUT_DISABLE;
 	if (HAL_OK != HAL_RTC_Init(&hrtc)) {
 		errorHandler();
 	};
+	HAL_RTCEx_EnableBypassShadow(&hrtc);                                        // registers are valid right after STOP mode
 
 	RTC_TimeTypeDef rtcTime = { 0 };
 	HAL_RTC_SetTime(&hrtc, &rtcTime, RTC_FORMAT_BIN);
@@ -8,12 +8,16 @@
 #include "stm32f3xx_hal.h"
 #include "main.h"
 #include "i2c.h"
+#include "regmap.h"
+#include "systime.h"
+#include "pipeline.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include "task.h"
 #include "stdbool.h"
 
-#define SENSOR_ADDR                     0x3A
+#define SENSOR_ADDR_SA0_HIGH            0x3A
+#define SENSOR_ADDR_SA0_LOW             0x3C
 
 /* registers and register bit patterns */
 
@@ -25,6 +29,7 @@
 #define OUT_Z_L_M                   0x0C
 #define OUT_Z_H_M                   0x0D
 #define WHO_AM_I                    0x0F
+#define     WHO_AM_I_VAL                0x49
 #define INT_CTRL_M                  0x12
 #define INT_SRC_M                   0x13
 #define INT_THS_L_M                 0x14
@@ -119,7 +124,12 @@
 
 #define IG_CFG1                     0x30
 #define		IG_CFG1_EN_ALL              0x3F
-#define IG_SRC1
+#define     IG_CFG_AOI                  0x80                                    // AND combination of enabled events
+#define     IG_CFG_ZLIE                 0x10
+#define     IG_CFG_YLIE                 0x04
+#define     IG_CFG_XLIE                 0x01
+#define IG_SRC1                     0x31
+#define     IG_SRC_IA                   0x40                                    // interrupt active
 #define IG_THS1                     0x32
 #define IG_DUR1                     0x33
 #define IG_CFG2                     0x34
@@ -134,9 +144,13 @@
 #define     CLICK_CFG_ENABLE_SGL_CLICK  0x15
 
 #define CLICK_SRC                   0x39
-#define     CLICK_SRC_DBL_CLICK_ENABLE  0x20
-#define     CLICK_SRC_SGL_CLICK_ENABLE  0x10
+#define     CLICK_SRC_IA                0x40                                    // interrupt active
+#define     CLICK_SRC_DBL_CLICK         0x20
+#define     CLICK_SRC_SGL_CLICK         0x10
+#define     CLICK_SRC_SIGN              0x08                                    // negative acceleration
 #define     CLICK_SRC_Z                 0x04
+#define     CLICK_SRC_Y                 0x02
+#define     CLICK_SRC_X                 0x01
 
 #define CLICK_THS                   0x3A
 
@@ -151,166 +165,622 @@
 #define CLICK_THS_VAL               0x02
 #define TIME_LIMIT_VAL              0x2F
 
+/* click setup at bring-up, same as former fixed register values at 2 g and 400 Hz */
+#define CLICK_DEFAULT_THS_MG            47
+#define CLICK_DEFAULT_LIMIT_MS          28
+#define CLICK_DEFAULT_LATENCY_MS        25
+#define CLICK_DEFAULT_WINDOW_MS         25
+
 #define AUTO_ADDR_INC                   0x80
 
-#define INT1_GPIO_PORT                  GPIOC
-#define INT1_GPIO_PIN                   GPIO_PIN_0
-#define INT2_GPIO_PORT                  GPIOC
-#define INT2_GPIO_PIN                   GPIO_PIN_1
+/* event thresholds have LSB of full scale / 128, event times LSB of 1 / ODR */
+#define THS_STEPS                       128
+#define PERIODS_7BIT_MAX                127
+#define PERIODS_8BIT_MAX                255
+
+/* free fall: all axes below threshold */
+#define FREE_FALL_CFG                   (IG_CFG_AOI | IG_CFG_ZLIE | IG_CFG_YLIE | IG_CFG_XLIE)
 
-#define EVT_NOTIFICATION_QUEUE_LEN      3
+#define BOOT_POLL_PERIOD_MS             1
+#define BOOT_TIMEOUT_MS                 20                                      // boot takes about 5 ms
+
+#define EVT_NOTIFICATION_QUEUE_LEN      (3 * SENSOR_MAX_INSTANCES)
+#define NO_INSTANCE                     0xFF
 #define AUX_TAB_LEN                     10
 #define MAX_INT16_VAL                   32767
 
+/* registers cleared by reading, never read just to merge neighbouring reads */
+#define READ_CLEARED_REGS               ((1ULL << INT_SRC_M) | (1ULL << IG_SRC1) \
+                                        | (1ULL << IG_SRC2) | (1ULL << CLICK_SRC))
+
+/* I2C bus usage of single data read: status and 6 data registers read in one burst,
+ * write of register address followed by repeated transfer with read. */
+#define I2C_READ_BITS(n)                ((1 + 9 + 9 + 1) + (1 + 9 + 9 * (n) + 1))
+#define BUS_BITS_PER_SAMPLE             I2C_READ_BITS(1 + ACC_XYZ_DATA_SIZE)
+#define BUS_LOAD_LIMIT_PERCENT          90                                      // leave room for event handling and config writes
+
+/* === private types === */
+
+enum State {
+    STATE_IDLE, STATE_ACTIVE
+};
+
+enum EventNotification {
+    NEW_DATA, NEW_DETECTION, GO_ACTIVE, APPLY_CONFIG
+};
+
+/** notification sent from EXTI callback, sensor_start() or sensor_changeAccConfig() to sensor_task */
+struct EventMsg {
+    enum EventNotification type;
+    uint8_t sensorIdx;
+    uint32_t timeMs;                                                            // tick time of interrupt
+    uint32_t cycles;                                                            // cycle counter at interrupt
+};
+
+/** board wiring of single sensor */
+struct InstanceHw {
+    uint8_t addr;                                                               // 8 bit I2C address
+    GPIO_TypeDef *int1Port;                                                     // INT1 - data ready
+    uint16_t int1Pin;
+    IRQn_Type int1IRQn;
+    GPIO_TypeDef *int2Port;                                                     // INT2 - event detection
+    uint16_t int2Pin;
+    IRQn_Type int2IRQn;
+};
+
+struct Instance {
+    const struct InstanceHw *hw;
+    struct regmap_Map regs;                                                     // register shadow and bus statistics
+    struct sensor_AccConfig acc;                                                // accelerometer setup
+    struct sensor_AccConfig requestedAcc;                                       // setup to apply at next sample boundary
+    volatile bool accRequested;                                                 // requestedAcc not applied yet
+    uint16_t freeFallMg, freeFallMs;                                            // free fall setup, threshold 0 disables
+    struct sensor_ClickConfig click;                                            // click setup in physical units
+    uint32_t detectionMs,                                                       // time of pending detection
+            detectionCycles;                                                    // cycle counter at its interrupt
+};
+
+/* === private variables === */
+static const struct InstanceHw instanceHw[SENSOR_MAX_INSTANCES] = {
+    { SENSOR_ADDR_SA0_HIGH, GPIOC, GPIO_PIN_0, EXTI0_IRQn, GPIOC, GPIO_PIN_1, EXTI1_IRQn },
+    { SENSOR_ADDR_SA0_LOW, GPIOC, GPIO_PIN_2, EXTI2_TSC_IRQn, GPIOC, GPIO_PIN_3, EXTI3_IRQn }
+};
+
+/* registers read on data ready, adjacent so they are read in one burst */
+static const uint8_t dataRegs[1 + ACC_XYZ_DATA_SIZE] = {
+    STATUS_A, OUT_X_L_A, OUT_X_H_A, OUT_Y_L_A, OUT_Y_H_A, OUT_Z_L_A, OUT_Z_H_A
+};
+
+static struct Base {
+    struct Instance instances[SENSOR_MAX_INSTANCES];                            // sensors found on the bus
+    uint8_t numOfInstances;
+    enum State state;                                                           // sensor state
+    SemaphoreHandle_t readySemph;                                               // given when bring-up is done
+    QueueHandle_t sensorOutputQueue,                                            // public queue with sensor output.
+                            sensorEventQueue,                                   // public queue with detected events
+                            evtQueue;                                           // private queue for handling sensor evt notifications
+                                                                                // and start requests, contains struct EventMsg
+    uint8_t pendingData,                                                        // bit per instance with data ready notification
+            pendingDetection,                                                   // bit per instance with event detection notification
+            pendingConfig,                                                      // bit per instance with setup change requested
+            lastServed;                                                         // instance served most recently, for round robin
+    struct sensor_AccConfig bootConfig[SENSOR_MAX_INSTANCES];                   // setup applied at bring-up
+    bool bootConfigValid;
+    uint8_t auxTab[AUX_TAB_LEN];
+    uint8_t rateMeasured;                                                       // instance with data ready edges time stamped
+    struct odr_Window rateWindow;                                               // written by EXTI interrupt
+} base;
+
 /* === private functions === */
 /* Init gpio EXTI lines for sensor INT1 and INT2 lines */
-inline void initExtiLines() {
+static void initExtiLines(const struct InstanceHw *hw) {
     __HAL_RCC_GPIOC_CLK_ENABLE();
 
     /* init GPIOs */
     GPIO_InitTypeDef gpioInit = { 0 };
-    gpioInit.Pin = INT1_GPIO_PIN;
+    gpioInit.Pin = hw->int1Pin;
     gpioInit.Mode = GPIO_MODE_IT_RISING;
     gpioInit.Pull = GPIO_NOPULL;
-    HAL_GPIO_Init(INT1_GPIO_PORT, &gpioInit);
-    gpioInit.Pin = INT2_GPIO_PIN;
-    gpioInit.Mode = GPIO_MODE_IT_FALLING;
-    HAL_GPIO_Init(INT2_GPIO_PORT, &gpioInit);
+    HAL_GPIO_Init(hw->int1Port, &gpioInit);
+    gpioInit.Pin = hw->int2Pin;
+    gpioInit.Mode = GPIO_MODE_IT_RISING;                                        // event sources are read while still active
+    HAL_GPIO_Init(hw->int2Port, &gpioInit);
 
     /* init EXTI */
-    HAL_NVIC_SetPriority(EXTI0_IRQn, 10, 10);
-    HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+    HAL_NVIC_SetPriority(hw->int1IRQn, 10, 10);
+    HAL_NVIC_EnableIRQ(hw->int1IRQn);
+
+    HAL_NVIC_SetPriority(hw->int2IRQn, 8, 8);
+    HAL_NVIC_EnableIRQ(hw->int2IRQn);
+}
+
+static uint32_t rateToInt(enum sensor_AccRate rate) {
+    switch (rate) {
+    case SENSOR_ACC_RATE_POWER_DOWN:
+        return 0;
+        break;
+    case SENSOR_ACC_RATE_3HZ125:
+        return 3125;
+        break;
+    case SENSOR_ACC_RATE_6HZ25:
+        return 6250;
+        break;
+    case SENSOR_ACC_RATE_12HZ5:
+        return 12500;
+        break;
+    case SENSOR_ACC_RATE_25HZ:
+        return 25000;
+        break;
+    case SENSOR_ACC_RATE_50HZ:
+        return 50000;
+        break;
+    case SENSOR_ACC_RATE_100HZ:
+        return 100000;
+        break;
+    case SENSOR_ACC_RATE_200HZ:
+        return 200000;
+        break;
+    case SENSOR_ACC_RATE_400HZ:
+        return 400000;
+        break;
+    case SENSOR_ACC_RATE_800HZ:
+        return 800000;
+        break;
+    case SENSOR_ACC_RATE_1600HZ:
+    default:
+        return 1600000;
+        break;
+    }
+}
 
-    HAL_NVIC_SetPriority(EXTI1_IRQn, 8, 8);
-    HAL_NVIC_EnableIRQ(EXTI1_IRQn);
+/* bus bits per second needed to read data of all instances, with instance idx at given rate */
+static uint32_t busDemand(uint8_t idx, enum sensor_AccRate rate) {
+    uint32_t demand = 0;
+    for (uint8_t i = 0; i < base.numOfInstances; i++) {
+        enum sensor_AccRate r = (i == idx) ? rate : base.instances[i].acc.rate;
+        demand += rateToInt(r) / 1000 * BUS_BITS_PER_SAMPLE;
+    }
+    return demand;
 }
 
-static void writeSensorRegisters(uint8_t startingReg, uint8_t *data, uint8_t numOfRegisters) {
-    I2C_writeByteStream(SENSOR_ADDR, startingReg | AUTO_ADDR_INC, data, numOfRegisters);
+/* restart rate measurement window, nominal rate may have changed */
+static void restartRateMeasurement(uint8_t idx) {
+    if (idx != NO_INSTANCE && base.rateMeasured == idx) {
+        taskENTER_CRITICAL();
+        odr_start(&base.rateWindow, rateToInt(base.instances[idx].acc.rate));
+        taskEXIT_CRITICAL();
+    }
 }
 
-static void writeSensorRegister(uint8_t reg, uint8_t data) {
-    I2C_writeByteStream(SENSOR_ADDR, reg, &data, 1);
+/* rate fits on the bus together with data reads of other instances */
+static bool rateFits(uint8_t idx, enum sensor_AccRate rate) {
+    return busDemand(idx, rate) <= I2C_getBusFrequency() / 100 * BUS_LOAD_LIMIT_PERCENT;
 }
 
-static void readSensorRegister(uint8_t reg, uint8_t *data) {
-    I2C_readByteStream(SENSOR_ADDR, reg, data, 1);
+/* event threshold register value, LSB is full scale / 128 */
+static uint8_t thsToReg(uint8_t idx, uint16_t mg) {
+    uint32_t fullScaleMg = sensor_getAccFullScaleInt(idx) * 1000UL;
+    uint32_t ths = (mg * THS_STEPS + fullScaleMg / 2) / fullScaleMg;
+    return ths < 1 ? 1 : (ths >= THS_STEPS ? THS_STEPS - 1 : ths);
 }
 
-static void readSensorRegisters(uint8_t startingReg, uint8_t *data, uint8_t numOfRegisters) {
-    I2C_readByteStream(SENSOR_ADDR, startingReg | AUTO_ADDR_INC, data, numOfRegisters);
+static uint16_t regToThs(uint8_t idx, uint8_t reg) {
+    return reg * sensor_getAccFullScaleInt(idx) * 1000UL / THS_STEPS;
 }
 
-/* === private types === */
+/* event time register value, LSB is one sample period */
+static uint8_t msToPeriods(uint8_t idx, uint16_t ms, uint8_t max) {
+    uint32_t periods = ((uint64_t) ms * sensor_getAccRateInt(idx) + 500000) / 1000000;
+    return periods > max ? max : periods;
+}
 
-enum State {
-    STATE_IDLE, STATE_ACTIVE
-};
+static uint16_t periodsToMs(uint8_t idx, uint8_t periods) {
+    uint32_t rate = sensor_getAccRateInt(idx);
+    return rate == 0 ? 0 : periods * 1000000ULL / rate;
+}
 
-enum EventNotification {
-    NEW_DATA, NEW_DETECTION
-};
+static bool msFits(uint8_t idx, uint16_t ms, uint8_t max) {
+    return (uint64_t) ms * sensor_getAccRateInt(idx) <= max * 1000000ULL;
+}
 
-struct Acc {
-    enum sensor_AccFullScale fullScale;
-    enum sensor_AccRate rate;
-    enum sensor_AccAAFilterBW AAFilterBW;
-};
+/* write free fall setup to register shadow, resolution follows full scale and rate */
+static void stageFreeFall(uint8_t idx) {
+    struct Instance *inst = &base.instances[idx];
+    if (inst->freeFallMg == 0) {
+        regmap_write(&inst->regs, IG_CFG1, 0);
+        return;
+    }
+    regmap_write(&inst->regs, IG_THS1, thsToReg(idx, inst->freeFallMg));
+    regmap_write(&inst->regs, IG_DUR1, msToPeriods(idx, inst->freeFallMs, PERIODS_7BIT_MAX));
+    regmap_write(&inst->regs, IG_CFG1, FREE_FALL_CFG);
+}
 
-/* === private variables === */
-static struct Base {
-    struct Acc acc;                                                             // accelerometer setup
-    enum State state;                                                           // sensor state
-    SemaphoreHandle_t goActiveSemph;                                            // semaphore given by sensor_start() to make
-                                                                                // sensor_task start reading data from sensor.
-    QueueHandle_t sensorOutputQueue,                                            // public queue with sensor output.
-                            evtQueue;                                           // private queue for handling sensor evt notifications.
-                                                                                // Queue contain objects of type enum EventNotification
-    uint8_t auxTab[AUX_TAB_LEN];
-} base;
+/* write click setup to register shadow, single click on all axes, double click unless window is 0 */
+static void stageClick(uint8_t idx) {
+    struct Instance *inst = &base.instances[idx];
+    const struct sensor_ClickConfig *click = &inst->click;
+    regmap_write(&inst->regs, CLICK_CFG, CLICK_CFG_ENABLE_SGL_CLICK
+            | (click->windowMs != 0 ? CLICK_CFG_ENABLE_DBL_CLICK : 0));
+    regmap_write(&inst->regs, CLICK_THS, thsToReg(idx, click->thresholdMg));
+    regmap_write(&inst->regs, TIME_LIMIT, msToPeriods(idx, click->limitMs, PERIODS_7BIT_MAX));
+    regmap_write(&inst->regs, TIME_LATENCY, msToPeriods(idx, click->latencyMs, PERIODS_8BIT_MAX));
+    regmap_write(&inst->regs, TIME_WINDOW, msToPeriods(idx, click->windowMs, PERIODS_8BIT_MAX));
+}
+
+/* write accelerometer setup to register shadow, written to sensor on next flush */
+static void stageAcc(uint8_t idx) {
+    struct Instance *inst = &base.instances[idx];
+    regmap_write(&inst->regs, CTRL1, inst->acc.rate | CTRL1_AZEN | CTRL1_AYEN | CTRL1_AXEN);    // all axis data read enabled by default.
+    regmap_write(&inst->regs, CTRL2, inst->acc.AAFilterBW | inst->acc.fullScale);
+    stageFreeFall(idx);
+    stageClick(idx);
+}
+
+/* default configuration of single sensor */
+static void configureInstance(uint8_t idx) {
+    struct Instance *inst = &base.instances[idx];
+    struct regmap_Map *regs = &inst->regs;
+
+    regmap_countOp(regs, SENSOR_BUS_OP_INIT);
+
+    /* enable high pass filters for click detection and interrupt generators */
+    regmap_write(regs, CTRL0, CTRL0_HP_CLICK);
+
+    /* enable int1 generation on new data available and int2 generation on click and free fall,
+     * free fall is latched until IG_SRC1 is read, magnetometer rate stays at default. Unlatched
+     * IG2 is kept off INT2, its level would hide rising edges of click and free fall. */
+    regmap_write(regs, CTRL3, CTRL3_INT1_DRDY_A);
+    regmap_write(regs, CTRL4, CTRL4_INT2_CLICK | CTRL4_INT2_IG1);
+    regmap_write(regs, CTRL5, CTRL5_M_ODR2 | CTRL5_M_ODR1 | CTRL5_LIR1);
+    inst->freeFallMg = 0;
+    inst->freeFallMs = 0;
+    inst->click.thresholdMg = CLICK_DEFAULT_THS_MG;
+    inst->click.limitMs = CLICK_DEFAULT_LIMIT_MS;
+    inst->click.latencyMs = CLICK_DEFAULT_LATENCY_MS;
+    inst->click.windowMs = CLICK_DEFAULT_WINDOW_MS;
+
+    /* initial user setups from boot profile or defaults, every next instance gets the highest rate
+     * which still fits on the bus */
+    enum sensor_AccRate rate = SENSOR_ACC_RATE_400HZ;
+    inst->acc.AAFilterBW = SENSOR_ACC_AAFILT_BW_773HZ;
+    inst->acc.fullScale = SENSOR_ACC_FULL_SCALE_2G;
+    if (base.bootConfigValid) {
+        inst->acc = base.bootConfig[idx];
+        rate = inst->acc.rate;
+    }
+    while (!rateFits(idx, rate) && rate > SENSOR_ACC_RATE_3HZ125) {
+        rate -= SENSOR_ACC_RATE_3HZ125;
+    }
+    inst->acc.rate = rate;
+    stageAcc(idx);
+
+    /* click detection setup, click registers are written by stageAcc() */
+    regmap_write(regs, IG_CFG2, 0x10);
+    regmap_write(regs, IG_THS2, 0x0A);
+    regmap_write(regs, IG_DUR2, 0x02);
+    regmap_write(regs, ACT_THS, 0x00);
+    regmap_write(regs, ACT_DUR, 0xF0);
+
+    /* CTRL0..CTRL5, IG_CFG1, IG_CFG2, IG_THS2..CLICK_CFG and CLICK_THS..ACT_DUR go out as five
+     * bursts, IG_SRC2 and CLICK_SRC are not written */
+    regmap_flush(regs, SENSOR_BUS_OP_INIT);
+}
+
+/* Probe both addresses, first sensor is used even if it does not answer */
+static void probeInstances() {
+    base.numOfInstances = 0;
+    for (uint8_t i = 0; i < SENSOR_MAX_INSTANCES; i++) {
+        struct Instance *inst = &base.instances[base.numOfInstances];
+        inst->hw = &instanceHw[i];
+        regmap_init(&inst->regs, inst->hw->addr, AUTO_ADDR_INC);
+        regmap_setNoIncidentalRead(&inst->regs, READ_CLEARED_REGS);
+        regmap_countOp(&inst->regs, SENSOR_BUS_OP_INIT);
+        base.auxTab[0] = 0;
+        regmap_read(&inst->regs, SENSOR_BUS_OP_INIT, WHO_AM_I, base.auxTab, 1);
+        if (base.auxTab[0] == WHO_AM_I_VAL || i == 0) {
+            base.numOfInstances++;
+        }
+    }
+}
+
+/* Reboot all sensors at once and sleep until BOOT bit clears on each of them. Registers get
+ * default content, so the shadow is no longer valid. */
+static void rebootInstances() {
+    for (uint8_t i = 0; i < base.numOfInstances; i++) {
+        regmap_writeThrough(&base.instances[i].regs, SENSOR_BUS_OP_INIT, CTRL0, CTRL0_BOOT);
+    }
+
+    for (uint8_t i = 0; i < base.numOfInstances; i++) {
+        struct regmap_Map *regs = &base.instances[i].regs;
+        TickType_t waited = 0;
+        do {
+            vTaskDelay(pdMS_TO_TICKS(BOOT_POLL_PERIOD_MS));
+            waited += BOOT_POLL_PERIOD_MS;
+            base.auxTab[0] = CTRL0_BOOT;
+            regmap_read(regs, SENSOR_BUS_OP_INIT, CTRL0, base.auxTab, 1);
+        } while ((base.auxTab[0] & CTRL0_BOOT) && waited < BOOT_TIMEOUT_MS);
+        regmap_invalidate(regs);
+    }
+}
+
+/* Bring-up after scheduler start: other tasks run while sensors boot */
+static void bringUp() {
+    probeInstances();
+    rebootInstances();
+
+    for (uint8_t i = 0; i < base.numOfInstances; i++) {
+        /* Initialise GPIOs and EXIT for sensor INT1 and INT2 lines, first data ready marks first sample */
+        initExtiLines(base.instances[i].hw);
+        configureInstance(i);
+    }
+    systime_markBoot(SYSTIME_BOOT_SENSOR_READY);
+    xSemaphoreGive(base.readySemph);
+}
+
+static void markPending(const struct EventMsg *msg) {
+    if (msg->type == NEW_DATA) {
+        base.pendingData |= 1 << msg->sensorIdx;
+    } else if (msg->type == NEW_DETECTION) {
+        base.pendingDetection |= 1 << msg->sensorIdx;
+        base.instances[msg->sensorIdx].detectionMs = msg->timeMs;
+        base.instances[msg->sensorIdx].detectionCycles = msg->cycles;
+    } else if (msg->type == APPLY_CONFIG) {
+        base.pendingConfig |= 1 << msg->sensorIdx;
+    }
+}
+
+/* Events have own queue, so they are not delayed by queued samples */
+static void sendEvent(struct sensor_Output *output) {
+    output->event.timeMs = base.instances[output->sensorIdx].detectionMs;
+    output->event.cycles = base.instances[output->sensorIdx].detectionCycles;
+    /* detections are reported while not started as well, reader may not be waiting then */
+    xQueueSendToBack(base.sensorEventQueue, output,
+            base.state == STATE_ACTIVE ? portMAX_DELAY : 0);
+}
+
+/* Decode click source register, kind, sign and axes come from one read */
+static bool decodeClick(uint8_t src, struct sensor_Event *event) {
+    event->axes = 0;
+    event->axes |= (src & CLICK_SRC_X) ? SENSOR_AXIS_X : 0;
+    event->axes |= (src & CLICK_SRC_Y) ? SENSOR_AXIS_Y : 0;
+    event->axes |= (src & CLICK_SRC_Z) ? SENSOR_AXIS_Z : 0;
+    event->negative = (src & CLICK_SRC_SIGN) != 0;
+    event->doubleClick = (src & CLICK_SRC_DBL_CLICK) != 0;
+    return (src & CLICK_SRC_IA) && (src & (CLICK_SRC_DBL_CLICK | CLICK_SRC_SGL_CLICK));
+}
+
+static void readAccData(uint8_t idx) {
+    struct sensor_Output output;
+    struct regmap_Map *regs = &base.instances[idx].regs;
+    uint32_t start = pipeline_beginItem(PIPELINE_ACQUIRE,
+            uxQueueMessagesWaiting(base.evtQueue) + 1);
+
+    /* read status together with data, specify new data type and put it into sensor output queue */
+    regmap_countOp(regs, SENSOR_BUS_OP_DATA);
+    if (I2C_SUCCES != regmap_readList(regs, SENSOR_BUS_OP_DATA, dataRegs, base.auxTab,
+                    sizeof(dataRegs))
+            || !(base.auxTab[0] & STATUS_A_ZYXADA)) {
+        /* bus error or accelerometer data not ready, item ends without output */
+        pipeline_endItem(PIPELINE_ACQUIRE, start);
+        return;
+    }
+
+    output.type = SENSOR_OUT_ACC_DATA;
+    output.sensorIdx = idx;
+    /* decode accelerometer data */
+    output.xyzData.x =
+            ((base.auxTab[1] | (base.auxTab[2] << 8)));
+    output.xyzData.x = ((double) (output.xyzData.x) / INT16_MAX)
+            * 1000.0 * sensor_getAccFullScaleInt(idx);
+    output.xyzData.y =
+            ((base.auxTab[3] | (base.auxTab[4] << 8)));
+    output.xyzData.y = ((double) (output.xyzData.y) / INT16_MAX)
+            * 1000.0 * sensor_getAccFullScaleInt(idx);
+    output.xyzData.z =
+            ((base.auxTab[5] | (base.auxTab[6] << 8)));
+    output.xyzData.z = ((double) (output.xyzData.z) / INT16_MAX)
+            * 1000.0 * sensor_getAccFullScaleInt(idx);
+
+    pipeline_endItem(PIPELINE_ACQUIRE, start);
+
+    /* full DSP stage holds acquisition back, data ready is served late then */
+    if (pdTRUE != xQueueSendToBack(base.sensorOutputQueue, &output, 0)) {
+        pipeline_outputFull(PIPELINE_ACQUIRE);
+        xQueueSendToBack(base.sensorOutputQueue, &output, portMAX_DELAY);
+    }
+    /* Add magnetometer and temperature read here in future */
+}
+
+static void readDetection(uint8_t idx) {
+    struct sensor_Output output = { 0 };
+    struct regmap_Map *regs = &base.instances[idx].regs;
+
+    /* specify new detection type and put it into sensor output queue*/
+    output.sensorIdx = idx;
+    regmap_countOp(regs, SENSOR_BUS_OP_DETECTION);
+    base.auxTab[0] = 0;
+    regmap_read(regs, SENSOR_BUS_OP_DETECTION, CLICK_SRC, base.auxTab, 1);
+    if (decodeClick(base.auxTab[0], &output.event)) {
+        output.type = SENSOR_OUT_CLICK_DETECTION;
+        sendEvent(&output);
+    }
+    /* reading source releases latched free fall interrupt */
+    if (base.instances[idx].freeFallMg != 0) {
+        base.auxTab[0] = 0;
+        regmap_read(regs, SENSOR_BUS_OP_DETECTION, IG_SRC1, base.auxTab, 1);
+        if (base.auxTab[0] & IG_SRC_IA) {
+            output.type = SENSOR_OUT_FREE_FALL;
+            output.event.axes = 0;
+            sendEvent(&output);
+        }
+    }
+}
+
+/* Write requested setup and mark the change in sample queue */
+static void applyConfig(uint8_t idx) {
+    struct sensor_Output output = { 0 };
+    struct Instance *inst = &base.instances[idx];
+
+    inst->accRequested = false;
+    inst->acc = inst->requestedAcc;
+    restartRateMeasurement(idx);
+    regmap_countOp(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    stageAcc(idx);
+    regmap_flush(&inst->regs, SENSOR_BUS_OP_CONFIG);
+
+    output.type = SENSOR_OUT_CONFIG;
+    output.sensorIdx = idx;
+    xQueueSendToBack(base.sensorOutputQueue, &output, portMAX_DELAY);
+}
+
+/* Serve pending notifications of all instances in round robin order, so a sensor at high
+ * rate can not starve the other one. Detection of an instance is served before its data, setup
+ * change after it, so a sample waiting in the sensor is read with the setup it was taken with. */
+static void serveInstances() {
+    struct EventMsg msg;
+
+    while (base.pendingData | base.pendingDetection | base.pendingConfig) {
+        uint8_t pending = base.pendingData | base.pendingDetection | base.pendingConfig;
+        uint8_t idx = base.lastServed;
+        do {
+            idx = (idx + 1) % base.numOfInstances;
+        } while (!((pending >> idx) & 1));
+
+        if (base.pendingDetection & (1 << idx)) {
+            base.pendingDetection &= ~(1 << idx);
+            readDetection(idx);
+        } else if (base.pendingData & (1 << idx)) {
+            base.pendingData &= ~(1 << idx);
+            readAccData(idx);
+        } else {
+            base.pendingConfig &= ~(1 << idx);
+            applyConfig(idx);
+        }
+        base.lastServed = idx;
+
+        /* collect notifications which arrived during bus transfer */
+        while (pdTRUE == xQueueReceive(base.evtQueue, &msg, 0)) {
+            markPending(&msg);
+        }
+    }
+}
 
 /* === exported functions === */
-void sensor_init(QueueHandle_t sensorOutputQueue) {
+void sensor_init(QueueHandle_t sensorOutputQueue, QueueHandle_t sensorEventQueue,
+        const struct sensor_AccConfig *bootConfig) {
     /* init base struct */
     base.state = STATE_IDLE;
     base.sensorOutputQueue = sensorOutputQueue;
+    base.sensorEventQueue = sensorEventQueue;
+    base.rateMeasured = NO_INSTANCE;
+    base.bootConfigValid = (bootConfig != NULL);
+    if (bootConfig != NULL) {
+        for (uint8_t i = 0; i < SENSOR_MAX_INSTANCES; i++) {
+            base.bootConfig[i] = bootConfig[i];
+        }
+    }
 
     /* init RTOS objects */
     base.evtQueue = xQueueCreate(EVT_NOTIFICATION_QUEUE_LEN,
-            sizeof(enum EventNotification));
+            sizeof(struct EventMsg));
     CHECK(base.evtQueue);
+    vQueueSetQueueNumber(base.evtQueue, TRACE_QUEUE_SENSOR_NOTIFY);
 
-    base.goActiveSemph = xSemaphoreCreateBinary();
-
-    /* Initialise GPIOs and EXIT for sensor INT1 and INT2 lines */
-    initExtiLines();
+    base.readySemph = xSemaphoreCreateBinary();
+    CHECK(base.readySemph);
 
-    /* init I2C */
+    /* init I2C, sensors are brought up by sensor_task */
     I2C_init();
+}
 
-    /* reboot sensor */
-    base.auxTab[0] = CTRL0_BOOT;
-    writeSensorRegister(CTRL0, base.auxTab[0]);
-    for (int i = 0; i < 8000; i++) {
-    };
+void sensor_waitReady() {
+    xSemaphoreTake(base.readySemph, portMAX_DELAY);
+    xSemaphoreGive(base.readySemph);                                            // leave it given for other callers
+}
 
-    /* enable high pass filters for click detection and interrupt generators */
-    base.auxTab[0] = CTRL0_HP_CLICK;
-    writeSensorRegister(CTRL0, base.auxTab[0]);
-
-    /* enable int1 generation on new data available and int2 generation on click*/
-    base.auxTab[0] = CTRL3_INT1_DRDY_A;
-    base.auxTab[1] = CTRL4_INT2_CLICK | CTRL4_INT2_IG1 | CTRL4_INT2_IG2;
-    writeSensorRegisters(CTRL3, base.auxTab, 2);
-
-    /* initial user setups */
-    sensor_setAccRate(SENSOR_ACC_RATE_400HZ);
-    sensor_setAccAAFiletrBW(SENSOR_ACC_AAFILT_BW_773HZ);
-    sensor_setAccFullScale(SENSOR_ACC_FULL_SCALE_2G);
-
-    /* click detection setup */
-    writeSensorRegister(IG_CFG2, 0x10);
-    writeSensorRegister(IG_THS2, 0x0A);
-    writeSensorRegister(IG_DUR2, 0x02);
-    writeSensorRegister(CLICK_CFG, 0x10);
-    writeSensorRegister(CLICK_SRC, 0x30);
-    writeSensorRegister(CLICK_THS, 0x03);
-    writeSensorRegister(TIME_LIMIT, 0x0B);
-    writeSensorRegister(TIME_LATENCY, 0x0A);
-    writeSensorRegister(TIME_WINDOW, 0x0A);
-    writeSensorRegister(ACT_THS, 0x00);
-    writeSensorRegister(ACT_DUR, 0xF0);
+uint8_t sensor_getNumOfInstances() {
+    return base.numOfInstances;
 }
 
 void sensor_start() {
-    xSemaphoreGive(base.goActiveSemph);
+    struct EventMsg msg = { GO_ACTIVE, 0, 0, 0 };
+    restartRateMeasurement(base.rateMeasured);
+    xQueueSendToBack(base.evtQueue, &msg, portMAX_DELAY);
 }
 
 void sensor_stop() {
     base.state = STATE_IDLE;
 }
 
-void sensor_setAccFullScale(enum sensor_AccFullScale fullScale) {
-    base.acc.fullScale = fullScale;
-    writeSensorRegister(CTRL2, fullScale | base.acc.AAFilterBW);
+void sensor_setAccFullScale(uint8_t sensorIdx, enum sensor_AccFullScale fullScale) {
+    struct Instance *inst = &base.instances[sensorIdx];
+    inst->acc.fullScale = fullScale;
+    regmap_countOp(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    stageAcc(sensorIdx);
+    regmap_flush(&inst->regs, SENSOR_BUS_OP_CONFIG);
 }
 
-void sensor_setAccRate(enum sensor_AccRate rate) {
-    base.acc.rate = rate;
-    writeSensorRegister(CTRL1, rate | CTRL1_AZEN | CTRL1_AYEN | CTRL1_AXEN);    // all axis data read enabled by default.
+bool sensor_setAccRate(uint8_t sensorIdx, enum sensor_AccRate rate) {
+    struct Instance *inst = &base.instances[sensorIdx];
+    if (!rateFits(sensorIdx, rate)) {
+        return false;
+    }
+    inst->acc.rate = rate;
+    restartRateMeasurement(sensorIdx);
+    regmap_countOp(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    stageAcc(sensorIdx);
+    regmap_flush(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    return true;
+}
+
+bool sensor_setAccConfig(uint8_t sensorIdx, const struct sensor_AccConfig *config) {
+    struct Instance *inst = &base.instances[sensorIdx];
+    if (!rateFits(sensorIdx, config->rate)) {
+        return false;
+    }
+    inst->acc = *config;
+    restartRateMeasurement(sensorIdx);
+    /* CTRL1 and CTRL2 are adjacent and go out in one burst */
+    regmap_countOp(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    stageAcc(sensorIdx);
+    regmap_flush(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    return true;
+}
+
+bool sensor_changeAccConfig(uint8_t sensorIdx, const struct sensor_AccConfig *config) {
+    struct EventMsg msg = { APPLY_CONFIG, sensorIdx, 0, 0 };
+    if (base.state != STATE_ACTIVE) {
+        return sensor_setAccConfig(sensorIdx, config);
+    }
+    if (!rateFits(sensorIdx, config->rate)) {
+        return false;
+    }
+    base.instances[sensorIdx].requestedAcc = *config;
+    base.instances[sensorIdx].accRequested = true;
+    xQueueSendToBack(base.evtQueue, &msg, portMAX_DELAY);
+    return true;
+}
+
+void sensor_getAccConfig(uint8_t sensorIdx, struct sensor_AccConfig *config) {
+    /* change requested while running counts, so requests made one after another add up */
+    const struct Instance *inst = &base.instances[sensorIdx];
+    *config = inst->accRequested ? inst->requestedAcc : inst->acc;
 }
 
-void sensor_setAccAAFiletrBW(enum sensor_AccAAFilterBW bandwidth) {
-    base.acc.AAFilterBW = bandwidth;
-    writeSensorRegister(CTRL2, bandwidth | base.acc.fullScale);
+void sensor_setAccAAFiletrBW(uint8_t sensorIdx, enum sensor_AccAAFilterBW bandwidth) {
+    struct Instance *inst = &base.instances[sensorIdx];
+    inst->acc.AAFilterBW = bandwidth;
+    regmap_countOp(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    stageAcc(sensorIdx);
+    regmap_flush(&inst->regs, SENSOR_BUS_OP_CONFIG);
 }
 
-enum sensor_AccFullScale sensor_getAccFullScale() {
-    return base.acc.fullScale;
+enum sensor_AccFullScale sensor_getAccFullScale(uint8_t sensorIdx) {
+    return base.instances[sensorIdx].acc.fullScale;
 }
 
-uint8_t sensor_getAccFullScaleInt() {
-    switch (base.acc.fullScale) {
+uint8_t sensor_getAccFullScaleInt(uint8_t sensorIdx) {
+    switch (base.instances[sensorIdx].acc.fullScale) {
     case SENSOR_ACC_FULL_SCALE_2G:
         return 2;
         break;
@@ -330,104 +800,140 @@ uint8_t sensor_getAccFullScaleInt() {
     }
 }
 
-enum sensor_AccRate sensor_getAccRate() {
-    return base.acc.rate;
+enum sensor_AccRate sensor_getAccRate(uint8_t sensorIdx) {
+    return base.instances[sensorIdx].acc.rate;
 }
 
-uint32_t sensor_getAccRateInt() {
-    switch (base.acc.rate) {
-    case SENSOR_ACC_RATE_3HZ125:
-        return 3125;
-        break;
-    case SENSOR_ACC_RATE_6HZ25:
-        return 6250;
-        break;
-    case SENSOR_ACC_RATE_12HZ5:
-        return 12500;
-        break;
-    case SENSOR_ACC_RATE_25HZ:
-        return 25000;
-        break;
-    case SENSOR_ACC_RATE_50HZ:
-        return 50000;
-        break;
-    case SENSOR_ACC_RATE_100HZ:
-        return 100000;
-        break;
-    case SENSOR_ACC_RATE_200HZ:
-        return 200000;
-        break;
-    case SENSOR_ACC_RATE_400HZ:
-        return 400000;
-        break;
-    case SENSOR_ACC_RATE_800HZ:
-        return 800000;
-        break;
-    case SENSOR_ACC_RATE_1600HZ:
-    default:
-        return 1600000;
-        break;
+uint32_t sensor_getAccRateInt(uint8_t sensorIdx) {
+    return rateToInt(base.instances[sensorIdx].acc.rate);
+}
+
+uint8_t sensor_getBusLoad() {
+    return busDemand(0, base.instances[0].acc.rate) / (I2C_getBusFrequency() / 100);
+}
+
+uint32_t sensor_getBusTimePerSampleUs() {
+    return (uint32_t) ((uint64_t) BUS_BITS_PER_SAMPLE * 1000000 / I2C_getBusFrequency());
+}
+
+const struct regmap_OpStats* sensor_getBusStats(uint8_t sensorIdx, enum sensor_BusOp op) {
+    return regmap_getStats(&base.instances[sensorIdx].regs, op);
+}
+
+bool sensor_setFreeFall(uint8_t sensorIdx, uint16_t thresholdMg, uint16_t durationMs) {
+    struct Instance *inst = &base.instances[sensorIdx];
+    if (thresholdMg >= sensor_getAccFullScaleInt(sensorIdx) * 1000UL
+            || !msFits(sensorIdx, durationMs, PERIODS_7BIT_MAX)) {
+        return false;
+    }
+    inst->freeFallMg = thresholdMg;
+    inst->freeFallMs = durationMs;
+    regmap_countOp(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    stageFreeFall(sensorIdx);
+    regmap_flush(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    return true;
+}
+
+void sensor_getFreeFall(uint8_t sensorIdx, uint16_t *thresholdMg, uint16_t *durationMs) {
+    const struct Instance *inst = &base.instances[sensorIdx];
+    *thresholdMg = 0;
+    *durationMs = 0;
+    if (inst->freeFallMg != 0) {
+        *thresholdMg = regToThs(sensorIdx, thsToReg(sensorIdx, inst->freeFallMg));
+        *durationMs = periodsToMs(sensorIdx,
+                msToPeriods(sensorIdx, inst->freeFallMs, PERIODS_7BIT_MAX));
+    }
+}
+
+void sensor_measureAccRate(uint8_t sensorIdx, bool enable) {
+    taskENTER_CRITICAL();
+    if (!enable) {
+        base.rateMeasured = base.rateMeasured == sensorIdx ? NO_INSTANCE : base.rateMeasured;
+    } else if (base.rateMeasured != sensorIdx) {
+        odr_start(&base.rateWindow, rateToInt(base.instances[sensorIdx].acc.rate));
+        base.rateMeasured = sensorIdx;
+    }
+    taskEXIT_CRITICAL();
+}
+
+bool sensor_getMeasuredAccRate(uint8_t sensorIdx, struct odr_Summary *summary) {
+    struct odr_Window window;
+    if (base.rateMeasured != sensorIdx) {
+        return false;
     }
+    /* copy is short compared to data ready period, evaluation runs with interrupts enabled */
+    taskENTER_CRITICAL();
+    window = base.rateWindow;
+    taskEXIT_CRITICAL();
+    odr_getSummary(&window, summary);
+    return true;
+}
+
+bool sensor_setClick(uint8_t sensorIdx, const struct sensor_ClickConfig *config) {
+    struct Instance *inst = &base.instances[sensorIdx];
+    if (config->thresholdMg >= sensor_getAccFullScaleInt(sensorIdx) * 1000UL
+            || !msFits(sensorIdx, config->limitMs, PERIODS_7BIT_MAX)
+            || !msFits(sensorIdx, config->latencyMs, PERIODS_8BIT_MAX)
+            || !msFits(sensorIdx, config->windowMs, PERIODS_8BIT_MAX)) {
+        return false;
+    }
+    inst->click = *config;
+    regmap_countOp(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    stageClick(sensorIdx);
+    regmap_flush(&inst->regs, SENSOR_BUS_OP_CONFIG);
+    return true;
+}
+
+void sensor_getClick(uint8_t sensorIdx, struct sensor_ClickConfig *config) {
+    const struct sensor_ClickConfig *click = &base.instances[sensorIdx].click;
+    config->thresholdMg = regToThs(sensorIdx, thsToReg(sensorIdx, click->thresholdMg));
+    config->limitMs = periodsToMs(sensorIdx,
+            msToPeriods(sensorIdx, click->limitMs, PERIODS_7BIT_MAX));
+    config->latencyMs = periodsToMs(sensorIdx,
+            msToPeriods(sensorIdx, click->latencyMs, PERIODS_8BIT_MAX));
+    config->windowMs = periodsToMs(sensorIdx,
+            msToPeriods(sensorIdx, click->windowMs, PERIODS_8BIT_MAX));
 }
 
 void sensor_task(void *params) {
     UNUSED(params);
 
-    enum EventNotification evtNotification;
-    struct sensor_Output output;
+    struct EventMsg msg;
+
+    systime_markBoot(SYSTIME_BOOT_SCHEDULER);
+    bringUp();
+
     while (1) {
         switch (base.state) {
         case STATE_IDLE:
-            /* block until active state requested by sensor_start() function. */
-            xSemaphoreTake(base.goActiveSemph, portMAX_DELAY);
+            /* block until active state requested by sensor_start() function. Detections are served
+             * meanwhile, data ready is left pending, so its line stays high and does not interrupt */
+            xQueueReceive(base.evtQueue, &msg, portMAX_DELAY);
+            if (msg.type == NEW_DETECTION) {
+                markPending(&msg);
+                base.pendingDetection &= ~(1 << msg.sensorIdx);
+                readDetection(msg.sensorIdx);
+                break;
+            } else if (msg.type == APPLY_CONFIG) {
+                /* requested just before stop, marker is dropped with the stream */
+                applyConfig(msg.sensorIdx);
+                break;
+            } else if (msg.type != GO_ACTIVE) {
+                break;
+            }
             /* make initial data read to unblock interrupts */
-            readSensorRegisters(OUT_X_L_A, base.auxTab, 6);
+            for (uint8_t i = 0; i < base.numOfInstances; i++) {
+                regmap_countOp(&base.instances[i].regs, SENSOR_BUS_OP_DATA);
+                regmap_read(&base.instances[i].regs, SENSOR_BUS_OP_DATA, OUT_X_L_A, base.auxTab, ACC_XYZ_DATA_SIZE);
+            }
 
             base.state = STATE_ACTIVE;
             break;
         case STATE_ACTIVE:
             /* Block in waiting for new data or event detection interrupt*/
-            xQueueReceive(base.evtQueue, &evtNotification, portMAX_DELAY);
-            /* Check if new data is available or event occured */
-            switch (evtNotification) {
-            case NEW_DATA:
-                /* specify new data type, read it and put into sensor output queue */
-                readSensorRegister(STATUS_A, base.auxTab);
-
-                /* if accelerometer data ready */
-                if (base.auxTab[0] && STATUS_A_ZYXADA) {
-
-                    output.type = SENSOR_OUT_ACC_DATA;
-                    /* read and decode accelerometer data */
-                    readSensorRegisters(OUT_X_L_A, base.auxTab, 6);
-                    output.xyzData.x =
-                            ((base.auxTab[0] | (base.auxTab[1] << 8)));
-                    output.xyzData.x = ((double) (output.xyzData.x) / INT16_MAX)
-                            * 1000.0 * sensor_getAccFullScaleInt();
-                    output.xyzData.y =
-                            ((base.auxTab[2] | (base.auxTab[3] << 8)));
-                    output.xyzData.y = ((double) (output.xyzData.y) / INT16_MAX)
-                            * 1000.0 * sensor_getAccFullScaleInt();
-                    output.xyzData.z =
-                            ((base.auxTab[4] | (base.auxTab[5] << 8)));
-                    output.xyzData.z = ((double) (output.xyzData.z) / INT16_MAX)
-                            * 1000.0 * sensor_getAccFullScaleInt();
-
-                    xQueueSendToBack(base.sensorOutputQueue, &output,
-                            portMAX_DELAY);
-                }
-                /* Add magnetometer and temperature read here in future */
-                break;
-            case NEW_DETECTION:
-                /* specify new detection type and put it into sensor output queue*/
-                readSensorRegister(CLICK_SRC, base.auxTab);
-                if (base.auxTab[0] & CLICK_SRC_Z) {
-                    output.type = SENSOR_OUT_CLICK_DETECTION;
-                    xQueueSendToBack(base.sensorOutputQueue, &output,
-                            portMAX_DELAY);
-                }
-                break;
-            }
+            xQueueReceive(base.evtQueue, &msg, portMAX_DELAY);
+            markPending(&msg);
+            serveInstances();
             break;
         }
     }
@@ -436,21 +942,48 @@ void sensor_task(void *params) {
 /* Interrupts on sensor data ready or event detection signals */
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
     BaseType_t higherPriorityTaskWoken = pdFALSE;
-    enum EventNotification notificationToSend;
-    if (GPIO_Pin == INT1_GPIO_PIN) {
-        notificationToSend = NEW_DATA;
-    } else if (GPIO_Pin == INT2_GPIO_PIN) {
-        notificationToSend = NEW_DETECTION;
+    struct EventMsg msg;
+    for (uint8_t i = 0; i < base.numOfInstances; i++) {
+        const struct InstanceHw *hw = base.instances[i].hw;
+        if (GPIO_Pin == hw->int1Pin || GPIO_Pin == hw->int2Pin) {
+            msg.type = (GPIO_Pin == hw->int1Pin) ? NEW_DATA : NEW_DETECTION;
+            if (msg.type == NEW_DATA) {
+                if (base.rateMeasured == i) {
+                    odr_addEdge(&base.rateWindow, systime_getCycles(), SystemCoreClock);
+                }
+                systime_markBoot(SYSTIME_BOOT_FIRST_SAMPLE);
+            }
+            msg.sensorIdx = i;
+            msg.timeMs = xTaskGetTickCountFromISR() * portTICK_PERIOD_MS;
+            msg.cycles = systime_getCycles();
+            xQueueSendFromISR(base.evtQueue, &msg,
+                    &higherPriorityTaskWoken);
+            break;
+        }
     }
-    xQueueSendFromISR(base.evtQueue, &notificationToSend,
-            &higherPriorityTaskWoken);
     portEND_SWITCHING_ISR(higherPriorityTaskWoken);
 }
 
 void EXTI0_IRQHandler(void) {
-    HAL_GPIO_EXTI_IRQHandler(INT1_GPIO_PIN);
+    TRACE_IRQ_ENTER(EXTI0_IRQn);
+    HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_0);
+    TRACE_IRQ_EXIT(EXTI0_IRQn);
 }
 
 void EXTI1_IRQHandler(void) {
+    TRACE_IRQ_ENTER(EXTI1_IRQn);
     HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_1);
+    TRACE_IRQ_EXIT(EXTI1_IRQn);
+}
+
+void EXTI2_TSC_IRQHandler(void) {
+    TRACE_IRQ_ENTER(EXTI2_TSC_IRQn);
+    HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_2);
+    TRACE_IRQ_EXIT(EXTI2_TSC_IRQn);
+}
+
+void EXTI3_IRQHandler(void) {
+    TRACE_IRQ_ENTER(EXTI3_IRQn);
+    HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3);
+    TRACE_IRQ_EXIT(EXTI3_IRQn);
 }
@@ -0,0 +1,99 @@
+/*
+ * stats.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "stats.h"
+
+/* === private functions === */
+/* Square root rounded to nearest */
+static uint32_t
+sqrtRound (uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > value)
+        {
+            bit >>= 2;
+        }
+    while (bit != 0)
+        {
+            if (value >= root + bit)
+                {
+                    value -= root + bit;
+                    root = (root >> 1) + bit;
+                }
+            else
+                {
+                    root >>= 1;
+                }
+            bit >>= 2;
+        }
+    /* value holds remainder, sqrt >= root + 0.5 when remainder > root */
+    return value > root ? root + 1 : root;
+}
+
+static int64_t
+divRound (int64_t num, uint64_t den)
+{
+    return num >= 0 ?
+            (int64_t) (((uint64_t) num + den / 2) / den) :
+            -(int64_t) (((uint64_t) -num + den / 2) / den);
+}
+
+/* === exported functions === */
+void
+stats_reset (struct stats_Window *window)
+{
+    window->count = 0;
+    for (uint8_t a = 0; a < STATS_AXES; a++)
+        {
+            window->axes[a].min = INT16_MAX;
+            window->axes[a].max = INT16_MIN;
+            window->axes[a].sum = 0;
+            window->axes[a].sumSq = 0;
+        }
+}
+
+void
+stats_add (struct stats_Window *window, int16_t x, int16_t y, int16_t z)
+{
+    const int16_t sample[STATS_AXES] =
+        { x, y, z };
+
+    if (window->count >= STATS_MAX_SAMPLES)
+        {
+            return;
+        }
+    window->count++;
+    for (uint8_t a = 0; a < STATS_AXES; a++)
+        {
+            struct stats_Axis *axis = &window->axes[a];
+            int32_t v = sample[a];
+            axis->min = v < axis->min ? v : axis->min;
+            axis->max = v > axis->max ? v : axis->max;
+            axis->sum += v;
+            axis->sumSq += (uint32_t) (v * v);
+        }
+}
+
+void
+stats_getSummary (const struct stats_Window *window, uint8_t axis,
+                  struct stats_Summary *summary)
+{
+    const struct stats_Axis *a = &window->axes[axis];
+    uint64_t n = window->count > 0 ? window->count : 1;
+
+    summary->min = a->min;
+    summary->max = a->max;
+    summary->mean = divRound (a->sum, n);
+    summary->rms = sqrtRound (divRound (a->sumSq, n));
+    summary->peak = -a->min > a->max ? -a->min : a->max;
+    summary->peakToPeak = a->max - a->min;
+
+    /* exact in 64 bits while count <= STATS_MAX_SAMPLES */
+    uint64_t sumAbs = a->sum >= 0 ? a->sum : -a->sum;
+    summary->variance = divRound (n * a->sumSq - sumAbs * sumAbs, n * n);
+}
@@ -0,0 +1,81 @@
+/*
+ * systime.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "systime.h"
+#include "stm32f3xx_hal.h"
+
+#define US_PER_S            1000000UL
+
+/* === private variables === */
+static struct Base
+{
+    volatile uint32_t bootMarksUs[SYSTIME_BOOT_MARK_COUNT];                     // time of boot stage
+    volatile bool bootMarkReached[SYSTIME_BOOT_MARK_COUNT];                     // one flag per stage, safe to set from ISR
+} base;
+
+void
+systime_init (void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;                             // enable trace and debug blocks
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;                                        // start cycle counter
+}
+
+uint32_t
+systime_getCycles (void)
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t
+systime_usToCycles (uint32_t us)
+{
+    return (uint32_t) (((uint64_t) us * SystemCoreClock) / US_PER_S);
+}
+
+uint32_t
+systime_cyclesToUs (uint32_t cycles)
+{
+    return (uint32_t) (((uint64_t) cycles * US_PER_S) / SystemCoreClock);
+}
+
+uint32_t
+systime_deadline (uint32_t us)
+{
+    return DWT->CYCCNT + systime_usToCycles (us);
+}
+
+bool
+systime_isReached (uint32_t deadline)
+{
+    return (int32_t) (DWT->CYCCNT - deadline) >= 0;                             // wrap safe comparison
+}
+
+void
+systime_delayUs (uint32_t us)
+{
+    uint32_t deadline = systime_deadline (us);
+    while (!systime_isReached (deadline))
+        {
+        }
+}
+
+void
+systime_markBoot (enum systime_BootMark mark)
+{
+    if (!base.bootMarkReached[mark])
+        {
+            /* time of boot stages stays far below counter wrap period */
+            base.bootMarksUs[mark] = systime_cyclesToUs (DWT->CYCCNT);
+            base.bootMarkReached[mark] = true;
+        }
+}
+
+uint32_t
+systime_getBootMarkUs (enum systime_BootMark mark)
+{
+    return base.bootMarkReached[mark] ? base.bootMarksUs[mark] : 0;
+}
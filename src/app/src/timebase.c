@@ -0,0 +1,69 @@
+/*
+ * timebase.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "timebase.h"
+#include "stm32f3xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* === private defines === */
+#define US_PER_S                        1000000UL
+#define US_PER_TICK                     (US_PER_S / configTICK_RATE_HZ)
+
+/* === private variables === */
+static struct Base
+{
+    TickType_t lastTicks;                                                       // tick count at last read, for wrap detection
+    uint32_t wraps;                                                             // tick counter wraps
+} base;
+
+/* === private functions === */
+/* Called with interrupts masked, tick interrupt can be pending but not served */
+static uint64_t
+readUs (TickType_t ticks)
+{
+    uint32_t val = SysTick->VAL;
+    uint32_t load = SysTick->LOAD;
+
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+        {
+            /* counter reloaded, but tick is not counted yet */
+            ticks++;
+            val = SysTick->VAL;
+        }
+    if (ticks < base.lastTicks)
+        {
+            base.wraps++;
+        }
+    base.lastTicks = ticks;
+
+    /* first period after clock change or stop mode has other length, fraction stays below a tick */
+    uint32_t fractionUs = (uint32_t) (((uint64_t) (load - val) * US_PER_S)
+            / SystemCoreClock);
+    fractionUs = fractionUs < US_PER_TICK ? fractionUs : US_PER_TICK - 1;
+    return ((((uint64_t) base.wraps << 32) | ticks) * US_PER_TICK) + fractionUs;
+}
+
+/* === exported functions === */
+uint64_t
+timebase_getUs (void)
+{
+    uint64_t us;
+
+    taskENTER_CRITICAL();
+    us = readUs (xTaskGetTickCount ());
+    taskEXIT_CRITICAL();
+    return us;
+}
+
+uint64_t
+timebase_getUsFromISR (void)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    uint64_t us = readUs (xTaskGetTickCountFromISR ());
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return us;
+}
@@ -0,0 +1,255 @@
+/*
+ * trace.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Administrator
+ */
+#include "trace.h"
+#include "capture.h"
+#include <string.h>
+
+/* === private defines === */
+#define MHZ                             1000000UL
+
+/* === private variables === */
+static struct Base
+{
+    volatile bool recording;
+    struct trace_Record ring[TRACE_RING_LEN];
+    uint16_t head;                                                              /// next ring index to write
+    uint16_t count;                                                             /// records in ring
+    uint32_t overwritten;                                                       /// records lost since start
+    uint32_t firstHz;                                                           /// cycle counter frequency at oldest record
+    uint32_t stopCycles;
+    uint8_t numTasks;
+    uint8_t tasks[TRACE_MAX_TASKS][TRACE_TASK_ENTRY_SIZE];                      /// number and name
+    uint8_t header[TRACE_HEADER_SIZE];                                          /// header of frame in readout
+    uint16_t frameSize;
+    uint16_t readPos;                                                           /// next frame byte to read
+    uint16_t readSum;                                                           /// checksum of bytes read so far
+} base;
+
+/* === private functions === */
+static uint8_t*
+put16 (uint8_t *dst, uint16_t value)
+{
+    *dst++ = value & 0xFF;
+    *dst++ = value >> 8;
+    return dst;
+}
+
+static uint8_t*
+put32 (uint8_t *dst, uint32_t value)
+{
+    dst = put16 (dst, value & 0xFFFF);
+    return put16 (dst, value >> 16);
+}
+
+static uint16_t
+get16 (const uint8_t *src)
+{
+    return src[0] | (src[1] << 8);
+}
+
+static uint32_t
+get32 (const uint8_t *src)
+{
+    return get16 (src) | ((uint32_t) get16 (src + 2) << 16);
+}
+
+static void
+buildHeader ()
+{
+    uint8_t *p = put16 (base.header, TRACE_SYNC);
+    *p++ = TRACE_VERSION;
+    *p++ = base.numTasks;
+    p = put16 (p, base.count);
+    p = put16 (p, base.overwritten > UINT16_MAX ? UINT16_MAX : base.overwritten);
+    p = put32 (p, base.firstHz);
+    put32 (p, base.stopCycles);
+    base.frameSize = TRACE_HEADER_SIZE + base.numTasks * TRACE_TASK_ENTRY_SIZE
+            + base.count * TRACE_RECORD_SIZE + TRACE_CHECKSUM_SIZE;
+}
+
+/* Frame byte without checksum */
+static uint8_t
+frameByte (uint16_t pos)
+{
+    uint16_t namesSize = base.numTasks * TRACE_TASK_ENTRY_SIZE;
+
+    if (pos < TRACE_HEADER_SIZE)
+        {
+            return base.header[pos];
+        }
+    pos -= TRACE_HEADER_SIZE;
+    if (pos < namesSize)
+        {
+            return base.tasks[pos / TRACE_TASK_ENTRY_SIZE][pos % TRACE_TASK_ENTRY_SIZE];
+        }
+    pos -= namesSize;
+
+    /* oldest record first */
+    uint16_t oldest = (base.head + TRACE_RING_LEN - base.count) % TRACE_RING_LEN;
+    const struct trace_Record *record =
+            &base.ring[(oldest + pos / TRACE_RECORD_SIZE) % TRACE_RING_LEN];
+    uint8_t bytes[TRACE_RECORD_SIZE];
+    uint8_t *p = put32 (bytes, record->cycles);
+    *p++ = record->type;
+    *p++ = record->id;
+    put16 (p, record->arg);
+    return bytes[pos % TRACE_RECORD_SIZE];
+}
+
+/* === exported functions === */
+void
+trace_start (uint32_t coreHz)
+{
+    base.recording = false;
+    base.head = 0;
+    base.count = 0;
+    base.overwritten = 0;
+    base.firstHz = coreHz;
+    base.numTasks = 0;
+    base.readPos = 0;
+    base.readSum = 0;
+    base.recording = true;
+}
+
+void
+trace_stop (uint32_t cycles)
+{
+    if (base.recording)
+        {
+            base.recording = false;
+            base.stopCycles = cycles;
+            base.readPos = 0;
+            base.readSum = 0;
+        }
+}
+
+bool
+trace_isRecording (void)
+{
+    return base.recording;
+}
+
+void
+trace_record (uint32_t cycles, uint8_t type, uint8_t id, uint16_t arg)
+{
+    if (!base.recording)
+        {
+            return;
+        }
+    struct trace_Record *record = &base.ring[base.head];
+    if (base.count == TRACE_RING_LEN)
+        {
+            /* frequency of the new oldest record follows the dropped clock change */
+            if (TRACE_CLOCK == record->type)
+                {
+                    base.firstHz = record->arg * MHZ;
+                }
+            base.overwritten++;
+        }
+    else
+        {
+            base.count++;
+        }
+    record->cycles = cycles;
+    record->type = type;
+    record->id = id;
+    record->arg = arg;
+    base.head = base.head + 1 < TRACE_RING_LEN ? base.head + 1 : 0;
+}
+
+void
+trace_getFill (uint16_t *records, uint32_t *overwritten)
+{
+    *records = base.count;
+    *overwritten = base.overwritten;
+}
+
+bool
+trace_addTaskName (uint8_t number, const char *name)
+{
+    uint8_t t = 0;
+
+    /* same task number replaces its entry, so repeated readouts do not fill the table */
+    while (t < base.numTasks && base.tasks[t][0] != number)
+        {
+            t++;
+        }
+    if (t >= TRACE_MAX_TASKS)
+        {
+            return false;
+        }
+    base.numTasks = t == base.numTasks ? t + 1 : base.numTasks;
+    uint8_t *entry = base.tasks[t];
+    entry[0] = number;
+    memset (&entry[1], 0, TRACE_TASK_NAME_LEN);
+    strncpy ((char*) &entry[1], name, TRACE_TASK_NAME_LEN);
+    base.readPos = 0;
+    base.readSum = 0;
+    return true;
+}
+
+uint16_t
+trace_readFrame (uint8_t *dst, uint16_t len)
+{
+    uint16_t n = 0;
+
+    if (base.recording)
+        {
+            return 0;
+        }
+    if (base.readPos == 0)
+        {
+            buildHeader ();
+        }
+    else if (base.readPos == base.frameSize)
+        {
+            /* frame end, next call reads the frame again */
+            base.readPos = 0;
+            base.readSum = 0;
+            return 0;
+        }
+    while (n < len && base.readPos < base.frameSize)
+        {
+            if (base.readPos < base.frameSize - TRACE_CHECKSUM_SIZE)
+                {
+                    dst[n] = frameByte (base.readPos);
+                    base.readSum = capture_checksum (base.readSum, &dst[n], 1);
+                }
+            else
+                {
+                    dst[n] = base.readPos == base.frameSize - TRACE_CHECKSUM_SIZE ?
+                            base.readSum & 0xFF : base.readSum >> 8;
+                }
+            n++;
+            base.readPos++;
+        }
+    return n;
+}
+
+bool
+trace_decodeHeader (const uint8_t *src, struct trace_FrameHeader *header)
+{
+    header->sync = get16 (src);
+    header->version = src[2];
+    header->numTasks = src[3];
+    header->numRecords = get16 (src + 4);
+    header->overwritten = get16 (src + 6);
+    header->coreHz = get32 (src + 8);
+    header->stopCycles = get32 (src + 12);
+    return TRACE_SYNC == header->sync && TRACE_VERSION == header->version
+            && header->numTasks <= TRACE_MAX_TASKS
+            && header->numRecords <= TRACE_RING_LEN;
+}
+
+void
+trace_decodeRecord (const uint8_t *src, struct trace_Record *record)
+{
+    record->cycles = get32 (src);
+    record->type = src[4];
+    record->id = src[5];
+    record->arg = get16 (src + 6);
+}
@@ -8,6 +8,7 @@
 #include "main.h"
 
 DMA_HandleTypeDef hdma_cli_tx;
+DMA_HandleTypeDef hdma_cli_rx;
 static struct Base
 {
     UART_HandleTypeDef *huart;
@@ -16,10 +17,12 @@ static struct Base
 void
 UART_Init (UART_HandleTypeDef *huart)
 {
-    /* enable DMA channel 7 */
+    /* enable DMA channel 7 (TX) and 6 (RX) */
     __HAL_RCC_DMA1_CLK_ENABLE();
     HAL_NVIC_SetPriority (DMA1_Channel7_IRQn, 10, 10);
     HAL_NVIC_EnableIRQ (DMA1_Channel7_IRQn);
+    HAL_NVIC_SetPriority (DMA1_Channel6_IRQn, 10, 10);
+    HAL_NVIC_EnableIRQ (DMA1_Channel6_IRQn);
     /* configure uart2 */
     huart->Instance = USART2;
     huart->Init.Mode = huart->Init.BaudRate = 460800;
@@ -38,6 +41,16 @@ UART_Init (UART_HandleTypeDef *huart)
         }
 }
 
+void
+UART_updateBaudRate (UART_HandleTypeDef *huart)
+{
+    /* BRR is writable only when USART is disabled, DMA requests resume after enable */
+    __HAL_UART_DISABLE(huart);
+    huart->Instance->BRR = UART_DIV_SAMPLING16(HAL_RCC_GetPCLK1Freq (),
+                                               huart->Init.BaudRate);
+    __HAL_UART_ENABLE(huart);
+}
+
 /**
  * @brief Initialize the UART MSP.
  * @param huart UART handle.
@@ -79,6 +92,22 @@ HAL_UART_MspInit (UART_HandleTypeDef *huart)
 
             __HAL_LINKDMA(huart, hdmatx, hdma_cli_tx);
 
+            /* RX DMA runs continuously over circular buffer */
+            hdma_cli_rx.Instance = DMA1_Channel6;
+            hdma_cli_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+            hdma_cli_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+            hdma_cli_rx.Init.MemInc = DMA_MINC_ENABLE;
+            hdma_cli_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+            hdma_cli_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+            hdma_cli_rx.Init.Mode = DMA_CIRCULAR;
+            hdma_cli_rx.Init.Priority = DMA_PRIORITY_MEDIUM;
+            if (HAL_OK != HAL_DMA_Init (&hdma_cli_rx))
+                {
+                    errorHandler ();
+                }
+
+            __HAL_LINKDMA(huart, hdmarx, hdma_cli_rx);
+
             /* USART2 interrupt init */
             HAL_NVIC_SetPriority (USART2_IRQn, 10, 10);
             HAL_NVIC_EnableIRQ (USART2_IRQn);
@@ -92,7 +121,20 @@ HAL_UART_MspInit (UART_HandleTypeDef *huart)
 void
 DMA1_Channel7_IRQHandler (void)
 {
+    TRACE_IRQ_ENTER(DMA1_Channel7_IRQn);
     HAL_DMA_IRQHandler (&hdma_cli_tx);
+    TRACE_IRQ_EXIT(DMA1_Channel7_IRQn);
+}
+
+/**
+ * @brief This function handles DMA1 channel6 global interrupt.
+ */
+void
+DMA1_Channel6_IRQHandler (void)
+{
+    TRACE_IRQ_ENTER(DMA1_Channel6_IRQn);
+    HAL_DMA_IRQHandler (&hdma_cli_rx);
+    TRACE_IRQ_EXIT(DMA1_Channel6_IRQn);
 }
 
 /**
@@ -101,5 +143,13 @@ DMA1_Channel7_IRQHandler (void)
 void
 USART2_IRQHandler (void)
 {
+    TRACE_IRQ_ENTER(USART2_IRQn);
+    /* HAL does not handle idle line, pass it to user */
+    if (__HAL_UART_GET_FLAG(base.huart, UART_FLAG_IDLE))
+        {
+            __HAL_UART_CLEAR_IDLEFLAG(base.huart);
+            UART_IdleCallback (base.huart);
+        }
     HAL_UART_IRQHandler (base.huart);
+    TRACE_IRQ_EXIT(USART2_IRQn);
 }
@@ -9,6 +9,17 @@
 #include "rtc.h"
 #include "i2c.h"
 #include "sensor.h"
+#include "systime.h"
+#include "profile.h"
+#include "flash.h"
+#include "fmt.h"
+#include "power.h"
+#include "clock.h"
+#include "capture.h"
+#include "stats.h"
+#include "filter.h"
+#include "trace.h"
+#include "pipeline.h"
 #include "semphr.h"
 #include "stdbool.h"
 #include <stdlib.h>
@@ -16,8 +27,17 @@
 #define CLI_RX_QUEUE_LEN                10                                      /// length of queue containing command received on CLI
 #define CLI_TX_QUEUE_LEN                10                                      /// length of queue containing commands to send via CLI
 #define SENSOR_OUT_QUEUE_LEN            4                                       /// length of queue containing sensor output
+#define SENSOR_EVENT_QUEUE_LEN          4                                       /// length of queue containing detected events
+#define FORMAT_QUEUE_LEN                4                                       /// length of queue from DSP to format stage
 
 #define MAIN_TASK_SACK_SIZE             512
+#define MAIN_TASK_PRIORITY              2                                       /// time sliced with DSP and format stages, so commands are served under full load
+
+/** Pipeline stages between sensor task and CLI task, see pipeline.h */
+#define DSP_TASK_STACK_SIZE             configMINIMAL_STACK_SIZE
+#define DSP_TASK_PRIORITY               2
+#define FORMAT_TASK_STACK_SIZE          (configMINIMAL_STACK_SIZE * 2)          /// statistics lines use snprintf
+#define FORMAT_TASK_PRIORITY            2
 
 #define ACC_SET_RATE_VALUE_POS_IN_CLI   13
 #define ACC_RATE_STRING_MAX_LEN         7
@@ -33,7 +53,15 @@
 
 /** Available sample average range */
 #define ACC_MIN_AVG_NUMBER              1
-#define ACC_MAX_AVG_NUMBER              1000
+#define ACC_MAX_AVG_NUMBER              FILTER_MA_MAX_LEN                       /// buffers exist per sensor instance
+
+/** Capture threshold range, LSM303D full scale is up to 16 g */
+#define CAPTURE_MIN_THRESHOLD_MG        1
+#define CAPTURE_MAX_THRESHOLD_MG        16000
+
+/** Statistics window range */
+#define STATS_MIN_WINDOW_MS             100
+#define STATS_MAX_WINDOW_MS             60000                                   /// STATS_MAX_SAMPLES at 1600 Hz is 81 s
 
 /** Clock initialisation */
 void
@@ -47,17 +75,17 @@ CLK_init (void);
 
 #define CLEAR_CLI()                         PRINT_TO_CLI("\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\r>>")
 
-#define FORMAT_ACC_DATA(data)               (data >= 0 ? "   %d.%.3d g" : "  -%d.%.3d g")
+#define SEND_TO_CLI(line)                   xQueueSendToBack(base.cliTxQueue, line, portMAX_DELAY)
 
 #define PRINT_COMMAND_NOT_RECOGNISED()      PRINT_TO_CLI("Wrong command.Type in \"help\" for command list."); \
                                             PRINT_TO_CLI("\n\r>>");
 
-#define ANY_CLI_ACTIVITY_DETECTED           (pdTRUE == xQueueReceive(base.cliRxQueue, base.auxTab, 0))
-
 #define SEND_NOT_RECOGNISED()               do{ \
                                                 xQueueSendToBack(CLI_TransmitQueue, "Command not recognised. Type \"help\" for help.\n\r>>", portMAX_DELAY); \
                                             }while(0)
 
+#define CYCLES_PER_SAMPLE                   6000                                // estimate of EXTI, sensor task, averaging and CLI line cost
+
 /* === private types === */
 enum SystemState
 {
@@ -65,49 +93,107 @@ enum SystemState
     SYSTEM_ACC_DATA_PROCESSING                                                   /// Accelerometer data reading and processing
 };
 
-/* === private variables === */
+/** item passed from DSP to format stage */
+enum StageItemType
+{
+    STAGE_ITEM_SAMPLE,                                                          /// filtered sample
+    STAGE_ITEM_STATS,                                                           /// summary of statistics window
+    STAGE_ITEM_CAPTURE,                                                         /// capture frame is frozen and ready to send
+    STAGE_ITEM_CONFIG                                                           /// setup changed while streaming
+};
 
-struct AveragedData
+struct StageItem
 {
-    int16_t xDataBuff[ACC_MAX_AVG_NUMBER],                                      /// buffer for x axis data
-            yDataBuff[ACC_MAX_AVG_NUMBER],                                      /// buffer for y axis data
-            zDataBuff[ACC_MAX_AVG_NUMBER],                                      /// buffer for z axis data
-            numOfAveragedSamples,                                               /// number of averaged samples
-            head;                                                               /// next index in buffer to be written
-    int32_t xNumerator,                                                         /// sum of @ref numOfAveragedSamples most recent x axis samples
-            yNumerator,                                                         /// sum of @ref numOfAveragedSamples most recent y axis samples
-            zNumerator;                                                         /// sum of @ref numOfAveragedSamples most recent z axis samples
+    enum StageItemType type;
+    uint8_t sensorIdx;
+    union
+    {
+        int16_t xyz[FILTER_AXES];                                               /// STAGE_ITEM_SAMPLE, mili g
+        struct stats_Summary summary[STATS_AXES];                               /// STAGE_ITEM_STATS
+        struct
+        {
+            uint32_t rateMilliHz;
+            uint8_t fullScaleG;
+            bool filterOff;                                                     /// a cutoff did not fit new rate
+            bool filterRejected;                                                /// a stage setup did not fit the chain
+            uint16_t avgNumber;
+        } config;                                                               /// STAGE_ITEM_CONFIG
+    };
 };
 
+/* === private variables === */
+
+/** CLI names of filter types */
+static const char *const filterTypeNames[FILTER_TYPE_COUNT] =
+    { "off", "avg", "ema", "lp", "hp" };
+
 static struct Base
 {
     QueueHandle_t cliTxQueue,                                                   /// CLI transfer queue
             cliRxQueue,                                                         /// CLI receive queue
-            sensorOutputQueue;                                                  /// queue with data received from sensor
+            sensorOutputQueue,                                                  /// queue with data received from sensor
+            sensorEventQueue,                                                   /// queue with events detected by sensor
+            formatQueue;                                                        /// items from DSP to format stage
+    QueueSetHandle_t mainSet;                                                   /// cliRxQueue and sensorEventQueue, waited on by main_task
+    SemaphoreHandle_t frameMutex;                                               /// keeps binary frame items together on CLI
+    SemaphoreHandle_t dspMutex;                                                 /// held by DSP stage while it serves an item
     UART_HandleTypeDef huart2;
-    enum SystemState state;                                                     /// fsm state
+    volatile enum SystemState state;                                            /// fsm state, read by DSP stage
     uint8_t auxTab[CLI_MAX_LINE_LEN];                                           /// general purpose array
-    struct AveragedData accData;                                                /// struct for data averaging purposes
+    uint8_t formatTab[CLI_MAX_LINE_LEN];                                        /// line built by format stage
+    struct filter_Chain filters[SENSOR_MAX_INSTANCES];                          /// data filtering, per sensor
+    uint32_t filterCycles, filterCyclesMax;                                     /// cost of last and worst filtered sample
+    uint8_t selectedSensor;                                                     /// sensor instance configured by CLI commands
     bool clickDetecionEnabled;                                                  /// click detection enabled flag
+    bool clockGovernorEnabled;                                                  /// SYSCLK follows workload
+    uint16_t statsWindowMs;                                                     /// summary period, 0 prints every sample
+    struct stats_Window statsWindow[SENSOR_MAX_INSTANCES];                      /// statistics of current window, per sensor
+    uint32_t statsWindowLen[SENSOR_MAX_INSTANCES];                              /// samples per window at sensor rate
+    volatile uint16_t pendingAvg[SENSOR_MAX_INSTANCES];                         /// moving average length for DSP stage, 0 for none
+    struct filter_StageConfig pendingStages[SENSOR_MAX_INSTANCES][FILTER_MAX_STAGES]; /// stage setups for DSP stage
+    volatile uint8_t pendingStageMask[SENSOR_MAX_INSTANCES];                    /// bit per stage waiting in pendingStages
 } base;
 
 /* === private functions === */
 
+/* Length of moving average stage, 1 when there is none */
+static uint16_t
+getAvgNumber (uint8_t idx)
+{
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+        {
+            const struct filter_StageConfig *config =
+                    &base.filters[idx].stages[s].config;
+            if (FILTER_MOVING_AVG == config->type)
+                {
+                    return config->param;
+                }
+        }
+    return 1;
+}
+
 static void
 printAccSetup ()
 {
+    uint8_t idx = base.selectedSensor;
+
+    /* print selected sensor when more than one found */
+    if (sensor_getNumOfInstances () > 1)
+        {
+            PRINT_TO_CLI("\n\rsensor %u of %u, I2C load %u%%", idx,
+                         sensor_getNumOfInstances (), sensor_getBusLoad ());
+        }
 
     /* print full scale */
     PRINT_TO_CLI("\n\rfull scale range +/- %u g\n\r",
-                 sensor_getAccFullScaleInt ());
+                 sensor_getAccFullScaleInt (idx));
     /* print data read rate */
     PRINT_TO_CLI("data read rate: %lu.%lu Hz\n\r",
-                 sensor_getAccRateInt () / 1000,
-                 sensor_getAccRateInt () % 1000);
+                 sensor_getAccRateInt (idx) / 1000,
+                 sensor_getAccRateInt (idx) % 1000);
 
     /* print number of averaged samples */
-    PRINT_TO_CLI("number of averaged samples: %d\n\r",
-                 base.accData.numOfAveragedSamples);
+    PRINT_TO_CLI("number of averaged samples: %u\n\r", getAvgNumber (idx));
 
     /* print state of  click detection */
     char tempStr[4];
@@ -121,6 +207,23 @@ printAccSetup ()
             snprintf ((char*) tempStr, CLI_MAX_LINE_LEN, "OFF");
         }
     PRINT_TO_CLI("click detection %s\n\r", tempStr);
+    struct sensor_ClickConfig click;
+    sensor_getClick (idx, &click);
+    PRINT_TO_CLI("click %u mg, %u ms, dbl %u+%u ms\n\r", click.thresholdMg,
+                 click.limitMs, click.latencyMs, click.windowMs);
+
+    /* print free fall detection setup */
+    uint16_t thresholdMg, durationMs;
+    sensor_getFreeFall (idx, &thresholdMg, &durationMs);
+    if (thresholdMg != 0)
+        {
+            PRINT_TO_CLI("free fall below %u mg for %u ms\n\r", thresholdMg,
+                         durationMs);
+        }
+    else
+        {
+            PRINT_TO_CLI("free fall detection OFF\n\r");
+        }
 }
 
 static void
@@ -129,78 +232,1169 @@ printHelp ()
     PRINT_TO_CLI("\n\rList of available commands:\n\racc get setup");
     PRINT_TO_CLI("\n\racc set range [2g|4g|6g|8g|16g]\n\racc set ra");
     PRINT_TO_CLI("te [25Hz|50Hz|100Hz|200Hz|400Hz|800Hz|1600Hz]\n\r");
-    PRINT_TO_CLI("acc set avg number [1-1000]\n\racc set click det ");
-    PRINT_TO_CLI("[on|off]\n\rstart\n\n\r>>");
+    PRINT_TO_CLI("acc rate measure [off]\n\r");
+    PRINT_TO_CLI("acc set avg number [1-500]\n\racc set click det ");
+    PRINT_TO_CLI("[on|off]\n\racc sel [0-1]\n\ri2c stats\n\rsys boot");
+    PRINT_TO_CLI("\n\racc set free fall [off|<mg> <ms>]");
+    PRINT_TO_CLI("\n\racc set click <mg> <ms> <lat ms> <win ms>");
+    PRINT_TO_CLI("\n\revent stats\n\rpipeline stats");
+    PRINT_TO_CLI("\n\ri2c speed [100|400|1000]");
+    PRINT_TO_CLI("\n\rpower [run|sleep|stop]\n\rpower stats");
+    PRINT_TO_CLI("\n\rclock [auto|8|24|48|72]\n\rclock get");
+    PRINT_TO_CLI("\n\rcapture [click|off|<mg>]\n\rcapture get");
+    PRINT_TO_CLI("\n\rstats [off|<window ms>]");
+    PRINT_TO_CLI("\n\rtrace [on|off|dump|get]");
+    PRINT_TO_CLI("\n\rfilter [0-2] [off|avg|ema|lp|hp] <n>");
+    PRINT_TO_CLI("\n\rfilter get");
+    PRINT_TO_CLI("\n\rprofile [save|load|default] <name>");
+    PRINT_TO_CLI("\n\rprofile list\n\rstart\n\rstop, while streaming range,");
+    PRINT_TO_CLI("\n\rrate, avg and sel work as well\n\n\r>>");
+}
+
+/* Convert stored sensor setup, stored values are sensor module enum values */
+static void
+toSensorConfig (const struct profile_SensorConfig *stored,
+                struct sensor_AccConfig *config)
+{
+    config->fullScale = stored->fullScale;
+    config->rate = stored->rate;
+    config->AAFilterBW = stored->AAFilterBW;
+}
+
+static bool
+isAvgNumberValid (uint16_t avgNumber)
+{
+    return avgNumber >= ACC_MIN_AVG_NUMBER && avgNumber <= ACC_MAX_AVG_NUMBER;
+}
+
+/* Set length of moving average stage, stage 0 is used when there is none yet */
+static bool
+setFilterAvgNumber (uint8_t idx, uint16_t avgNumber)
+{
+    const struct filter_StageConfig config =
+        { FILTER_MOVING_AVG, avgNumber };
+    uint8_t stage = 0;
+
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+        {
+            if (FILTER_MOVING_AVG == base.filters[idx].stages[s].config.type)
+                {
+                    stage = s;
+                }
+        }
+    return filter_setStage (&base.filters[idx], stage, &config);
+}
+
+/* Get current setup of all sensors and data processing */
+static void
+captureProfile (struct profile_Config *config)
+{
+    struct sensor_AccConfig acc;
+
+    memset (config, 0, sizeof(*config));
+    for (uint8_t i = 0; i < sensor_getNumOfInstances (); i++)
+        {
+            sensor_getAccConfig (i, &acc);
+            config->sensors[i].fullScale = acc.fullScale;
+            config->sensors[i].rate = acc.rate;
+            config->sensors[i].AAFilterBW = acc.AAFilterBW;
+            config->sensors[i].avgNumber = getAvgNumber (i);
+        }
+    config->clickDetection = base.clickDetecionEnabled;
+}
+
+/* Apply data processing part of profile, sensor part is applied by caller */
+static void
+applyProcessingConfig (const struct profile_Config *config)
+{
+    for (uint8_t i = 0; i < SENSOR_MAX_INSTANCES; i++)
+        {
+            if (isAvgNumberValid (config->sensors[i].avgNumber))
+                {
+                    setFilterAvgNumber (i, config->sensors[i].avgNumber);
+                }
+        }
+    base.clickDetecionEnabled = config->clickDetection;
+}
+
+static void
+printProfileStatus (enum profile_Status status)
+{
+    switch (status)
+        {
+        case PROFILE_OK:
+            break;
+        case PROFILE_NOT_FOUND:
+            PRINT_TO_CLI("No such profile\n\r");
+            break;
+        case PROFILE_FULL:
+            PRINT_TO_CLI("Profile store full\n\r");
+            break;
+        case PROFILE_INVALID_NAME:
+            PRINT_TO_CLI("Wrong profile name\n\r");
+            break;
+        case PROFILE_FLASH_ERROR:
+        default:
+            PRINT_TO_CLI("Flash error\n\r");
+            break;
+        }
+}
+
+static void
+saveProfile (const char *name)
+{
+    struct profile_Config config;
+
+    captureProfile (&config);
+    printProfileStatus (profile_save (name, &config));
+}
+
+static void
+loadProfile (const char *name)
+{
+    struct profile_Config config;
+    struct sensor_AccConfig acc;
+    enum profile_Status status = profile_load (name, &config);
+
+    if (status != PROFILE_OK)
+        {
+            printProfileStatus (status);
+            return;
+        }
+    /* every sensor gets whole setup in one burst */
+    for (uint8_t i = 0; i < sensor_getNumOfInstances (); i++)
+        {
+            toSensorConfig (&config.sensors[i], &acc);
+            if (!sensor_setAccConfig (i, &acc))
+                {
+                    PRINT_TO_CLI("Rate exceeds I2C bus bandwidth\n\r");
+                }
+        }
+    applyProcessingConfig (&config);
+}
+
+static void
+printProfiles ()
+{
+    char defaultName[PROFILE_NAME_LEN] =
+        { 0 };
+    const char *name = profile_getDefault ();
+    struct profile_Info info;
+
+    if (name != NULL)
+        {
+            strncpy (defaultName, name, PROFILE_NAME_LEN - 1);
+        }
+    for (uint8_t n = 0; (name = profile_getName (n)) != NULL; n++)
+        {
+            PRINT_TO_CLI("\n\r%c %s",
+                         0 == strncmp (name, defaultName, PROFILE_NAME_LEN) ?
+                                 '*' : ' ',
+                         name);
+        }
+    profile_getInfo (&info);
+    PRINT_TO_CLI("\n\rpage %u, sequence %lu, %lu bytes free\n\r",
+                 info.activePage, info.sequence, info.freeBytes);
+}
+
+/* Mount profile store and load boot profile, false if there is none */
+static bool
+loadBootProfile (struct sensor_AccConfig bootConfig[SENSOR_MAX_INSTANCES])
+{
+    struct profile_Config config;
+    const char *name;
+
+    if (PROFILE_OK != profile_init (flash_getProfileArea ())
+            || NULL == (name = profile_getDefault ())
+            || PROFILE_OK != profile_load (name, &config))
+        {
+            return false;
+        }
+    for (uint8_t i = 0; i < SENSOR_MAX_INSTANCES; i++)
+        {
+            toSensorConfig (&config.sensors[i], &bootConfig[i]);
+        }
+    applyProcessingConfig (&config);
+    return true;
+}
+
+static void
+printBootTimes ()
+{
+    static const char *markNames[SYSTIME_BOOT_MARK_COUNT] =
+        { "clocks", "scheduler", "sensor ready", "first sample" };
+
+    PRINT_TO_CLI("\n\rms from reset:");
+    for (uint8_t mark = 0; mark < SYSTIME_BOOT_MARK_COUNT; mark++)
+        {
+            uint32_t us = systime_getBootMarkUs (mark);
+            if (us == 0)
+                {
+                    PRINT_TO_CLI("\n\r%-14s%10s", markNames[mark], "-");
+                }
+            else
+                {
+                    PRINT_TO_CLI("\n\r%-14s%6lu.%.3lu", markNames[mark],
+                                 us / 1000, us % 1000);
+                }
+        }
+    PRINT_TO_CLI("\n\r");
+}
+
+static void
+printBusStats ()
+{
+    static const char *opNames[SENSOR_BUS_OP_COUNT] =
+        { "init", "config", "data", "event" };
+
+    for (uint8_t i = 0; i < sensor_getNumOfInstances (); i++)
+        {
+            PRINT_TO_CLI("\n\rsensor %u%9s%10s%10s", i, "ops", "trans",
+                         "skipped");
+            for (uint8_t op = 0; op < SENSOR_BUS_OP_COUNT; op++)
+                {
+                    const struct regmap_OpStats *stats = sensor_getBusStats (i,
+                                                                             op);
+                    PRINT_TO_CLI("\n\r%-7s%10lu%10lu%10lu", opNames[op],
+                                 stats->ops, stats->transactions,
+                                 stats->writesSkipped);
+                }
+        }
+    const struct I2C_Stats *i2cStats = I2C_getStats ();
+    PRINT_TO_CLI("\n\rtransfers %lu, failed %lu", i2cStats->transfers,
+                 i2cStats->failures);
+    PRINT_TO_CLI("\n\rretries %lu, recoveries %lu", i2cStats->retries,
+                 i2cStats->recoveries);
+    PRINT_TO_CLI("\n\rnack %lu, berr %lu, arlo %lu, timeout %lu",
+                 i2cStats->nacks, i2cStats->busErrors,
+                 i2cStats->arbitrationLosses, i2cStats->timeouts);
+    PRINT_TO_CLI("\n\r");
+}
+
+/* Select lowest SYSCLK which handles sample processing of all sensors */
+static void
+governClock ()
+{
+    if (!base.clockGovernorEnabled)
+        {
+            return;
+        }
+
+    uint32_t cyclesPerSecond = 0;
+    if (SYSTEM_ACC_DATA_PROCESSING == base.state)
+        {
+            for (uint8_t i = 0; i < sensor_getNumOfInstances (); i++)
+                {
+                    cyclesPerSecond += (uint32_t) (((uint64_t) sensor_getAccRateInt (
+                            i) * CYCLES_PER_SAMPLE) / 1000);
+                }
+        }
+    clock_setLevel (clock_levelForLoad (cyclesPerSecond));
+}
+
+static void
+setClockMhz (uint16_t mhz)
+{
+    for (uint8_t level = 0; level < CLOCK_LEVEL_COUNT; level++)
+        {
+            if (clock_getLevelHz (level) == mhz * 1000000UL)
+                {
+                    base.clockGovernorEnabled = false;
+                    clock_setLevel (level);
+                    return;
+                }
+        }
+    PRINT_TO_CLI("Available: 8, 24, 48, 72 MHz\n\r");
+}
+
+static void
+printClock ()
+{
+    PRINT_TO_CLI("\n\rsysclk %lu MHz, %s, %lu switches\n\r",
+                 clock_getLevelHz (clock_getLevel ()) / 1000000,
+                 base.clockGovernorEnabled ? "auto" : "fixed",
+                 clock_getNumOfSwitches ());
+}
+
+static void
+printBusSpeed ()
+{
+    static const char *speedNames[I2CTIMING_SPEED_COUNT] =
+        { "standard", "fast", "fast plus" };
+
+    PRINT_TO_CLI("\n\rI2C %s, SCL %lu Hz", speedNames[I2C_getSpeed ()],
+                 I2C_getBusFrequency ());
+    PRINT_TO_CLI("\n\rsample read %lu us, bus load %u%%\n\r",
+                 sensor_getBusTimePerSampleUs (), sensor_getBusLoad ());
+}
+
+static void
+setBusSpeed (uint16_t khz)
+{
+    for (uint8_t speed = 0; speed < I2CTIMING_SPEED_COUNT; speed++)
+        {
+            if (i2ctiming_getSpec (speed)->hz == khz * 1000UL)
+                {
+                    if (!I2C_setSpeed (speed))
+                        {
+                            PRINT_TO_CLI("Speed not reachable at this clock\n\r");
+                        }
+                    printBusSpeed ();
+                    return;
+                }
+        }
+    PRINT_TO_CLI("Available: 100, 400, 1000 kHz\n\r");
+}
+
+static const char *powerModeNames[POWER_MODE_COUNT] =
+    { "run", "sleep", "stop" };
+
+static void
+setPowerMode (const char *modeName)
+{
+    for (uint8_t mode = 0; mode < POWER_MODE_COUNT; mode++)
+        {
+            if (0 == strncmp (modeName, powerModeNames[mode], CLI_MAX_LINE_LEN))
+                {
+                    power_setMode (mode);
+                    return;
+                }
+        }
+    PRINT_COMMAND_NOT_RECOGNISED();
+}
+
+/* Print time share spent in sleep and STOP mode since last mode change */
+static void
+printPowerStats ()
+{
+    struct power_Stats stats;
+    power_getStats (&stats);
+    uint64_t totalUs = stats.totalUs > 0 ? stats.totalUs : 1;
+    uint32_t sleepPermille = stats.sleepUs * 1000 / totalUs;
+    uint32_t stopPermille = stats.stopUs * 1000 / totalUs;
+
+    PRINT_TO_CLI("\n\rmode %s, %lu s", powerModeNames[power_getMode ()],
+                 (uint32_t) (stats.totalUs / 1000000));
+    PRINT_TO_CLI("\n\rsleep %3lu.%lu%%, %lu entries", sleepPermille / 10,
+                 sleepPermille % 10, stats.sleeps);
+    PRINT_TO_CLI("\n\rstop  %3lu.%lu%%, %lu entries", stopPermille / 10,
+                 stopPermille % 10, stats.stops);
+    PRINT_TO_CLI("\n\ruart wakeups %lu\n\r", stats.uartWakeups);
+}
+
+static void
+setCaptureThreshold (uint16_t thresholdMg)
+{
+    if (thresholdMg >= CAPTURE_MIN_THRESHOLD_MG
+            && thresholdMg <= CAPTURE_MAX_THRESHOLD_MG)
+        {
+            capture_enable (base.selectedSensor, CAPTURE_TRIGGER_THRESHOLD,
+                            thresholdMg);
+        }
+    else
+        {
+            PRINT_TO_CLI("Threshold range 1-16000 mg\n\r");
+        }
+}
+
+static void
+printCapture ()
+{
+    static const char *triggerNames[CAPTURE_TRIGGER_COUNT] =
+        { "click", "threshold" };
+    const struct capture_Stats *stats = capture_getStats ();
+    enum capture_Trigger trigger;
+    uint16_t thresholdMg;
+    uint8_t idx;
+
+    capture_getSetup (&idx, &trigger, &thresholdMg);
+    if (!capture_isEnabled ())
+        {
+            PRINT_TO_CLI("\n\rcapture off");
+        }
+    else if (CAPTURE_TRIGGER_THRESHOLD == trigger)
+        {
+            PRINT_TO_CLI("\n\rcapture sensor %u, %s %u mg", idx,
+                         triggerNames[trigger], thresholdMg);
+        }
+    else
+        {
+            PRINT_TO_CLI("\n\rcapture sensor %u, %s", idx,
+                         triggerNames[trigger]);
+        }
+    PRINT_TO_CLI("\n\r%u+%u samples, %lu frames, %lu missed\n\r",
+                 CAPTURE_PRE_SAMPLES, CAPTURE_POST_SAMPLES, stats->frames,
+                 stats->missedTriggers);
+}
+
+static void
+setStatsWindow (uint16_t windowMs)
+{
+    if (windowMs >= STATS_MIN_WINDOW_MS && windowMs <= STATS_MAX_WINDOW_MS)
+        {
+            base.statsWindowMs = windowMs;
+        }
+    else
+        {
+            PRINT_TO_CLI("Window range 100-60000 ms\n\r");
+        }
+}
+
+/* Window length in samples at current rate of sensor, window starts again */
+static void
+restartStatsWindow (uint8_t idx)
+{
+    uint32_t len = (uint32_t) ((uint64_t) sensor_getAccRateInt (idx)
+            * base.statsWindowMs / 1000000);
+    base.statsWindowLen[idx] = len > 0 ? len : 1;
+    stats_reset (&base.statsWindow[idx]);
+}
+
+static void
+startStats ()
+{
+    for (uint8_t i = 0; i < sensor_getNumOfInstances (); i++)
+        {
+            restartStatsWindow (i);
+        }
+    PRINT_TO_CLI("       mean   rms      var  peak   p-p\n\r");
+}
+
+/* Add sample to window, summary of every axis is taken when window is complete */
+static bool
+processStats (const struct sensor_Output *sensOut, struct StageItem *item)
+{
+    struct stats_Window *window = &base.statsWindow[sensOut->sensorIdx];
+
+    stats_add (window, sensOut->xyzData.x, sensOut->xyzData.y,
+               sensOut->xyzData.z);
+    if (window->count < base.statsWindowLen[sensOut->sensorIdx])
+        {
+            return false;
+        }
+    for (uint8_t axis = 0; axis < STATS_AXES; axis++)
+        {
+            stats_getSummary (window, axis, &item->summary[axis]);
+        }
+    stats_reset (window);
+    item->type = STAGE_ITEM_STATS;
+    item->sensorIdx = sensOut->sensorIdx;
+    return true;
+}
+
+/* Print one line per axis of statistics window summary */
+static void
+formatStats (const struct StageItem *item)
+{
+    static const char axisNames[STATS_AXES] =
+        { 'x', 'y', 'z' };
+
+    for (uint8_t axis = 0; axis < STATS_AXES; axis++)
+        {
+            const struct stats_Summary *summary = &item->summary[axis];
+            snprintf ((char*) base.formatTab, CLI_MAX_LINE_LEN,
+                      "#%u %c %6d%6u%9lu%6u%6u\n\r", item->sensorIdx,
+                      axisNames[axis], summary->mean, summary->rms,
+                      summary->variance, summary->peak, summary->peakToPeak);
+            SEND_TO_CLI(base.formatTab);
+        }
+}
+
+/* Send frozen capture as binary TX items */
+static void
+sendCaptureFrame (uint8_t *item)
+{
+    xSemaphoreTake (base.frameMutex, portMAX_DELAY);
+    item[0] = CLI_BIN_ITEM_MARK;
+    while (0 < (item[1] = capture_readFrame (&item[2], CLI_BIN_MAX_LEN)))
+        {
+            SEND_TO_CLI(item);
+        }
+    xSemaphoreGive (base.frameMutex);
+}
+
+/* Stop recording and send ring with task names as binary TX items, dump itself is not recorded */
+static void
+sendTraceFrame ()
+{
+    TaskStatus_t tasks[TRACE_MAX_TASKS];
+
+    trace_stop (systime_getCycles ());
+    UBaseType_t numOfTasks = uxTaskGetSystemState (tasks, TRACE_MAX_TASKS,
+                                                   NULL);
+    for (UBaseType_t t = 0; t < numOfTasks; t++)
+        {
+            trace_addTaskName (tasks[t].xTaskNumber, tasks[t].pcTaskName);
+        }
+    xSemaphoreTake (base.frameMutex, portMAX_DELAY);
+    base.auxTab[0] = CLI_BIN_ITEM_MARK;
+    while (0
+            < (base.auxTab[1] = trace_readFrame (&base.auxTab[2],
+                                                 CLI_BIN_MAX_LEN)))
+        {
+            SEND_TO_CLI(base.auxTab);
+        }
+    xSemaphoreGive (base.frameMutex);
+}
+
+static void
+printTrace ()
+{
+    uint16_t records;
+    uint32_t overwritten;
+
+    trace_getFill (&records, &overwritten);
+    PRINT_TO_CLI("trace %s, %u records, %lu lost\n\r",
+                 trace_isRecording () ? "on" : "off", records, overwritten);
 }
 
 static void
 setAccFullScale (uint8_t fullScaleVal)
 {
+    struct sensor_AccConfig config;
+
+    sensor_getAccConfig (base.selectedSensor, &config);
     switch (fullScaleVal)
         {
-        case 2:
-            sensor_setAccFullScale (SENSOR_ACC_FULL_SCALE_2G);
-            break;
-        case 4:
-            sensor_setAccFullScale (SENSOR_ACC_FULL_SCALE_4G);
-            break;
-        case 6:
-            sensor_setAccFullScale (SENSOR_ACC_FULL_SCALE_6G);
-            break;
-        case 8:
-            sensor_setAccFullScale (SENSOR_ACC_FULL_SCALE_8G);
-            break;
-        case 16:
-            sensor_setAccFullScale (SENSOR_ACC_FULL_SCALE_16G);
-            break;
-        default:
-            PRINT_TO_CLI("Wrong full scale value\n\r");
-            break;
+        case 2:
+            config.fullScale = SENSOR_ACC_FULL_SCALE_2G;
+            break;
+        case 4:
+            config.fullScale = SENSOR_ACC_FULL_SCALE_4G;
+            break;
+        case 6:
+            config.fullScale = SENSOR_ACC_FULL_SCALE_6G;
+            break;
+        case 8:
+            config.fullScale = SENSOR_ACC_FULL_SCALE_8G;
+            break;
+        case 16:
+            config.fullScale = SENSOR_ACC_FULL_SCALE_16G;
+            break;
+        default:
+            PRINT_TO_CLI("Wrong full scale value\n\r");
+            return;
+        }
+    /* while streaming, new range takes effect at a sample boundary */
+    sensor_changeAccConfig (base.selectedSensor, &config);
+}
+
+static void
+setAccRate (uint16_t rateVal)
+{
+    struct sensor_AccConfig config;
+    enum sensor_AccRate rate;
+
+    switch (rateVal)
+        {
+        case 25:
+            rate = SENSOR_ACC_RATE_25HZ;
+            break;
+        case 50:
+            rate = SENSOR_ACC_RATE_50HZ;
+            break;
+        case 100:
+            rate = SENSOR_ACC_RATE_100HZ;
+            break;
+        case 200:
+            rate = SENSOR_ACC_RATE_200HZ;
+            break;
+        case 400:
+            rate = SENSOR_ACC_RATE_400HZ;
+            break;
+        case 800:
+            rate = SENSOR_ACC_RATE_800HZ;
+            break;
+        case 1600:
+            rate = SENSOR_ACC_RATE_1600HZ;
+            break;
+        default:
+            PRINT_TO_CLI("Wrong rate value\n\r");
+            return;
+        }
+
+    /* while streaming, DSP stage follows the new rate when it reaches the stream */
+    sensor_getAccConfig (base.selectedSensor, &config);
+    config.rate = rate;
+    if (!sensor_changeAccConfig (base.selectedSensor, &config))
+        {
+            PRINT_TO_CLI("Rate exceeds I2C bus bandwidth\n\r");
+        }
+    else if (SYSTEM_ACC_DATA_PROCESSING == base.state)
+        {
+            governClock ();
+        }
+    else if (!filter_setRate (&base.filters[base.selectedSensor],
+                              sensor_getAccRateInt (base.selectedSensor)))
+        {
+            PRINT_TO_CLI("Filter cutoff over rate, turned off\n\r");
+        }
+}
+
+static void
+setAccAvgNumber (uint16_t avgNumebr)
+{
+    if (!isAvgNumberValid (avgNumebr))
+        {
+            PRINT_TO_CLI("wrong number of averaged samples");
+        }
+    else if (SYSTEM_ACC_DATA_PROCESSING == base.state)
+        {
+            /* filter belongs to DSP stage while streaming, it takes the change with next sample */
+            base.pendingAvg[base.selectedSensor] = avgNumebr;
+        }
+    else if (!setFilterAvgNumber (base.selectedSensor, avgNumebr))
+        {
+            PRINT_TO_CLI("wrong number of averaged samples");
+        }
+}
+
+static void
+setFilterStage (uint8_t stage, const char *typeName, uint16_t param)
+{
+    uint8_t idx = base.selectedSensor;
+    struct filter_StageConfig config =
+        { FILTER_TYPE_COUNT, param };
+    bool valid;
+
+    for (uint8_t t = 0; t < FILTER_TYPE_COUNT; t++)
+        {
+            if (0 == strcmp (typeName, filterTypeNames[t]))
+                {
+                    config.type = t;
+                }
+        }
+    if (SYSTEM_ACC_DATA_PROCESSING == base.state)
+        {
+            /* filter belongs to DSP stage while streaming, setup is checked between two of its
+             * items and it takes the change with next sample */
+            xSemaphoreTake (base.dspMutex, portMAX_DELAY);
+            valid = FILTER_TYPE_COUNT != config.type
+                    && filter_checkStage (&base.filters[idx], stage, &config);
+            xSemaphoreGive (base.dspMutex);
+            if (valid)
+                {
+                    taskENTER_CRITICAL();
+                    base.pendingStages[idx][stage] = config;
+                    base.pendingStageMask[idx] |= 1 << stage;
+                    taskEXIT_CRITICAL();
+                }
+        }
+    else
+        {
+            /* biquads are designed for current rate of selected sensor */
+            filter_setRate (&base.filters[idx], sensor_getAccRateInt (idx));
+            valid = FILTER_TYPE_COUNT != config.type
+                    && filter_setStage (&base.filters[idx], stage, &config);
+        }
+    if (!valid)
+        {
+            PRINT_TO_CLI("Wrong filter setup\n\r");
+        }
+}
+
+static void
+printFilter ()
+{
+    const struct filter_Chain *chain = &base.filters[base.selectedSensor];
+
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+        {
+            const struct filter_StageConfig *config = &chain->stages[s].config;
+            PRINT_TO_CLI("\n\rstage %u: %s %u", s, filterTypeNames[config->type],
+                         config->param);
+        }
+    PRINT_TO_CLI("\n\rcycles/sample %lu, max %lu\n\r", base.filterCycles,
+                 base.filterCyclesMax);
+}
+
+/* First call arms measurement of selected sensor, window fills while streaming */
+static void
+printMeasuredRate ()
+{
+    uint8_t idx = base.selectedSensor;
+    uint32_t nominal = sensor_getAccRateInt (idx);
+    struct odr_Summary summary;
+
+    if (!sensor_getMeasuredAccRate (idx, &summary))
+        {
+            sensor_measureAccRate (idx, true);
+            PRINT_TO_CLI("rate measurement armed, type start\n\r");
+            return;
+        }
+    if (summary.rateMilliHz == 0 || nominal == 0)
+        {
+            PRINT_TO_CLI("no data ready edges yet\n\r");
+            return;
+        }
+    int32_t ppm = ((int64_t) summary.rateMilliHz - nominal) * 1000000
+            / (int64_t) nominal;
+    PRINT_TO_CLI("rate %lu.%03lu Hz, %+ld ppm\n\r",
+                 summary.rateMilliHz / 1000, summary.rateMilliHz % 1000, ppm);
+    PRINT_TO_CLI("nominal %lu.%03lu Hz\n\r", nominal / 1000, nominal % 1000);
+    PRINT_TO_CLI("jitter rms %lu ns, max %lu ns\n\r", summary.jitterNs,
+                 summary.maxDeviationNs);
+    PRINT_TO_CLI("missed %lu of %lu periods\n\r", summary.missed,
+                 summary.periods);
+}
+
+static void
+setFreeFall (uint16_t thresholdMg, uint16_t durationMs)
+{
+    if (!sensor_setFreeFall (base.selectedSensor, thresholdMg, durationMs))
+        {
+            PRINT_TO_CLI("Free fall setup out of range\n\r");
+        }
+}
+
+/* Event lines in base.auxTab go through CLI event lane ahead of sample lines, but not in between
+ * items of binary capture frame. Latency is measured while streaming. */
+static void
+sendEventLine (const struct sensor_Output *sensOut)
+{
+    if (capture_isEnabled ())
+        {
+            xSemaphoreTake (base.frameMutex, portMAX_DELAY);
+            SEND_TO_CLI(base.auxTab);
+            xSemaphoreGive (base.frameMutex);
+        }
+    else
+        {
+            CLI_sendEvent ((char*) base.auxTab, sensOut->event.cycles,
+                           SYSTEM_ACC_DATA_PROCESSING == base.state);
+        }
+}
+
+static void
+printFreeFall (const struct sensor_Output *sensOut)
+{
+    snprintf ((char*) base.auxTab, CLI_MAX_LINE_LEN,
+              "\n\rfree fall #%u at %lu.%03lu s\n\r", sensOut->sensorIdx,
+              sensOut->event.timeMs / 1000, sensOut->event.timeMs % 1000);
+    sendEventLine (sensOut);
+}
+
+/* Print time, axes, sign and kind of click at end of current sample line, cursor is moved back.
+ * Time is taken at interrupt, RTC and tick time both start at 00:00:00 on boot. */
+static void
+printClick (const struct sensor_Output *sensOut)
+{
+    uint32_t seconds = sensOut->event.timeMs / 1000;
+    char *start = fmt_str ((char*) base.auxTab, "   ");
+    char *line = fmt_hhmmss (start, seconds / 3600 % 24, seconds / 60 % 60,
+                             seconds % 60);
+    *line++ = ' ';
+    for (uint8_t a = 0; a < 3; a++)
+        {
+            if (sensOut->event.axes & (SENSOR_AXIS_X << a))
+                {
+                    *line++ = 'x' + a;
+                }
+        }
+    *line++ = sensOut->event.negative ? '-' : '+';
+    if (sensOut->event.doubleClick)
+        {
+            line = fmt_str (line, " dbl");
+        }
+    for (int n = line - start; n > 0; n--)
+        {
+            *line++ = '\b';
+        }
+    *line = '\0';
+    sendEventLine (sensOut);
+}
+
+static void
+printEventLatency ()
+{
+    struct CLI_LatencyStats stats;
+
+    CLI_getEventLatency (&stats);
+    PRINT_TO_CLI("\n\revents %lu, latency last %lu us", stats.count,
+                 stats.lastUs);
+    PRINT_TO_CLI("\n\rmax %lu us, avg %lu us\n\r", stats.maxUs, stats.avgUs);
+}
+
+static void
+printPipeline ()
+{
+    struct pipeline_StageStats stats;
+
+    PRINT_TO_CLI("stage     it/s qmax  max us avg us load full\n\r");
+    for (uint8_t s = 0; s < PIPELINE_STAGE_COUNT; s++)
+        {
+            pipeline_getStats (s, &stats);
+            PRINT_TO_CLI("%-9s%5lu%5u%8lu%7lu%4u%%%5lu\n\r",
+                         pipeline_getStageName (s), stats.itemsPerS,
+                         stats.queueMax, stats.serviceMaxUs,
+                         stats.serviceAvgUs, stats.loadPercent,
+                         stats.outputFull);
+        }
+}
+
+static void
+setClick (uint16_t thresholdMg, uint16_t limitMs, uint16_t latencyMs,
+          uint16_t windowMs)
+{
+    const struct sensor_ClickConfig config =
+        { thresholdMg, limitMs, latencyMs, windowMs };
+
+    if (!sensor_setClick (base.selectedSensor, &config))
+        {
+            PRINT_TO_CLI("Click setup out of range\n\r");
+        }
+}
+
+/* Serve detection as soon as it arrives. Free fall is reported in every state, clicks only while
+ * streaming, where they belong to the sample lines. */
+static void
+processEvent (const struct sensor_Output *sensOut)
+{
+    switch (sensOut->type)
+        {
+        case SENSOR_OUT_FREE_FALL:
+            printFreeFall (sensOut);
+            break;
+        case SENSOR_OUT_CLICK_DETECTION:
+            if (SYSTEM_ACC_DATA_PROCESSING != base.state)
+                {
+                    break;
+                }
+            /* send notification and time of click detection to CLI, capture runs in DSP stage */
+            if (capture_isEnabled ())
+                {
+                    vTaskSuspendAll ();
+                    capture_onClick (sensOut->sensorIdx);
+                    xTaskResumeAll ();
+                }
+            else if (base.clickDetecionEnabled)
+                {
+                    printClick (sensOut);
+                }
+            break;
+        default:
+            break;
+        }
+}
+
+static void
+selectSensor (uint8_t sensorIdx)
+{
+    if (sensorIdx < sensor_getNumOfInstances ())
+        {
+            base.selectedSensor = sensorIdx;
+        }
+    else
+        {
+            PRINT_TO_CLI("No such sensor\n\r");
+        }
+}
+
+/* DSP stage work on one sample, fills up to two items for format stage */
+static uint8_t
+processAccData (const struct sensor_Output *sensOut,
+                struct StageItem items[2])
+{
+    uint8_t n = 0;
+
+    /* with capture or statistics, samples are not printed one by one */
+    if (capture_isEnabled ()
+            && capture_addSample (sensOut->sensorIdx, sensOut->xyzData.x,
+                                  sensOut->xyzData.y, sensOut->xyzData.z))
+        {
+            items[n].type = STAGE_ITEM_CAPTURE;
+            items[n++].sensorIdx = sensOut->sensorIdx;
+        }
+    if (base.statsWindowMs != 0 && processStats (sensOut, &items[n]))
+        {
+            n++;
+        }
+    if (capture_isEnabled () || base.statsWindowMs != 0)
+        {
+            return n;
+        }
+
+    struct StageItem *item = &items[n++];
+    item->type = STAGE_ITEM_SAMPLE;
+    item->sensorIdx = sensOut->sensorIdx;
+    item->xyz[0] = sensOut->xyzData.x;
+    item->xyz[1] = sensOut->xyzData.y;
+    item->xyz[2] = sensOut->xyzData.z;
+    uint32_t start = systime_getCycles ();
+    filter_process (&base.filters[sensOut->sensorIdx], item->xyz);
+    base.filterCycles = systime_getCycles () - start;
+    if (base.filterCycles > base.filterCyclesMax)
+        {
+            base.filterCyclesMax = base.filterCycles;
+        }
+    return n;
+}
+
+/* Take filter changes requested by main_task while streaming, stage setups in stage order, then
+ * moving average length. Returns false if a stage setup did not fit the chain any more. */
+static bool
+applyPendingFilter (uint8_t idx)
+{
+    struct filter_StageConfig stages[FILTER_MAX_STAGES];
+    uint8_t mask;
+    uint16_t avgNumber;
+    bool valid = true;
+
+    taskENTER_CRITICAL();
+    mask = base.pendingStageMask[idx];
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+        {
+            stages[s] = base.pendingStages[idx][s];
+        }
+    avgNumber = base.pendingAvg[idx];
+    base.pendingStageMask[idx] = 0;
+    base.pendingAvg[idx] = 0;
+    taskEXIT_CRITICAL();
+
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+        {
+            if ((mask & (1 << s))
+                    && !filter_setStage (&base.filters[idx], s, &stages[s]))
+                {
+                    valid = false;
+                }
+        }
+    if (avgNumber != 0)
+        {
+            setFilterAvgNumber (idx, avgNumber);
+        }
+    return valid;
+}
+
+/* Setup change reaches DSP stage at a sample boundary: sensor setup as item from sensor task, filter
+ * stages and moving average length from main_task through pendingStages and pendingAvg. Processing
+ * follows the new setup and a marker goes to the stream. */
+static void
+processSetupChange (uint8_t idx, bool sensorChanged, struct StageItem *item)
+{
+    item->type = STAGE_ITEM_CONFIG;
+    item->sensorIdx = idx;
+    item->config.filterOff = false;
+    item->config.filterRejected = !applyPendingFilter (idx);
+    if (sensorChanged)
+        {
+            item->config.filterOff = !filter_setRate (&base.filters[idx],
+                                                      sensor_getAccRateInt (idx));
+            if (base.statsWindowMs != 0)
+                {
+                    restartStatsWindow (idx);
+                }
+        }
+    item->config.rateMilliHz = sensor_getAccRateInt (idx);
+    item->config.fullScaleG = sensor_getAccFullScaleInt (idx);
+    item->config.avgNumber = getAvgNumber (idx);
+}
+
+/* Setup marker line, samples which follow it use the new setup */
+static void
+formatConfig (const struct StageItem *item)
+{
+    snprintf ((char*) base.formatTab, CLI_MAX_LINE_LEN,
+              "\n\r@cfg #%u %lu.%03luHz %ug avg %u\n\r", item->sensorIdx,
+              item->config.rateMilliHz / 1000, item->config.rateMilliHz % 1000,
+              item->config.fullScaleG, item->config.avgNumber);
+    SEND_TO_CLI(base.formatTab);
+    if (item->config.filterOff)
+        {
+            snprintf ((char*) base.formatTab, CLI_MAX_LINE_LEN,
+                      "Filter cutoff over rate, turned off\n\r");
+            SEND_TO_CLI(base.formatTab);
+        }
+    if (item->config.filterRejected)
+        {
+            snprintf ((char*) base.formatTab, CLI_MAX_LINE_LEN,
+                      "Wrong filter setup\n\r");
+            SEND_TO_CLI(base.formatTab);
+        }
+}
+
+/* Print sample line, lines are tagged with sensor index when more than one sensor found. Line is
+ * dropped when CLI is behind, so acquisition is not held back by the UART. */
+static void
+formatSample (const struct StageItem *item)
+{
+    if (0 == uxQueueSpacesAvailable (base.cliTxQueue))
+        {
+            pipeline_outputFull (PIPELINE_FORMAT);
+            return;
+        }
+
+    /* whole line is built in place and sent as one queue item */
+    char *line = (char*) base.formatTab;
+    *line++ = '\r';
+    if (sensor_getNumOfInstances () > 1)
+        {
+            *line++ = '#';
+            line = fmt_uint (line, item->sensorIdx);
+        }
+    for (uint8_t a = 0; a < FILTER_AXES; a++)
+        {
+            line = fmt_milliG (line, item->xyz[a]);
+        }
+    *line = '\0';
+    SEND_TO_CLI(base.formatTab);
+}
+
+/* Pipeline DSP stage: capture, statistics and filtering of samples. Samples are dropped while
+ * not streaming, setup is changed by main_task only then. */
+static void
+dsp_task (void *params)
+{
+    UNUSED(params);
+
+    struct sensor_Output sensOut;
+    struct StageItem items[3];
+
+    while (1)
+        {
+            xQueueReceive (base.sensorOutputQueue, &sensOut, portMAX_DELAY);
+            /* state is checked under the lock, so after stop the filters belong to main_task */
+            xSemaphoreTake (base.dspMutex, portMAX_DELAY);
+            if (SYSTEM_ACC_DATA_PROCESSING != base.state)
+                {
+                    xSemaphoreGive (base.dspMutex);
+                    continue;
+                }
+            uint32_t start = pipeline_beginItem (
+                    PIPELINE_DSP,
+                    uxQueueMessagesWaiting (base.sensorOutputQueue) + 1);
+            uint8_t n = 0;
+            if (SENSOR_OUT_CONFIG == sensOut.type
+                    || 0 != base.pendingAvg[sensOut.sensorIdx]
+                    || 0 != base.pendingStageMask[sensOut.sensorIdx])
+                {
+                    processSetupChange (sensOut.sensorIdx,
+                                        SENSOR_OUT_CONFIG == sensOut.type,
+                                        &items[n++]);
+                }
+            if (SENSOR_OUT_ACC_DATA == sensOut.type)
+                {
+                    n += processAccData (&sensOut, &items[n]);
+                }
+            pipeline_endItem (PIPELINE_DSP, start);
+            xSemaphoreGive (base.dspMutex);
+            for (uint8_t i = 0; i < n; i++)
+                {
+                    if (pdTRUE != xQueueSendToBack (base.formatQueue, &items[i], 0))
+                        {
+                            pipeline_outputFull (PIPELINE_DSP);
+                            xQueueSendToBack (base.formatQueue, &items[i],
+                                              portMAX_DELAY);
+                        }
+                }
+        }
+}
+
+/* Pipeline format stage: CLI lines and binary frames */
+static void
+format_task (void *params)
+{
+    UNUSED(params);
+
+    struct StageItem item;
+
+    while (1)
+        {
+            xQueueReceive (base.formatQueue, &item, portMAX_DELAY);
+            uint32_t start = pipeline_beginItem (
+                    PIPELINE_FORMAT, uxQueueMessagesWaiting (base.formatQueue) + 1);
+            switch (item.type)
+                {
+                case STAGE_ITEM_SAMPLE:
+                    formatSample (&item);
+                    break;
+                case STAGE_ITEM_STATS:
+                    formatStats (&item);
+                    break;
+                case STAGE_ITEM_CAPTURE:
+                    sendCaptureFrame (base.formatTab);
+                    break;
+                case STAGE_ITEM_CONFIG:
+                    formatConfig (&item);
+                    break;
+                }
+            pipeline_endItem (PIPELINE_FORMAT, start);
         }
 }
 
+/* Leave streaming, sensor stops interrupting after one more data read */
 static void
-setAccRate (uint16_t rateVal)
+stopStreaming ()
 {
-    switch (rateVal)
+    /* trace keeps the records up to here */
+    trace_stop (systime_getCycles ());
+    sensor_stop ();
+    base.state = SYSTEM_IDLE;
+
+    /* wait for the item DSP stage may be serving, it drops samples from then on and does not touch
+     * filters or pending changes, a change it did not take yet is applied here */
+    xSemaphoreTake (base.dspMutex, portMAX_DELAY);
+    xSemaphoreGive (base.dspMutex);
+    for (uint8_t i = 0; i < SENSOR_MAX_INSTANCES; i++)
         {
-        case 25:
-            sensor_setAccRate (SENSOR_ACC_RATE_25HZ);
-            break;
-        case 50:
-            sensor_setAccRate (SENSOR_ACC_RATE_50HZ);
-            break;
-        case 100:
-            sensor_setAccRate (SENSOR_ACC_RATE_100HZ);
-            break;
-        case 200:
-            sensor_setAccRate (SENSOR_ACC_RATE_200HZ);
-            break;
-        case 400:
-            sensor_setAccRate (SENSOR_ACC_RATE_400HZ);
-            break;
-        case 800:
-            sensor_setAccRate (SENSOR_ACC_RATE_800HZ);
-            break;
-        case 1600:
-            sensor_setAccRate (SENSOR_ACC_RATE_1600HZ);
-            break;
-        default:
-            PRINT_TO_CLI("Wrong rate value\n\r");
-            break;
+            applyPendingFilter (i);
         }
+    CLEAR_CLI();
+    governClock ();
 }
 
+/* Commands accepted while streaming. Setup changes take effect at a sample boundary and are
+ * marked in the stream, an empty line or "stop" ends streaming. */
 static void
-setAccAvgNumber (uint16_t avgNumebr)
+executeStreamingCommand ()
 {
-    if (avgNumebr > ACC_MIN_AVG_NUMBER && avgNumebr < ACC_MAX_AVG_NUMBER)
+    uint16_t tempInt = 0;
+    uint16_t param = 0;
+    uint8_t fullScale = 0;
+    char filterName[4];
+
+    if (base.auxTab[0] == 0
+            || 0 == strncmp ((char*) base.auxTab, "stop", CLI_MAX_LINE_LEN))
+        {
+            stopStreaming ();
+        }
+    else if (1
+            == sscanf ((char*) base.auxTab, "acc set range %hhug", &fullScale))
+        {
+            setAccFullScale (fullScale);
+        }
+    else if (1 == sscanf ((char*) base.auxTab, "acc set rate %huHz", &tempInt))
+        {
+            setAccRate (tempInt);
+        }
+    else if (1
+            == sscanf ((char*) base.auxTab, "acc set avg number %hu", &tempInt))
+        {
+            setAccAvgNumber (tempInt);
+        }
+    else if (2
+            <= sscanf ((char*) base.auxTab, "filter %hu %3s %hu", &tempInt,
+                       filterName, &param))
+        {
+            setFilterStage (tempInt, filterName, param);
+        }
+    else if (1 == sscanf ((char*) base.auxTab, "acc sel %hu", &tempInt))
+        {
+            selectSensor (tempInt);
+        }
+    else if (0
+            == strncmp ((char*) base.auxTab, "pipeline stats", CLI_MAX_LINE_LEN))
+        {
+            printPipeline ();
+        }
+    else if (0
+            == strncmp ((char*) base.auxTab, "event stats", CLI_MAX_LINE_LEN))
         {
-            base.accData.numOfAveragedSamples = avgNumebr;
+            printEventLatency ();
         }
     else
         {
-            PRINT_TO_CLI("wrong number of averaged samples");
+            PRINT_TO_CLI("\n\rNot while streaming, type stop first\n\r");
         }
 }
 
@@ -211,20 +1405,32 @@ main_task (void *params)
 
     /* temp variables */
     uint16_t tempInt = 0;
-    RTC_TimeTypeDef rtcTime =
-        { 0 };
-    RTC_DateTypeDef rtcDate =
-        { 0 };
+    char profileName[PROFILE_NAME_LEN];
+    char powerModeName[6];
+    char filterName[4];
+    uint16_t tempInt2 = 0;
+    uint16_t clickSetup[4];
 
+    sensor_waitReady ();
     PRINT_TO_CLI("Type in \"help\" for command list\n\r>>");
-    /* main system loop */
+    /* main system loop, single wait for commands and events in every state */
     while (1)
         {
+            /* one item is taken per selected handle, so set and queues stay in step */
+            if (base.sensorEventQueue
+                    == xQueueSelectFromSet (base.mainSet, portMAX_DELAY))
+                {
+                    struct sensor_Output sensOut =
+                        { 0 };
+                    xQueueReceive (base.sensorEventQueue, &sensOut, 0);
+                    processEvent (&sensOut);
+                    continue;
+                }
+
+            xQueueReceive (base.cliRxQueue, base.auxTab, 0);
             switch (base.state)
                 {
                 case SYSTEM_IDLE:
-                    /* Block task until new command available */
-                    xQueueReceive (base.cliRxQueue, base.auxTab, portMAX_DELAY);
                     /* Execute commands */
                     if (base.auxTab[0] == 0)
                         {
@@ -259,6 +1465,21 @@ main_task (void *params)
                         {
                             setAccRate (tempInt);
 
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "acc rate measure",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printMeasuredRate ();
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab,
+                                        "acc rate measure off",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            sensor_measureAccRate (base.selectedSensor, false);
+
                         }
                     else if (1
                             == sscanf ((char*) base.auxTab,
@@ -266,6 +1487,13 @@ main_task (void *params)
                         {
                             setAccAvgNumber (tempInt);
 
+                        }
+                    else if (1
+                            == sscanf ((char*) base.auxTab, "acc sel %hu",
+                                       &tempInt))
+                        {
+                            selectSensor (tempInt);
+
                         }
                     else if (0
                             == strncmp ((char*) base.auxTab,
@@ -282,174 +1510,350 @@ main_task (void *params)
                         {
                             base.clickDetecionEnabled = false;
 
+                        }
+                    else if (4
+                            == sscanf ((char*) base.auxTab,
+                                       "acc set click %hu %hu %hu %hu",
+                                       &clickSetup[0], &clickSetup[1],
+                                       &clickSetup[2], &clickSetup[3]))
+                        {
+                            setClick (clickSetup[0], clickSetup[1],
+                                      clickSetup[2], clickSetup[3]);
+
                         }
                     else if (0
-                            == strncmp ((char*) base.auxTab, "start",
+                            == strncmp ((char*) base.auxTab,
+                                        "acc set free fall off",
                                         CLI_MAX_LINE_LEN))
                         {
-                            PRINT_TO_CLI("   acc x:    acc y:    acc z:    ");
-                            PRINT_TO_CLI("last click time: \n\r");
-                            sensor_start ();
-                            base.state = SYSTEM_ACC_DATA_PROCESSING;
+                            setFreeFall (0, 0);
 
                         }
-                    else
+                    else if (2
+                            == sscanf ((char*) base.auxTab,
+                                       "acc set free fall %hu %hu", &tempInt,
+                                       &tempInt2))
                         {
-                            PRINT_COMMAND_NOT_RECOGNISED();
+                            setFreeFall (tempInt, tempInt2);
+
                         }
-                    break;
-                case SYSTEM_ACC_DATA_PROCESSING:
-                    if (ANY_CLI_ACTIVITY_DETECTED)
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "i2c stats",
+                                        CLI_MAX_LINE_LEN))
                         {
-                            /* in case of anything received on CLI, go to IDLE state */
-                            base.state = SYSTEM_IDLE;
-                            CLEAR_CLI();
+                            printBusStats ();
 
                         }
-                    else
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "i2c speed",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printBusSpeed ();
+
+                        }
+                    else if (1
+                            == sscanf ((char*) base.auxTab, "i2c speed %hu",
+                                       &tempInt))
+                        {
+                            setBusSpeed (tempInt);
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "capture click",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            capture_enable (base.selectedSensor,
+                                            CAPTURE_TRIGGER_CLICK, 0);
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "capture off",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            capture_disable ();
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "trace on",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            trace_start (SystemCoreClock);
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "trace off",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            trace_stop (systime_getCycles ());
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "trace dump",
+                                        CLI_MAX_LINE_LEN))
                         {
-                            struct sensor_Output sensOut =
-                                { 0 };
-                            int16_t averagedVal;
-                            /* Block in waiting for next data or event from accelerometer */
-                            if (pdTRUE
-                                    == xQueueReceive (base.sensorOutputQueue,
-                                                      &sensOut, portMAX_DELAY))
+                            sendTraceFrame ();
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "trace get",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printTrace ();
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "capture get",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printCapture ();
+
+                        }
+                    else if (1
+                            == sscanf ((char*) base.auxTab, "capture %hu",
+                                       &tempInt))
+                        {
+                            setCaptureThreshold (tempInt);
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "stats off",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            base.statsWindowMs = 0;
+
+                        }
+                    else if (1
+                            == sscanf ((char*) base.auxTab, "stats %hu",
+                                       &tempInt))
+                        {
+                            setStatsWindow (tempInt);
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "filter get",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printFilter ();
+
+                        }
+                    else if (2
+                            <= sscanf ((char*) base.auxTab, "filter %hu %3s %hu",
+                                       &tempInt, filterName, &tempInt2))
+                        {
+                            setFilterStage (tempInt, filterName, tempInt2);
+                            tempInt2 = 0;
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "event stats",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printEventLatency ();
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "pipeline stats",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printPipeline ();
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "sys boot",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printBootTimes ();
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "clock auto",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            base.clockGovernorEnabled = true;
+                            governClock ();
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "clock get",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printClock ();
+
+                        }
+                    else if (1
+                            == sscanf ((char*) base.auxTab, "clock %hu",
+                                       &tempInt))
+                        {
+                            setClockMhz (tempInt);
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "power stats",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printPowerStats ();
+
+                        }
+                    else if (1
+                            == sscanf ((char*) base.auxTab, "power %5s",
+                                       powerModeName))
+                        {
+                            setPowerMode (powerModeName);
+
+                        }
+                    else if (1
+                            == sscanf ((char*) base.auxTab, "profile save %11s",
+                                       profileName))
+                        {
+                            saveProfile (profileName);
+
+                        }
+                    else if (1
+                            == sscanf ((char*) base.auxTab, "profile load %11s",
+                                       profileName))
+                        {
+                            loadProfile (profileName);
+
+                        }
+                    else if (1
+                            == sscanf ((char*) base.auxTab,
+                                       "profile default %11s", profileName))
+                        {
+                            printProfileStatus (
+                                    profile_setDefault (profileName));
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "profile list",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            printProfiles ();
+
+                        }
+                    else if (0
+                            == strncmp ((char*) base.auxTab, "start",
+                                        CLI_MAX_LINE_LEN))
+                        {
+                            if (capture_isEnabled ())
+                                {
+                                    uint8_t idx;
+                                    enum capture_Trigger trigger;
+                                    uint16_t thresholdMg;
+                                    capture_getSetup (&idx, &trigger,
+                                                      &thresholdMg);
+                                    capture_arm (sensor_getAccRateInt (idx));
+                                    PRINT_TO_CLI("capture armed\n\r");
+                                }
+                            for (uint8_t i = 0;
+                                    i < sensor_getNumOfInstances (); i++)
+                                {
+                                    filter_setRate (&base.filters[i],
+                                                    sensor_getAccRateInt (i));
+                                }
+                            base.filterCyclesMax = 0;
+                            CLI_resetEventLatency ();
+                            pipeline_reset ();
+                            if (base.statsWindowMs != 0)
+                                {
+                                    startStats ();
+                                }
+                            else if (!capture_isEnabled ())
                                 {
-                                    switch (sensOut.type)
-                                        {
-                                        case SENSOR_OUT_ACC_DATA:
-                                            /* Calculate average value and print it to CLI */
-                                            base.accData.xDataBuff[base.accData.head] =
-                                                    sensOut.xyzData.x;
-                                            base.accData.yDataBuff[base.accData.head] =
-                                                    sensOut.xyzData.y;
-                                            base.accData.zDataBuff[base.accData.head] =
-                                                    sensOut.xyzData.z;
-                                            int16_t substrSampleIndex =
-                                                    base.accData.head
-                                                            - base.accData.numOfAveragedSamples;
-                                            if (substrSampleIndex < 0)
-                                                {
-                                                    substrSampleIndex +=
-                                                            ACC_MAX_AVG_NUMBER; // modulo could be used here, but this way it is more effective
-                                                }
-
-                                            base.accData.xNumerator =
-                                                    base.accData.xNumerator
-                                                            + base.accData.xDataBuff[base.accData.head]
-                                                            - base.accData.xDataBuff[substrSampleIndex];
-                                            base.accData.yNumerator =
-                                                    base.accData.yNumerator
-                                                            + base.accData.yDataBuff[base.accData.head]
-                                                            - base.accData.yDataBuff[substrSampleIndex];
-                                            base.accData.zNumerator =
-                                                    base.accData.zNumerator
-                                                            + base.accData.zDataBuff[base.accData.head]
-                                                            - base.accData.zDataBuff[substrSampleIndex];
-
-                                            base.accData.head++;
-                                            if (base.accData.head
-                                                    >= ACC_MAX_AVG_NUMBER)
-                                                {
-                                                    base.accData.head = 0;
-                                                }
-
-                                            /* print new data on CLI */
-                                            if (4
-                                                    <= uxQueueSpacesAvailable (
-                                                            base.cliTxQueue))
-                                                {
-                                                    PRINT_TO_CLI("\r");
-                                                    averagedVal =
-                                                            base.accData.xNumerator
-                                                                    / base.accData.numOfAveragedSamples;
-                                                    PRINT_TO_CLI(
-                                                            FORMAT_ACC_DATA(averagedVal),
-                                                            abs (averagedVal)
-                                                                    / 1000,
-                                                            abs (averagedVal)
-                                                                    % 1000);
-
-                                                    averagedVal =
-                                                            base.accData.yNumerator
-                                                                    / base.accData.numOfAveragedSamples;
-                                                    PRINT_TO_CLI(
-                                                            FORMAT_ACC_DATA(averagedVal),
-                                                            abs (averagedVal)
-                                                                    / 1000,
-                                                            abs (averagedVal)
-                                                                    % 1000);
-
-                                                    averagedVal =
-                                                            base.accData.zNumerator
-                                                                    / base.accData.numOfAveragedSamples;
-                                                    PRINT_TO_CLI(
-                                                            FORMAT_ACC_DATA(averagedVal),
-                                                            abs (averagedVal)
-                                                                    / 1000,
-                                                            abs (averagedVal)
-                                                                    % 1000);
-                                                }
-                                            break;
-                                        case SENSOR_OUT_CLICK_DETECTION:
-                                            /* send notification and time of click detection to CLI */
-                                            if (base.clickDetecionEnabled)
-                                                {
-                                                    HAL_RTC_GetTime (
-                                                            &hrtc, &rtcTime,
-                                                            RTC_FORMAT_BIN);
-                                                    HAL_RTC_GetDate (
-                                                            &hrtc, &rtcDate,
-                                                            RTC_FORMAT_BIN);
-                                                    PRINT_TO_CLI(
-                                                            "   %02d:%02d:%02d\b\b\b\b\b\b\b\b",
-                                                            rtcTime.Hours,
-                                                            rtcTime.Minutes,
-                                                            rtcTime.Seconds);
-                                                }
-                                            break;
-                                        }
+                                    PRINT_TO_CLI("   acc x:    acc y:    acc z:    ");
+                                    PRINT_TO_CLI("last click time: \n\r");
                                 }
+                            sensor_start ();
+                            base.state = SYSTEM_ACC_DATA_PROCESSING;
+                            governClock ();
+
+                        }
+                    else
+                        {
+                            PRINT_COMMAND_NOT_RECOGNISED();
                         }
                     break;
+                case SYSTEM_ACC_DATA_PROCESSING:
+                    /* samples are served by pipeline stages */
+                    executeStreamingCommand ();
+                    break;
                 }
         }
 }
 int
 main ()
 {
+    /* start cycle counter first, boot times are measured from here */
+    systime_init ();
+
     /* initialise hardware */
     HAL_Init ();
     CLK_init ();
+    systime_markBoot (SYSTIME_BOOT_CLOCKS);
 
     /* init global RTOS variables (queues, semaphores) */
     base.cliTxQueue = xQueueCreate(CLI_TX_QUEUE_LEN,
                                    sizeof(uint8_t) * CLI_MAX_LINE_LEN);
     CHECK(base.cliTxQueue);
+    vQueueSetQueueNumber (base.cliTxQueue, TRACE_QUEUE_CLI_TX);
 
     base.cliRxQueue = xQueueCreate(CLI_RX_QUEUE_LEN,
                                    sizeof(uint8_t) * CLI_MAX_LINE_LEN);
     CHECK(base.cliRxQueue);
+    vQueueSetQueueNumber (base.cliRxQueue, TRACE_QUEUE_CLI_RX);
 
     base.sensorOutputQueue = xQueueCreate(SENSOR_OUT_QUEUE_LEN,
                                           sizeof(struct sensor_Output));
     CHECK(base.sensorOutputQueue);
+    vQueueSetQueueNumber (base.sensorOutputQueue, TRACE_QUEUE_SENSOR_OUT);
+
+    base.sensorEventQueue = xQueueCreate(SENSOR_EVENT_QUEUE_LEN,
+                                         sizeof(struct sensor_Output));
+    CHECK(base.sensorEventQueue);
+    vQueueSetQueueNumber (base.sensorEventQueue, TRACE_QUEUE_SENSOR_EVENT);
+
+    base.formatQueue = xQueueCreate(FORMAT_QUEUE_LEN, sizeof(struct StageItem));
+    CHECK(base.formatQueue);
+    vQueueSetQueueNumber (base.formatQueue, TRACE_QUEUE_DSP_OUT);
+
+    /* set holds one handle per queued item, queues are empty when added */
+    base.mainSet = xQueueCreateSet (CLI_RX_QUEUE_LEN + SENSOR_EVENT_QUEUE_LEN);
+    CHECK(base.mainSet);
+    xQueueAddToSet (base.cliRxQueue, base.mainSet);
+    xQueueAddToSet (base.sensorEventQueue, base.mainSet);
+
+    base.frameMutex = xSemaphoreCreateMutex ();
+    CHECK(base.frameMutex);
+    base.dspMutex = xSemaphoreCreateMutex ();
+    CHECK(base.dspMutex);
 
     /* initial app setups */
-    base.accData.numOfAveragedSamples = 1;
+    for (uint8_t i = 0; i < SENSOR_MAX_INSTANCES; i++)
+        {
+            filter_init (&base.filters[i], 0);
+            setFilterAvgNumber (i, 1);
+        }
+    base.selectedSensor = 0;
     base.clickDetecionEnabled = false;
+    base.clockGovernorEnabled = true;
+    base.statsWindowMs = 0;
+
+    /* boot profile overrides defaults */
+    struct sensor_AccConfig bootConfig[SENSOR_MAX_INSTANCES];
+    bool bootProfileLoaded = loadBootProfile (bootConfig);
 
     /* initialise modules and start tasks */
     RTC_init ();
 
     CLI_init (base.cliTxQueue, base.cliRxQueue, &base.huart2);
+    power_init (&base.huart2);
+    clock_init (&base.huart2);
 
-    sensor_init (base.sensorOutputQueue);
+    sensor_init (base.sensorOutputQueue, base.sensorEventQueue,
+                 bootProfileLoaded ? bootConfig : NULL);
 
     if (!(pdTRUE
             == xTaskCreate (main_task, "main task", MAIN_TASK_SACK_SIZE, NULL,
-                            1, NULL)))
+                            MAIN_TASK_PRIORITY, NULL)))
         {
             errorHandler ();
         }
@@ -459,12 +1863,30 @@ main ()
         {
             errorHandler ();
         }
+    if (!(pdTRUE
+            == xTaskCreate (CLI_rxTask, "CLI rx task",
+                            configMINIMAL_STACK_SIZE, NULL, 2, NULL)))
+        {
+            errorHandler ();
+        }
     if (!(pdTRUE
             == xTaskCreate (sensor_task, "sensor task",
                             configMINIMAL_STACK_SIZE, NULL, 3, NULL)))
         {
             errorHandler ();
         }
+    if (!(pdTRUE
+            == xTaskCreate (dsp_task, "dsp task", DSP_TASK_STACK_SIZE, NULL,
+                            DSP_TASK_PRIORITY, NULL)))
+        {
+            errorHandler ();
+        }
+    if (!(pdTRUE
+            == xTaskCreate (format_task, "fmt task", FORMAT_TASK_STACK_SIZE,
+                            NULL, FORMAT_TASK_PRIORITY, NULL)))
+        {
+            errorHandler ();
+        }
 
     /* start scheduler */
     vTaskStartScheduler ();
@@ -515,7 +1937,7 @@ CLK_init (void)
     RCC_ClkInit.AHBCLKDivider = RCC_SYSCLK_DIV1;
     RCC_ClkInit.APB1CLKDivider = RCC_HCLK_DIV1;
     RCC_ClkInit.APB2CLKDivider = RCC_HCLK_DIV1;
-    if (HAL_OK != HAL_RCC_ClockConfig (&RCC_ClkInit, FLASH_LATENCY_2))
+    if (HAL_OK != HAL_RCC_ClockConfig (&RCC_ClkInit, FLASH_LATENCY_0))
         {
             errorHandler ();
         }